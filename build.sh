@@ -60,7 +60,7 @@ for source in "${source_files[@]}"; do
     $CC -c -o "$object" "test/src/$source" $(IFS=$'\n'; echo "${flags[*]}") &
 done
 wait
-$CC -Llib -lnaxa $(IFS=$'\n'; echo "${flags[*]}") -o "test/test" $(IFS=$'\n'; echo "${object_files[*]}")
+$CC -Llib -lnaxa -lm $(IFS=$'\n'; echo "${flags[*]}") -o "test/test" $(IFS=$'\n'; echo "${object_files[*]}")
 
 # Do static analysis after the executable is done
 echo "Build done, doing static analysis"
@@ -0,0 +1,302 @@
+/**
+ * @file anim.h
+ * @author ItsHighNoon
+ * @brief Naxa skeletal animation APIs.
+ * @date 10-18-2026
+ *
+ * @copyright Copyright (c) 2025
+ */
+
+#ifndef __naxa_anim_h__
+#define __naxa_anim_h__
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#include <naxa/struct.h>
+
+/**
+ * @brief Find an animation clip of a model by name.
+ *
+ * @param dest A pointer to a NaxaClip_t* which will hold the clip.
+ * @param model The model the clip was imported with.
+ * @param name The name of the animation in the source file.
+ * @return int32_t NAXA_E_SUCCESS or an error code. On error, dest is set to NULL.
+ *
+ * Clips are imported by naxa_load_model along with the skeleton and live
+ * as long as the model does. They are also listed in model->clips.
+ */
+int32_t naxa_find_clip(NaxaClip_t** dest, NaxaModel_t* model, char* name);
+
+/**
+ * @brief Allocate a pose for the skeleton of a model.
+ *
+ * @param dest The pose to fill in.
+ * @param model The model whose skeleton is posed.
+ * @return int32_t NAXA_E_SUCCESS or an error code.
+ *
+ * The pose starts out as the rest pose of the skeleton.
+ */
+int32_t naxa_init_pose(NaxaPose_t* dest, NaxaModel_t* model);
+
+/**
+ * @brief Free a pose allocated by naxa_init_pose.
+ *
+ * @param pose The pose to free.
+ * @return int32_t NAXA_E_SUCCESS.
+ */
+int32_t naxa_free_pose(NaxaPose_t* pose);
+
+/**
+ * @brief Find a morph target of a model by name.
+ *
+ * @param dest Where to put the index of the morph target.
+ * @param model The model the morph target was imported with.
+ * @param name The name of the morph target in the source file.
+ * @return int32_t NAXA_E_SUCCESS or an error code. On error, dest is set to -1.
+ */
+int32_t naxa_find_morph(int32_t* dest, NaxaModel_t* model, char* name);
+
+/**
+ * @brief Set how far a pose has a morph target applied.
+ *
+ * @param pose The pose to change.
+ * @param morph Index of the morph target in model->morphs.
+ * @param weight 0 for none of the morph, 1 for all of it.
+ * @return int32_t NAXA_E_SUCCESS or an error code.
+ *
+ * Morphs are applied to the bind pose before skinning. Drawing costs
+ * nothing extra while every weight of a pose is 0, and otherwise scales
+ * with how many vertices the model's morph targets move.
+ */
+int32_t naxa_set_morph_weight(NaxaPose_t* pose, int32_t morph, float weight);
+
+/**
+ * @brief Set up a sampler to play a clip.
+ *
+ * @param dest The sampler to fill in.
+ * @param model The model the clip belongs to.
+ * @param clip The clip to play.
+ * @return int32_t NAXA_E_SUCCESS or an error code.
+ */
+int32_t naxa_init_sampler(NaxaAnimSampler_t* dest, NaxaModel_t* model, NaxaClip_t* clip);
+
+/**
+ * @brief Free a sampler set up by naxa_init_sampler.
+ *
+ * @param sampler The sampler to free.
+ * @return int32_t NAXA_E_SUCCESS.
+ */
+int32_t naxa_free_sampler(NaxaAnimSampler_t* sampler);
+
+/**
+ * @brief Evaluate a clip at a point in time.
+ *
+ * @param sampler The sampler playing the clip.
+ * @param time The time in seconds, clips loop so any time is fine.
+ * @param dest A pose of the same model to write the joints to.
+ * @return int32_t NAXA_E_SUCCESS or an error code.
+ *
+ * Keys are interpolated linearly, rotations with a normalized lerp. Moving
+ * forward in time only steps over the keys passed since the previous call,
+ * moving backwards or looping around rescans the tracks from their start.
+ * A sampler shouldn't be shared between threads, one per character.
+ */
+int32_t naxa_sample_clip(NaxaAnimSampler_t* sampler, float time, NaxaPose_t* dest);
+
+/**
+ * @brief Set up an arena for per frame scratch memory.
+ *
+ * @param dest The arena to fill in.
+ * @param bytes How much memory the arena hands out before it runs dry.
+ * @return int32_t NAXA_E_SUCCESS or an error code.
+ *
+ * Blend trees take their temporary poses from an arena. Each one needs a
+ * pose's worth for every blend node on the deepest path of the tree, see
+ * naxa_pose_bytes. Give every thread evaluating trees its own arena.
+ */
+int32_t naxa_init_arena(NaxaArena_t* dest, int64_t bytes);
+
+/**
+ * @brief Give back everything handed out by an arena.
+ *
+ * @param arena The arena to reset.
+ * @return int32_t NAXA_E_SUCCESS or an error code.
+ */
+int32_t naxa_reset_arena(NaxaArena_t* arena);
+
+/**
+ * @brief Free the memory of an arena.
+ *
+ * @param arena The arena to free.
+ * @return int32_t NAXA_E_SUCCESS.
+ */
+int32_t naxa_free_arena(NaxaArena_t* arena);
+
+/**
+ * @brief Get the size of one pose of a model.
+ *
+ * @param model The model whose skeleton is posed.
+ * @return int32_t The number of bytes a pose takes in an arena.
+ */
+int32_t naxa_pose_bytes(NaxaModel_t* model);
+
+#define NAXA_BLEND_CLIP 0
+#define NAXA_BLEND_LERP 1
+#define NAXA_BLEND_ADDITIVE 2
+
+/**
+ * @brief Set up an empty blend tree.
+ *
+ * @param dest The tree to fill in.
+ * @param model The model the tree animates.
+ * @param node_capacity The most nodes the tree will ever have.
+ * @return int32_t NAXA_E_SUCCESS or an error code.
+ */
+int32_t naxa_init_blend_tree(NaxaBlendTree_t* dest, NaxaModel_t* model, int32_t node_capacity);
+
+/**
+ * @brief Free a blend tree and everything its nodes own.
+ *
+ * @param tree The tree to free.
+ * @return int32_t NAXA_E_SUCCESS.
+ */
+int32_t naxa_free_blend_tree(NaxaBlendTree_t* tree);
+
+/**
+ * @brief Add a node playing a clip.
+ *
+ * @param tree The tree to add to.
+ * @param dest Set to the index of the new node.
+ * @param clip The clip to play, it must belong to the tree's model.
+ * @return int32_t NAXA_E_SUCCESS or an error code.
+ *
+ * The clip plays from time 0 at normal speed, see naxa_blend_restart.
+ */
+int32_t naxa_blend_clip(NaxaBlendTree_t* tree, int32_t* dest, NaxaClip_t* clip);
+
+/**
+ * @brief Add a node crossfading between two nodes.
+ *
+ * @param tree The tree to add to.
+ * @param dest Set to the index of the new node.
+ * @param from The node shown at weight 0.
+ * @param to The node shown at weight 1.
+ * @return int32_t NAXA_E_SUCCESS or an error code.
+ *
+ * Weights start at 0. Only the nodes that contribute are evaluated, at
+ * weight 0 the to side costs nothing and at weight 1 without a mask the
+ * from side costs nothing.
+ */
+int32_t naxa_blend_lerp(NaxaBlendTree_t* tree, int32_t* dest, int32_t from, int32_t to);
+
+/**
+ * @brief Add a node layering one node on top of another.
+ *
+ * @param tree The tree to add to.
+ * @param dest Set to the index of the new node.
+ * @param base The node layered onto.
+ * @param additive The node whose difference from the rest pose is added.
+ * @return int32_t NAXA_E_SUCCESS or an error code.
+ *
+ * Weights start at 0, which skips the additive side entirely.
+ */
+int32_t naxa_blend_additive(NaxaBlendTree_t* tree, int32_t* dest, int32_t base, int32_t additive);
+
+/**
+ * @brief Restrict a blend node to a branch of the skeleton.
+ *
+ * @param tree The tree the node is in.
+ * @param node A lerp or additive node.
+ * @param joint_name The joint at the top of the branch.
+ * @return int32_t NAXA_E_SUCCESS or an error code.
+ *
+ * The node only blends the joint and everything below it, the rest of the
+ * skeleton keeps the first child's pose. Calling it again adds another
+ * branch, say both arms.
+ */
+int32_t naxa_blend_mask_branch(NaxaBlendTree_t* tree, int32_t node, char* joint_name);
+
+/**
+ * @brief Fade the weight of a blend node.
+ *
+ * @param tree The tree the node is in.
+ * @param node A lerp or additive node.
+ * @param weight The weight to end up at.
+ * @param seconds How long the fade takes, 0 to jump straight there.
+ * @param now The time evaluations of the tree are made at.
+ * @return int32_t NAXA_E_SUCCESS or an error code.
+ *
+ * The fade starts from wherever the weight is at now, so a fade can be
+ * turned around halfway through without popping.
+ */
+int32_t naxa_blend_fade(NaxaBlendTree_t* tree, int32_t node, float weight, float seconds, float now);
+
+/**
+ * @brief Play the clip of a clip node from its start.
+ *
+ * @param tree The tree the node is in.
+ * @param node A clip node.
+ * @param now The time evaluations of the tree are made at.
+ * @param speed How fast to play, 1 is normal speed.
+ * @return int32_t NAXA_E_SUCCESS or an error code.
+ */
+int32_t naxa_blend_restart(NaxaBlendTree_t* tree, int32_t node, float now, float speed);
+
+/**
+ * @brief Evaluate a blend tree into a pose.
+ *
+ * @param tree The tree to evaluate.
+ * @param root The node whose output is wanted, usually the last one made.
+ * @param now The time in seconds.
+ * @param arena Where temporary poses come from, they are given back before
+ * this returns.
+ * @param dest A pose of the tree's model to write to.
+ * @return int32_t NAXA_E_SUCCESS or an error code. NAXA_E_EXHAUSTED if the
+ * arena is too small.
+ */
+int32_t naxa_evaluate_blend_tree(NaxaBlendTree_t* tree, int32_t root, float now, NaxaArena_t* arena, NaxaPose_t* dest);
+
+/**
+ * @brief Set up animation level of detail for one character.
+ *
+ * @param dest The LOD state to fill in.
+ * @param model The model the character is drawn with.
+ * @return int32_t NAXA_E_SUCCESS or an error code.
+ */
+int32_t naxa_init_anim_lod(NaxaAnimLod_t* dest, NaxaModel_t* model);
+
+/**
+ * @brief Free the poses held by an animation LOD state.
+ *
+ * @param lod The LOD state to free.
+ * @return int32_t NAXA_E_SUCCESS.
+ */
+int32_t naxa_free_anim_lod(NaxaAnimLod_t* lod);
+
+/**
+ * @brief Animate a character at a level of detail fitting its screen size.
+ *
+ * @param lod The character's LOD state.
+ * @param entity The character, its pose is written.
+ * @param now The time in seconds, called once per frame.
+ * @param source Evaluates the character's animation, say a clip or blend
+ * tree, at a given time. It only has to fill in the pose's active joints.
+ * @param user Passed through to source.
+ * @return int32_t NAXA_E_SUCCESS or an error code from source.
+ *
+ * Close up the pose is evaluated every frame. Further out the deepest
+ * joints are left as they are and the pose is only evaluated every 2nd or
+ * 4th frame, a little ahead of time so the frames in between interpolate
+ * towards it. Which frame a character updates on depends on when its LOD
+ * state was made, so a crowd spreads out over frames. Different
+ * characters can be updated from different threads.
+ */
+int32_t naxa_update_anim_lod(NaxaAnimLod_t* lod, NaxaEntity_t* entity, float now, NaxaPoseSource_t source, void* user);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -17,6 +17,12 @@ extern "C" {
 
 #include <naxa/struct.h>
 
+#define NAXA_TEXTURE_RGBA8 0
+#define NAXA_TEXTURE_BC1 1
+#define NAXA_TEXTURE_BC3 2
+#define NAXA_TEXTURE_BC5 3
+#define NAXA_TEXTURE_BC7 4
+
 /**
  * @brief Load a texture at a specified path.
  * 
@@ -26,10 +32,34 @@ extern "C" {
  *
  * If the path specified matches the path of a texture that has already been loaded,
  * the texture will be fetched from memory instead of being loaded from disk
- * and its reference count will be increased.
+ * and its reference count will be increased. KTX2 files produced by
+ * naxa_cook_texture are detected by their contents and uploaded as cooked.
+ * Other images may have 1 to 4 channels, grey is spread over RGB and missing
+ * alpha is opaque. They get a full mip chain filtered in linear light and are
+ * sampled trilinearly with anisotropic filtering. Decoding happens on a background
+ * thread, so the texture is returned right away and reads as white until its
+ * contents arrive a few frames later. Only the small mips are loaded at first,
+ * the rest streams in once the texture is drawn large enough to need them.
+ * Colour is treated as sRGB and converted to linear when sampled, see
+ * naxa_load_linear_texture for normal maps.
  */
 int32_t naxa_load_texture(NaxaTexture_t** dest, char* path);
 
+/**
+ * @brief Load a texture that holds data rather than colour.
+ * 
+ * @param dest A pointer to a NaxaTexture_t* which will hold the texture.
+ * @param path The path on the file system relative to the working directory.
+ * @return int32_t NAXA_E_SUCCESS or an error code. On error, dest is set to NULL.
+ *
+ * Works like naxa_load_texture, except that images which aren't cooked are
+ * filtered and sampled as linear values with no sRGB conversion, the way
+ * naxa_cook_texture treats BC5. Use it for normal maps and masks. Cooked
+ * files keep whatever they were cooked as, and a path that is already
+ * loaded keeps the colour space it was first loaded with.
+ */
+int32_t naxa_load_linear_texture(NaxaTexture_t** dest, char* path);
+
 /**
  * @brief Mark a texture as no longer used.
  * 
@@ -42,6 +72,171 @@ int32_t naxa_load_texture(NaxaTexture_t** dest, char* path);
  */
 int32_t naxa_free_texture(NaxaTexture_t* texture);
 
+/**
+ * @brief Compress an image into a block compressed KTX2 file.
+ * 
+ * @param src_path The path of the source image (anything stb_image reads).
+ * @param dest_path The path the KTX2 file will be written to.
+ * @param format The format to encode. See NAXA_TEXTURE_*.
+ * @return int32_t NAXA_E_SUCCESS or an error code.
+ *
+ * The full mip chain is generated and encoded on the CPU. BC1 keeps 1 bit
+ * alpha, BC3 full alpha, BC5 only the red and green channels (normal maps)
+ * and BC7 full RGBA at the highest quality. RGBA8 stores the chain raw,
+ * which costs VRAM but loads without any image decoding at all. Everything
+ * except BC5 is marked sRGB. Files written here can be passed straight to
+ * naxa_load_texture.
+ */
+int32_t naxa_cook_texture(char* src_path, char* dest_path, int32_t format);
+
+/**
+ * @brief Set how much VRAM streamed textures may use.
+ * 
+ * @param bytes The budget in bytes.
+ * @return int32_t NAXA_E_SUCCESS or an error code.
+ *
+ * Textures always keep their small mips. When the renderer asks for more
+ * detail than fits, the least recently drawn textures lose their top mips
+ * first. Textures on screen are never evicted, so the budget can be exceeded
+ * by a frame that really needs it.
+ */
+int32_t naxa_set_texture_budget(int64_t bytes);
+
+/**
+ * @brief Get texture residency statistics.
+ * 
+ * @param dest The structure to fill in.
+ * @return int32_t NAXA_E_SUCCESS or an error code.
+ *
+ * resident_bytes counts the mips in VRAM, full_bytes what every texture would
+ * take fully resident and pool_bytes what the texture arrays actually
+ * allocated including spare layers.
+ */
+int32_t naxa_get_texture_stats(NaxaTextureStats_t* dest);
+
+/**
+ * @brief Skip entities hidden behind occluders before they are queued.
+ *
+ * @param enabled NAXA_TRUE to test entities against the occluders,
+ * NAXA_FALSE to draw everything inside the frustum.
+ * @return int32_t NAXA_E_SUCCESS.
+ *
+ * Occluders are rasterized into a small depth buffer on the CPU once per
+ * frame, and every entity's bounding box is tested against it. Nothing is
+ * hidden until occluders are added with naxa_add_occluder.
+ */
+int32_t naxa_set_occlusion_culling(int32_t enabled);
+
+/**
+ * @brief Add a mesh that hides whatever is behind it.
+ *
+ * @param positions vertex_count vertex positions in model space.
+ * @param vertex_count How many positions there are.
+ * @param indices Triangle list indices into positions.
+ * @param index_count How many indices there are.
+ * @param transform Model matrix placing the occluder in the world.
+ * @return int32_t NAXA_E_SUCCESS or an error code.
+ *
+ * The mesh is copied. Occluders should be a few large triangles standing
+ * inside solid geometry such as walls and terrain, never bigger than what
+ * they stand for or visible things will be culled. Triangles are drawn
+ * from both sides. Up to 64 occluders can be added.
+ */
+int32_t naxa_add_occluder(vec3* positions, int32_t vertex_count, uint32_t* indices, int32_t index_count, mat4 transform);
+
+/**
+ * @brief Remove every occluder.
+ *
+ * @return int32_t NAXA_E_SUCCESS.
+ */
+int32_t naxa_clear_occluders();
+
+/**
+ * @brief Skin animated models once per frame instead of in every draw.
+ *
+ * @param enabled NAXA_TRUE to skin in a compute shader, NAXA_FALSE to skin
+ * in the vertex shader.
+ * @return int32_t NAXA_E_SUCCESS or an error code.
+ *
+ * Every posed entity gets its own vertex buffer which a compute pass fills
+ * with the skinned positions and normals before anything draws, so extra
+ * passes over the same entity don't skin it again. A pose whose revision
+ * hasn't moved since it was last skinned keeps its vertices and skips
+ * building a palette too, leave paused characters unsampled to get this.
+ * A pose shouldn't be shared between entities of different models.
+ */
+int32_t naxa_set_preskinning(int32_t enabled);
+
+/**
+ * @brief Skin with dual quaternions instead of blending matrices.
+ *
+ * @param enabled NAXA_TRUE for dual quaternions, NAXA_FALSE for matrices.
+ * @return int32_t NAXA_E_SUCCESS or an error code.
+ *
+ * Dual quaternions keep the volume of twisting joints where blending
+ * matrices collapses them, and take half the palette space per bone. They
+ * can't carry scale, so joints that scale come out at their rigid part.
+ */
+int32_t naxa_set_dual_quat_skinning(int32_t enabled);
+
+/**
+ * @brief Bake every clip of a model into vertex animation textures.
+ *
+ * @param dest The NaxaVertexAnimation_t to fill.
+ * @param model An animated model, it has to outlive dest.
+ * @param frame_rate Frames per second of animation to bake.
+ * @return int32_t NAXA_E_SUCCESS or an error code.
+ *
+ * Each frame is skinned once on the CPU and kept as textures, characters
+ * drawn from them need no skeleton, pose or palette at all. The cost is
+ * that they can only play whole clips and never blend them.
+ */
+int32_t naxa_cook_vertex_animation(NaxaVertexAnimation_t* dest, NaxaModel_t* model, float frame_rate);
+
+/**
+ * @brief Free the textures of a baked vertex animation.
+ *
+ * @param animation The NaxaVertexAnimation_t to free.
+ * @return int32_t NAXA_E_SUCCESS.
+ */
+int32_t naxa_free_vertex_animation(NaxaVertexAnimation_t* animation);
+
+/**
+ * @brief Make a crowd of characters playing a baked vertex animation.
+ *
+ * @param dest The NaxaCrowd_t to fill.
+ * @param animation The animation every character plays a clip of.
+ * @param instance_count How many characters there are.
+ * @return int32_t NAXA_E_SUCCESS or an error code.
+ *
+ * Every character starts out at the origin playing the first clip, place
+ * them with naxa_set_crowd_instances.
+ */
+int32_t naxa_init_crowd(NaxaCrowd_t* dest, NaxaVertexAnimation_t* animation, int32_t instance_count);
+
+/**
+ * @brief Free the instances of a crowd.
+ *
+ * @param crowd The NaxaCrowd_t to free.
+ * @return int32_t NAXA_E_SUCCESS.
+ */
+int32_t naxa_free_crowd(NaxaCrowd_t* crowd);
+
+/**
+ * @brief Place characters of a crowd and choose what they play.
+ *
+ * @param crowd The crowd to change.
+ * @param first Index of the first character to set.
+ * @param count How many characters to set.
+ * @param instances count characters to copy in.
+ * @return int32_t NAXA_E_SUCCESS or an error code.
+ *
+ * This is the only per character cost, characters that are left alone
+ * keep animating on the GPU. The crowd's bounds are fitted again over
+ * every character each call, so set many at once rather than one by one.
+ */
+int32_t naxa_set_crowd_instances(NaxaCrowd_t* crowd, int32_t first, int32_t count, NaxaCrowdInstance_t* instances);
+
 /**
  * @brief Load a 3D model at a specified path.
  * 
@@ -15,6 +15,7 @@ extern "C" {
 
 #include <stdint.h>
 
+#include <naxa/anim.h>
 #include <naxa/err.h>
 #include <naxa/gfx.h>
 #include <naxa/log.h>
@@ -32,6 +33,19 @@ extern "C" {
  */
 extern int32_t naxa_init();
 
+/**
+ * @brief Initialize the parts of Naxa that don't need a window.
+ *
+ * @return int32_t NAXA_E_SUCCESS or an error code.
+ *
+ * Logging, the job threads and the CPU side of occlusion culling come up,
+ * and texture pools and streaming keep their bookkeeping without VRAM
+ * behind it. No window or graphics context is made. Meant for checks and benchmarks
+ * on machines without a display, anything that touches the GPU is
+ * unsupported after this. naxa_teardown works the same either way.
+ */
+extern int32_t naxa_init_headless();
+
 /**
  * @brief Pass control to Naxa.
  * 
@@ -17,23 +17,87 @@ extern "C" {
 
 #include <cglm/cglm.h>
 
+#define NAXA_MAX_LODS 4
+#define NAXA_ANIM_LODS 4
+
 /**
  * @brief A texture in VRAM managed by the Naxa loader.
+ *
+ * Textures of the same size and format share a texture array. The texture is
+ * one layer of that pool's array. Only levels from resident_level down are
+ * in VRAM, the streamer moves the texture between pools as that changes.
  */
 typedef struct NaxaTexture {
-    uint32_t texture;
+    int32_t pool;
+    int32_t layer;
+    int32_t width;
+    int32_t height;
+    int32_t level_count;
+    int32_t format;
+    int32_t cooked;
+    int32_t srgb;
+    uint32_t internal_format;
+    int32_t resident_level;
+    int32_t floor_level;
+    int32_t ceiling_level;
+    int32_t requested_level;
+    int32_t streaming;
+    int64_t last_used;
+    int32_t stream_index;
     int32_t refs;
     char* path;
     struct NaxaTexture* next;
 } NaxaTexture_t;
 
 /**
- * @brief An individually renderable portion of a NaxaModel_t.
+ * @brief Texture streaming residency, see naxa_get_texture_stats.
+ */
+typedef struct {
+    int64_t budget_bytes;
+    int64_t resident_bytes;
+    int64_t full_bytes;
+    int64_t pool_bytes;
+    int64_t promotions;
+    int64_t evictions;
+    int32_t texture_count;
+    int32_t full_resolution_count;
+    int32_t streaming_count;
+} NaxaTextureStats_t;
+
+/**
+ * @brief Model space bounding volumes computed by the Naxa loader.
+ *
+ * The sphere is centered on the box and is tight to the vertices rather
+ * than to the corners of the box.
+ */
+typedef struct {
+    vec3 min;
+    vec3 max;
+    vec3 center;
+    float radius;
+} NaxaBounds_t;
+
+/**
+ * @brief One level of detail of a NaxaSubmodel_t.
+ *
+ * All levels share the vertices of the model and differ only in which
+ * indices they draw. The error is the approximate distance, in model
+ * space, that the simplified surface strays from the full detail one.
  */
 typedef struct {
     int32_t vertex_count;
     int32_t offset;
+    float error;
+} NaxaLod_t;
+
+/**
+ * @brief An individually renderable portion of a NaxaModel_t.
+ */
+typedef struct {
+    int32_t lod_count;
+    NaxaLod_t lods[NAXA_MAX_LODS];
     NaxaTexture_t* diffuse;
+    NaxaBounds_t bounds;
 } NaxaSubmodel_t;
 
 /**
@@ -45,6 +109,105 @@ typedef struct {
     mat4 matrix;
 } NaxaBone_t;
 
+/**
+ * @brief A morph target (blend shape) of a NaxaModel_t.
+ *
+ * Only the vertices the target actually moves are kept, delta_count of
+ * them. Targets of the same name in different meshes are one morph.
+ */
+typedef struct {
+    char* name;
+    int32_t delta_count;
+} NaxaMorph_t;
+
+/**
+ * @brief The node hierarchy a NaxaModel_t is animated through.
+ *
+ * Joints are sorted so that every parent comes before its children, a pose
+ * can be resolved in one pass front to back. Joints that deform nothing are
+ * kept because they still carry the joints below them. Joints without an
+ * animation track hold their rest transform. bone_joints maps every
+ * NaxaBone_t to the joint that moves it, or -1 if no node has its name.
+ * Joints are also sorted by how far out they stay animated, animation LOD
+ * l only evaluates the first lod_joint_counts[l] of them and the rest
+ * follow their parents in rest_locals, the rest transforms as matrices.
+ */
+typedef struct {
+    int32_t joint_count;
+    int32_t lod_joint_counts[NAXA_ANIM_LODS];
+    char** names;
+    int32_t* parents;
+    vec3* rest_translations;
+    versor* rest_rotations;
+    vec3* rest_scales;
+    mat4* rest_locals;
+    int32_t* bone_joints;
+    mat4 inverse_root;
+} NaxaSkeleton_t;
+
+/**
+ * @brief Keyframes of one vector property for every joint of a clip.
+ *
+ * Keys of joint j are [starts[j], starts[j + 1]), joints the clip leaves
+ * alone get their rest value as a single key. Values are stored as one
+ * plane per component, component c of key k is values[c * key_count + k].
+ */
+typedef struct {
+    int32_t key_count;
+    int32_t* starts;
+    float* times;
+    float* values;
+} NaxaVec3Track_t;
+
+/**
+ * @brief Keyframes of the joint rotations of a clip.
+ *
+ * Laid out like NaxaVec3Track_t with x, y, z and w planes quantized to
+ * signed 16 bit. Consecutive keys of a joint are in the same hemisphere so
+ * they can be blended without a sign check.
+ */
+typedef struct {
+    int32_t key_count;
+    int32_t* starts;
+    float* times;
+    int16_t* values;
+} NaxaQuatTrack_t;
+
+/**
+ * @brief An animation of a NaxaSkeleton_t, times are in seconds.
+ */
+typedef struct {
+    char* name;
+    float duration;
+    NaxaVec3Track_t translations;
+    NaxaQuatTrack_t rotations;
+    NaxaVec3Track_t scales;
+} NaxaClip_t;
+
+/**
+ * @brief Local joint transforms of a NaxaSkeleton_t.
+ *
+ * Same planar layout as the tracks, component c of joint j is at
+ * c * stride + j. The stride is padded so every plane stays aligned.
+ * The revision goes up every time a clip, blend tree or morph weight
+ * writes the pose, the renderer keeps the pre-skinned vertices of a pose
+ * in skin_slot. Only the first active_joint_count joints are written, the
+ * rest keep what they had and are skinned in their rest transform. It is
+ * all of them unless animation LOD cuts it down. Every morph target of the model has a weight, 0 until it is set.
+ */
+typedef struct {
+    int32_t joint_count;
+    int32_t active_joint_count;
+    int32_t stride;
+    float* translations;
+    float* rotations;
+    float* scales;
+    uint32_t revision;
+    int32_t skin_slot;
+    int32_t morph_count;
+    float* morph_weights;
+} NaxaPose_t;
+
 /**
  * @brief A vertex buffer in VRAM managed by the Naxa loader.
  */
@@ -56,19 +219,167 @@ typedef struct NaxaModel {
     NaxaSubmodel_t* submodels;
     int32_t bone_count;
     NaxaBone_t* bones;
+    NaxaBounds_t bounds;
     int32_t refs;
     char* path;
-    struct NaxaModel* next;    
-    // skeleton_t
+    struct NaxaModel* next;
+    int32_t vertex_count;
+    NaxaSkeleton_t skeleton;
+    int32_t clip_count;
+    NaxaClip_t* clips;
+    int32_t morph_count;
+    NaxaMorph_t* morphs;
+    uint32_t morph_start_ssbo;
+    uint32_t morph_delta_ssbo;
 } NaxaModel_t;
 
+/**
+ * @brief Plays a NaxaClip_t back into a NaxaPose_t.
+ *
+ * Every track remembers the key it was last between, so sampling forward
+ * in time only ever steps over the keys that passed since the last call.
+ */
+typedef struct {
+    NaxaModel_t* model;
+    NaxaClip_t* clip;
+    float time;
+    int32_t* cursors;
+} NaxaAnimSampler_t;
+
+/**
+ * @brief One node of a NaxaBlendTree_t, see naxa_blend_clip and friends.
+ *
+ * The weight fades linearly from weight_from to weight_to over
+ * fade_duration seconds from fade_start. A mask scales the weight per
+ * joint, joints outside of it keep the first child's pose.
+ */
+typedef struct {
+    int32_t type;
+    int32_t children[2];
+    float weight_from;
+    float weight_to;
+    float fade_start;
+    float fade_duration;
+    float start;
+    float speed;
+    float* mask;
+    NaxaAnimSampler_t sampler;
+} NaxaBlendNode_t;
+
+/**
+ * @brief Clips combined through crossfades and additive layers.
+ *
+ * Nodes are made up front and only refer to nodes made before them.
+ * Evaluating never allocates, so a tree per character can be evaluated on
+ * any thread as long as no two threads share a tree or an arena.
+ */
+typedef struct {
+    NaxaModel_t* model;
+    NaxaPose_t rest;
+    int32_t node_count;
+    int32_t node_size;
+    NaxaBlendNode_t* nodes;
+} NaxaBlendTree_t;
+
+/**
+ * @brief Scratch memory handed out front to back and dropped all at once.
+ */
+typedef struct {
+    uint8_t* memory;
+    int64_t size;
+    int64_t used;
+} NaxaArena_t;
+
+/**
+ * @brief Fills in a pose for some point in time, see naxa_update_anim_lod.
+ */
+typedef int32_t (*NaxaPoseSource_t)(void* user, float time, NaxaPose_t* dest);
+
+/**
+ * @brief Animation level of detail of one character.
+ *
+ * Coarser levels evaluate fewer joints and update every few frames. Each
+ * update samples the pose one update ahead into to, the frames in between
+ * are interpolated from the previous update. phase staggers the updates of
+ * a crowd so they don't all land on the same frame.
+ */
+typedef struct {
+    NaxaModel_t* model;
+    int32_t level;
+    int32_t phase;
+    int32_t period;
+    int32_t frames_since_update;
+    int64_t frame;
+    int32_t primed;
+    float last_now;
+    float frame_time;
+    NaxaPose_t from;
+    NaxaPose_t to;
+} NaxaAnimLod_t;
+
+/**
+ * @brief Every clip of a NaxaModel_t baked into vertex textures.
+ *
+ * A frame is the skinned position and normal of every vertex, wrapped into
+ * rows_per_frame rows of width texels. Clip c is clip_frame_counts[c]
+ * frames from frame clip_first_frames[c], spread evenly over the clip so
+ * its last frame loops back into its first. The bounds cover every frame.
+ */
+typedef struct {
+    NaxaModel_t* model;
+    int32_t width;
+    int32_t rows_per_frame;
+    int32_t frame_count;
+    int32_t clip_count;
+    int32_t* clip_first_frames;
+    int32_t* clip_frame_counts;
+    uint32_t position_texture;
+    uint32_t normal_texture;
+    NaxaBounds_t bounds;
+} NaxaVertexAnimation_t;
+
+/**
+ * @brief One character of a NaxaCrowd_t.
+ *
+ * The clip plays from time_offset seconds in at speed times its normal
+ * rate, looping forever.
+ */
+typedef struct {
+    vec3 position;
+    vec4 rotation_quat;
+    int32_t clip;
+    float time_offset;
+    float speed;
+} NaxaCrowdInstance_t;
+
+/**
+ * @brief Characters drawn from a NaxaVertexAnimation_t in one instanced draw.
+ *
+ * Instances live on the GPU and are only touched when set, instances that
+ * were never set stand at the origin. The bounds cover where every instance
+ * is right now, and the whole crowd is culled and given a mesh LOD as one.
+ */
+typedef struct {
+    NaxaVertexAnimation_t* animation;
+    int32_t instance_count;
+    uint32_t instance_ssbo;
+    vec3* positions;
+    NaxaBounds_t bounds;
+    int32_t lod;
+} NaxaCrowd_t;
+
 /**
  * @brief An object that exists in the game world.
+ *
+ * Skinned models are drawn in the pose given, or in their bind pose when
+ * it is NULL.
  */
 typedef struct {
     vec3 position;
     vec4 rotation_quat;
     NaxaModel_t* model;
+    NaxaPose_t* pose;
+    int32_t lod;
 } NaxaEntity_t;
 
 #ifdef __cplusplus
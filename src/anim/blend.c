@@ -0,0 +1,357 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include <naxa/anim.h>
+#include <naxa/err.h>
+#include <naxa/lanes.h>
+#include <naxa/log.h>
+#include <naxa/naxa_internal.h>
+
+static int32_t add_node(NaxaBlendTree_t* tree, int32_t* dest, int32_t type) {
+    if (tree == NULL || dest == NULL) {
+        report_error(NAXA_E_NULLPTR);
+        return NAXA_E_NULLPTR;
+    }
+    if (tree->node_count >= tree->node_size) {
+        report_error(NAXA_E_EXHAUSTED);
+        return NAXA_E_EXHAUSTED;
+    }
+    NaxaBlendNode_t* node = &tree->nodes[tree->node_count];
+    memset(node, 0, sizeof(NaxaBlendNode_t));
+    node->type = type;
+    node->children[0] = -1;
+    node->children[1] = -1;
+    node->speed = 1.0f;
+    *dest = tree->node_count++;
+    return NAXA_E_SUCCESS;
+}
+
+// Children have to exist already, which also keeps the graph acyclic
+static int32_t add_blend_node(NaxaBlendTree_t* tree, int32_t* dest, int32_t type, int32_t first, int32_t second) {
+    if (tree != NULL && (first < 0 || first >= tree->node_count || second < 0 || second >= tree->node_count)) {
+        report_error(NAXA_E_BOUNDS);
+        return NAXA_E_BOUNDS;
+    }
+    int32_t rc = add_node(tree, dest, type);
+    if (rc != NAXA_E_SUCCESS) {
+        return rc;
+    }
+    tree->nodes[*dest].children[0] = first;
+    tree->nodes[*dest].children[1] = second;
+    return NAXA_E_SUCCESS;
+}
+
+static NaxaBlendNode_t* find_node(NaxaBlendTree_t* tree, int32_t node, int32_t blend_only) {
+    if (tree == NULL || node < 0 || node >= tree->node_count) {
+        return NULL;
+    }
+    if (blend_only && tree->nodes[node].type == NAXA_BLEND_CLIP) {
+        return NULL;
+    }
+    return &tree->nodes[node];
+}
+
+static float node_weight(NaxaBlendNode_t* node, float now) {
+    if (node->fade_duration <= 0.0f || now >= node->fade_start + node->fade_duration) {
+        return node->weight_to;
+    }
+    if (now <= node->fade_start) {
+        return node->weight_from;
+    }
+    float t = (now - node->fade_start) / node->fade_duration;
+    return node->weight_from + (node->weight_to - node->weight_from) * t;
+}
+
+// Per joint weight of a node, the mask scales a single weight
+static Lane_t lane_weight(float* mask, int32_t joint, Lane_t weight) {
+    return mask == NULL ? weight : lane_mul(weight, lane_load(&mask[joint]));
+}
+
+static void lerp_planes(float* dest, float* other, int32_t planes, int32_t stride, int32_t count, float* mask, float weight) {
+    Lane_t w = lane_set1(weight);
+    for (int32_t joint = 0; joint < count; joint += LANES) {
+        Lane_t t = lane_weight(mask, joint, w);
+        for (int32_t c = 0; c < planes; c++) {
+            Lane_t a = lane_load(&dest[c * stride + joint]);
+            Lane_t b = lane_load(&other[c * stride + joint]);
+            lane_store(&dest[c * stride + joint], lane_add(a, lane_mul(lane_sub(b, a), t)));
+        }
+    }
+}
+
+// dest = dest towards other by weight. Rotations take the short way round.
+void anim_blend_lerp(NaxaPose_t* dest, NaxaPose_t* other, float* mask, float weight) {
+    int32_t stride = dest->stride;
+    int32_t count = dest->active_joint_count;
+    lerp_planes(dest->translations, other->translations, 3, stride, count, mask, weight);
+    lerp_planes(dest->scales, other->scales, 3, stride, count, mask, weight);
+
+    float* a = dest->rotations;
+    float* b = other->rotations;
+    Lane_t w = lane_set1(weight);
+    for (int32_t joint = 0; joint < count; joint += LANES) {
+        Lane_t t = lane_weight(mask, joint, w);
+        Lane_t ax = lane_load(&a[joint]);
+        Lane_t ay = lane_load(&a[stride + joint]);
+        Lane_t az = lane_load(&a[2 * stride + joint]);
+        Lane_t aw = lane_load(&a[3 * stride + joint]);
+        Lane_t bx = lane_load(&b[joint]);
+        Lane_t by = lane_load(&b[stride + joint]);
+        Lane_t bz = lane_load(&b[2 * stride + joint]);
+        Lane_t bw = lane_load(&b[3 * stride + joint]);
+        Lane_t dot = lane_add(lane_add(lane_mul(ax, bx), lane_mul(ay, by)), lane_add(lane_mul(az, bz), lane_mul(aw, bw)));
+        bx = lane_flip_sign(bx, dot);
+        by = lane_flip_sign(by, dot);
+        bz = lane_flip_sign(bz, dot);
+        bw = lane_flip_sign(bw, dot);
+        Lane_t x = lane_add(ax, lane_mul(lane_sub(bx, ax), t));
+        Lane_t y = lane_add(ay, lane_mul(lane_sub(by, ay), t));
+        Lane_t z = lane_add(az, lane_mul(lane_sub(bz, az), t));
+        Lane_t qw = lane_add(aw, lane_mul(lane_sub(bw, aw), t));
+        Lane_t inverse = lane_inverse_length(lane_add(lane_add(lane_mul(x, x), lane_mul(y, y)), lane_add(lane_mul(z, z), lane_mul(qw, qw))));
+        lane_store(&a[joint], lane_mul(x, inverse));
+        lane_store(&a[stride + joint], lane_mul(y, inverse));
+        lane_store(&a[2 * stride + joint], lane_mul(z, inverse));
+        lane_store(&a[3 * stride + joint], lane_mul(qw, inverse));
+    }
+}
+
+// dest = dest plus weight times how far layer is from the rest pose.
+// Translations add, scales multiply and rotations compose.
+static void blend_additive(NaxaPose_t* dest, NaxaPose_t* layer, NaxaPose_t* rest, float* mask, float weight) {
+    int32_t stride = dest->stride;
+    Lane_t w = lane_set1(weight);
+    Lane_t one = lane_set1(1.0f);
+    for (int32_t joint = 0; joint < dest->active_joint_count; joint += LANES) {
+        Lane_t t = lane_weight(mask, joint, w);
+        for (int32_t c = 0; c < 3; c++) {
+            int32_t i = c * stride + joint;
+            Lane_t offset = lane_sub(lane_load(&layer->translations[i]), lane_load(&rest->translations[i]));
+            lane_store(&dest->translations[i], lane_add(lane_load(&dest->translations[i]), lane_mul(offset, t)));
+            Lane_t ratio = lane_div(lane_load(&layer->scales[i]), lane_load(&rest->scales[i]));
+            Lane_t factor = lane_add(one, lane_mul(lane_sub(ratio, one), t));
+            lane_store(&dest->scales[i], lane_mul(lane_load(&dest->scales[i]), factor));
+        }
+
+        // delta = conjugate(rest) * layer
+        float* r = rest->rotations;
+        float* l = layer->rotations;
+        Lane_t rx = lane_sub(lane_set1(0.0f), lane_load(&r[joint]));
+        Lane_t ry = lane_sub(lane_set1(0.0f), lane_load(&r[stride + joint]));
+        Lane_t rz = lane_sub(lane_set1(0.0f), lane_load(&r[2 * stride + joint]));
+        Lane_t rw = lane_load(&r[3 * stride + joint]);
+        Lane_t lx = lane_load(&l[joint]);
+        Lane_t ly = lane_load(&l[stride + joint]);
+        Lane_t lz = lane_load(&l[2 * stride + joint]);
+        Lane_t lw = lane_load(&l[3 * stride + joint]);
+        Lane_t dx = lane_add(lane_sub(lane_add(lane_mul(rw, lx), lane_mul(rx, lw)), lane_mul(rz, ly)), lane_mul(ry, lz));
+        Lane_t dy = lane_add(lane_sub(lane_add(lane_mul(rw, ly), lane_mul(ry, lw)), lane_mul(rx, lz)), lane_mul(rz, lx));
+        Lane_t dz = lane_add(lane_sub(lane_add(lane_mul(rw, lz), lane_mul(rz, lw)), lane_mul(ry, lx)), lane_mul(rx, ly));
+        Lane_t dw = lane_sub(lane_sub(lane_mul(rw, lw), lane_mul(rx, lx)), lane_add(lane_mul(ry, ly), lane_mul(rz, lz)));
+
+        // Scale the delta by nlerping from identity, short way round
+        dx = lane_mul(lane_flip_sign(dx, dw), t);
+        dy = lane_mul(lane_flip_sign(dy, dw), t);
+        dz = lane_mul(lane_flip_sign(dz, dw), t);
+        dw = lane_add(one, lane_mul(lane_sub(lane_flip_sign(dw, dw), one), t));
+        Lane_t inverse = lane_inverse_length(lane_add(lane_add(lane_mul(dx, dx), lane_mul(dy, dy)), lane_add(lane_mul(dz, dz), lane_mul(dw, dw))));
+        dx = lane_mul(dx, inverse);
+        dy = lane_mul(dy, inverse);
+        dz = lane_mul(dz, inverse);
+        dw = lane_mul(dw, inverse);
+
+        // dest = dest * delta
+        float* b = dest->rotations;
+        Lane_t bx = lane_load(&b[joint]);
+        Lane_t by = lane_load(&b[stride + joint]);
+        Lane_t bz = lane_load(&b[2 * stride + joint]);
+        Lane_t bw = lane_load(&b[3 * stride + joint]);
+        lane_store(&b[joint], lane_add(lane_sub(lane_add(lane_mul(bw, dx), lane_mul(bx, dw)), lane_mul(bz, dy)), lane_mul(by, dz)));
+        lane_store(&b[stride + joint], lane_add(lane_sub(lane_add(lane_mul(bw, dy), lane_mul(by, dw)), lane_mul(bx, dz)), lane_mul(bz, dx)));
+        lane_store(&b[2 * stride + joint], lane_add(lane_sub(lane_add(lane_mul(bw, dz), lane_mul(bz, dw)), lane_mul(by, dx)), lane_mul(bx, dy)));
+        lane_store(&b[3 * stride + joint], lane_sub(lane_sub(lane_mul(bw, dw), lane_mul(bx, dx)), lane_add(lane_mul(by, dy), lane_mul(bz, dz))));
+    }
+}
+
+// Temporary poses come off the arena and go back as soon as they are
+// blended in, so the arena only ever holds one per level of nesting
+static int32_t evaluate_node(NaxaBlendTree_t* tree, int32_t index, float now, NaxaArena_t* arena, NaxaPose_t* dest) {
+    NaxaBlendNode_t* node = &tree->nodes[index];
+    if (node->type == NAXA_BLEND_CLIP) {
+        return naxa_sample_clip(&node->sampler, (now - node->start) * node->speed, dest);
+    }
+
+    // Nodes that can't be seen aren't evaluated at all
+    float weight = node_weight(node, now);
+    if (weight <= 0.0f) {
+        return evaluate_node(tree, node->children[0], now, arena, dest);
+    }
+    if (node->type == NAXA_BLEND_LERP && weight >= 1.0f && node->mask == NULL) {
+        return evaluate_node(tree, node->children[1], now, arena, dest);
+    }
+
+    int32_t rc = evaluate_node(tree, node->children[0], now, arena, dest);
+    if (rc != NAXA_E_SUCCESS) {
+        return rc;
+    }
+    int64_t mark = arena->used;
+    float* planes = arena_alloc(arena, anim_pose_bytes(dest->joint_count), NAXA_POSE_ALIGNMENT);
+    if (planes == NULL) {
+        report_error(NAXA_E_EXHAUSTED);
+        return NAXA_E_EXHAUSTED;
+    }
+    NaxaPose_t other;
+    anim_pose_bind(&other, planes, dest->joint_count);
+    other.active_joint_count = dest->active_joint_count;
+    rc = evaluate_node(tree, node->children[1], now, arena, &other);
+    if (rc == NAXA_E_SUCCESS) {
+        if (node->type == NAXA_BLEND_LERP) {
+            anim_blend_lerp(dest, &other, node->mask, weight);
+        } else {
+            blend_additive(dest, &other, &tree->rest, node->mask, weight);
+        }
+    }
+    arena->used = mark;
+    return rc;
+}
+
+int32_t naxa_pose_bytes(NaxaModel_t* model) {
+    if (model == NULL) {
+        report_error(NAXA_E_NULLPTR);
+        return 0;
+    }
+    return anim_pose_bytes(model->skeleton.joint_count) + NAXA_POSE_ALIGNMENT;
+}
+
+int32_t naxa_init_blend_tree(NaxaBlendTree_t* dest, NaxaModel_t* model, int32_t node_capacity) {
+    if (dest == NULL || model == NULL) {
+        report_error(NAXA_E_NULLPTR);
+        return NAXA_E_NULLPTR;
+    }
+    if (node_capacity <= 0) {
+        report_error(NAXA_E_BOUNDS);
+        return NAXA_E_BOUNDS;
+    }
+    int32_t rc = naxa_init_pose(&dest->rest, model);
+    if (rc != NAXA_E_SUCCESS) {
+        return rc;
+    }
+    dest->model = model;
+    dest->node_count = 0;
+    dest->node_size = node_capacity;
+    dest->nodes = malloc(node_capacity * sizeof(NaxaBlendNode_t));
+    return NAXA_E_SUCCESS;
+}
+
+int32_t naxa_free_blend_tree(NaxaBlendTree_t* tree) {
+    if (tree == NULL) {
+        return NAXA_E_SUCCESS;
+    }
+    for (int32_t i = 0; i < tree->node_count; i++) {
+        if (tree->nodes[i].type == NAXA_BLEND_CLIP) {
+            naxa_free_sampler(&tree->nodes[i].sampler);
+        }
+        free(tree->nodes[i].mask);
+    }
+    free(tree->nodes);
+    naxa_free_pose(&tree->rest);
+    memset(tree, 0, sizeof(NaxaBlendTree_t));
+    return NAXA_E_SUCCESS;
+}
+
+int32_t naxa_blend_clip(NaxaBlendTree_t* tree, int32_t* dest, NaxaClip_t* clip) {
+    if (clip == NULL) {
+        report_error(NAXA_E_NULLPTR);
+        return NAXA_E_NULLPTR;
+    }
+    int32_t rc = add_node(tree, dest, NAXA_BLEND_CLIP);
+    if (rc != NAXA_E_SUCCESS) {
+        return rc;
+    }
+    return naxa_init_sampler(&tree->nodes[*dest].sampler, tree->model, clip);
+}
+
+int32_t naxa_blend_lerp(NaxaBlendTree_t* tree, int32_t* dest, int32_t from, int32_t to) {
+    return add_blend_node(tree, dest, NAXA_BLEND_LERP, from, to);
+}
+
+int32_t naxa_blend_additive(NaxaBlendTree_t* tree, int32_t* dest, int32_t base, int32_t additive) {
+    return add_blend_node(tree, dest, NAXA_BLEND_ADDITIVE, base, additive);
+}
+
+int32_t naxa_blend_mask_branch(NaxaBlendTree_t* tree, int32_t node, char* joint_name) {
+    NaxaBlendNode_t* blend = find_node(tree, node, NAXA_TRUE);
+    if (blend == NULL || joint_name == NULL) {
+        report_error(NAXA_E_BOUNDS);
+        return NAXA_E_BOUNDS;
+    }
+    NaxaSkeleton_t* skeleton = &tree->model->skeleton;
+    int32_t top = -1;
+    for (int32_t joint = 0; joint < skeleton->joint_count; joint++) {
+        if (strcmp(skeleton->names[joint], joint_name) == 0) {
+            top = joint;
+            break;
+        }
+    }
+    if (top < 0) {
+        report_error(NAXA_E_BOUNDS);
+        return NAXA_E_BOUNDS;
+    }
+
+    // Padded like a pose plane so it loads a vector at a time
+    if (blend->mask == NULL) {
+        int32_t bytes = anim_pose_bytes(skeleton->joint_count) / NAXA_POSE_PLANES;
+        blend->mask = aligned_alloc(NAXA_POSE_ALIGNMENT, bytes);
+        memset(blend->mask, 0, bytes);
+    }
+
+    // Descendants come after their parents, one pass finds the branch
+    blend->mask[top] = 1.0f;
+    for (int32_t joint = top + 1; joint < skeleton->joint_count; joint++) {
+        int32_t parent = skeleton->parents[joint];
+        if (parent >= top && blend->mask[parent] > 0.0f) {
+            blend->mask[joint] = 1.0f;
+        }
+    }
+    return NAXA_E_SUCCESS;
+}
+
+int32_t naxa_blend_fade(NaxaBlendTree_t* tree, int32_t node, float weight, float seconds, float now) {
+    NaxaBlendNode_t* blend = find_node(tree, node, NAXA_TRUE);
+    if (blend == NULL) {
+        report_error(NAXA_E_BOUNDS);
+        return NAXA_E_BOUNDS;
+    }
+    blend->weight_from = node_weight(blend, now);
+    blend->weight_to = weight;
+    blend->fade_start = now;
+    blend->fade_duration = seconds;
+    return NAXA_E_SUCCESS;
+}
+
+int32_t naxa_blend_restart(NaxaBlendTree_t* tree, int32_t node, float now, float speed) {
+    NaxaBlendNode_t* clip = find_node(tree, node, NAXA_FALSE);
+    if (clip == NULL || clip->type != NAXA_BLEND_CLIP) {
+        report_error(NAXA_E_BOUNDS);
+        return NAXA_E_BOUNDS;
+    }
+    clip->start = now;
+    clip->speed = speed;
+    return NAXA_E_SUCCESS;
+}
+
+int32_t naxa_evaluate_blend_tree(NaxaBlendTree_t* tree, int32_t root, float now, NaxaArena_t* arena, NaxaPose_t* dest) {
+    if (tree == NULL || arena == NULL || dest == NULL) {
+        report_error(NAXA_E_NULLPTR);
+        return NAXA_E_NULLPTR;
+    }
+    if (root < 0 || root >= tree->node_count || dest->joint_count != tree->model->skeleton.joint_count) {
+        report_error(NAXA_E_BOUNDS);
+        return NAXA_E_BOUNDS;
+    }
+    int32_t rc = evaluate_node(tree, root, now, arena, dest);
+    if (rc == NAXA_E_SUCCESS) {
+        dest->revision++;
+    }
+    return rc;
+}
@@ -0,0 +1,406 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <assimp/scene.h>
+#include <assimp/types.h>
+
+#include <naxa/err.h>
+#include <naxa/log.h>
+#include <naxa/naxa_internal.h>
+
+// Files that don't say how fast they tick are usually at 25
+#define DEFAULT_TICKS_PER_SECOND 25.0
+#define CONSTANT_EPSILON 1e-5f
+#define QUAT_QUANTIZE 32767.0f
+#define LOD_BLOCK NAXA_POSE_STRIDE_MULTIPLE
+
+// Joints the clip doesn't animate get their rest value as a single key, so
+// the sampler never has to check for an empty track
+typedef struct {
+    int32_t len;
+    struct aiVectorKey* vectors;
+    struct aiQuatKey* quats;
+    float rest[4];
+} KeySource_t;
+
+static char* copy_ai_string(struct aiString* string) {
+    char* copy = malloc(string->length + 1);
+    memcpy(copy, string->data, string->length);
+    copy[string->length] = '\0';
+    return copy;
+}
+
+static int32_t count_nodes(struct aiNode* node) {
+    int32_t count = 1;
+    for (int32_t i = 0; i < node->mNumChildren; i++) {
+        count += count_nodes(node->mChildren[i]);
+    }
+    return count;
+}
+
+// Depth first puts every parent before its children
+static void add_joints(NaxaSkeleton_t* skeleton, struct aiNode* node, int32_t parent) {
+    int32_t joint = skeleton->joint_count++;
+    skeleton->names[joint] = copy_ai_string(&node->mName);
+    skeleton->parents[joint] = parent;
+
+    mat4 local;
+    anim_ai_matrix(local, &node->mTransformation);
+    vec4 translation;
+    mat4 rotation;
+    glm_decompose(local, translation, rotation, skeleton->rest_scales[joint]);
+    glm_vec3_copy(translation, skeleton->rest_translations[joint]);
+    glm_mat4_quat(rotation, skeleton->rest_rotations[joint]);
+
+    for (int32_t i = 0; i < node->mNumChildren; i++) {
+        add_joints(skeleton, node->mChildren[i], joint);
+    }
+}
+
+// Coarser animation LODs drop the deepest deforming joints first and
+// joints that deform nothing right away. A joint stays as long as any
+// joint below it does, so sorting by level keeps parents in front of their
+// children and every level is a prefix of the joints. Levels are rounded
+// up to whole blocks since a block costs the same however full it is.
+static void sort_joints_by_lod(NaxaSkeleton_t* skeleton, NaxaModel_t* model) {
+    int32_t joint_count = skeleton->joint_count;
+    int32_t* depths = malloc(joint_count * sizeof(int32_t));
+    int32_t* levels = malloc(joint_count * sizeof(int32_t));
+    int32_t min_depth = joint_count;
+    int32_t max_depth = 0;
+    for (int32_t joint = 0; joint < joint_count; joint++) {
+        int32_t parent = skeleton->parents[joint];
+        depths[joint] = parent < 0 ? 0 : depths[parent] + 1;
+        levels[joint] = -1;
+        for (int32_t i = 0; i < model->bone_count; i++) {
+            if (strcmp(skeleton->names[joint], model->bones[i].name) == 0) {
+                levels[joint] = NAXA_ANIM_LODS - 1;
+                min_depth = depths[joint] < min_depth ? depths[joint] : min_depth;
+                max_depth = depths[joint] > max_depth ? depths[joint] : max_depth;
+                break;
+            }
+        }
+    }
+    int32_t depth_range = max_depth - min_depth;
+    for (int32_t joint = 0; joint < joint_count; joint++) {
+        if (levels[joint] < 0) {
+            levels[joint] = 0;
+            continue;
+        }
+        int32_t depth = depths[joint] - min_depth;
+        while (levels[joint] > 0 && depth * NAXA_ANIM_LODS > depth_range * (NAXA_ANIM_LODS - levels[joint])) {
+            levels[joint]--;
+        }
+    }
+    for (int32_t joint = joint_count - 1; joint >= 0; joint--) {
+        int32_t parent = skeleton->parents[joint];
+        if (parent >= 0 && levels[parent] < levels[joint]) {
+            levels[parent] = levels[joint];
+        }
+    }
+
+    // Stable by level, old_joints[new] is where each joint came from
+    int32_t* old_joints = malloc(joint_count * sizeof(int32_t));
+    int32_t* new_joints = malloc(joint_count * sizeof(int32_t));
+    int32_t sorted = 0;
+    for (int32_t level = NAXA_ANIM_LODS - 1; level >= 0; level--) {
+        for (int32_t joint = 0; joint < joint_count; joint++) {
+            if (levels[joint] == level) {
+                new_joints[joint] = sorted;
+                old_joints[sorted++] = joint;
+            }
+        }
+        int32_t count = sorted > 0 ? (sorted + LOD_BLOCK - 1) / LOD_BLOCK * LOD_BLOCK : LOD_BLOCK;
+        skeleton->lod_joint_counts[level] = count < joint_count ? count : joint_count;
+    }
+
+    char** names = malloc(joint_count * sizeof(char*));
+    int32_t* parents = malloc(joint_count * sizeof(int32_t));
+    vec3* translations = malloc(joint_count * sizeof(vec3));
+    versor* rotations = malloc(joint_count * sizeof(versor));
+    vec3* scales = malloc(joint_count * sizeof(vec3));
+    for (int32_t joint = 0; joint < joint_count; joint++) {
+        int32_t old = old_joints[joint];
+        names[joint] = skeleton->names[old];
+        parents[joint] = skeleton->parents[old] < 0 ? -1 : new_joints[skeleton->parents[old]];
+        glm_vec3_copy(skeleton->rest_translations[old], translations[joint]);
+        memcpy(rotations[joint], skeleton->rest_rotations[old], sizeof(versor));
+        glm_vec3_copy(skeleton->rest_scales[old], scales[joint]);
+    }
+    free(skeleton->names);
+    free(skeleton->parents);
+    free(skeleton->rest_translations);
+    free(skeleton->rest_rotations);
+    free(skeleton->rest_scales);
+    skeleton->names = names;
+    skeleton->parents = parents;
+    skeleton->rest_translations = translations;
+    skeleton->rest_rotations = rotations;
+    skeleton->rest_scales = scales;
+    free(old_joints);
+    free(new_joints);
+    free(depths);
+    free(levels);
+}
+
+static int32_t find_joint(NaxaSkeleton_t* skeleton, struct aiString* name) {
+    for (int32_t i = 0; i < skeleton->joint_count; i++) {
+        if (strlen(skeleton->names[i]) == name->length && strncmp(skeleton->names[i], name->data, name->length) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static void vector_value(KeySource_t* source, int32_t key, float* dest) {
+    if (source->vectors == NULL && source->quats == NULL) {
+        memcpy(dest, source->rest, sizeof(source->rest));
+    } else if (source->vectors) {
+        dest[0] = source->vectors[key].mValue.x;
+        dest[1] = source->vectors[key].mValue.y;
+        dest[2] = source->vectors[key].mValue.z;
+    } else {
+        dest[0] = source->quats[key].mValue.x;
+        dest[1] = source->quats[key].mValue.y;
+        dest[2] = source->quats[key].mValue.z;
+        dest[3] = source->quats[key].mValue.w;
+    }
+}
+
+static double key_time(KeySource_t* source, int32_t key) {
+    if (source->vectors == NULL && source->quats == NULL) {
+        return 0.0;
+    }
+    return source->vectors ? source->vectors[key].mTime : source->quats[key].mTime;
+}
+
+// Tracks that never move only need their first key
+static int32_t useful_keys(KeySource_t* source, int32_t components) {
+    float first[4];
+    float value[4];
+    vector_value(source, 0, first);
+    for (int32_t key = 1; key < source->len; key++) {
+        vector_value(source, key, value);
+        for (int32_t c = 0; c < components; c++) {
+            if (fabsf(value[c] - first[c]) > CONSTANT_EPSILON) {
+                return source->len;
+            }
+        }
+    }
+    return 1;
+}
+
+// Lay out the keys of every joint back to back and return the total
+static int32_t layout_keys(int32_t* starts, KeySource_t* sources, int32_t joint_count, int32_t components) {
+    int32_t key_count = 0;
+    for (int32_t joint = 0; joint < joint_count; joint++) {
+        starts[joint] = key_count;
+        sources[joint].len = useful_keys(&sources[joint], components);
+        key_count += sources[joint].len;
+    }
+    starts[joint_count] = key_count;
+    return key_count;
+}
+
+static void import_vec3_track(NaxaVec3Track_t* track, KeySource_t* sources, int32_t joint_count, double ticks_per_second) {
+    track->starts = malloc((joint_count + 1) * sizeof(int32_t));
+    int32_t key_count = layout_keys(track->starts, sources, joint_count, 3);
+    track->key_count = key_count;
+    track->times = malloc(key_count * sizeof(float));
+    track->values = malloc(key_count * 3 * sizeof(float));
+    for (int32_t joint = 0; joint < joint_count; joint++) {
+        for (int32_t key = 0; key < sources[joint].len; key++) {
+            int32_t index = track->starts[joint] + key;
+            float value[4];
+            vector_value(&sources[joint], key, value);
+            track->times[index] = key_time(&sources[joint], key) / ticks_per_second;
+            for (int32_t c = 0; c < 3; c++) {
+                track->values[c * key_count + index] = value[c];
+            }
+        }
+    }
+}
+
+static void import_quat_track(NaxaQuatTrack_t* track, KeySource_t* sources, int32_t joint_count, double ticks_per_second) {
+    track->starts = malloc((joint_count + 1) * sizeof(int32_t));
+    int32_t key_count = layout_keys(track->starts, sources, joint_count, 4);
+    track->key_count = key_count;
+    track->times = malloc(key_count * sizeof(float));
+    track->values = malloc(key_count * 4 * sizeof(int16_t));
+    for (int32_t joint = 0; joint < joint_count; joint++) {
+        versor previous;
+        glm_quat_identity(previous);
+        for (int32_t key = 0; key < sources[joint].len; key++) {
+            int32_t index = track->starts[joint] + key;
+            versor value;
+            vector_value(&sources[joint], key, value);
+            glm_quat_normalize(value);
+
+            // q and -q are the same rotation, keep neighbours on the same
+            // side so blending between them takes the short way around
+            if (key > 0 && glm_vec4_dot(previous, value) < 0.0f) {
+                glm_vec4_scale(value, -1.0f, value);
+            }
+            glm_vec4_copy(value, previous);
+            track->times[index] = key_time(&sources[joint], key) / ticks_per_second;
+            for (int32_t c = 0; c < 4; c++) {
+                track->values[c * key_count + index] = (int16_t)lrintf(value[c] * QUAT_QUANTIZE);
+            }
+        }
+    }
+}
+
+static int32_t import_clip(NaxaClip_t* clip, NaxaSkeleton_t* skeleton, struct aiAnimation* animation) {
+    double ticks_per_second = animation->mTicksPerSecond > 0.0 ? animation->mTicksPerSecond : DEFAULT_TICKS_PER_SECOND;
+    clip->name = copy_ai_string(&animation->mName);
+    clip->duration = animation->mDuration / ticks_per_second;
+
+    // Find which joint each channel drives
+    int32_t joint_count = skeleton->joint_count;
+    KeySource_t* translations = calloc(joint_count, sizeof(KeySource_t));
+    KeySource_t* rotations = calloc(joint_count, sizeof(KeySource_t));
+    KeySource_t* scales = calloc(joint_count, sizeof(KeySource_t));
+    for (int32_t joint = 0; joint < joint_count; joint++) {
+        translations[joint].len = 1;
+        glm_vec3_copy(skeleton->rest_translations[joint], translations[joint].rest);
+        rotations[joint].len = 1;
+        memcpy(rotations[joint].rest, skeleton->rest_rotations[joint], sizeof(versor));
+        scales[joint].len = 1;
+        glm_vec3_copy(skeleton->rest_scales[joint], scales[joint].rest);
+    }
+    for (int32_t i = 0; i < animation->mNumChannels; i++) {
+        struct aiNodeAnim* channel = animation->mChannels[i];
+        int32_t joint = find_joint(skeleton, &channel->mNodeName);
+        if (joint < 0) {
+            internal_logf(NAXA_SEVERITY_WARN, "Clip %s animates missing node %s", clip->name, channel->mNodeName.data);
+            continue;
+        }
+        if (channel->mNumPositionKeys > 0) {
+            translations[joint].len = channel->mNumPositionKeys;
+            translations[joint].vectors = channel->mPositionKeys;
+        }
+        if (channel->mNumRotationKeys > 0) {
+            rotations[joint].len = channel->mNumRotationKeys;
+            rotations[joint].quats = channel->mRotationKeys;
+        }
+        if (channel->mNumScalingKeys > 0) {
+            scales[joint].len = channel->mNumScalingKeys;
+            scales[joint].vectors = channel->mScalingKeys;
+        }
+    }
+
+    import_vec3_track(&clip->translations, translations, joint_count, ticks_per_second);
+    import_quat_track(&clip->rotations, rotations, joint_count, ticks_per_second);
+    import_vec3_track(&clip->scales, scales, joint_count, ticks_per_second);
+    free(translations);
+    free(rotations);
+    free(scales);
+    return NAXA_E_SUCCESS;
+}
+
+void anim_ai_matrix(mat4 dest, struct aiMatrix4x4* src) {
+    // Assimp is row major, cglm wants columns
+    memcpy(dest, src, sizeof(mat4));
+    glm_mat4_transpose(dest);
+}
+
+int32_t anim_import(NaxaModel_t* model, const struct aiScene* scene) {
+    if (model == NULL || scene == NULL) {
+        report_error(NAXA_E_NULLPTR);
+        return NAXA_E_NULLPTR;
+    }
+    NaxaSkeleton_t* skeleton = &model->skeleton;
+    memset(skeleton, 0, sizeof(NaxaSkeleton_t));
+    model->clip_count = 0;
+    model->clips = NULL;
+    if (scene->mRootNode == NULL) {
+        return NAXA_E_SUCCESS;
+    }
+
+    // Flatten the node hierarchy
+    int32_t node_count = count_nodes(scene->mRootNode);
+    skeleton->names = malloc(node_count * sizeof(char*));
+    skeleton->parents = malloc(node_count * sizeof(int32_t));
+    skeleton->rest_translations = malloc(node_count * sizeof(vec3));
+    skeleton->rest_rotations = malloc(node_count * sizeof(versor));
+    skeleton->rest_scales = malloc(node_count * sizeof(vec3));
+    add_joints(skeleton, scene->mRootNode, -1);
+    mat4 root;
+    anim_ai_matrix(root, &scene->mRootNode->mTransformation);
+    glm_mat4_inv(root, skeleton->inverse_root);
+    sort_joints_by_lod(skeleton, model);
+
+    // Joints animation LOD leaves out are posed straight from these
+    skeleton->rest_locals = aligned_alloc(NAXA_POSE_ALIGNMENT, (skeleton->joint_count > 0 ? skeleton->joint_count : 1) * sizeof(mat4));
+    for (int32_t joint = 0; joint < skeleton->joint_count; joint++) {
+        mat4* local = &skeleton->rest_locals[joint];
+        glm_translate_make(*local, skeleton->rest_translations[joint]);
+        glm_quat_rotate(*local, skeleton->rest_rotations[joint], *local);
+        glm_scale(*local, skeleton->rest_scales[joint]);
+    }
+
+    // Hook the bones up to the nodes that share their names
+    skeleton->bone_joints = malloc((model->bone_count > 0 ? model->bone_count : 1) * sizeof(int32_t));
+    for (int32_t i = 0; i < model->bone_count; i++) {
+        skeleton->bone_joints[i] = -1;
+        for (int32_t joint = 0; joint < skeleton->joint_count; joint++) {
+            if (strcmp(skeleton->names[joint], model->bones[i].name) == 0) {
+                skeleton->bone_joints[i] = joint;
+                break;
+            }
+        }
+        if (skeleton->bone_joints[i] < 0) {
+            internal_logf(NAXA_SEVERITY_WARN, "Bone %s has no node, it will stay in bind pose", model->bones[i].name);
+        }
+    }
+
+    if (scene->mNumAnimations > 0) {
+        // Whatever made it in so far goes again if a clip fails
+        model->clips = malloc(scene->mNumAnimations * sizeof(NaxaClip_t));
+        for (int32_t i = 0; i < scene->mNumAnimations; i++) {
+            int32_t rc = import_clip(&model->clips[i], skeleton, scene->mAnimations[i]);
+            if (rc != NAXA_E_SUCCESS) {
+                anim_free(model);
+                return rc;
+            }
+            model->clip_count++;
+        }
+    }
+    internal_logf(NAXA_SEVERITY_INFO, "Imported %d joints and %d clips", skeleton->joint_count, model->clip_count);
+    return NAXA_E_SUCCESS;
+}
+
+static void free_vec3_track(NaxaVec3Track_t* track) {
+    free(track->starts);
+    free(track->times);
+    free(track->values);
+}
+
+int32_t anim_free(NaxaModel_t* model) {
+    NaxaSkeleton_t* skeleton = &model->skeleton;
+    for (int32_t i = 0; i < skeleton->joint_count; i++) {
+        free(skeleton->names[i]);
+    }
+    free(skeleton->names);
+    free(skeleton->parents);
+    free(skeleton->rest_translations);
+    free(skeleton->rest_rotations);
+    free(skeleton->rest_scales);
+    free(skeleton->rest_locals);
+    free(skeleton->bone_joints);
+    memset(skeleton, 0, sizeof(NaxaSkeleton_t));
+
+    for (int32_t i = 0; i < model->clip_count; i++) {
+        free(model->clips[i].name);
+        free_vec3_track(&model->clips[i].translations);
+        free(model->clips[i].rotations.starts);
+        free(model->clips[i].rotations.times);
+        free(model->clips[i].rotations.values);
+        free_vec3_track(&model->clips[i].scales);
+    }
+    free(model->clips);
+    model->clips = NULL;
+    model->clip_count = 0;
+    return NAXA_E_SUCCESS;
+}
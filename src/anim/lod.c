@@ -0,0 +1,145 @@
+#include <stdatomic.h>
+#include <string.h>
+
+#include <naxa/anim.h>
+#include <naxa/err.h>
+#include <naxa/log.h>
+#include <naxa/naxa_internal.h>
+
+#define ANIM_LOD_HYSTERESIS 0.1f
+#define ANIM_LOD_MAX_PERIOD 4
+#define DEFAULT_FRAME_TIME (1.0f / 60.0f)
+#define FRAME_TIME_SMOOTHING 0.25f
+
+// Fraction of the screen height below which each coarser level kicks in,
+// and how many frames apart each level updates. Periods divide the
+// largest one so a phase staggers every level.
+static const float ANIM_LOD_SCREEN_SIZES[NAXA_ANIM_LODS - 1] = { 0.25f, 0.125f, 0.0625f };
+static const int32_t ANIM_LOD_PERIODS[NAXA_ANIM_LODS] = { 1, 2, 4, 4 };
+
+atomic_int anim_lod_instances;
+
+static int32_t select_level(NaxaAnimLod_t* lod, float screen_size) {
+    // Same hysteresis as mesh LODs so a character on a boundary doesn't
+    // flip between update rates
+    int32_t level = 0;
+    while (level < NAXA_ANIM_LODS - 1) {
+        float threshold = ANIM_LOD_SCREEN_SIZES[level];
+        if (level < lod->level) {
+            threshold *= 1.0f + ANIM_LOD_HYSTERESIS;
+        } else {
+            threshold *= 1.0f - ANIM_LOD_HYSTERESIS;
+        }
+        if (screen_size >= threshold) {
+            break;
+        }
+        level++;
+    }
+    return level;
+}
+
+static void copy_joints(NaxaPose_t* dest, NaxaPose_t* src, int32_t count) {
+    // The planes of a pose are back to back, stride apart
+    for (int32_t plane = 0; plane < NAXA_POSE_PLANES; plane++) {
+        memcpy(&dest->translations[plane * dest->stride], &src->translations[plane * src->stride], count * sizeof(float));
+    }
+}
+
+int32_t anim_lod_update(NaxaAnimLod_t* lod, int32_t level, float now, NaxaPoseSource_t source, void* user, NaxaPose_t* dest) {
+    NaxaSkeleton_t* skeleton = &lod->model->skeleton;
+    int32_t active = skeleton->lod_joint_counts[level];
+    int32_t period = ANIM_LOD_PERIODS[level];
+    lod->level = level;
+    if (lod->frame > 0) {
+        lod->frame_time += (now - lod->last_now - lod->frame_time) * FRAME_TIME_SMOOTHING;
+    }
+    lod->last_now = now;
+    lod->frame++;
+    lod->frames_since_update++;
+    dest->active_joint_count = active;
+
+    // Full rate needs nothing in between, start over when slowing down
+    if (period == 1) {
+        lod->primed = NAXA_FALSE;
+        return source(user, now, dest);
+    }
+
+    int32_t rc = NAXA_E_SUCCESS;
+    if (!lod->primed || lod->frames_since_update >= lod->period || (lod->frame + lod->phase) % period == 0) {
+        // Carry on from wherever the last interpolation got to, which is
+        // now unless the period changed, and sample one update ahead
+        lod->from.active_joint_count = active;
+        lod->to.active_joint_count = active;
+        if (lod->primed) {
+            float t = (float)lod->frames_since_update / lod->period;
+            anim_blend_lerp(&lod->from, &lod->to, NULL, t < 1.0f ? t : 1.0f);
+        } else {
+            rc = source(user, now, &lod->from);
+        }
+        if (rc == NAXA_E_SUCCESS) {
+            rc = source(user, now + period * lod->frame_time, &lod->to);
+        }
+        if (rc != NAXA_E_SUCCESS) {
+            lod->primed = NAXA_FALSE;
+            return rc;
+        }
+        lod->primed = NAXA_TRUE;
+        lod->period = period;
+        lod->frames_since_update = 0;
+    }
+
+    copy_joints(dest, &lod->from, active);
+    if (lod->frames_since_update > 0) {
+        float t = (float)lod->frames_since_update / lod->period;
+        anim_blend_lerp(dest, &lod->to, NULL, t < 1.0f ? t : 1.0f);
+    }
+    dest->revision++;
+    return NAXA_E_SUCCESS;
+}
+
+int32_t naxa_init_anim_lod(NaxaAnimLod_t* dest, NaxaModel_t* model) {
+    if (dest == NULL || model == NULL) {
+        report_error(NAXA_E_NULLPTR);
+        return NAXA_E_NULLPTR;
+    }
+    memset(dest, 0, sizeof(NaxaAnimLod_t));
+    int32_t rc = naxa_init_pose(&dest->from, model);
+    if (rc != NAXA_E_SUCCESS) {
+        return rc;
+    }
+    rc = naxa_init_pose(&dest->to, model);
+    if (rc != NAXA_E_SUCCESS) {
+        naxa_free_pose(&dest->from);
+        return rc;
+    }
+    dest->model = model;
+    dest->period = 1;
+    dest->frame_time = DEFAULT_FRAME_TIME;
+
+    // Consecutive characters land on different frames
+    dest->phase = atomic_fetch_add(&anim_lod_instances, 1) % ANIM_LOD_MAX_PERIOD;
+    return NAXA_E_SUCCESS;
+}
+
+int32_t naxa_free_anim_lod(NaxaAnimLod_t* lod) {
+    if (lod == NULL) {
+        return NAXA_E_SUCCESS;
+    }
+    naxa_free_pose(&lod->from);
+    naxa_free_pose(&lod->to);
+    memset(lod, 0, sizeof(NaxaAnimLod_t));
+    return NAXA_E_SUCCESS;
+}
+
+int32_t naxa_update_anim_lod(NaxaAnimLod_t* lod, NaxaEntity_t* entity, float now, NaxaPoseSource_t source, void* user) {
+    if (lod == NULL || entity == NULL || entity->pose == NULL || source == NULL) {
+        report_error(NAXA_E_NULLPTR);
+        return NAXA_E_NULLPTR;
+    }
+    if (entity->model != lod->model || entity->pose->joint_count != lod->model->skeleton.joint_count) {
+        report_error(NAXA_E_BOUNDS);
+        return NAXA_E_BOUNDS;
+    }
+    int32_t level = select_level(lod, render_screen_size(entity));
+    return anim_lod_update(lod, level, now, source, user, entity->pose);
+}
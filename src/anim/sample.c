@@ -0,0 +1,471 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <naxa/anim.h>
+#include <naxa/err.h>
+#include <naxa/lanes.h>
+#include <naxa/log.h>
+#include <naxa/naxa_internal.h>
+
+#define QUAT_DEQUANTIZE (1.0f / 32767.0f)
+
+// Joints are evaluated 8 at a time, as one AVX register, two SSE registers
+// or 8 scalar iterations. Pose strides are padded to match so a block never
+// needs a tail.
+#define BLOCK NAXA_POSE_STRIDE_MULTIPLE
+#define ALIGNED LANE_ALIGNED
+
+// The two keys each joint of a block sits between
+typedef struct {
+    int32_t from[BLOCK];
+    int32_t to[BLOCK];
+    float t[BLOCK] ALIGNED;
+} KeyBlock_t;
+
+// Model space joint matrices, each thread building palettes gets its own
+thread_local int32_t anim_model_space_size;
+thread_local mat4* anim_model_space;
+
+// Step the cursor of one joint's keys up to the key at or before time and
+// return it. Only goes back to the first key when time went backwards.
+static int32_t advance_cursor(int32_t* cursor, float* times, int32_t start, int32_t end, float time) {
+    int32_t key = *cursor;
+    if (key < start || key >= end - 1 || times[key] > time) {
+        key = start;
+    }
+    while (key < end - 2 && times[key + 1] <= time) {
+        key++;
+    }
+    *cursor = key;
+    return key;
+}
+
+// Padding joints past the end just repeat the first key. Joints with a
+// single key have it as both ends, whatever fraction they get.
+static void find_keys(KeyBlock_t* dest, int32_t* cursors, int32_t* starts, float* times, int32_t base, int32_t joint_count, float time) {
+    float from_times[BLOCK] ALIGNED;
+    float to_times[BLOCK] ALIGNED;
+    for (int32_t lane = 0; lane < BLOCK; lane++) {
+        int32_t joint = base + lane;
+        if (joint >= joint_count) {
+            dest->from[lane] = 0;
+            dest->to[lane] = 0;
+        } else {
+            int32_t start = starts[joint];
+            int32_t end = starts[joint + 1];
+            if (end - start == 1) {
+                dest->from[lane] = start;
+                dest->to[lane] = start;
+            } else {
+                dest->from[lane] = advance_cursor(&cursors[joint], times, start, end, time);
+                dest->to[lane] = dest->from[lane] + 1;
+            }
+        }
+        from_times[lane] = times[dest->from[lane]];
+        to_times[lane] = times[dest->to[lane]];
+    }
+
+    // Fractions between the keys, clamped for times outside the track
+    Lane_t now = lane_set1(time);
+    Lane_t zero = lane_set1(0.0f);
+    Lane_t one = lane_set1(1.0f);
+    Lane_t min_span = lane_set1(1e-6f);
+    for (int32_t lane = 0; lane < BLOCK; lane += LANES) {
+        Lane_t from = lane_load(&from_times[lane]);
+        Lane_t span = lane_max(lane_sub(lane_load(&to_times[lane]), from), min_span);
+        Lane_t t = lane_div(lane_sub(now, from), span);
+        lane_store(&dest->t[lane], lane_min(lane_max(t, zero), one));
+    }
+}
+
+static void lerp_vec3_block(float* dest, int32_t stride, NaxaVec3Track_t* track, KeyBlock_t* keys) {
+    float from[BLOCK] ALIGNED;
+    float to[BLOCK] ALIGNED;
+    for (int32_t c = 0; c < 3; c++) {
+        float* plane = &track->values[c * track->key_count];
+        for (int32_t lane = 0; lane < BLOCK; lane++) {
+            from[lane] = plane[keys->from[lane]];
+            to[lane] = plane[keys->to[lane]];
+        }
+        for (int32_t lane = 0; lane < BLOCK; lane += LANES) {
+            Lane_t a = lane_load(&from[lane]);
+            Lane_t b = lane_load(&to[lane]);
+            Lane_t t = lane_load(&keys->t[lane]);
+            lane_store(&dest[c * stride + lane], lane_add(a, lane_mul(lane_sub(b, a), t)));
+        }
+    }
+}
+
+// Keys were stored in the same hemisphere, a plain lerp and normalize is
+// all it takes.
+static void nlerp_quat_block(float* dest, int32_t stride, NaxaQuatTrack_t* track, KeyBlock_t* keys) {
+    float q[4][BLOCK] ALIGNED;
+    float from[BLOCK] ALIGNED;
+    float to[BLOCK] ALIGNED;
+    for (int32_t c = 0; c < 4; c++) {
+        int16_t* plane = &track->values[c * track->key_count];
+        for (int32_t lane = 0; lane < BLOCK; lane++) {
+            from[lane] = plane[keys->from[lane]] * QUAT_DEQUANTIZE;
+            to[lane] = plane[keys->to[lane]] * QUAT_DEQUANTIZE;
+        }
+        for (int32_t lane = 0; lane < BLOCK; lane += LANES) {
+            Lane_t a = lane_load(&from[lane]);
+            Lane_t b = lane_load(&to[lane]);
+            Lane_t t = lane_load(&keys->t[lane]);
+            lane_store(&q[c][lane], lane_add(a, lane_mul(lane_sub(b, a), t)));
+        }
+    }
+    for (int32_t lane = 0; lane < BLOCK; lane += LANES) {
+        Lane_t x = lane_load(&q[0][lane]);
+        Lane_t y = lane_load(&q[1][lane]);
+        Lane_t z = lane_load(&q[2][lane]);
+        Lane_t w = lane_load(&q[3][lane]);
+        Lane_t length2 = lane_add(lane_add(lane_mul(x, x), lane_mul(y, y)), lane_add(lane_mul(z, z), lane_mul(w, w)));
+        Lane_t inverse = lane_inverse_length(length2);
+        lane_store(&dest[lane], lane_mul(x, inverse));
+        lane_store(&dest[stride + lane], lane_mul(y, inverse));
+        lane_store(&dest[2 * stride + lane], lane_mul(z, inverse));
+        lane_store(&dest[3 * stride + lane], lane_mul(w, inverse));
+    }
+}
+
+// Rotation times scale of a block of joints, as planes of the nine entries
+// of the upper 3x3 in column order
+static void local_block(float dest[9][BLOCK], NaxaPose_t* pose, int32_t base) {
+    int32_t stride = pose->stride;
+    float* r = &pose->rotations[base];
+    float* s = &pose->scales[base];
+    Lane_t one = lane_set1(1.0f);
+    Lane_t two = lane_set1(2.0f);
+    for (int32_t lane = 0; lane < BLOCK; lane += LANES) {
+        Lane_t x = lane_load(&r[lane]);
+        Lane_t y = lane_load(&r[stride + lane]);
+        Lane_t z = lane_load(&r[2 * stride + lane]);
+        Lane_t w = lane_load(&r[3 * stride + lane]);
+        Lane_t sx = lane_load(&s[lane]);
+        Lane_t sy = lane_load(&s[stride + lane]);
+        Lane_t sz = lane_load(&s[2 * stride + lane]);
+        Lane_t xx = lane_mul(x, x);
+        Lane_t yy = lane_mul(y, y);
+        Lane_t zz = lane_mul(z, z);
+        Lane_t xy = lane_mul(x, y);
+        Lane_t xz = lane_mul(x, z);
+        Lane_t yz = lane_mul(y, z);
+        Lane_t wx = lane_mul(w, x);
+        Lane_t wy = lane_mul(w, y);
+        Lane_t wz = lane_mul(w, z);
+        lane_store(&dest[0][lane], lane_mul(lane_sub(one, lane_mul(two, lane_add(yy, zz))), sx));
+        lane_store(&dest[1][lane], lane_mul(lane_mul(two, lane_add(xy, wz)), sx));
+        lane_store(&dest[2][lane], lane_mul(lane_mul(two, lane_sub(xz, wy)), sx));
+        lane_store(&dest[3][lane], lane_mul(lane_mul(two, lane_sub(xy, wz)), sy));
+        lane_store(&dest[4][lane], lane_mul(lane_sub(one, lane_mul(two, lane_add(xx, zz))), sy));
+        lane_store(&dest[5][lane], lane_mul(lane_mul(two, lane_add(yz, wx)), sy));
+        lane_store(&dest[6][lane], lane_mul(lane_mul(two, lane_add(xz, wy)), sz));
+        lane_store(&dest[7][lane], lane_mul(lane_mul(two, lane_sub(yz, wx)), sz));
+        lane_store(&dest[8][lane], lane_mul(lane_sub(one, lane_mul(two, lane_add(xx, yy))), sz));
+    }
+}
+
+int32_t naxa_find_clip(NaxaClip_t** dest, NaxaModel_t* model, char* name) {
+    if (dest == NULL || model == NULL || name == NULL) {
+        report_error(NAXA_E_NULLPTR);
+        return NAXA_E_NULLPTR;
+    }
+    *dest = NULL;
+    for (int32_t i = 0; i < model->clip_count; i++) {
+        if (strcmp(model->clips[i].name, name) == 0) {
+            *dest = &model->clips[i];
+            return NAXA_E_SUCCESS;
+        }
+    }
+    report_error(NAXA_E_BOUNDS);
+    return NAXA_E_BOUNDS;
+}
+
+int32_t anim_pose_bytes(int32_t joint_count) {
+    int32_t stride = (joint_count + NAXA_POSE_STRIDE_MULTIPLE - 1) / NAXA_POSE_STRIDE_MULTIPLE * NAXA_POSE_STRIDE_MULTIPLE;
+    if (stride == 0) {
+        stride = NAXA_POSE_STRIDE_MULTIPLE;
+    }
+    return NAXA_POSE_PLANES * stride * sizeof(float);
+}
+
+// Ten planes of aligned floats in one block. Padding joints get an
+// identity transform so no lane ever holds garbage.
+void anim_pose_bind(NaxaPose_t* dest, float* planes, int32_t joint_count) {
+    int32_t stride = anim_pose_bytes(joint_count) / NAXA_POSE_PLANES / sizeof(float);
+    dest->joint_count = joint_count;
+    dest->stride = stride;
+    dest->translations = planes;
+    dest->rotations = planes + 3 * stride;
+    dest->scales = planes + 7 * stride;
+    dest->active_joint_count = joint_count;
+    dest->revision = 0;
+    dest->skin_slot = -1;
+    dest->morph_count = 0;
+    dest->morph_weights = NULL;
+    for (int32_t joint = joint_count; joint < stride; joint++) {
+        for (int32_t c = 0; c < 3; c++) {
+            dest->translations[c * stride + joint] = 0.0f;
+            dest->rotations[c * stride + joint] = 0.0f;
+            dest->scales[c * stride + joint] = 1.0f;
+        }
+        dest->rotations[3 * stride + joint] = 1.0f;
+    }
+}
+
+int32_t naxa_init_pose(NaxaPose_t* dest, NaxaModel_t* model) {
+    if (dest == NULL || model == NULL) {
+        report_error(NAXA_E_NULLPTR);
+        return NAXA_E_NULLPTR;
+    }
+    NaxaSkeleton_t* skeleton = &model->skeleton;
+    float* planes = aligned_alloc(NAXA_POSE_ALIGNMENT, anim_pose_bytes(skeleton->joint_count));
+    if (planes == NULL) {
+        report_error(NAXA_E_EXHAUSTED);
+        return NAXA_E_EXHAUSTED;
+    }
+    anim_pose_bind(dest, planes, skeleton->joint_count);
+    if (model->morph_count > 0) {
+        dest->morph_count = model->morph_count;
+        dest->morph_weights = calloc(model->morph_count, sizeof(float));
+    }
+    int32_t stride = dest->stride;
+    for (int32_t joint = 0; joint < skeleton->joint_count; joint++) {
+        for (int32_t c = 0; c < 3; c++) {
+            dest->translations[c * stride + joint] = skeleton->rest_translations[joint][c];
+            dest->scales[c * stride + joint] = skeleton->rest_scales[joint][c];
+        }
+        for (int32_t c = 0; c < 4; c++) {
+            dest->rotations[c * stride + joint] = skeleton->rest_rotations[joint][c];
+        }
+    }
+    return NAXA_E_SUCCESS;
+}
+
+int32_t naxa_free_pose(NaxaPose_t* pose) {
+    if (pose == NULL) {
+        return NAXA_E_SUCCESS;
+    }
+    // The other planes live in the same allocation
+    skin_release(pose);
+    free(pose->translations);
+    free(pose->morph_weights);
+    memset(pose, 0, sizeof(NaxaPose_t));
+    return NAXA_E_SUCCESS;
+}
+
+int32_t naxa_find_morph(int32_t* dest, NaxaModel_t* model, char* name) {
+    if (dest == NULL || model == NULL || name == NULL) {
+        report_error(NAXA_E_NULLPTR);
+        return NAXA_E_NULLPTR;
+    }
+    for (int32_t i = 0; i < model->morph_count; i++) {
+        if (strcmp(model->morphs[i].name, name) == 0) {
+            *dest = i;
+            return NAXA_E_SUCCESS;
+        }
+    }
+    *dest = -1;
+    report_error(NAXA_E_BOUNDS);
+    return NAXA_E_BOUNDS;
+}
+
+int32_t naxa_set_morph_weight(NaxaPose_t* pose, int32_t morph, float weight) {
+    if (pose == NULL) {
+        report_error(NAXA_E_NULLPTR);
+        return NAXA_E_NULLPTR;
+    }
+    if (morph < 0 || morph >= pose->morph_count) {
+        report_error(NAXA_E_BOUNDS);
+        return NAXA_E_BOUNDS;
+    }
+
+    // Only a change has to be skinned again
+    if (pose->morph_weights[morph] != weight) {
+        pose->morph_weights[morph] = weight;
+        pose->revision++;
+    }
+    return NAXA_E_SUCCESS;
+}
+
+int32_t naxa_init_sampler(NaxaAnimSampler_t* dest, NaxaModel_t* model, NaxaClip_t* clip) {
+    if (dest == NULL || model == NULL || clip == NULL) {
+        report_error(NAXA_E_NULLPTR);
+        return NAXA_E_NULLPTR;
+    }
+    int32_t joint_count = model->skeleton.joint_count;
+    dest->model = model;
+    dest->clip = clip;
+    dest->time = 0.0f;
+    dest->cursors = calloc(joint_count > 0 ? joint_count * 3 : 1, sizeof(int32_t));
+    for (int32_t joint = 0; joint < joint_count; joint++) {
+        dest->cursors[joint] = clip->translations.starts[joint];
+        dest->cursors[joint_count + joint] = clip->rotations.starts[joint];
+        dest->cursors[2 * joint_count + joint] = clip->scales.starts[joint];
+    }
+    return NAXA_E_SUCCESS;
+}
+
+int32_t naxa_free_sampler(NaxaAnimSampler_t* sampler) {
+    if (sampler == NULL) {
+        return NAXA_E_SUCCESS;
+    }
+    free(sampler->cursors);
+    memset(sampler, 0, sizeof(NaxaAnimSampler_t));
+    return NAXA_E_SUCCESS;
+}
+
+int32_t naxa_sample_clip(NaxaAnimSampler_t* sampler, float time, NaxaPose_t* dest) {
+    if (sampler == NULL || sampler->clip == NULL || dest == NULL) {
+        report_error(NAXA_E_NULLPTR);
+        return NAXA_E_NULLPTR;
+    }
+    NaxaSkeleton_t* skeleton = &sampler->model->skeleton;
+    if (dest->joint_count != skeleton->joint_count) {
+        report_error(NAXA_E_BOUNDS);
+        return NAXA_E_BOUNDS;
+    }
+
+    // Clips loop
+    NaxaClip_t* clip = sampler->clip;
+    if (clip->duration > 0.0f) {
+        time = fmodf(time, clip->duration);
+        if (time < 0.0f) {
+            time += clip->duration;
+        }
+    }
+    sampler->time = time;
+
+    // Cursors are stepped per joint, the blending runs a block at a time.
+    // Joints past the active ones are left as they are.
+    int32_t joint_count = skeleton->joint_count;
+    int32_t stride = dest->stride;
+    int32_t* cursors = sampler->cursors;
+    KeyBlock_t keys;
+    for (int32_t base = 0; base < dest->active_joint_count; base += BLOCK) {
+        find_keys(&keys, cursors, clip->translations.starts, clip->translations.times, base, joint_count, time);
+        lerp_vec3_block(&dest->translations[base], stride, &clip->translations, &keys);
+        find_keys(&keys, &cursors[joint_count], clip->rotations.starts, clip->rotations.times, base, joint_count, time);
+        nlerp_quat_block(&dest->rotations[base], stride, &clip->rotations, &keys);
+        find_keys(&keys, &cursors[2 * joint_count], clip->scales.starts, clip->scales.times, base, joint_count, time);
+        lerp_vec3_block(&dest->scales[base], stride, &clip->scales, &keys);
+    }
+    dest->revision++;
+    return NAXA_E_SUCCESS;
+}
+
+// Model space matrices of every joint into anim_model_space
+static int32_t resolve_model_space(NaxaModel_t* model, NaxaPose_t* pose) {
+    NaxaSkeleton_t* skeleton = &model->skeleton;
+    if (pose->joint_count != skeleton->joint_count) {
+        report_error(NAXA_E_BOUNDS);
+        return NAXA_E_BOUNDS;
+    }
+    if (skeleton->joint_count > anim_model_space_size) {
+        anim_model_space_size = skeleton->joint_count;
+        free(anim_model_space);
+        anim_model_space = aligned_alloc(NAXA_POSE_ALIGNMENT, anim_model_space_size * sizeof(mat4));
+    }
+
+    // Parents come first, so one pass resolves the whole hierarchy. Roots
+    // start from the inverse root transform so the palette needn't. Only
+    // the active joints have fresh locals, so only they are built from
+    // the pose.
+    float local[9][BLOCK] ALIGNED;
+    int32_t stride = pose->stride;
+    int32_t active = pose->active_joint_count;
+    for (int32_t base = 0; base < active; base += BLOCK) {
+        local_block(local, pose, base);
+        int32_t block_len = active - base < BLOCK ? active - base : BLOCK;
+        for (int32_t lane = 0; lane < block_len; lane++) {
+            int32_t joint = base + lane;
+            mat4 matrix = {
+                { local[0][lane], local[1][lane], local[2][lane], 0.0f },
+                { local[3][lane], local[4][lane], local[5][lane], 0.0f },
+                { local[6][lane], local[7][lane], local[8][lane], 0.0f },
+                { pose->translations[joint], pose->translations[stride + joint], pose->translations[2 * stride + joint], 1.0f }
+            };
+            int32_t parent = skeleton->parents[joint];
+            glm_mat4_mul(parent < 0 ? skeleton->inverse_root : anim_model_space[parent], matrix, anim_model_space[joint]);
+        }
+    }
+
+    // The rest hang off their parents in rest pose, whatever a finer LOD
+    // left in their locals
+    for (int32_t joint = active; joint < skeleton->joint_count; joint++) {
+        int32_t parent = skeleton->parents[joint];
+        glm_mat4_mul(parent < 0 ? skeleton->inverse_root : anim_model_space[parent], skeleton->rest_locals[joint], anim_model_space[joint]);
+    }
+    return NAXA_E_SUCCESS;
+}
+
+// The rigid part of a bone matrix as a dual quaternion, real part first.
+// Dual quaternions can't carry scale so it is normalized away.
+static void matrix_dual_quat(vec4 real, vec4 dual, mat4 matrix) {
+    mat4 rotation;
+    glm_mat4_copy(matrix, rotation);
+    glm_vec3_normalize(rotation[0]);
+    glm_vec3_normalize(rotation[1]);
+    glm_vec3_normalize(rotation[2]);
+    glm_mat4_quat(rotation, real);
+
+    // dual = translation * real / 2
+    float x = matrix[3][0];
+    float y = matrix[3][1];
+    float z = matrix[3][2];
+    dual[0] = 0.5f * (x * real[3] + y * real[2] - z * real[1]);
+    dual[1] = 0.5f * (y * real[3] + z * real[0] - x * real[2]);
+    dual[2] = 0.5f * (z * real[3] + x * real[1] - y * real[0]);
+    dual[3] = -0.5f * (x * real[0] + y * real[1] + z * real[2]);
+}
+
+int32_t anim_skin_dual_quats(vec4* dest, NaxaModel_t* model, NaxaPose_t* pose) {
+    if (dest == NULL || model == NULL || pose == NULL) {
+        report_error(NAXA_E_NULLPTR);
+        return NAXA_E_NULLPTR;
+    }
+    int32_t rc = resolve_model_space(model, pose);
+    if (rc != NAXA_E_SUCCESS) {
+        return rc;
+    }
+
+    // Two vec4 per bone, built aside since dest may be mapped GPU memory
+    NaxaSkeleton_t* skeleton = &model->skeleton;
+    for (int32_t i = 0; i < model->bone_count; i++) {
+        int32_t joint = skeleton->bone_joints[i];
+        vec4 dual_quat[2] = { { 0.0f, 0.0f, 0.0f, 1.0f }, { 0.0f, 0.0f, 0.0f, 0.0f } };
+        if (joint >= 0) {
+            mat4 bone;
+            glm_mat4_mul(anim_model_space[joint], model->bones[i].matrix, bone);
+            matrix_dual_quat(dual_quat[0], dual_quat[1], bone);
+        }
+        memcpy(&dest[2 * i], dual_quat, sizeof(dual_quat));
+    }
+    return NAXA_E_SUCCESS;
+}
+
+int32_t anim_skin_palette(mat4* dest, NaxaModel_t* model, NaxaPose_t* pose) {
+    if (dest == NULL || model == NULL || pose == NULL) {
+        report_error(NAXA_E_NULLPTR);
+        return NAXA_E_NULLPTR;
+    }
+    int32_t rc = resolve_model_space(model, pose);
+    if (rc != NAXA_E_SUCCESS) {
+        return rc;
+    }
+    NaxaSkeleton_t* skeleton = &model->skeleton;
+
+    // Bones take vertices from bind pose into their joint and back out.
+    // dest may be mapped GPU memory, it is only ever written.
+    for (int32_t i = 0; i < model->bone_count; i++) {
+        int32_t joint = skeleton->bone_joints[i];
+        if (joint < 0) {
+            glm_mat4_identity(dest[i]);
+            continue;
+        }
+        glm_mat4_mul(anim_model_space[joint], model->bones[i].matrix, dest[i]);
+    }
+    return NAXA_E_SUCCESS;
+}
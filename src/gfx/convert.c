@@ -0,0 +1,114 @@
+#if defined(__SSE2__)
+#include <tmmintrin.h>
+#endif
+#include <string.h>
+
+#include <naxa/err.h>
+#include <naxa/naxa_internal.h>
+
+// Everything the GPU sees is RGBA8, whatever stb_image decoded. Grey goes
+// into all three colour channels and missing alpha is opaque.
+
+static void expand_scalar(uint8_t* dest, uint8_t* src, int32_t pixel_count, int32_t channels) {
+    for (int32_t i = 0; i < pixel_count; i++) {
+        uint8_t* in = &src[i * channels];
+        uint8_t* out = &dest[i * 4];
+        switch (channels) {
+            case 1:
+                out[0] = out[1] = out[2] = in[0];
+                out[3] = 255;
+                break;
+            case 2:
+                out[0] = out[1] = out[2] = in[0];
+                out[3] = in[1];
+                break;
+            case 3:
+                out[0] = in[0];
+                out[1] = in[1];
+                out[2] = in[2];
+                out[3] = 255;
+                break;
+        }
+    }
+}
+
+#if defined(__SSE2__)
+// 16 grey pixels per iteration
+static int32_t expand_grey(uint8_t* dest, uint8_t* src, int32_t pixel_count) {
+    __m128i opaque = _mm_set1_epi8((char)0xFF);
+    int32_t i = 0;
+    for (; i + 16 <= pixel_count; i += 16) {
+        __m128i grey = _mm_loadu_si128((__m128i*)&src[i]);
+        __m128i gg_lo = _mm_unpacklo_epi8(grey, grey);
+        __m128i gg_hi = _mm_unpackhi_epi8(grey, grey);
+        __m128i ga_lo = _mm_unpacklo_epi8(grey, opaque);
+        __m128i ga_hi = _mm_unpackhi_epi8(grey, opaque);
+        _mm_storeu_si128((__m128i*)&dest[i * 4], _mm_unpacklo_epi16(gg_lo, ga_lo));
+        _mm_storeu_si128((__m128i*)&dest[i * 4 + 16], _mm_unpackhi_epi16(gg_lo, ga_lo));
+        _mm_storeu_si128((__m128i*)&dest[i * 4 + 32], _mm_unpacklo_epi16(gg_hi, ga_hi));
+        _mm_storeu_si128((__m128i*)&dest[i * 4 + 48], _mm_unpackhi_epi16(gg_hi, ga_hi));
+    }
+    return i;
+}
+
+// 8 grey and alpha pixels per iteration
+static int32_t expand_grey_alpha(uint8_t* dest, uint8_t* src, int32_t pixel_count) {
+    __m128i low_byte = _mm_set1_epi16(0x00FF);
+    int32_t i = 0;
+    for (; i + 8 <= pixel_count; i += 8) {
+        __m128i ga = _mm_loadu_si128((__m128i*)&src[i * 2]);
+        __m128i grey = _mm_and_si128(ga, low_byte);
+        __m128i gg = _mm_or_si128(grey, _mm_slli_epi16(grey, 8));
+        _mm_storeu_si128((__m128i*)&dest[i * 4], _mm_unpacklo_epi16(gg, ga));
+        _mm_storeu_si128((__m128i*)&dest[i * 4 + 16], _mm_unpackhi_epi16(gg, ga));
+    }
+    return i;
+}
+#endif
+
+#if defined(__SSE2__)
+// 4 RGB pixels per iteration. Each load reads 16 bytes for the 12 it uses,
+// so stop while a whole spare pixel and a bit are still left. The build
+// only assumes SSE2, so this is compiled for SSSE3 on its own and only
+// called when the CPU says it has it.
+__attribute__((target("ssse3")))
+static int32_t expand_rgb(uint8_t* dest, uint8_t* src, int32_t pixel_count) {
+    __m128i shuffle = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+    __m128i opaque = _mm_set1_epi32((int)0xFF000000);
+    int32_t i = 0;
+    for (; i + 6 <= pixel_count; i += 4) {
+        __m128i rgb = _mm_loadu_si128((__m128i*)&src[i * 3]);
+        _mm_storeu_si128((__m128i*)&dest[i * 4], _mm_or_si128(_mm_shuffle_epi8(rgb, shuffle), opaque));
+    }
+    return i;
+}
+#endif
+
+int32_t image_expand_rgba(uint8_t* dest, uint8_t* src, int32_t pixel_count, int32_t channels) {
+    if (dest == NULL || src == NULL) {
+        report_error(NAXA_E_NULLPTR);
+        return NAXA_E_NULLPTR;
+    }
+    if (channels < 1 || channels > 4) {
+        report_error(NAXA_E_BOUNDS);
+        return NAXA_E_BOUNDS;
+    }
+    if (channels == 4) {
+        memcpy(dest, src, (size_t)pixel_count * 4);
+        return NAXA_E_SUCCESS;
+    }
+
+    // Vector loops do the bulk, whatever doesn't fill a vector goes scalar
+    int32_t done = 0;
+#if defined(__SSE2__)
+    if (channels == 1) {
+        done = expand_grey(dest, src, pixel_count);
+    } else if (channels == 2) {
+        done = expand_grey_alpha(dest, src, pixel_count);
+    } else if (__builtin_cpu_supports("ssse3")) {
+        done = expand_rgb(dest, src, pixel_count);
+    }
+#endif
+    expand_scalar(&dest[done * 4], &src[done * channels], pixel_count - done, channels);
+    return NAXA_E_SUCCESS;
+}
@@ -0,0 +1,72 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include <stb/stb_image.h>
+
+#include <naxa/err.h>
+#include <naxa/gfx.h>
+#include <naxa/log.h>
+#include <naxa/naxa_internal.h>
+
+extern int32_t naxa_cook_texture(char* src_path, char* dest_path, int32_t format) {
+    if (src_path == NULL || dest_path == NULL) {
+        report_error(NAXA_E_NULLPTR);
+        return NAXA_E_NULLPTR;
+    }
+    if (texcomp_block_size(format) == 0) {
+        report_error(NAXA_E_BOUNDS);
+        return NAXA_E_BOUNDS;
+    }
+
+    // Match the orientation naxa_load_texture gives uncooked images
+    int32_t width;
+    int32_t height;
+    int32_t channels;
+    stbi_set_flip_vertically_on_load(1);
+    uint8_t* rgba = stbi_load(src_path, &width, &height, &channels, 4);
+    if (rgba == NULL) {
+        report_error(NAXA_E_FILE);
+        return NAXA_E_FILE;
+    }
+
+    // Filter the whole chain first, normal maps are not gamma encoded
+    int32_t level_count = mip_level_count(width, height);
+    level_count = level_count < NAXA_MAX_MIP_LEVELS ? level_count : NAXA_MAX_MIP_LEVELS;
+    uint8_t* chain = malloc(mip_chain_size(width, height, level_count));
+    memcpy(chain, rgba, width * height * 4);
+    stbi_image_free(rgba);
+    mip_build_chain(chain, width, height, level_count, format != NAXA_TEXTURE_BC5);
+
+    // Encode every level of the mip chain
+    NaxaKtx_t ktx;
+    memset(&ktx, 0, sizeof(ktx));
+    ktx.format = format;
+    ktx.srgb = format != NAXA_TEXTURE_BC5;
+    ktx.width = width;
+    ktx.height = height;
+    ktx.level_count = level_count;
+    uint8_t* level_rgba = chain;
+    int32_t level_width = width;
+    int32_t level_height = height;
+    float psnr = 0.0f;
+    for (int32_t level = 0; level < level_count; level++) {
+        ktx.level_sizes[level] = texcomp_size(level_width, level_height, format);
+        ktx.levels[level] = malloc(ktx.level_sizes[level]);
+        texcomp_encode(ktx.levels[level], level_rgba, level_width, level_height, format);
+        if (level == 0) {
+            psnr = texcomp_psnr(level_rgba, ktx.levels[level], level_width, level_height, format);
+        }
+        level_rgba += level_width * level_height * 4;
+        level_width = level_width > 1 ? level_width / 2 : 1;
+        level_height = level_height > 1 ? level_height / 2 : 1;
+    }
+    free(chain);
+
+    int32_t rc = ktx_write(dest_path, &ktx);
+    if (rc == NAXA_E_SUCCESS) {
+        internal_logf(NAXA_SEVERITY_INFO, "Cooked texture %s to %s (%dx%d, %d levels, %.2f dB)",
+            src_path, dest_path, width, height, ktx.level_count, psnr);
+    }
+    ktx_free(&ktx);
+    return rc;
+}
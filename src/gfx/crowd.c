@@ -0,0 +1,269 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <glad/glad.h>
+
+#include <naxa/anim.h>
+#include <naxa/err.h>
+#include <naxa/gfx.h>
+#include <naxa/log.h>
+#include <naxa/naxa_internal.h>
+
+// One instance as the crowd variant of basic.vert reads it. The clip is
+// boiled down to frames so the shader only has to wrap and look up.
+typedef struct {
+    float position[3];
+    float first_frame;
+    float rotation_quat[4];
+    float frame_count;
+    float frames_per_second;
+    float frame_offset;
+    float padding;
+} CrowdInstanceData_t;
+
+// Blend the vertex the way the skinned vertex shader does
+static void skin_vertex(VertexData_t* vertex, mat4* palette, int32_t bone_count, vec3 position, vec3 normal) {
+    if (vertex->bone_ids[0] < 0) {
+        glm_vec3_copy(vertex->position, position);
+        glm_vec3_copy(vertex->normal, normal);
+        return;
+    }
+    glm_vec3_zero(position);
+    glm_vec3_zero(normal);
+    for (int32_t i = 0; i < MAX_BONE_WEIGHTS; i++) {
+        int32_t bone = vertex->bone_ids[i];
+        if (bone < 0 || bone >= bone_count) {
+            break;
+        }
+        vec3 moved;
+        glm_mat4_mulv3(palette[bone], vertex->position, 1.0f, moved);
+        glm_vec3_muladds(moved, vertex->bone_weights[i], position);
+        glm_mat4_mulv3(palette[bone], vertex->normal, 0.0f, moved);
+        glm_vec3_muladds(moved, vertex->bone_weights[i], normal);
+    }
+    glm_vec3_normalize(normal);
+}
+
+static int32_t bake_clips(NaxaVertexAnimation_t* dest, NaxaModel_t* model, VertexData_t* vertices) {
+    NaxaPose_t pose;
+    int32_t rc = naxa_init_pose(&pose, model);
+    if (rc != NAXA_E_SUCCESS) {
+        return rc;
+    }
+    mat4* palette = malloc(model->bone_count * sizeof(mat4));
+    int32_t texels = dest->width * dest->rows_per_frame;
+    float* positions = calloc(texels, 4 * sizeof(float));
+    float* normals = calloc(texels, 4 * sizeof(float));
+    for (int32_t c = 0; c < dest->clip_count && rc == NAXA_E_SUCCESS; c++) {
+        NaxaAnimSampler_t sampler;
+        rc = naxa_init_sampler(&sampler, model, &model->clips[c]);
+        if (rc != NAXA_E_SUCCESS) {
+            break;
+        }
+        int32_t frame_count = dest->clip_frame_counts[c];
+        for (int32_t f = 0; f < frame_count; f++) {
+            rc = naxa_sample_clip(&sampler, model->clips[c].duration * f / frame_count, &pose);
+            if (rc != NAXA_E_SUCCESS) {
+                break;
+            }
+            anim_skin_palette(palette, model, &pose);
+            for (int32_t v = 0; v < model->vertex_count; v++) {
+                skin_vertex(&vertices[v], palette, model->bone_count, &positions[v * 4], &normals[v * 4]);
+                glm_vec3_minv(dest->bounds.min, &positions[v * 4], dest->bounds.min);
+                glm_vec3_maxv(dest->bounds.max, &positions[v * 4], dest->bounds.max);
+            }
+
+            // GL converts down to the texture formats on the way up
+            int32_t row = (dest->clip_first_frames[c] + f) * dest->rows_per_frame;
+            glTextureSubImage2D(dest->position_texture, 0, 0, row, dest->width, dest->rows_per_frame, GL_RGBA, GL_FLOAT, positions);
+            glTextureSubImage2D(dest->normal_texture, 0, 0, row, dest->width, dest->rows_per_frame, GL_RGBA, GL_FLOAT, normals);
+        }
+        naxa_free_sampler(&sampler);
+    }
+    free(positions);
+    free(normals);
+    free(palette);
+    naxa_free_pose(&pose);
+    return rc;
+}
+
+int32_t naxa_cook_vertex_animation(NaxaVertexAnimation_t* dest, NaxaModel_t* model, float frame_rate) {
+    if (dest == NULL || model == NULL) {
+        report_error(NAXA_E_NULLPTR);
+        return NAXA_E_NULLPTR;
+    }
+    memset(dest, 0, sizeof(NaxaVertexAnimation_t));
+    if (model->clip_count <= 0 || model->bone_count <= 0 || model->vertex_count <= 0 || frame_rate <= 0.0f) {
+        report_error(NAXA_E_BOUNDS);
+        return NAXA_E_BOUNDS;
+    }
+
+    // Lay every clip's frames out one after another, vertices wrap onto
+    // extra rows when the model is wider than a texture can be
+    int32_t max_size = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_size);
+    dest->model = model;
+    dest->clip_count = model->clip_count;
+    dest->clip_first_frames = malloc(model->clip_count * sizeof(int32_t));
+    dest->clip_frame_counts = malloc(model->clip_count * sizeof(int32_t));
+    for (int32_t c = 0; c < model->clip_count; c++) {
+        int32_t frame_count = (int32_t)ceilf(model->clips[c].duration * frame_rate);
+        dest->clip_first_frames[c] = dest->frame_count;
+        dest->clip_frame_counts[c] = frame_count > 1 ? frame_count : 1;
+        dest->frame_count += dest->clip_frame_counts[c];
+    }
+    dest->width = model->vertex_count < max_size ? model->vertex_count : max_size;
+    dest->rows_per_frame = (model->vertex_count + dest->width - 1) / dest->width;
+    if ((int64_t)dest->frame_count * dest->rows_per_frame > max_size) {
+        internal_logf(NAXA_SEVERITY_ERROR, "%d frames of %d vertices don't fit in a texture", dest->frame_count, model->vertex_count);
+        naxa_free_vertex_animation(dest);
+        report_error(NAXA_E_BOUNDS);
+        return NAXA_E_BOUNDS;
+    }
+
+    // Positions want the range of half floats, normals are fine in bytes
+    int32_t height = dest->frame_count * dest->rows_per_frame;
+    glCreateTextures(GL_TEXTURE_2D, 1, &dest->position_texture);
+    glCreateTextures(GL_TEXTURE_2D, 1, &dest->normal_texture);
+    if (dest->position_texture == 0 || dest->normal_texture == 0) {
+        naxa_free_vertex_animation(dest);
+        report_error(NAXA_E_INTERNAL);
+        return NAXA_E_INTERNAL;
+    }
+    glTextureStorage2D(dest->position_texture, 1, GL_RGBA16F, dest->width, height);
+    glTextureStorage2D(dest->normal_texture, 1, GL_RGBA8_SNORM, dest->width, height);
+
+    // The model keeps no vertices in RAM, read back what the loader uploaded
+    VertexData_t* vertices = malloc(model->vertex_count * sizeof(VertexData_t));
+    glGetNamedBufferSubData(model->vbo, 0, model->vertex_count * sizeof(VertexData_t), vertices);
+    glm_vec3_copy(vertices[0].position, dest->bounds.min);
+    glm_vec3_copy(vertices[0].position, dest->bounds.max);
+    int32_t rc = bake_clips(dest, model, vertices);
+    free(vertices);
+    if (rc != NAXA_E_SUCCESS) {
+        naxa_free_vertex_animation(dest);
+        return rc;
+    }
+    glm_vec3_center(dest->bounds.min, dest->bounds.max, dest->bounds.center);
+    dest->bounds.radius = glm_vec3_distance(dest->bounds.center, dest->bounds.max);
+
+    internal_logf(NAXA_SEVERITY_INFO, "Baked %d clips of %s into %d frames (%dx%d texels)",
+        dest->clip_count, model->path, dest->frame_count, dest->width, height);
+    return NAXA_E_SUCCESS;
+}
+
+int32_t naxa_free_vertex_animation(NaxaVertexAnimation_t* animation) {
+    if (animation == NULL) {
+        return NAXA_E_SUCCESS;
+    }
+    if (animation->position_texture != 0) {
+        glDeleteTextures(1, &animation->position_texture);
+    }
+    if (animation->normal_texture != 0) {
+        glDeleteTextures(1, &animation->normal_texture);
+    }
+    free(animation->clip_first_frames);
+    free(animation->clip_frame_counts);
+    memset(animation, 0, sizeof(NaxaVertexAnimation_t));
+    return NAXA_E_SUCCESS;
+}
+
+static void instance_data(CrowdInstanceData_t* dest, NaxaVertexAnimation_t* animation, NaxaCrowdInstance_t* instance) {
+    int32_t clip = instance->clip >= 0 && instance->clip < animation->clip_count ? instance->clip : 0;
+    float duration = animation->model->clips[clip].duration;
+    float frame_count = (float)animation->clip_frame_counts[clip];
+    float frames_per_second = duration > 0.0f ? frame_count / duration : 0.0f;
+    memcpy(dest->position, instance->position, sizeof(dest->position));
+    memcpy(dest->rotation_quat, instance->rotation_quat, sizeof(dest->rotation_quat));
+    dest->first_frame = (float)animation->clip_first_frames[clip];
+    dest->frame_count = frame_count;
+    dest->frames_per_second = frames_per_second * instance->speed;
+    dest->frame_offset = frames_per_second * instance->time_offset;
+    dest->padding = 0.0f;
+}
+
+// Fit the bounds to where the instances are now, they can move anywhere so
+// nothing from the last fit is kept
+static void crowd_bounds(NaxaCrowd_t* crowd) {
+    glm_vec3_copy(crowd->positions[0], crowd->bounds.min);
+    glm_vec3_copy(crowd->positions[0], crowd->bounds.max);
+    for (int32_t i = 1; i < crowd->instance_count; i++) {
+        glm_vec3_minv(crowd->bounds.min, crowd->positions[i], crowd->bounds.min);
+        glm_vec3_maxv(crowd->bounds.max, crowd->positions[i], crowd->bounds.max);
+    }
+
+    // Any rotation of the animation's sphere fits around its center
+    glm_vec3_center(crowd->bounds.min, crowd->bounds.max, crowd->bounds.center);
+    crowd->bounds.radius = glm_vec3_distance(crowd->bounds.center, crowd->bounds.max) +
+        glm_vec3_norm(crowd->animation->bounds.center) + crowd->animation->bounds.radius;
+}
+
+int32_t naxa_init_crowd(NaxaCrowd_t* dest, NaxaVertexAnimation_t* animation, int32_t instance_count) {
+    if (dest == NULL || animation == NULL) {
+        report_error(NAXA_E_NULLPTR);
+        return NAXA_E_NULLPTR;
+    }
+    memset(dest, 0, sizeof(NaxaCrowd_t));
+    if (instance_count <= 0 || animation->model == NULL) {
+        report_error(NAXA_E_BOUNDS);
+        return NAXA_E_BOUNDS;
+    }
+    NaxaCrowdInstance_t instance;
+    memset(&instance, 0, sizeof(instance));
+    glm_quat_identity(instance.rotation_quat);
+    instance.speed = 1.0f;
+    CrowdInstanceData_t* data = malloc(instance_count * sizeof(CrowdInstanceData_t));
+    instance_data(&data[0], animation, &instance);
+    for (int32_t i = 1; i < instance_count; i++) {
+        data[i] = data[0];
+    }
+    glCreateBuffers(1, &dest->instance_ssbo);
+    if (dest->instance_ssbo == 0) {
+        free(data);
+        report_error(NAXA_E_INTERNAL);
+        return NAXA_E_INTERNAL;
+    }
+    glNamedBufferStorage(dest->instance_ssbo, instance_count * sizeof(CrowdInstanceData_t), data, GL_DYNAMIC_STORAGE_BIT);
+    free(data);
+    dest->animation = animation;
+    dest->instance_count = instance_count;
+    dest->positions = calloc(instance_count, sizeof(vec3));
+    crowd_bounds(dest);
+    return NAXA_E_SUCCESS;
+}
+
+int32_t naxa_free_crowd(NaxaCrowd_t* crowd) {
+    if (crowd == NULL) {
+        return NAXA_E_SUCCESS;
+    }
+    if (crowd->instance_ssbo != 0) {
+        glDeleteBuffers(1, &crowd->instance_ssbo);
+    }
+    free(crowd->positions);
+    memset(crowd, 0, sizeof(NaxaCrowd_t));
+    return NAXA_E_SUCCESS;
+}
+
+int32_t naxa_set_crowd_instances(NaxaCrowd_t* crowd, int32_t first, int32_t count, NaxaCrowdInstance_t* instances) {
+    if (crowd == NULL || instances == NULL) {
+        report_error(NAXA_E_NULLPTR);
+        return NAXA_E_NULLPTR;
+    }
+    if (first < 0 || count < 0 || first + count > crowd->instance_count) {
+        report_error(NAXA_E_BOUNDS);
+        return NAXA_E_BOUNDS;
+    }
+    if (count == 0) {
+        return NAXA_E_SUCCESS;
+    }
+    CrowdInstanceData_t* data = malloc(count * sizeof(CrowdInstanceData_t));
+    for (int32_t i = 0; i < count; i++) {
+        instance_data(&data[i], crowd->animation, &instances[i]);
+        glm_vec3_copy(instances[i].position, crowd->positions[first + i]);
+    }
+    glNamedBufferSubData(crowd->instance_ssbo, first * sizeof(CrowdInstanceData_t), count * sizeof(CrowdInstanceData_t), data);
+    free(data);
+    crowd_bounds(crowd);
+    return NAXA_E_SUCCESS;
+}
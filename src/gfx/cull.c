@@ -0,0 +1,133 @@
+#if defined(__SSE__)
+#include <immintrin.h>
+#endif
+
+#include <naxa/err.h>
+#include <naxa/naxa_internal.h>
+
+#define FRUSTUM_PLANES 6
+
+int32_t cull_sphere_visible(vec4 planes[6], vec3 center, float radius) {
+    for (int32_t p = 0; p < FRUSTUM_PLANES; p++) {
+        float distance = planes[p][0] * center[0] + planes[p][1] * center[1] + planes[p][2] * center[2] + planes[p][3];
+        if (distance < -radius) {
+            return NAXA_FALSE;
+        }
+    }
+    return NAXA_TRUE;
+}
+
+int32_t cull_spheres_scalar(vec4 planes[6], int32_t count, float* x, float* y, float* z, float* r, uint8_t* visible) {
+    if (planes == NULL || x == NULL || y == NULL || z == NULL || r == NULL || visible == NULL) {
+        report_error(NAXA_E_NULLPTR);
+        return NAXA_E_NULLPTR;
+    }
+    for (int32_t i = 0; i < count; i++) {
+        visible[i] = cull_sphere_visible(planes, (vec3){ x[i], y[i], z[i] }, r[i]);
+    }
+    return NAXA_E_SUCCESS;
+}
+
+#if defined(__SSE__)
+// One 8 wide register per batch. The build only assumes SSE, so this is
+// compiled for AVX on its own and only called when the CPU has it.
+__attribute__((target("avx")))
+static int32_t cull_batches_avx(vec4 planes[6], int32_t count, float* x, float* y, float* z, float* r, uint8_t* visible) {
+    int32_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 cx = _mm256_loadu_ps(&x[i]);
+        __m256 cy = _mm256_loadu_ps(&y[i]);
+        __m256 cz = _mm256_loadu_ps(&z[i]);
+        __m256 neg_r = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(&r[i]));
+        __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        for (int32_t p = 0; p < FRUSTUM_PLANES; p++) {
+            __m256 distance = _mm256_add_ps(
+                _mm256_add_ps(_mm256_mul_ps(cx, _mm256_set1_ps(planes[p][0])), _mm256_mul_ps(cy, _mm256_set1_ps(planes[p][1]))),
+                _mm256_add_ps(_mm256_mul_ps(cz, _mm256_set1_ps(planes[p][2])), _mm256_set1_ps(planes[p][3])));
+            inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, neg_r, _CMP_GE_OQ));
+        }
+        int32_t mask = _mm256_movemask_ps(inside);
+        for (int32_t j = 0; j < 8; j++) {
+            visible[i + j] = (mask >> j) & 1;
+        }
+    }
+    return i;
+}
+
+// Two 4 wide registers per batch so we still retire 8 spheres per iteration
+static int32_t cull_batches_sse(vec4 planes[6], int32_t count, float* x, float* y, float* z, float* r, uint8_t* visible) {
+    int32_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128 cx0 = _mm_loadu_ps(&x[i]);
+        __m128 cx1 = _mm_loadu_ps(&x[i + 4]);
+        __m128 cy0 = _mm_loadu_ps(&y[i]);
+        __m128 cy1 = _mm_loadu_ps(&y[i + 4]);
+        __m128 cz0 = _mm_loadu_ps(&z[i]);
+        __m128 cz1 = _mm_loadu_ps(&z[i + 4]);
+        __m128 neg_r0 = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(&r[i]));
+        __m128 neg_r1 = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(&r[i + 4]));
+        __m128 inside0 = _mm_cmpeq_ps(neg_r0, neg_r0);
+        __m128 inside1 = inside0;
+        for (int32_t p = 0; p < FRUSTUM_PLANES; p++) {
+            __m128 nx = _mm_set1_ps(planes[p][0]);
+            __m128 ny = _mm_set1_ps(planes[p][1]);
+            __m128 nz = _mm_set1_ps(planes[p][2]);
+            __m128 d = _mm_set1_ps(planes[p][3]);
+            __m128 distance0 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(cx0, nx), _mm_mul_ps(cy0, ny)), _mm_add_ps(_mm_mul_ps(cz0, nz), d));
+            __m128 distance1 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(cx1, nx), _mm_mul_ps(cy1, ny)), _mm_add_ps(_mm_mul_ps(cz1, nz), d));
+            inside0 = _mm_and_ps(inside0, _mm_cmpge_ps(distance0, neg_r0));
+            inside1 = _mm_and_ps(inside1, _mm_cmpge_ps(distance1, neg_r1));
+        }
+        int32_t mask = _mm_movemask_ps(inside0) | (_mm_movemask_ps(inside1) << 4);
+        for (int32_t j = 0; j < 8; j++) {
+            visible[i + j] = (mask >> j) & 1;
+        }
+    }
+    return i;
+}
+#endif
+
+int32_t cull_kernel_supported(int32_t kernel) {
+    switch (kernel) {
+        case CULL_KERNEL_SCALAR:
+            return NAXA_TRUE;
+#if defined(__SSE__)
+        case CULL_KERNEL_SSE:
+            return NAXA_TRUE;
+        case CULL_KERNEL_AVX:
+            return __builtin_cpu_supports("avx") != 0;
+#endif
+    }
+    return NAXA_FALSE;
+}
+
+int32_t cull_spheres_kernel(int32_t kernel, vec4 planes[6], int32_t count, float* x, float* y, float* z, float* r, uint8_t* visible) {
+    if (planes == NULL || x == NULL || y == NULL || z == NULL || r == NULL || visible == NULL) {
+        report_error(NAXA_E_NULLPTR);
+        return NAXA_E_NULLPTR;
+    }
+    if (!cull_kernel_supported(kernel)) {
+        report_error(NAXA_E_BOUNDS);
+        return NAXA_E_BOUNDS;
+    }
+    int32_t i = 0;
+#if defined(__SSE__)
+    if (kernel == CULL_KERNEL_AVX) {
+        i = cull_batches_avx(planes, count, x, y, z, r, visible);
+    } else if (kernel == CULL_KERNEL_SSE) {
+        i = cull_batches_sse(planes, count, x, y, z, r, visible);
+    }
+#endif
+    // Whatever didn't fill a batch, or everything if we have no SIMD
+    return cull_spheres_scalar(planes, count - i, &x[i], &y[i], &z[i], &r[i], &visible[i]);
+}
+
+int32_t cull_spheres(vec4 planes[6], int32_t count, float* x, float* y, float* z, float* r, uint8_t* visible) {
+    // Widest the CPU has, looked up once
+    static int32_t best = -1;
+    if (best < 0) {
+        best = cull_kernel_supported(CULL_KERNEL_AVX) ? CULL_KERNEL_AVX :
+            (cull_kernel_supported(CULL_KERNEL_SSE) ? CULL_KERNEL_SSE : CULL_KERNEL_SCALAR);
+    }
+    return cull_spheres_kernel(best, planes, count, x, y, z, r, visible);
+}
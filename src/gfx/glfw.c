@@ -52,6 +52,7 @@ int32_t init_gfx_context(int32_t window_width, int32_t window_height, char* wind
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
     glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, GL_TRUE);
+    glfwWindowHint(GLFW_SRGB_CAPABLE, GL_TRUE);
     naxa_globals.window = glfwCreateWindow(window_width, window_height, window_name, NULL, NULL);
     if (naxa_globals.window == NULL) {
         report_error(NAXA_E_INTERNAL);
@@ -0,0 +1,292 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <naxa/err.h>
+#include <naxa/gfx.h>
+#include <naxa/naxa_internal.h>
+
+// Just enough of KTX2 for what the cooker writes: a single 2D image with
+// a mip chain, no supercompression and no key/value data.
+// https://registry.khronos.org/KTX/specs/2.0/ktxspec.v2.html
+
+#define KTX_HEADER_SIZE 80
+#define KTX_LEVEL_ENTRY_SIZE 24
+
+#define VK_FORMAT_R8G8B8A8_UNORM 37
+#define VK_FORMAT_R8G8B8A8_SRGB 43
+#define VK_FORMAT_BC1_RGBA_UNORM_BLOCK 133
+#define VK_FORMAT_BC1_RGBA_SRGB_BLOCK 134
+#define VK_FORMAT_BC3_UNORM_BLOCK 137
+#define VK_FORMAT_BC3_SRGB_BLOCK 138
+#define VK_FORMAT_BC5_UNORM_BLOCK 141
+#define VK_FORMAT_BC7_UNORM_BLOCK 145
+#define VK_FORMAT_BC7_SRGB_BLOCK 146
+
+#define KHR_DF_MODEL_RGBSDA 1
+#define KHR_DF_MODEL_BC1A 128
+#define KHR_DF_MODEL_BC3 130
+#define KHR_DF_MODEL_BC5 132
+#define KHR_DF_MODEL_BC7 134
+#define KHR_DF_PRIMARIES_BT709 1
+#define KHR_DF_TRANSFER_LINEAR 1
+#define KHR_DF_TRANSFER_SRGB 2
+#define KHR_DF_CHANNEL_ALPHA 15
+#define KHR_DF_SAMPLE_LINEAR 0x10
+
+static const uint8_t KTX_IDENTIFIER[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+// Formats without an sRGB variant have 0 there
+typedef struct {
+    int32_t format;
+    uint32_t vk_format;
+    uint32_t vk_srgb_format;
+    uint32_t color_model;
+    int32_t sample_count;
+    uint32_t sample_channels[4];
+} KtxFormatInfo_t;
+
+static const KtxFormatInfo_t KTX_FORMATS[] = {
+    { NAXA_TEXTURE_RGBA8, VK_FORMAT_R8G8B8A8_UNORM, VK_FORMAT_R8G8B8A8_SRGB, KHR_DF_MODEL_RGBSDA, 4, { 0, 1, 2, KHR_DF_CHANNEL_ALPHA } },
+    { NAXA_TEXTURE_BC1, VK_FORMAT_BC1_RGBA_UNORM_BLOCK, VK_FORMAT_BC1_RGBA_SRGB_BLOCK, KHR_DF_MODEL_BC1A, 1, { 1 } },
+    { NAXA_TEXTURE_BC3, VK_FORMAT_BC3_UNORM_BLOCK, VK_FORMAT_BC3_SRGB_BLOCK, KHR_DF_MODEL_BC3, 2, { KHR_DF_CHANNEL_ALPHA, 0 } },
+    { NAXA_TEXTURE_BC5, VK_FORMAT_BC5_UNORM_BLOCK, 0, KHR_DF_MODEL_BC5, 2, { 0, 1 } },
+    { NAXA_TEXTURE_BC7, VK_FORMAT_BC7_UNORM_BLOCK, VK_FORMAT_BC7_SRGB_BLOCK, KHR_DF_MODEL_BC7, 1, { 0 } },
+};
+
+static const KtxFormatInfo_t* find_format(int32_t format) {
+    for (int32_t i = 0; i < sizeof(KTX_FORMATS) / sizeof(KtxFormatInfo_t); i++) {
+        if (KTX_FORMATS[i].format == format) {
+            return &KTX_FORMATS[i];
+        }
+    }
+    return NULL;
+}
+
+static const KtxFormatInfo_t* find_vk_format(uint32_t vk_format, int32_t* srgb) {
+    for (int32_t i = 0; i < sizeof(KTX_FORMATS) / sizeof(KtxFormatInfo_t); i++) {
+        if (KTX_FORMATS[i].vk_format == vk_format || (vk_format != 0 && KTX_FORMATS[i].vk_srgb_format == vk_format)) {
+            *srgb = KTX_FORMATS[i].vk_srgb_format == vk_format;
+            return &KTX_FORMATS[i];
+        }
+    }
+    return NULL;
+}
+
+static void write_u32(uint8_t* dest, uint32_t value) {
+    memcpy(dest, &value, sizeof(uint32_t));
+}
+
+static void write_u64(uint8_t* dest, uint64_t value) {
+    memcpy(dest, &value, sizeof(uint64_t));
+}
+
+static uint32_t read_u32(uint8_t* src) {
+    uint32_t value;
+    memcpy(&value, src, sizeof(uint32_t));
+    return value;
+}
+
+static uint64_t read_u64(uint8_t* src) {
+    uint64_t value;
+    memcpy(&value, src, sizeof(uint64_t));
+    return value;
+}
+
+int32_t ktx_is_ktx(char* path) {
+    FILE* fp = fopen(path, "rb");
+    if (fp == NULL) {
+        return NAXA_FALSE;
+    }
+    uint8_t identifier[sizeof(KTX_IDENTIFIER)];
+    int32_t matches = fread(identifier, 1, sizeof(identifier), fp) == sizeof(identifier) &&
+        memcmp(identifier, KTX_IDENTIFIER, sizeof(identifier)) == 0;
+    fclose(fp);
+    return matches;
+}
+
+int32_t ktx_write(char* path, NaxaKtx_t* ktx) {
+    if (path == NULL || ktx == NULL) {
+        report_error(NAXA_E_NULLPTR);
+        return NAXA_E_NULLPTR;
+    }
+    const KtxFormatInfo_t* info = find_format(ktx->format);
+    if (info == NULL || (ktx->srgb && info->vk_srgb_format == 0) || ktx->level_count <= 0 || ktx->level_count > NAXA_MAX_MIP_LEVELS) {
+        report_error(NAXA_E_BOUNDS);
+        return NAXA_E_BOUNDS;
+    }
+    uint32_t block_size = texcomp_block_size(ktx->format);
+
+    // Data format descriptor, one basic block. Uncompressed texels are
+    // 1x1 blocks whose samples top out at 255.
+    int32_t compressed = ktx->format != NAXA_TEXTURE_RGBA8;
+    uint32_t dfd_block_size = 24 + 16 * info->sample_count;
+    uint32_t dfd_size = 4 + dfd_block_size;
+    uint8_t dfd[4 + 24 + 16 * 4];
+    memset(dfd, 0, sizeof(dfd));
+    write_u32(&dfd[0], dfd_size);
+    write_u32(&dfd[4], 0);
+    write_u32(&dfd[8], 2 | (dfd_block_size << 16));
+    uint32_t transfer = ktx->srgb ? KHR_DF_TRANSFER_SRGB : KHR_DF_TRANSFER_LINEAR;
+    write_u32(&dfd[12], info->color_model | (KHR_DF_PRIMARIES_BT709 << 8) | (transfer << 16));
+    write_u32(&dfd[16], compressed ? 3 | (3 << 8) : 0);
+    write_u32(&dfd[20], block_size);
+    for (int32_t i = 0; i < info->sample_count; i++) {
+        uint32_t bits = block_size * 8 / info->sample_count;
+        uint32_t channel = info->sample_channels[i];
+        if (ktx->srgb && channel == KHR_DF_CHANNEL_ALPHA) {
+            // Alpha is never gamma encoded
+            channel |= KHR_DF_SAMPLE_LINEAR;
+        }
+        uint8_t* sample = &dfd[28 + i * 16];
+        write_u32(&sample[0], (bits * i) | ((bits - 1) << 16) | (channel << 24));
+        write_u32(&sample[12], compressed ? 0xFFFFFFFF : (1u << bits) - 1);
+    }
+
+    // Mip data goes smallest level first, each aligned to the block size
+    uint32_t dfd_offset = KTX_HEADER_SIZE + KTX_LEVEL_ENTRY_SIZE * ktx->level_count;
+    uint64_t level_offsets[NAXA_MAX_MIP_LEVELS];
+    uint64_t cursor = dfd_offset + dfd_size;
+    for (int32_t level = ktx->level_count - 1; level >= 0; level--) {
+        cursor = (cursor + block_size - 1) / block_size * block_size;
+        level_offsets[level] = cursor;
+        cursor += ktx->level_sizes[level];
+    }
+
+    uint8_t header[KTX_HEADER_SIZE];
+    memset(header, 0, sizeof(header));
+    memcpy(header, KTX_IDENTIFIER, sizeof(KTX_IDENTIFIER));
+    write_u32(&header[12], ktx->srgb ? info->vk_srgb_format : info->vk_format);
+    write_u32(&header[16], 1);
+    write_u32(&header[20], ktx->width);
+    write_u32(&header[24], ktx->height);
+    write_u32(&header[36], 1);
+    write_u32(&header[40], ktx->level_count);
+    write_u32(&header[48], dfd_offset);
+    write_u32(&header[52], dfd_size);
+
+    FILE* fp = fopen(path, "wb");
+    if (fp == NULL) {
+        report_error(NAXA_E_FILE);
+        return NAXA_E_FILE;
+    }
+    fwrite(header, 1, sizeof(header), fp);
+    for (int32_t level = 0; level < ktx->level_count; level++) {
+        uint8_t entry[KTX_LEVEL_ENTRY_SIZE];
+        write_u64(&entry[0], level_offsets[level]);
+        write_u64(&entry[8], ktx->level_sizes[level]);
+        write_u64(&entry[16], ktx->level_sizes[level]);
+        fwrite(entry, 1, sizeof(entry), fp);
+    }
+    fwrite(dfd, 1, dfd_size, fp);
+    for (int32_t level = ktx->level_count - 1; level >= 0; level--) {
+        static const uint8_t padding[16] = { 0 };
+        long position = ftell(fp);
+        if (position < level_offsets[level]) {
+            fwrite(padding, 1, level_offsets[level] - position, fp);
+        }
+        fwrite(ktx->levels[level], 1, ktx->level_sizes[level], fp);
+    }
+    int32_t failed = ferror(fp);
+    fclose(fp);
+    if (failed) {
+        report_error(NAXA_E_FILE);
+        return NAXA_E_FILE;
+    }
+    return NAXA_E_SUCCESS;
+}
+
+// Only plain 2D images without supercompression
+static int32_t parse_header(NaxaKtx_t* dest, uint8_t* header) {
+    if (memcmp(header, KTX_IDENTIFIER, sizeof(KTX_IDENTIFIER)) != 0) {
+        return NAXA_FALSE;
+    }
+    int32_t srgb = NAXA_FALSE;
+    const KtxFormatInfo_t* info = find_vk_format(read_u32(&header[12]), &srgb);
+    int32_t level_count = read_u32(&header[40]);
+    level_count = level_count == 0 ? 1 : level_count;
+    if (info == NULL || read_u32(&header[28]) > 1 || read_u32(&header[32]) > 0 || read_u32(&header[36]) != 1 ||
+        read_u32(&header[44]) != 0 || level_count > NAXA_MAX_MIP_LEVELS) {
+        return NAXA_FALSE;
+    }
+    dest->format = info->format;
+    dest->srgb = srgb;
+    dest->width = read_u32(&header[20]);
+    dest->height = read_u32(&header[24]);
+    dest->level_count = level_count;
+    return NAXA_TRUE;
+}
+
+int32_t ktx_read_header(NaxaKtx_t* dest, char* path) {
+    if (dest == NULL || path == NULL) {
+        report_error(NAXA_E_NULLPTR);
+        return NAXA_E_NULLPTR;
+    }
+    memset(dest, 0, sizeof(NaxaKtx_t));
+    FILE* fp = fopen(path, "rb");
+    if (fp == NULL) {
+        report_error(NAXA_E_FILE);
+        return NAXA_E_FILE;
+    }
+    uint8_t header[KTX_HEADER_SIZE];
+    int32_t valid = fread(header, 1, sizeof(header), fp) == sizeof(header) && parse_header(dest, header);
+    fclose(fp);
+    if (!valid) {
+        report_error(NAXA_E_FILE);
+        return NAXA_E_FILE;
+    }
+    return NAXA_E_SUCCESS;
+}
+
+int32_t ktx_read(NaxaKtx_t* dest, char* path) {
+    if (dest == NULL || path == NULL) {
+        report_error(NAXA_E_NULLPTR);
+        return NAXA_E_NULLPTR;
+    }
+    memset(dest, 0, sizeof(NaxaKtx_t));
+    FILE* fp = fopen(path, "rb");
+    if (fp == NULL) {
+        report_error(NAXA_E_FILE);
+        return NAXA_E_FILE;
+    }
+    uint32_t file_len = 0;
+    uint8_t* data = (uint8_t*)read_file_into_buffer(fp, &file_len);
+    fclose(fp);
+    if (data == NULL || file_len < KTX_HEADER_SIZE || !parse_header(dest, data) ||
+        KTX_HEADER_SIZE + KTX_LEVEL_ENTRY_SIZE * dest->level_count > file_len) {
+        memset(dest, 0, sizeof(NaxaKtx_t));
+        free(data);
+        report_error(NAXA_E_FILE);
+        return NAXA_E_FILE;
+    }
+    for (int32_t level = 0; level < dest->level_count; level++) {
+        uint8_t* entry = &data[KTX_HEADER_SIZE + level * KTX_LEVEL_ENTRY_SIZE];
+        uint64_t offset = read_u64(&entry[0]);
+        uint64_t length = read_u64(&entry[8]);
+        int32_t width = dest->width >> level > 0 ? dest->width >> level : 1;
+        int32_t height = dest->height >> level > 0 ? dest->height >> level : 1;
+        if (offset + length > file_len || length != texcomp_size(width, height, dest->format)) {
+            ktx_free(dest);
+            free(data);
+            report_error(NAXA_E_FILE);
+            return NAXA_E_FILE;
+        }
+        dest->level_sizes[level] = length;
+        dest->levels[level] = malloc(length);
+        memcpy(dest->levels[level], &data[offset], length);
+    }
+    free(data);
+    return NAXA_E_SUCCESS;
+}
+
+int32_t ktx_free(NaxaKtx_t* ktx) {
+    if (ktx == NULL) {
+        return NAXA_E_SUCCESS;
+    }
+    for (int32_t level = 0; level < ktx->level_count; level++) {
+        free(ktx->levels[level]);
+        ktx->levels[level] = NULL;
+    }
+    ktx->level_count = 0;
+    return NAXA_E_SUCCESS;
+}
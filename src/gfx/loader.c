@@ -18,15 +18,9 @@
 #define TEXTURE_CACHE_SIZE 512
 #define MODEL_CACHE_HASH_SIZE 16
 #define TEXTURE_CACHE_HASH_SIZE 16
-#define MAX_BONE_WEIGHTS 4
-
-typedef struct {
-    vec3 position;
-    vec2 texture;
-    vec3 normal;
-    ivec4 bone_ids;
-    vec4 bone_weights;
-} VertexData_t;
+#define LOD_RATIO 0.5f
+#define LOD_MIN_REDUCTION 0.85f
+#define LOD_MIN_TRIANGLES 64
 
 NaxaModel_t* model_cache_next;
 NaxaModel_t model_cache[MODEL_CACHE_SIZE];
@@ -35,6 +29,85 @@ NaxaTexture_t* texture_cache_next;
 NaxaTexture_t texture_cache[TEXTURE_CACHE_SIZE];
 NaxaTexture_t* texture_cache_hash_map[TEXTURE_CACHE_HASH_SIZE];
 
+static void compute_bounds(NaxaBounds_t* bounds, VertexData_t* vertices, int32_t vertex_count) {
+    if (vertex_count <= 0) {
+        memset(bounds, 0, sizeof(NaxaBounds_t));
+        return;
+    }
+    glm_vec3_copy(vertices[0].position, bounds->min);
+    glm_vec3_copy(vertices[0].position, bounds->max);
+    for (int32_t i = 1; i < vertex_count; i++) {
+        glm_vec3_minv(bounds->min, vertices[i].position, bounds->min);
+        glm_vec3_maxv(bounds->max, vertices[i].position, bounds->max);
+    }
+    glm_vec3_center(bounds->min, bounds->max, bounds->center);
+    float radius2 = 0.0f;
+    for (int32_t i = 0; i < vertex_count; i++) {
+        float distance2 = glm_vec3_distance2(bounds->center, vertices[i].position);
+        if (distance2 > radius2) {
+            radius2 = distance2;
+        }
+    }
+    bounds->radius = sqrtf(radius2);
+}
+
+static int32_t generate_lods(NaxaSubmodel_t* submodel, uint32_t** elements, int32_t* elements_len, int32_t* elements_size, VertexData_t* vertices, int32_t vertex_offset, int32_t vertex_count) {
+    submodel->lod_count = 1;
+    submodel->lods[0].error = 0.0f;
+    int32_t full_len = submodel->lods[0].vertex_count;
+    if (full_len < LOD_MIN_TRIANGLES * 3) {
+        return NAXA_E_SUCCESS;
+    }
+
+    // Simplify in mesh local indices, each level from the one before it
+    int32_t source_len = full_len;
+    uint32_t* source = malloc(full_len * sizeof(uint32_t));
+    uint32_t* simplified = malloc(full_len * sizeof(uint32_t));
+    uint32_t* first = *elements + submodel->lods[0].offset / sizeof(uint32_t);
+    for (int32_t i = 0; i < full_len; i++) {
+        source[i] = first[i] - vertex_offset;
+    }
+    float target_ratio = 1.0f;
+    for (int32_t lod = 1; lod < NAXA_MAX_LODS; lod++) {
+        target_ratio *= LOD_RATIO;
+        int32_t target_len = (int32_t)(full_len / 3 * target_ratio) * 3;
+        int32_t simplified_len = 0;
+        float error = 0.0f;
+        int32_t rc = simplify_mesh(simplified, &simplified_len, &error, source, source_len, vertices, vertex_count, target_len);
+        if (rc != NAXA_E_SUCCESS) {
+            free(source);
+            free(simplified);
+            return rc;
+        }
+        if (simplified_len > source_len * LOD_MIN_REDUCTION) {
+            // Seams and borders are holding it in place, not worth a level
+            break;
+        }
+
+        // Append the level to the shared element buffer
+        while (*elements_len + simplified_len > *elements_size) {
+            *elements_size *= 2;
+            *elements = realloc(*elements, *elements_size * sizeof(uint32_t));
+        }
+        for (int32_t i = 0; i < simplified_len; i++) {
+            (*elements)[*elements_len + i] = simplified[i] + vertex_offset;
+        }
+        submodel->lods[lod].vertex_count = simplified_len;
+        submodel->lods[lod].offset = *elements_len * sizeof(uint32_t);
+        submodel->lods[lod].error = submodel->lods[lod - 1].error + error;
+        *elements_len += simplified_len;
+        submodel->lod_count++;
+
+        uint32_t* swap = source;
+        source = simplified;
+        simplified = swap;
+        source_len = simplified_len;
+    }
+    free(source);
+    free(simplified);
+    return NAXA_E_SUCCESS;
+}
+
 int32_t init_loader_caches() {
     memset(model_cache, 0, sizeof(model_cache));
     memset(model_cache_hash_map, 0, sizeof(model_cache_hash_map));
@@ -50,50 +123,130 @@ int32_t init_loader_caches() {
     }
     texture_cache[TEXTURE_CACHE_SIZE - 1].next = NULL;
     texture_cache_next = &texture_cache[0];
+    init_texture_pools();
+    init_streaming();
+    init_mip_tables();
     return NAXA_E_SUCCESS;
 }
 
-int32_t load_shader_program(uint32_t* dest, int32_t stages_len, NaxaShaderType_t* stages) {
-    if (dest == NULL || stages == NULL) {
-        report_error(NAXA_E_NULLPTR);
-        return NAXA_E_NULLPTR;
+static int32_t add_texture_to_cache(NaxaTexture_t** dest, char* path, NaxaTexture_t* prototype, int32_t hash_bucket) {
+    // Set up a texture cache slot
+    if (texture_cache_next == NULL) {
+        texpool_release(prototype);
+        report_error(NAXA_E_EXHAUSTED);
+        return NAXA_E_EXHAUSTED;
     }
-    int32_t success;
-    char info_log[512];
-    uint32_t program = glCreateProgram();
-    uint32_t shaders[stages_len];
-    for (int32_t i = 0; i < stages_len; i++) {
-        shaders[i] = glCreateShader(stages[i].type);
-        FILE* fp = fopen(stages[i].path, "r");
-        if (fp == NULL) {
+    int32_t path_len = strlen(path);
+    char* path_copy = malloc(path_len + 1);
+    memcpy(path_copy, path, path_len + 1);
+    NaxaTexture_t* texture = texture_cache_next;
+    NaxaTexture_t* next = texture->next;
+    memcpy(texture, prototype, sizeof(NaxaTexture_t));
+    texture_cache_next = next;
+    texture->next = texture_cache_hash_map[hash_bucket];
+    texture_cache_hash_map[hash_bucket] = texture;
+    texture->path = path_copy;
+    texture->refs = 1;
+    stream_register(texture);
+
+    internal_logf(NAXA_SEVERITY_INFO, "Newly loaded texture %s", path);
+    *dest = texture;
+    return NAXA_E_SUCCESS;
+}
+
+static uint32_t gl_texture_format(int32_t format, int32_t srgb) {
+    switch (format) {
+        case NAXA_TEXTURE_RGBA8:
+            return srgb ? GL_SRGB8_ALPHA8 : GL_RGBA8;
+        case NAXA_TEXTURE_BC1:
+            return srgb ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT : GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+        case NAXA_TEXTURE_BC3:
+            return srgb ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+        case NAXA_TEXTURE_BC5:
+            return GL_COMPRESSED_RG_RGTC2;
+        case NAXA_TEXTURE_BC7:
+            return srgb ? GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM : GL_COMPRESSED_RGBA_BPTC_UNORM;
+        default:
+            return 0;
+    }
+}
+
+// Only the header is read here, the decoder thread does the rest. Cooked
+// textures go up to the GPU in whatever format they were cooked, srgb only
+// decides for everything else.
+static int32_t read_texture_header(NaxaTexture_t* dest, char* path, int32_t srgb) {
+    memset(dest, 0, sizeof(NaxaTexture_t));
+    if (ktx_is_ktx(path)) {
+        NaxaKtx_t ktx;
+        int32_t rc = ktx_read_header(&ktx, path);
+        if (rc != NAXA_E_SUCCESS) {
+            return rc;
+        }
+        dest->format = ktx.format;
+        dest->cooked = NAXA_TRUE;
+        dest->srgb = ktx.srgb;
+        dest->internal_format = gl_texture_format(ktx.format, ktx.srgb);
+        dest->width = ktx.width;
+        dest->height = ktx.height;
+        dest->level_count = ktx.level_count;
+    } else {
+        int32_t channels;
+        if (!stbi_info(path, &dest->width, &dest->height, &channels)) {
             report_error(NAXA_E_FILE);
             return NAXA_E_FILE;
         }
-        char* source = read_file_into_buffer(fp, NULL);
-        glShaderSource(shaders[i], 1, (const char**)&source, NULL);
-        glCompileShader(shaders[i]);
-        free(source);
-        glGetShaderiv(shaders[i], GL_COMPILE_STATUS, &success);
-        if (success == 0) {
-            glGetShaderInfoLog(shaders[i], sizeof(info_log), NULL, info_log);
-            internal_logf(NAXA_SEVERITY_ERROR, "Failed to compile shader %s:\n%s", stages[i].path, info_log);
+        if (channels < 1 || channels > 4) {
+            report_error(NAXA_E_INTERNAL);
+            return NAXA_E_INTERNAL;
         }
-        glAttachShader(program, shaders[i]);
+
+        // Everything is expanded to RGBA on decode, so one pool per size
+        dest->format = NAXA_TEXTURE_RGBA8;
+        dest->srgb = srgb;
+        dest->internal_format = gl_texture_format(NAXA_TEXTURE_RGBA8, srgb);
+        dest->level_count = mip_level_count(dest->width, dest->height);
     }
-    glLinkProgram(program);
-    glGetProgramiv(program, GL_LINK_STATUS, &success);
-    if (success == 0) {
-        glGetProgramInfoLog(program, sizeof(info_log), NULL, info_log);
-        internal_logf(NAXA_SEVERITY_ERROR, "Failed to link shader:\n%s", info_log);
+    return NAXA_E_SUCCESS;
+}
+
+// Draw white until the real contents land
+static void clear_texture_layer(NaxaTexture_t* texture) {
+    static const uint8_t white[4 * 4 * 4] = {
+        255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+        255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+        255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+        255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255
+    };
+    uint32_t texture_id = texpool_texture(texture->pool);
+    uint8_t block[16];
+    uint8_t* blocks = NULL;
+    if (texture->format != NAXA_TEXTURE_RGBA8) {
+        // Compressed formats can't be cleared, fill them with a white block
+        texcomp_encode(block, (uint8_t*)white, 4, 4, texture->format);
+        int32_t width = texture->width >> texture->resident_level > 0 ? texture->width >> texture->resident_level : 1;
+        int32_t height = texture->height >> texture->resident_level > 0 ? texture->height >> texture->resident_level : 1;
+        int32_t block_size = texcomp_block_size(texture->format);
+        int32_t size = texcomp_size(width, height, texture->format);
+        blocks = malloc(size);
+        for (int32_t i = 0; i < size; i += block_size) {
+            memcpy(&blocks[i], block, block_size);
+        }
     }
-    for (int32_t i = 0; i < stages_len; i++) {
-        glDeleteShader(shaders[i]);
+    for (int32_t level = texture->resident_level; level < texture->level_count; level++) {
+        int32_t width = texture->width >> level > 0 ? texture->width >> level : 1;
+        int32_t height = texture->height >> level > 0 ? texture->height >> level : 1;
+        if (blocks) {
+            glCompressedTextureSubImage3D(texture_id, level - texture->resident_level, 0, 0, texture->layer,
+                width, height, 1, texture->internal_format, texcomp_size(width, height, texture->format), blocks);
+        } else {
+            glClearTexSubImage(texture_id, level - texture->resident_level, 0, 0, texture->layer,
+                width, height, 1, GL_RGBA, GL_UNSIGNED_BYTE, white);
+        }
     }
-    *dest = program;
-    return NAXA_E_SUCCESS;
+    free(blocks);
 }
 
-int32_t naxa_load_texture(NaxaTexture_t** dest, char* path) {
+static int32_t load_texture(NaxaTexture_t** dest, char* path, int32_t srgb) {
     if (dest == NULL || path == NULL) {
         report_error(NAXA_E_NULLPTR);
         return NAXA_E_NULLPTR;
@@ -107,6 +260,10 @@ int32_t naxa_load_texture(NaxaTexture_t** dest, char* path) {
         if (strcmp(path, current->path) == 0) {
             // We found our texture
             internal_logf(NAXA_SEVERITY_TRACE, "Found texture %s in texture cache", path);
+            if (!current->cooked && current->srgb != srgb) {
+                internal_logf(NAXA_SEVERITY_WARN, "Texture %s was loaded as %s first and stays that way", path,
+                    current->srgb ? "sRGB" : "linear");
+            }
             current->refs++;
             *dest = current;
             return NAXA_E_SUCCESS;
@@ -114,61 +271,99 @@ int32_t naxa_load_texture(NaxaTexture_t** dest, char* path) {
         current = current->next;
     }
 
-    // Do the load
-    int32_t width;
-    int32_t height;
-    int32_t channels;
-    stbi_set_flip_vertically_on_load(1);
-    stbi_uc* texture_data = stbi_load(path, &width, &height, &channels, 0);
-    if (texture_data == NULL) {
-             report_error(NAXA_E_FILE);
-        return NAXA_E_FILE;
+    NaxaTexture_t prototype;
+    int32_t rc = read_texture_header(&prototype, path, srgb);
+    if (rc != NAXA_E_SUCCESS) {
+        return rc;
     }
-    uint32_t texture_id = 0;
-    glGenTextures(1, &texture_id);
-    if (texture_id == 0) {
-        stbi_image_free(texture_data);
-        report_error(NAXA_E_INTERNAL);
-        return NAXA_E_INTERNAL;
+
+    // Start out with just the small mips
+    int32_t level = stream_initial_level(prototype.width, prototype.height, prototype.level_count);
+    prototype.resident_level = level;
+    prototype.floor_level = level;
+    rc = texpool_allocate(&prototype, prototype.internal_format, prototype.width >> level > 0 ? prototype.width >> level : 1,
+        prototype.height >> level > 0 ? prototype.height >> level : 1, prototype.level_count - level);
+    if (rc != NAXA_E_SUCCESS) {
+        return rc;
     }
-    glBindTexture(GL_TEXTURE_2D, texture_id);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    switch (channels) {
-        case 3:
-            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, texture_data);
-            break;
-        case 4:
-            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, texture_data);
-            break;
-        default:
-            stbi_image_free(texture_data);
-            report_error(NAXA_E_INTERNAL);
-            return NAXA_E_INTERNAL;
+    clear_texture_layer(&prototype);
+    rc = add_texture_to_cache(dest, path, &prototype, hash_bucket);
+    if (rc != NAXA_E_SUCCESS) {
+        return rc;
+    }
+    rc = upload_queue_texture(*dest, (*dest)->pool, (*dest)->layer, level);
+    if (rc != NAXA_E_SUCCESS) {
+        naxa_free_texture(*dest);
+        *dest = NULL;
+        return rc;
     }
-    stbi_image_free(texture_data);
+    return NAXA_E_SUCCESS;
+}
 
-    // Set up a texture cache slot
-    if (texture_cache_next == NULL) {
-        report_error(NAXA_E_EXHAUSTED);
-        return NAXA_E_EXHAUSTED;
+int32_t naxa_load_texture(NaxaTexture_t** dest, char* path) {
+    return load_texture(dest, path, NAXA_TRUE);
+}
+
+int32_t naxa_load_linear_texture(NaxaTexture_t** dest, char* path) {
+    return load_texture(dest, path, NAXA_FALSE);
+}
+
+int32_t reload_texture(char* path) {
+    if (path == NULL) {
+        report_error(NAXA_E_NULLPTR);
+        return NAXA_E_NULLPTR;
+    }
+    int32_t hash_bucket = hash_code(path) % TEXTURE_CACHE_HASH_SIZE;
+    NaxaTexture_t* texture = texture_cache_hash_map[hash_bucket];
+    while (texture && strcmp(path, texture->path) != 0) {
+        texture = texture->next;
+    }
+    if (texture == NULL) {
+        // Not something we have loaded
+        return NAXA_E_SUCCESS;
+    }
+    NaxaTexture_t prototype;
+    int32_t rc = read_texture_header(&prototype, path, texture->srgb);
+    if (rc != NAXA_E_SUCCESS) {
+        return rc;
     }
-    int32_t path_len = strlen(path);
-    char* path_copy = malloc(path_len + 1);
-    memcpy(path_copy, path, path_len + 1);
-    NaxaTexture_t* texture = texture_cache_next;
-    texture_cache_next = texture->next;
-    texture->next = texture_cache_hash_map[hash_bucket];
-    texture_cache_hash_map[hash_bucket] = texture;
-    texture->path = path_copy;
-    texture->refs = 1;
-    texture->texture = texture_id;
 
-    internal_logf(NAXA_SEVERITY_INFO, "Newly loaded texture %s", path);
-    *dest = texture;
-    return NAXA_E_SUCCESS;
+    // Whatever was on its way up is out of date now
+    upload_cancel_texture(texture);
+    texture->streaming = NAXA_FALSE;
+    texture->ceiling_level = 0;
+    if (prototype.width == texture->width && prototype.height == texture->height &&
+        prototype.internal_format == texture->internal_format && prototype.level_count == texture->level_count) {
+        // Same shape, the new contents go over the old ones in place
+        texture->format = prototype.format;
+        texture->cooked = prototype.cooked;
+        texture->srgb = prototype.srgb;
+        return upload_queue_texture(texture, texture->pool, texture->layer, texture->resident_level);
+    }
+
+    // Different shape, start the handle over at its small mips
+    int32_t level = stream_initial_level(prototype.width, prototype.height, prototype.level_count);
+    prototype.resident_level = level;
+    prototype.floor_level = level;
+    rc = texpool_allocate(&prototype, prototype.internal_format, prototype.width >> level > 0 ? prototype.width >> level : 1,
+        prototype.height >> level > 0 ? prototype.height >> level : 1, prototype.level_count - level);
+    if (rc != NAXA_E_SUCCESS) {
+        return rc;
+    }
+    clear_texture_layer(&prototype);
+    texpool_release(texture);
+    texture->pool = prototype.pool;
+    texture->layer = prototype.layer;
+    texture->width = prototype.width;
+    texture->height = prototype.height;
+    texture->level_count = prototype.level_count;
+    texture->format = prototype.format;
+    texture->cooked = prototype.cooked;
+    texture->srgb = prototype.srgb;
+    texture->internal_format = prototype.internal_format;
+    texture->resident_level = level;
+    texture->floor_level = level;
+    return upload_queue_texture(texture, texture->pool, texture->layer, level);
 }
 
 int32_t naxa_free_texture(NaxaTexture_t* texture) {
@@ -203,7 +398,9 @@ int32_t naxa_free_texture(NaxaTexture_t* texture) {
         }
 
         // Add to the available list
-        glDeleteTextures(1, &texture->texture);
+        upload_cancel_texture(texture);
+        stream_unregister(texture);
+        texpool_release(texture);
         internal_logf(NAXA_SEVERITY_INFO, "Unloaded texture %s", texture->path);
         memset(texture, 0, sizeof(NaxaTexture_t));
         texture->next = texture_cache_next;
@@ -303,8 +500,10 @@ int32_t naxa_load_model(NaxaModel_t** dest, char* path) {
     int32_t unique_bones = 0;
     int32_t bones_size = 10;
     NaxaBone_t* bones = malloc(bones_size * sizeof(NaxaBone_t));
+    int32_t* mesh_vertex_offsets = malloc(sizeof(int32_t) * scene->mNumMeshes);
     int32_t vertex_buffer_size = total_vertices * sizeof(VertexData_t);
-    int32_t element_buffer_size = total_faces * 3 * sizeof(int32_t);
+    int32_t elements_len = total_faces * 3;
+    int32_t elements_size = elements_len;
     int32_t vertex_offset = 0;
     int32_t element_offset = 0;
     VertexData_t* vertices = malloc(vertex_buffer_size);
@@ -313,7 +512,7 @@ int32_t naxa_load_model(NaxaModel_t** dest, char* path) {
             vertices[v_idx].bone_ids[bone_id_idx] = -1;
         }
     }
-    uint32_t* elements = malloc(element_buffer_size);
+    uint32_t* elements = malloc(elements_size * sizeof(uint32_t));
     for (int32_t mesh_idx = 0; mesh_idx < scene->mNumMeshes; mesh_idx++) {
         struct aiMesh* mesh = scene->mMeshes[mesh_idx];
 
@@ -333,8 +532,10 @@ int32_t naxa_load_model(NaxaModel_t** dest, char* path) {
             elements[e_idx * 3 + 1 + element_offset] = mesh->mFaces[e_idx].mIndices[1] + vertex_offset;
             elements[e_idx * 3 + 2 + element_offset] = mesh->mFaces[e_idx].mIndices[2] + vertex_offset;
         }
-        submodels[mesh_idx].vertex_count = mesh->mNumFaces * 3;
-        submodels[mesh_idx].offset = element_offset * sizeof(uint32_t);
+        submodels[mesh_idx].lods[0].vertex_count = mesh->mNumFaces * 3;
+        submodels[mesh_idx].lods[0].offset = element_offset * sizeof(uint32_t);
+        mesh_vertex_offsets[mesh_idx] = vertex_offset;
+        compute_bounds(&submodels[mesh_idx].bounds, &vertices[vertex_offset], mesh->mNumVertices);
         
         // Load bone data
         for (int32_t bone_idx = 0; bone_idx < mesh->mNumBones; bone_idx++) {
@@ -355,7 +556,7 @@ int32_t naxa_load_model(NaxaModel_t** dest, char* path) {
                 bones[unique_bones].name = malloc(mesh->mBones[bone_idx]->mName.length + 1);
                 strncpy(bones[unique_bones].name, mesh->mBones[bone_idx]->mName.data, mesh->mBones[bone_idx]->mName.length);
                 bones[unique_bones].name[mesh->mBones[bone_idx]->mName.length] = '\0';
-                memcpy(bones[unique_bones].matrix, &mesh->mBones[bone_idx]->mOffsetMatrix, sizeof(mat4));
+                anim_ai_matrix(bones[unique_bones].matrix, &mesh->mBones[bone_idx]->mOffsetMatrix);
                 unique_bones++;
             }
             for (int32_t weight_idx = 0; weight_idx < mesh->mBones[bone_idx]->mNumWeights; weight_idx++) {
@@ -379,6 +580,14 @@ int32_t naxa_load_model(NaxaModel_t** dest, char* path) {
         aiReturn ai_rc = aiGetMaterialTexture(material, aiTextureType_DIFFUSE, 0, &texture_path, NULL, NULL, NULL, NULL, NULL, NULL);
         if (ai_rc != aiReturn_SUCCESS) {
             free(directory);
+            for (int32_t loaded_idx = 0; loaded_idx < mesh_idx; loaded_idx++) {
+                if (submodels[loaded_idx].diffuse != NULL) {
+                    naxa_free_texture(submodels[loaded_idx].diffuse);
+                }
+            }
+            glDeleteVertexArrays(1, &vao);
+            glDeleteBuffers(1, &vbo);
+            glDeleteBuffers(1, &ebo);
             for (int32_t bone_idx = 0; bone_idx < unique_bones; bone_idx++) {
                 free(bones[bone_idx].name);
             }
@@ -386,6 +595,7 @@ int32_t naxa_load_model(NaxaModel_t** dest, char* path) {
             free(vertices);
             free(elements);
             free(submodels);
+            free(mesh_vertex_offsets);
             aiReleaseImport(scene);
             report_error(NAXA_E_INTERNAL);
             return NAXA_E_INTERNAL;
@@ -422,16 +632,46 @@ int32_t naxa_load_model(NaxaModel_t** dest, char* path) {
         }
     }
 
+    // Build the LOD chain of every submodel now that skinning is final
+    for (int32_t mesh_idx = 0; mesh_idx < scene->mNumMeshes; mesh_idx++) {
+        int32_t base = mesh_vertex_offsets[mesh_idx];
+        int32_t rc = generate_lods(&submodels[mesh_idx], &elements, &elements_len, &elements_size,
+            &vertices[base], base, scene->mMeshes[mesh_idx]->mNumVertices);
+        if (rc != NAXA_E_SUCCESS) {
+            internal_logf(NAXA_SEVERITY_ERROR, "Failed to generate LODs for mesh %d of %s", mesh_idx, path);
+            for (int32_t loaded_idx = 0; loaded_idx < scene->mNumMeshes; loaded_idx++) {
+                if (submodels[loaded_idx].diffuse != NULL) {
+                    naxa_free_texture(submodels[loaded_idx].diffuse);
+                }
+            }
+            glDeleteVertexArrays(1, &vao);
+            glDeleteBuffers(1, &vbo);
+            glDeleteBuffers(1, &ebo);
+            for (int32_t bone_idx = 0; bone_idx < unique_bones; bone_idx++) {
+                free(bones[bone_idx].name);
+            }
+            free(bones);
+            free(vertices);
+            free(elements);
+            free(submodels);
+            free(mesh_vertex_offsets);
+            aiReleaseImport(scene);
+            return rc;
+        }
+    }
+    free(mesh_vertex_offsets);
+    internal_logf(NAXA_SEVERITY_INFO, "Generated LODs for %s (%d indices total)", path, elements_len);
+
     // Load vertex data into VAO
     glBindVertexArray(vao);
     glBindBuffer(GL_ARRAY_BUFFER, vbo);
     glBufferData(GL_ARRAY_BUFFER, vertex_buffer_size, vertices, GL_STATIC_DRAW);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, element_buffer_size, elements, GL_STATIC_DRAW);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, elements_len * sizeof(uint32_t), elements, GL_STATIC_DRAW);
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(VertexData_t), (void*)offsetof(VertexData_t, position));
     glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(VertexData_t), (void*)offsetof(VertexData_t, texture));
     glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(VertexData_t), (void*)offsetof(VertexData_t, normal));
-    glVertexAttribPointer(3, 4, GL_INT, GL_FALSE, sizeof(VertexData_t), (void*)offsetof(VertexData_t, bone_ids));
+    glVertexAttribIPointer(3, 4, GL_INT, sizeof(VertexData_t), (void*)offsetof(VertexData_t, bone_ids));
     glVertexAttribPointer(4, 4, GL_FLOAT, GL_FALSE, sizeof(VertexData_t), (void*)offsetof(VertexData_t, bone_weights));
     glEnableVertexAttribArray(0);
     glEnableVertexAttribArray(1);
@@ -439,12 +679,11 @@ int32_t naxa_load_model(NaxaModel_t** dest, char* path) {
     glEnableVertexAttribArray(3);
     glEnableVertexAttribArray(4);
     glBindVertexArray(0);
-    free(vertices);
     free(elements);
 
     // We set everything up in OpenGL, wrap the handles up in an object
     // TODO ok this should definitely be allocated somewhere real
-    NaxaModel_t* model = malloc(sizeof(NaxaModel_t));
+    NaxaModel_t* model = calloc(1, sizeof(NaxaModel_t));
     model->vao = vao;
     model->vbo = vbo;
     model->ebo = ebo;
@@ -452,6 +691,26 @@ int32_t naxa_load_model(NaxaModel_t** dest, char* path) {
     model->submodels = submodels;
     model->bone_count = unique_bones;
     model->bones = bones;
+    model->vertex_count = total_vertices;
+    compute_bounds(&model->bounds, vertices, total_vertices);
+    free(vertices);
+
+    // A model with half a skeleton is no good to anyone, the importers clean
+    // up after themselves so the model frees like any other
+    int32_t rc = anim_import(model, scene);
+    if (rc != NAXA_E_SUCCESS) {
+        internal_logf(NAXA_SEVERITY_ERROR, "Failed to import the animations of %s", path);
+        naxa_free_model(model);
+        aiReleaseImport(scene);
+        return rc;
+    }
+    rc = morph_import(model, scene);
+    if (rc != NAXA_E_SUCCESS) {
+        internal_logf(NAXA_SEVERITY_ERROR, "Failed to import the morph targets of %s", path);
+        naxa_free_model(model);
+        aiReleaseImport(scene);
+        return rc;
+    }
     *dest = model;
     aiReleaseImport(scene);
     return NAXA_E_SUCCESS;
@@ -468,6 +727,12 @@ int32_t naxa_free_model(NaxaModel_t* model) {
         naxa_free_texture(model->submodels[i].diffuse);
     }
     free(model->submodels);
+    for (int32_t i = 0; i < model->bone_count; i++) {
+        free(model->bones[i].name);
+    }
+    free(model->bones);
+    anim_free(model);
+    morph_free(model);
     free(model);
     return NAXA_E_SUCCESS;
 }
\ No newline at end of file
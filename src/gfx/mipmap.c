@@ -0,0 +1,120 @@
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#include <math.h>
+#include <string.h>
+
+#include <naxa/err.h>
+#include <naxa/naxa_internal.h>
+
+// Resolution of the linear to sRGB table, fine enough that every 8 bit
+// value round trips
+#define LINEAR_TO_SRGB_SIZE 4096
+
+float srgb_to_linear[256];
+float unorm_to_float[256];
+uint8_t linear_to_srgb[LINEAR_TO_SRGB_SIZE];
+
+int32_t init_mip_tables() {
+    for (int32_t i = 0; i < 256; i++) {
+        float c = i / 255.0f;
+        srgb_to_linear[i] = c <= 0.04045f ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+        unorm_to_float[i] = c;
+    }
+    for (int32_t i = 0; i < LINEAR_TO_SRGB_SIZE; i++) {
+        float l = i / (float)(LINEAR_TO_SRGB_SIZE - 1);
+        float c = l <= 0.0031308f ? l * 12.92f : 1.055f * powf(l, 1.0f / 2.4f) - 0.055f;
+        linear_to_srgb[i] = (uint8_t)(c * 255.0f + 0.5f);
+    }
+    return NAXA_E_SUCCESS;
+}
+
+int32_t mip_level_count(int32_t width, int32_t height) {
+    int32_t levels = 1;
+    while (width > 1 || height > 1) {
+        width = width > 1 ? width / 2 : 1;
+        height = height > 1 ? height / 2 : 1;
+        levels++;
+    }
+    return levels;
+}
+
+int32_t mip_chain_size(int32_t width, int32_t height, int32_t level_count) {
+    int32_t size = 0;
+    for (int32_t level = 0; level < level_count; level++) {
+        size += width * height * 4;
+        width = width > 1 ? width / 2 : 1;
+        height = height > 1 ? height / 2 : 1;
+    }
+    return size;
+}
+
+// dest may be src, every pixel lands at or before the first one it reads
+// and nothing past that has been read yet
+int32_t mip_downsample(uint8_t* dest, uint8_t* src, int32_t src_width, int32_t src_height, int32_t gamma_correct) {
+    if (dest == NULL || src == NULL) {
+        report_error(NAXA_E_NULLPTR);
+        return NAXA_E_NULLPTR;
+    }
+    int32_t width = src_width > 1 ? src_width / 2 : 1;
+    int32_t height = src_height > 1 ? src_height / 2 : 1;
+
+    // Colour goes through linear light when asked, alpha never does
+    float* decode = gamma_correct ? srgb_to_linear : unorm_to_float;
+    float color_scale = gamma_correct ? LINEAR_TO_SRGB_SIZE - 1 : 255.0f;
+#if defined(__SSE2__)
+    __m128 quarter = _mm_set1_ps(0.25f);
+    __m128 scale = _mm_set_ps(255.0f, color_scale, color_scale, color_scale);
+#endif
+
+    for (int32_t y = 0; y < height; y++) {
+        int32_t y0 = y * 2 < src_height ? y * 2 : src_height - 1;
+        int32_t y1 = y * 2 + 1 < src_height ? y * 2 + 1 : y0;
+        uint8_t* row0 = &src[y0 * src_width * 4];
+        uint8_t* row1 = &src[y1 * src_width * 4];
+        for (int32_t x = 0; x < width; x++) {
+            int32_t x0 = x * 2 < src_width ? x * 2 : src_width - 1;
+            int32_t x1 = x * 2 + 1 < src_width ? x * 2 + 1 : x0;
+            uint8_t* p[4] = { &row0[x0 * 4], &row0[x1 * 4], &row1[x0 * 4], &row1[x1 * 4] };
+            uint8_t* out = &dest[(y * width + x) * 4];
+#if defined(__SSE2__)
+            __m128 sum = _mm_setzero_ps();
+            for (int32_t i = 0; i < 4; i++) {
+                sum = _mm_add_ps(sum, _mm_set_ps(unorm_to_float[p[i][3]], decode[p[i][2]], decode[p[i][1]], decode[p[i][0]]));
+            }
+            int32_t index[4];
+            _mm_storeu_si128((__m128i*)index, _mm_cvtps_epi32(_mm_mul_ps(_mm_mul_ps(sum, quarter), scale)));
+#else
+            int32_t index[4];
+            for (int32_t c = 0; c < 4; c++) {
+                float* table = c == 3 ? unorm_to_float : decode;
+                float sum = table[p[0][c]] + table[p[1][c]] + table[p[2][c]] + table[p[3][c]];
+                index[c] = (int32_t)lrintf(sum * 0.25f * (c == 3 ? 255.0f : color_scale));
+            }
+#endif
+            for (int32_t c = 0; c < 3; c++) {
+                out[c] = gamma_correct ? linear_to_srgb[index[c]] : index[c];
+            }
+            out[3] = index[3];
+        }
+    }
+    return NAXA_E_SUCCESS;
+}
+
+int32_t mip_build_chain(uint8_t* dest, int32_t width, int32_t height, int32_t level_count, int32_t gamma_correct) {
+    if (dest == NULL) {
+        report_error(NAXA_E_NULLPTR);
+        return NAXA_E_NULLPTR;
+    }
+
+    // Level 0 is already in place, every other level follows the one before
+    uint8_t* level = dest;
+    for (int32_t i = 1; i < level_count; i++) {
+        uint8_t* next = level + width * height * 4;
+        mip_downsample(next, level, width, height, gamma_correct);
+        level = next;
+        width = width > 1 ? width / 2 : 1;
+        height = height > 1 ? height / 2 : 1;
+    }
+    return NAXA_E_SUCCESS;
+}
@@ -0,0 +1,153 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include <assimp/scene.h>
+#include <assimp/types.h>
+
+#include <glad/glad.h>
+
+#include <naxa/err.h>
+#include <naxa/log.h>
+#include <naxa/naxa_internal.h>
+
+// Anything smaller than this doesn't visibly move a vertex
+#define MORPH_EPSILON 1e-6f
+
+// One vertex of one morph target as the shaders read it, the morph index
+// rides along in the fourth component of the position
+typedef struct {
+    float position[3];
+    int32_t morph;
+    float normal[3];
+    float padding;
+} MorphDelta_t;
+
+static int32_t find_or_add_morph(NaxaModel_t* model, int32_t* morphs_size, struct aiString* name) {
+    for (int32_t i = 0; name->length > 0 && i < model->morph_count; i++) {
+        if (strlen(model->morphs[i].name) == name->length && memcmp(model->morphs[i].name, name->data, name->length) == 0) {
+            return i;
+        }
+    }
+    if (model->morph_count >= *morphs_size) {
+        *morphs_size = *morphs_size ? *morphs_size * 2 : 16;
+        model->morphs = realloc(model->morphs, *morphs_size * sizeof(NaxaMorph_t));
+    }
+    NaxaMorph_t* morph = &model->morphs[model->morph_count];
+    morph->name = malloc(name->length + 1);
+    memcpy(morph->name, name->data, name->length);
+    morph->name[name->length] = '\0';
+    morph->delta_count = 0;
+    return model->morph_count++;
+}
+
+// Deltas are gathered morph by morph as Assimp has them, then sorted by
+// vertex so a shader only walks the deltas of the vertex it is on
+int32_t morph_import(NaxaModel_t* model, const struct aiScene* scene) {
+    if (model == NULL || scene == NULL) {
+        report_error(NAXA_E_NULLPTR);
+        return NAXA_E_NULLPTR;
+    }
+    model->morph_count = 0;
+    model->morphs = NULL;
+    model->morph_start_ssbo = 0;
+    model->morph_delta_ssbo = 0;
+    int32_t morphs_size = 0;
+    int32_t deltas_len = 0;
+    int32_t deltas_size = 0;
+    MorphDelta_t* deltas = NULL;
+    int32_t* delta_vertices = NULL;
+    int32_t vertex_offset = 0;
+    for (int32_t mesh_idx = 0; mesh_idx < scene->mNumMeshes; mesh_idx++) {
+        struct aiMesh* mesh = scene->mMeshes[mesh_idx];
+        for (int32_t anim_idx = 0; anim_idx < mesh->mNumAnimMeshes; anim_idx++) {
+            struct aiAnimMesh* anim_mesh = mesh->mAnimMeshes[anim_idx];
+            if (anim_mesh->mVertices == NULL || anim_mesh->mNumVertices != mesh->mNumVertices) {
+                continue;
+            }
+            int32_t morph = find_or_add_morph(model, &morphs_size, &anim_mesh->mName);
+            for (int32_t v_idx = 0; v_idx < mesh->mNumVertices; v_idx++) {
+                MorphDelta_t delta;
+                memset(&delta, 0, sizeof(delta));
+                delta.morph = morph;
+                delta.position[0] = anim_mesh->mVertices[v_idx].x - mesh->mVertices[v_idx].x;
+                delta.position[1] = anim_mesh->mVertices[v_idx].y - mesh->mVertices[v_idx].y;
+                delta.position[2] = anim_mesh->mVertices[v_idx].z - mesh->mVertices[v_idx].z;
+                if (anim_mesh->mNormals != NULL && mesh->mNormals != NULL) {
+                    delta.normal[0] = anim_mesh->mNormals[v_idx].x - mesh->mNormals[v_idx].x;
+                    delta.normal[1] = anim_mesh->mNormals[v_idx].y - mesh->mNormals[v_idx].y;
+                    delta.normal[2] = anim_mesh->mNormals[v_idx].z - mesh->mNormals[v_idx].z;
+                }
+                if (glm_vec3_norm2(delta.position) < MORPH_EPSILON * MORPH_EPSILON &&
+                    glm_vec3_norm2(delta.normal) < MORPH_EPSILON * MORPH_EPSILON) {
+                    continue;
+                }
+                if (deltas_len >= deltas_size) {
+                    deltas_size = deltas_size ? deltas_size * 2 : 256;
+                    deltas = realloc(deltas, deltas_size * sizeof(MorphDelta_t));
+                    delta_vertices = realloc(delta_vertices, deltas_size * sizeof(int32_t));
+                }
+                deltas[deltas_len] = delta;
+                delta_vertices[deltas_len] = vertex_offset + v_idx;
+                deltas_len++;
+                model->morphs[morph].delta_count++;
+            }
+        }
+        vertex_offset += mesh->mNumVertices;
+    }
+    if (model->morph_count == 0) {
+        return NAXA_E_SUCCESS;
+    }
+    model->morphs = realloc(model->morphs, model->morph_count * sizeof(NaxaMorph_t));
+
+    // Counting sort by vertex, starts[v] to starts[v + 1] are vertex v's
+    uint32_t* starts = calloc(model->vertex_count + 1, sizeof(uint32_t));
+    for (int32_t i = 0; i < deltas_len; i++) {
+        starts[delta_vertices[i] + 1]++;
+    }
+    for (int32_t v = 0; v < model->vertex_count; v++) {
+        starts[v + 1] += starts[v];
+    }
+    uint32_t* cursors = malloc(model->vertex_count * sizeof(uint32_t));
+    memcpy(cursors, starts, model->vertex_count * sizeof(uint32_t));
+    MorphDelta_t* sorted = malloc((deltas_len > 0 ? deltas_len : 1) * sizeof(MorphDelta_t));
+    for (int32_t i = 0; i < deltas_len; i++) {
+        sorted[cursors[delta_vertices[i]]++] = deltas[i];
+    }
+    free(cursors);
+    free(deltas);
+    free(delta_vertices);
+
+    glCreateBuffers(1, &model->morph_start_ssbo);
+    glCreateBuffers(1, &model->morph_delta_ssbo);
+    if (model->morph_start_ssbo == 0 || model->morph_delta_ssbo == 0) {
+        free(starts);
+        free(sorted);
+        morph_free(model);
+        report_error(NAXA_E_INTERNAL);
+        return NAXA_E_INTERNAL;
+    }
+    glNamedBufferStorage(model->morph_start_ssbo, (model->vertex_count + 1) * sizeof(uint32_t), starts, 0);
+    glNamedBufferStorage(model->morph_delta_ssbo, (deltas_len > 0 ? deltas_len : 1) * sizeof(MorphDelta_t), sorted, 0);
+    free(starts);
+    free(sorted);
+    internal_logf(NAXA_SEVERITY_INFO, "Imported %d morph targets (%d vertex deltas)", model->morph_count, deltas_len);
+    return NAXA_E_SUCCESS;
+}
+
+int32_t morph_free(NaxaModel_t* model) {
+    for (int32_t i = 0; i < model->morph_count; i++) {
+        free(model->morphs[i].name);
+    }
+    free(model->morphs);
+    if (model->morph_start_ssbo != 0) {
+        glDeleteBuffers(1, &model->morph_start_ssbo);
+    }
+    if (model->morph_delta_ssbo != 0) {
+        glDeleteBuffers(1, &model->morph_delta_ssbo);
+    }
+    model->morphs = NULL;
+    model->morph_count = 0;
+    model->morph_start_ssbo = 0;
+    model->morph_delta_ssbo = 0;
+    return NAXA_E_SUCCESS;
+}
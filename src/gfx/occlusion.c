@@ -0,0 +1,340 @@
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <naxa/err.h>
+#include <naxa/naxa_internal.h>
+
+#define OCCLUSION_WIDTH 256
+#define OCCLUSION_HEIGHT 128
+#define OCCLUSION_LEVELS 9
+#define OCCLUSION_NEAR_W 0.0001f
+#define MAX_OCCLUDERS 64
+
+typedef struct {
+    int32_t vertex_count;
+    int32_t index_count;
+    vec3* positions;
+    uint32_t* indices;
+    mat4 transform;
+} Occluder_t;
+
+int32_t occluder_count;
+Occluder_t occluders[MAX_OCCLUDERS];
+
+// Level 0 is the rasterized depth, each level after holds the furthest
+// depth of the 2x2 texels under it
+int32_t hiz_width[OCCLUSION_LEVELS];
+int32_t hiz_height[OCCLUSION_LEVELS];
+float* hiz_levels[OCCLUSION_LEVELS];
+float hiz_storage[OCCLUSION_WIDTH * OCCLUSION_HEIGHT * 2] __attribute__((aligned(16)));
+mat4 hiz_view_projection;
+int32_t hiz_ready;
+
+int32_t init_occlusion() {
+    occluder_count = 0;
+    hiz_ready = NAXA_FALSE;
+    float* cursor = hiz_storage;
+    int32_t width = OCCLUSION_WIDTH;
+    int32_t height = OCCLUSION_HEIGHT;
+    for (int32_t level = 0; level < OCCLUSION_LEVELS; level++) {
+        hiz_width[level] = width;
+        hiz_height[level] = height;
+        hiz_levels[level] = cursor;
+        cursor += width * height;
+        width = width > 1 ? width / 2 : 1;
+        height = height > 1 ? height / 2 : 1;
+    }
+    return NAXA_E_SUCCESS;
+}
+
+int32_t occlusion_add_occluder(vec3* positions, int32_t vertex_count, uint32_t* indices, int32_t index_count, mat4 transform) {
+    if (positions == NULL || indices == NULL) {
+        report_error(NAXA_E_NULLPTR);
+        return NAXA_E_NULLPTR;
+    }
+    if (occluder_count >= MAX_OCCLUDERS) {
+        report_error(NAXA_E_EXHAUSTED);
+        return NAXA_E_EXHAUSTED;
+    }
+    Occluder_t* occluder = &occluders[occluder_count];
+    occluder->vertex_count = vertex_count;
+    occluder->index_count = index_count;
+    occluder->positions = malloc(vertex_count * sizeof(vec3));
+    memcpy(occluder->positions, positions, vertex_count * sizeof(vec3));
+    occluder->indices = malloc(index_count * sizeof(uint32_t));
+    memcpy(occluder->indices, indices, index_count * sizeof(uint32_t));
+    glm_mat4_copy(transform, occluder->transform);
+    occluder_count++;
+    return NAXA_E_SUCCESS;
+}
+
+int32_t naxa_add_occluder(vec3* positions, int32_t vertex_count, uint32_t* indices, int32_t index_count, mat4 transform) {
+    if (transform == NULL) {
+        report_error(NAXA_E_NULLPTR);
+        return NAXA_E_NULLPTR;
+    }
+    return occlusion_add_occluder(positions, vertex_count, indices, index_count, transform);
+}
+
+int32_t naxa_clear_occluders() {
+    return occlusion_clear_occluders();
+}
+
+int32_t naxa_set_occlusion_culling(int32_t enabled) {
+    if (enabled) {
+        naxa_globals.flags1 |= GLOBAL_FLAGS1_OCCLUSION_CULLING;
+    } else {
+        naxa_globals.flags1 &= ~GLOBAL_FLAGS1_OCCLUSION_CULLING;
+    }
+    return NAXA_E_SUCCESS;
+}
+
+int32_t occlusion_clear_occluders() {
+    for (int32_t i = 0; i < occluder_count; i++) {
+        free(occluders[i].positions);
+        free(occluders[i].indices);
+    }
+    occluder_count = 0;
+    return NAXA_E_SUCCESS;
+}
+
+static void rasterize_triangle(vec4 a, vec4 b, vec4 c) {
+    // Anything touching the near plane is skipped, which only ever makes
+    // the occluder set smaller and so keeps the test conservative
+    if (a[3] < OCCLUSION_NEAR_W || b[3] < OCCLUSION_NEAR_W || c[3] < OCCLUSION_NEAR_W) {
+        return;
+    }
+    vec3 v[3];
+    float* clip[3] = { a, b, c };
+    for (int32_t i = 0; i < 3; i++) {
+        v[i][0] = (clip[i][0] / clip[i][3] * 0.5f + 0.5f) * OCCLUSION_WIDTH;
+        v[i][1] = (clip[i][1] / clip[i][3] * 0.5f + 0.5f) * OCCLUSION_HEIGHT;
+        v[i][2] = clip[i][2] / clip[i][3] * 0.5f + 0.5f;
+    }
+
+    // Occluders are drawn double sided, so just fix up the winding
+    float area = (v[1][0] - v[0][0]) * (v[2][1] - v[0][1]) - (v[1][1] - v[0][1]) * (v[2][0] - v[0][0]);
+    if (area < 0.0f) {
+        vec3 swap;
+        glm_vec3_copy(v[1], swap);
+        glm_vec3_copy(v[2], v[1]);
+        glm_vec3_copy(swap, v[2]);
+        area = -area;
+    }
+    if (area < 1e-6f) {
+        return;
+    }
+
+    // Edge functions and the depth plane as linear functions of the pixel
+    float edge_a[3];
+    float edge_b[3];
+    float edge_c[3];
+    for (int32_t i = 0; i < 3; i++) {
+        float* from = v[(i + 1) % 3];
+        float* to = v[(i + 2) % 3];
+        edge_a[i] = from[1] - to[1];
+        edge_b[i] = to[0] - from[0];
+        edge_c[i] = from[0] * to[1] - from[1] * to[0];
+    }
+    float inverse_area = 1.0f / area;
+    float depth_a = (edge_a[0] * v[0][2] + edge_a[1] * v[1][2] + edge_a[2] * v[2][2]) * inverse_area;
+    float depth_b = (edge_b[0] * v[0][2] + edge_b[1] * v[1][2] + edge_b[2] * v[2][2]) * inverse_area;
+    float depth_c = (edge_c[0] * v[0][2] + edge_c[1] * v[1][2] + edge_c[2] * v[2][2]) * inverse_area;
+
+    int32_t min_x = (int32_t)floorf(fminf(fminf(v[0][0], v[1][0]), v[2][0]));
+    int32_t max_x = (int32_t)ceilf(fmaxf(fmaxf(v[0][0], v[1][0]), v[2][0]));
+    int32_t min_y = (int32_t)floorf(fminf(fminf(v[0][1], v[1][1]), v[2][1]));
+    int32_t max_y = (int32_t)ceilf(fmaxf(fmaxf(v[0][1], v[1][1]), v[2][1]));
+    min_x = min_x < 0 ? 0 : min_x & ~3;
+    min_y = min_y < 0 ? 0 : min_y;
+    max_x = max_x > OCCLUSION_WIDTH - 1 ? OCCLUSION_WIDTH - 1 : max_x;
+    max_y = max_y > OCCLUSION_HEIGHT - 1 ? OCCLUSION_HEIGHT - 1 : max_y;
+
+    float* depth = hiz_levels[0];
+    for (int32_t y = min_y; y <= max_y; y++) {
+        float py = y + 0.5f;
+        int32_t x = min_x;
+#if defined(__SSE__)
+        // 4 pixels at a time. Rows are a multiple of 4 wide so the block
+        // never leaves the buffer, and the edge test rejects the extras
+        __m128 offsets = _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f);
+        for (; x <= max_x; x += 4) {
+            __m128 px = _mm_add_ps(_mm_set1_ps((float)x), offsets);
+            __m128 inside = _mm_cmpeq_ps(px, px);
+            for (int32_t i = 0; i < 3; i++) {
+                __m128 edge = _mm_add_ps(_mm_mul_ps(px, _mm_set1_ps(edge_a[i])), _mm_set1_ps(edge_b[i] * py + edge_c[i]));
+                inside = _mm_and_ps(inside, _mm_cmpge_ps(edge, _mm_setzero_ps()));
+            }
+            __m128 z = _mm_add_ps(_mm_mul_ps(px, _mm_set1_ps(depth_a)), _mm_set1_ps(depth_b * py + depth_c));
+            __m128 old = _mm_load_ps(&depth[y * OCCLUSION_WIDTH + x]);
+            __m128 updated = _mm_or_ps(_mm_and_ps(inside, _mm_min_ps(old, z)), _mm_andnot_ps(inside, old));
+            _mm_store_ps(&depth[y * OCCLUSION_WIDTH + x], updated);
+        }
+#endif
+        for (; x <= max_x; x++) {
+            float px = x + 0.5f;
+            if (edge_a[0] * px + edge_b[0] * py + edge_c[0] < 0.0f ||
+                edge_a[1] * px + edge_b[1] * py + edge_c[1] < 0.0f ||
+                edge_a[2] * px + edge_b[2] * py + edge_c[2] < 0.0f) {
+                continue;
+            }
+            float z = depth_a * px + depth_b * py + depth_c;
+            if (z < depth[y * OCCLUSION_WIDTH + x]) {
+                depth[y * OCCLUSION_WIDTH + x] = z;
+            }
+        }
+    }
+}
+
+static void build_pyramid() {
+    for (int32_t level = 1; level < OCCLUSION_LEVELS; level++) {
+        float* src = hiz_levels[level - 1];
+        float* dst = hiz_levels[level];
+        int32_t src_width = hiz_width[level - 1];
+        int32_t src_height = hiz_height[level - 1];
+        for (int32_t y = 0; y < hiz_height[level]; y++) {
+            int32_t y0 = y * 2;
+            int32_t y1 = y0 + 1 < src_height ? y0 + 1 : y0;
+            for (int32_t x = 0; x < hiz_width[level]; x++) {
+                int32_t x0 = x * 2;
+                int32_t x1 = x0 + 1 < src_width ? x0 + 1 : x0;
+                float far = fmaxf(fmaxf(src[y0 * src_width + x0], src[y0 * src_width + x1]),
+                    fmaxf(src[y1 * src_width + x0], src[y1 * src_width + x1]));
+                dst[y * hiz_width[level] + x] = far;
+            }
+        }
+    }
+}
+
+int32_t occlusion_begin_frame(mat4 view_projection) {
+    float* depth = hiz_levels[0];
+    for (int32_t i = 0; i < OCCLUSION_WIDTH * OCCLUSION_HEIGHT; i++) {
+        depth[i] = 1.0f;
+    }
+    glm_mat4_copy(view_projection, hiz_view_projection);
+    for (int32_t i = 0; i < occluder_count; i++) {
+        Occluder_t* occluder = &occluders[i];
+        mat4 mvp;
+        glm_mat4_mul(view_projection, occluder->transform, mvp);
+        for (int32_t j = 0; j + 2 < occluder->index_count; j += 3) {
+            vec4 clip[3];
+            for (int32_t k = 0; k < 3; k++) {
+                uint32_t index = occluder->indices[j + k];
+                if (index >= occluder->vertex_count) {
+                    report_error(NAXA_E_BOUNDS);
+                    return NAXA_E_BOUNDS;
+                }
+                float* position = occluder->positions[index];
+                glm_mat4_mulv(mvp, (vec4){ position[0], position[1], position[2], 1.0f }, clip[k]);
+            }
+            rasterize_triangle(clip[0], clip[1], clip[2]);
+        }
+    }
+    build_pyramid();
+    hiz_ready = NAXA_TRUE;
+    return NAXA_E_SUCCESS;
+}
+
+int32_t occlusion_end_frame() {
+    hiz_ready = NAXA_FALSE;
+    return NAXA_E_SUCCESS;
+}
+
+int32_t occlusion_frame_ready() {
+    return hiz_ready;
+}
+
+int32_t occlusion_test_box(vec3 min, vec3 max, mat4 transform) {
+    if (!hiz_ready || occluder_count == 0) {
+        return NAXA_TRUE;
+    }
+
+    // Project the corners to get a screen rectangle and the nearest depth
+    mat4 mvp;
+    glm_mat4_mul(hiz_view_projection, transform, mvp);
+    float rect_min[2] = { INFINITY, INFINITY };
+    float rect_max[2] = { -INFINITY, -INFINITY };
+    float nearest = INFINITY;
+    for (int32_t i = 0; i < 8; i++) {
+        vec4 corner = {
+            (i & 1) ? max[0] : min[0],
+            (i & 2) ? max[1] : min[1],
+            (i & 4) ? max[2] : min[2],
+            1.0f
+        };
+        glm_mat4_mulv(mvp, corner, corner);
+        if (corner[3] < OCCLUSION_NEAR_W) {
+            // Straddles the camera, we can't say anything useful
+            return NAXA_TRUE;
+        }
+        float x = (corner[0] / corner[3] * 0.5f + 0.5f) * OCCLUSION_WIDTH;
+        float y = (corner[1] / corner[3] * 0.5f + 0.5f) * OCCLUSION_HEIGHT;
+        float z = corner[2] / corner[3] * 0.5f + 0.5f;
+        rect_min[0] = fminf(rect_min[0], x);
+        rect_min[1] = fminf(rect_min[1], y);
+        rect_max[0] = fmaxf(rect_max[0], x);
+        rect_max[1] = fmaxf(rect_max[1], y);
+        nearest = fminf(nearest, z);
+    }
+    int32_t x0 = (int32_t)floorf(rect_min[0]);
+    int32_t y0 = (int32_t)floorf(rect_min[1]);
+    int32_t x1 = (int32_t)ceilf(rect_max[0]);
+    int32_t y1 = (int32_t)ceilf(rect_max[1]);
+    if (x1 < 0 || y1 < 0 || x0 >= OCCLUSION_WIDTH || y0 >= OCCLUSION_HEIGHT) {
+        // Off screen is for the frustum test to decide
+        return NAXA_TRUE;
+    }
+    x0 = x0 < 0 ? 0 : x0;
+    y0 = y0 < 0 ? 0 : y0;
+    x1 = x1 >= OCCLUSION_WIDTH ? OCCLUSION_WIDTH - 1 : x1;
+    y1 = y1 >= OCCLUSION_HEIGHT ? OCCLUSION_HEIGHT - 1 : y1;
+
+    // Pick the level where the rectangle covers at most a few texels
+    int32_t level = 0;
+    int32_t extent = (x1 - x0) > (y1 - y0) ? (x1 - x0) : (y1 - y0);
+    while (extent > 2 && level < OCCLUSION_LEVELS - 1) {
+        extent >>= 1;
+        level++;
+    }
+    float* depth = hiz_levels[level];
+    for (int32_t y = y0 >> level; y <= y1 >> level; y++) {
+        for (int32_t x = x0 >> level; x <= x1 >> level; x++) {
+            if (nearest <= depth[y * hiz_width[level] + x]) {
+                return NAXA_TRUE;
+            }
+        }
+    }
+    return NAXA_FALSE;
+}
+
+int32_t occlusion_dump(char* path, int32_t level) {
+    if (path == NULL) {
+        report_error(NAXA_E_NULLPTR);
+        return NAXA_E_NULLPTR;
+    }
+    if (level < 0 || level >= OCCLUSION_LEVELS) {
+        report_error(NAXA_E_BOUNDS);
+        return NAXA_E_BOUNDS;
+    }
+    FILE* fp = fopen(path, "wb");
+    if (fp == NULL) {
+        report_error(NAXA_E_FILE);
+        return NAXA_E_FILE;
+    }
+
+    // Binary PGM, flipped so the top row of the file is the top of the screen
+    fprintf(fp, "P5\n%d %d\n255\n", hiz_width[level], hiz_height[level]);
+    for (int32_t y = hiz_height[level] - 1; y >= 0; y--) {
+        for (int32_t x = 0; x < hiz_width[level]; x++) {
+            float z = hiz_levels[level][y * hiz_width[level] + x];
+            uint8_t pixel = (uint8_t)(fminf(fmaxf(z, 0.0f), 1.0f) * 255.0f);
+            fwrite(&pixel, 1, 1, fp);
+        }
+    }
+    fclose(fp);
+    return NAXA_E_SUCCESS;
+}
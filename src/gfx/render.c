@@ -9,30 +9,208 @@
 #include <naxa/log.h>
 #include <naxa/naxa_internal.h>
 
-#define MAX_BONES 200
+#define PALETTE_BINDING 0
+#define PALETTE_REGIONS 3
+#define PALETTE_WAIT_NANOSECONDS 1000000000
+
+// Uniform locations fixed in res/naxa.glsl
+#define U_MODEL 0
+#define U_MVP 1
+#define U_PALETTE_OFFSET 2
+#define U_TEXTURE_POOL 3
+#define U_TEXTURE_LAYER 4
+#define U_CROWD_TIME 6
+#define U_VAT_WIDTH 7
+#define U_VAT_ROWS_PER_FRAME 8
+#define U_MORPH_OFFSET 9
+#define CROWD_BINDING 3
+#define MORPH_START_BINDING 4
+#define MORPH_DELTA_BINDING 5
+#define VAT_POSITION_UNIT NAXA_TEXTURE_POOL_COUNT
+#define VAT_NORMAL_UNIT (NAXA_TEXTURE_POOL_COUNT + 1)
+#define FIELD_OF_VIEW 90.0f
+#define LOD_HYSTERESIS 0.1f
+#define CULL_MIN_CHUNK 1024
+
+// Fraction of the screen height below which each coarser LOD kicks in
+static const float LOD_SCREEN_SIZES[NAXA_MAX_LODS - 1] = { 0.5f, 0.25f, 0.125f };
 
 typedef struct {
     NaxaModel_t* model;
     vec3 position;
     vec4 rotation_quat;
+    uint32_t vao;
+    int32_t skin_slot;
+    uint32_t features;
+    int32_t palette_offset;
+    int32_t morph_offset;
+    int32_t lod;
+    float screen_size;
 } Renderable_t;
 
+typedef struct {
+    NaxaCrowd_t* crowd;
+    float time;
+    float screen_size;
+} CrowdRenderable_t;
+
 int32_t render_queue_len;
 int32_t render_queue_size;
 Renderable_t* render_queue;
+int32_t crowd_queue_len;
+int32_t crowd_queue_size;
+CrowdRenderable_t* crowd_queue;
 
-uint32_t basic_shader;
-int32_t basic_shader_u_model;
-int32_t basic_shader_u_mvp;
-int32_t basic_shader_u_skeleton;
+// Bounding spheres of the render queue in SoA form for the culling stage
+float* cull_x;
+float* cull_y;
+float* cull_z;
+float* cull_r;
+uint8_t* cull_visible;
+
+// Bone palettes of every skinned renderable this frame, packed end to end.
+// The animation code writes them straight into a persistently mapped SSBO
+// split in one region per frame in flight, so the GPU never reads a region
+// we are writing. Sizes are in vec4, a bone is a mat4 or a dual quaternion
+// and morph weights are packed four to a vec4 after the bones.
+int32_t palette_len;
+int32_t palette_size;
+int32_t palette_region;
+int32_t palette_region_ready;
+int64_t palette_region_bytes;
+uint32_t palette_ssbo;
+uint8_t* palette_mapped;
+GLsync palette_fences[PALETTE_REGIONS];
+
+NaxaShaderVariants_t basic_shader;
 
 static int32_t compare_renderables(const void* a, const void* b) {
     Renderable_t* left = (Renderable_t*)a;
     Renderable_t* right = (Renderable_t*)b;
-    if (left->model == right->model) {
-        return 0;
+
+    // Group by shader variant first, program switches cost more than VAOs
+    if (left->features != right->features) {
+        return left->features < right->features ? -1 : 1;
+    }
+    if (left->vao != right->vao) {
+        return left->vao > right->vao ? -1 : 1;
+    }
+    return 0;
+}
+
+static int32_t create_palette_buffer(int32_t size) {
+    // Regions are bound by offset, which has to be suitably aligned
+    int32_t alignment = 256;
+    glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    int64_t region_bytes = (int64_t)size * sizeof(vec4);
+    region_bytes = (region_bytes + alignment - 1) / alignment * alignment;
+
+    uint32_t ssbo = 0;
+    glCreateBuffers(1, &ssbo);
+    uint32_t flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glNamedBufferStorage(ssbo, region_bytes * PALETTE_REGIONS, NULL, flags);
+    uint8_t* mapped = glMapNamedBufferRange(ssbo, 0, region_bytes * PALETTE_REGIONS, flags);
+    if (mapped == NULL) {
+        glDeleteBuffers(1, &ssbo);
+        report_error(NAXA_E_INTERNAL);
+        return NAXA_E_INTERNAL;
+    }
+    palette_ssbo = ssbo;
+    palette_mapped = mapped;
+    palette_size = size;
+    palette_region_bytes = region_bytes;
+    palette_region = 0;
+    for (int32_t i = 0; i < PALETTE_REGIONS; i++) {
+        palette_fences[i] = NULL;
+    }
+    return NAXA_E_SUCCESS;
+}
+
+static vec4* palette_region_base() {
+    return (vec4*)(palette_mapped + palette_region * palette_region_bytes);
+}
+
+// Wait out the GPU on this frame's region the first time anything skinned
+// is queued. With three regions it is normally long done.
+static void palette_begin_frame() {
+    if (palette_region_ready) {
+        return;
+    }
+    GLsync fence = palette_fences[palette_region];
+    if (fence != NULL) {
+        glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, PALETTE_WAIT_NANOSECONDS);
+        glDeleteSync(fence);
+        palette_fences[palette_region] = NULL;
+    }
+    palette_region_ready = NAXA_TRUE;
+}
+
+// Out of room mid frame. Rare enough to just move to a bigger buffer and
+// copy over what this frame wrote, GL keeps the old one alive until the
+// draws using it are done.
+static int32_t grow_palette(int32_t needed) {
+    uint32_t old_ssbo = palette_ssbo;
+    vec4* old_region = palette_region_base();
+    GLsync old_fences[PALETTE_REGIONS];
+    memcpy(old_fences, palette_fences, sizeof(old_fences));
+    int32_t size = palette_size;
+    while (size < needed) {
+        size *= 2;
+    }
+    int32_t rc = create_palette_buffer(size);
+    if (rc != NAXA_E_SUCCESS) {
+        return rc;
+    }
+    memcpy(palette_region_base(), old_region, palette_len * sizeof(vec4));
+    glUnmapNamedBuffer(old_ssbo);
+    glDeleteBuffers(1, &old_ssbo);
+    for (int32_t i = 0; i < PALETTE_REGIONS; i++) {
+        if (old_fences[i] != NULL) {
+            glDeleteSync(old_fences[i]);
+        }
+    }
+    internal_logf(NAXA_SEVERITY_INFO, "Grew bone palette to %d vec4 per frame", size);
+    return NAXA_E_SUCCESS;
+}
+
+static void view_projection(mat4 dest) {
+    glm_perspective(glm_rad(FIELD_OF_VIEW), (float)naxa_globals.window_width / (float)naxa_globals.window_height, 0.1f, 100.0f, dest);
+}
+
+// Projected diameter of a sphere as a fraction of the screen
+static float sphere_screen_size(vec3 center, float radius) {
+    float distance = glm_vec3_norm(center);
+    if (distance <= radius) {
+        return 1.0f;
     }
-    return right->model->vao - left->model->vao;
+    return radius / (distance * tanf(glm_rad(FIELD_OF_VIEW) * 0.5f));
+}
+
+float render_screen_size(NaxaEntity_t* entity) {
+    vec3 center;
+    glm_quat_rotatev(entity->rotation_quat, entity->model->bounds.center, center);
+    glm_vec3_add(center, entity->position, center);
+    return sphere_screen_size(center, entity->model->bounds.radius);
+}
+
+static int32_t select_lod(int32_t* current, float screen_size) {
+    // Boundaries move away from the current LOD so we don't flicker
+    // between two levels when sitting right on a threshold
+    int32_t lod = 0;
+    while (lod < NAXA_MAX_LODS - 1) {
+        float threshold = LOD_SCREEN_SIZES[lod];
+        if (lod < *current) {
+            threshold *= 1.0f + LOD_HYSTERESIS;
+        } else {
+            threshold *= 1.0f - LOD_HYSTERESIS;
+        }
+        if (screen_size >= threshold) {
+            break;
+        }
+        lod++;
+    }
+    *current = lod;
+    return lod;
 }
 
 int32_t init_renderer() {
@@ -40,71 +218,277 @@ int32_t init_renderer() {
     render_queue_len = 0;
     render_queue_size = 10;
     render_queue = malloc(render_queue_size * sizeof(Renderable_t));
+    cull_x = malloc(render_queue_size * sizeof(float));
+    cull_y = malloc(render_queue_size * sizeof(float));
+    cull_z = malloc(render_queue_size * sizeof(float));
+    cull_r = malloc(render_queue_size * sizeof(float));
+    cull_visible = malloc(render_queue_size * sizeof(uint8_t));
+    crowd_queue_len = 0;
+    crowd_queue_size = 4;
+    crowd_queue = malloc(crowd_queue_size * sizeof(CrowdRenderable_t));
+    palette_len = 0;
+    palette_region_ready = NAXA_FALSE;
+    int32_t rc = create_palette_buffer(1024);
+    if (rc != NAXA_E_SUCCESS) {
+        return rc;
+    }
 
     NaxaShaderType_t basic_shader_stages[] = {
         { GL_VERTEX_SHADER, "res/basic.vert" },
         { GL_FRAGMENT_SHADER, "res/basic.frag" }
     };
-    load_shader_program(&basic_shader, sizeof(basic_shader_stages) / sizeof(NaxaShaderType_t), basic_shader_stages);
-    basic_shader_u_model = glGetUniformLocation(basic_shader, "u_model");
-    basic_shader_u_mvp = glGetUniformLocation(basic_shader, "u_mvp");
-    basic_shader_u_skeleton = glGetUniformLocation(basic_shader, "u_skeleton");
+    shader_variants_init(&basic_shader, sizeof(basic_shader_stages) / sizeof(NaxaShaderType_t), basic_shader_stages);
+
+    // Start on the variants the test scene draws with, they compile while
+    // the rest of the startup goes on
+    shader_variant(&basic_shader, 0);
+    shader_variant(&basic_shader, NAXA_SHADER_SKINNED);
 
-    glClearColor(0.5f, 0.0f, 0.5f, 1.0f);
+    // Shaders work in linear light, the framebuffer encodes back to sRGB.
+    // The clear colour is linear too, this is the old 0.5 purple.
+    glEnable(GL_FRAMEBUFFER_SRGB);
+    glClearColor(0.214f, 0.0f, 0.214f, 1.0f);
     glEnable(GL_DEPTH_TEST);
     glEnable(GL_CULL_FACE);
     glCullFace(GL_BACK);
     return NAXA_E_SUCCESS;
 }
 
+// Bring [first, last) of the queue's bounding spheres into world space and
+// test them, data is the frustum planes
+static void cull_range(void* data, int32_t first, int32_t last) {
+    vec4* planes = data;
+    for (int32_t i = first; i < last; i++) {
+        NaxaBounds_t* bounds = &render_queue[i].model->bounds;
+        vec3 center;
+        glm_quat_rotatev(render_queue[i].rotation_quat, bounds->center, center);
+        glm_vec3_add(center, render_queue[i].position, center);
+        cull_x[i] = center[0];
+        cull_y[i] = center[1];
+        cull_z[i] = center[2];
+        cull_r[i] = bounds->radius;
+    }
+    cull_spheres(planes, last - first, &cull_x[first], &cull_y[first], &cull_z[first], &cull_r[first], &cull_visible[first]);
+}
+
+static int32_t cull_render_queue(vec4 planes[6]) {
+    // Small queues stay on this thread, the chunks never get split up
+    job_parallel_for(render_queue_len, CULL_MIN_CHUNK, cull_range, planes);
+
+    // Compact the queue down to what survived
+    int32_t visible_len = 0;
+    for (int32_t i = 0; i < render_queue_len; i++) {
+        if (cull_visible[i]) {
+            render_queue[visible_len] = render_queue[i];
+            visible_len++;
+        }
+    }
+    render_queue_len = visible_len;
+    return NAXA_E_SUCCESS;
+}
+
+static void draw_submodels(NaxaModel_t* model, int32_t model_lod, float screen_size, int32_t instance_count) {
+    NaxaTexture_t* last_texture = NULL;
+    for (int32_t j = 0; j < model->submodel_count; j++) {
+        NaxaSubmodel_t* submodel = &model->submodels[j];
+        stream_request(submodel->diffuse, screen_size * naxa_globals.window_height);
+        if (submodel->diffuse != last_texture) {
+            last_texture = submodel->diffuse;
+            glUniform1i(U_TEXTURE_POOL, last_texture->pool);
+            glUniform1i(U_TEXTURE_LAYER, last_texture->layer);
+        }
+        int32_t lod = model_lod < submodel->lod_count ? model_lod : submodel->lod_count - 1;
+        glDrawElementsInstanced(GL_TRIANGLES, submodel->lods[lod].vertex_count, GL_UNSIGNED_INT,
+            (void*)(int64_t)submodel->lods[lod].offset, instance_count);
+    }
+}
+
+// A whole crowd is one instanced draw per submodel, every character finds
+// its own frame in the vertex textures
+static void draw_crowds(mat4 vp_matrix, vec4 frustum_planes[6]) {
+    uint32_t program = crowd_queue_len > 0 ? shader_variant(&basic_shader, NAXA_SHADER_CROWD) : 0;
+    if (program == 0) {
+        return;
+    }
+    glUseProgram(program);
+    glUniformMatrix4fv(U_MVP, 1, GL_FALSE, vp_matrix[0]);
+    for (int32_t i = 0; i < crowd_queue_len; i++) {
+        NaxaCrowd_t* crowd = crowd_queue[i].crowd;
+        NaxaVertexAnimation_t* animation = crowd->animation;
+        if (!cull_sphere_visible(frustum_planes, crowd->bounds.center, crowd->bounds.radius)) {
+            continue;
+        }
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CROWD_BINDING, crowd->instance_ssbo);
+        glBindTextureUnit(VAT_POSITION_UNIT, animation->position_texture);
+        glBindTextureUnit(VAT_NORMAL_UNIT, animation->normal_texture);
+        glUniform1f(U_CROWD_TIME, crowd_queue[i].time);
+        glUniform1i(U_VAT_WIDTH, animation->width);
+        glUniform1i(U_VAT_ROWS_PER_FRAME, animation->rows_per_frame);
+        glBindVertexArray(animation->model->vao);
+        draw_submodels(animation->model, crowd->lod, crowd_queue[i].screen_size, crowd->instance_count);
+    }
+}
+
 int32_t render_all() {
+    mat4 vp_matrix;
+    view_projection(vp_matrix);
+    vec4 frustum_planes[6];
+    glm_frustum_planes(vp_matrix, frustum_planes);
+    cull_render_queue(frustum_planes);
+
+    // Palettes are already in place, just point the shaders at this frame
+    if (palette_len > 0) {
+        glBindBufferRange(GL_SHADER_STORAGE_BUFFER, PALETTE_BINDING, palette_ssbo,
+            palette_region * palette_region_bytes, palette_len * sizeof(vec4));
+    }
+
+    // Pre-skin the poses that changed, once, before anything draws them.
+    // Until the compute shader is built they skin in the vertex shader.
+    for (int32_t i = 0; i < render_queue_len; i++) {
+        Renderable_t* renderable = &render_queue[i];
+        if (renderable->skin_slot < 0) {
+            continue;
+        }
+        if (renderable->palette_offset >= 0) {
+            if (!skin_dispatch(renderable->skin_slot, renderable->model, renderable->palette_offset, renderable->morph_offset, renderable->features)) {
+                continue;
+            }
+            renderable->palette_offset = -1;
+            renderable->features = 0;
+        }
+        renderable->vao = skin_vao(renderable->skin_slot);
+    }
+    skin_finish_dispatches();
+
     qsort(render_queue, render_queue_len, sizeof(Renderable_t), compare_renderables);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    mat4 vp_matrix;
-    glm_perspective(glm_rad(90.0f), (float)naxa_globals.window_width / (float)naxa_globals.window_height, 0.1f, 100.0f, vp_matrix);
-
-    glUseProgram(basic_shader);
+    uint32_t last_program = 0;
     uint32_t last_vao = 0;
-    uint32_t last_texture = 0;
+    NaxaTexture_t* last_texture = NULL;
+    draw_crowds(vp_matrix, frustum_planes);
     for (int32_t i = 0; i < render_queue_len; i++) {
+        // Static meshes get the variant without any skinning in it. Nothing
+        // draws until its variant is out of the compiler.
+        uint32_t features = render_queue[i].features;
+        uint32_t program = shader_variant(&basic_shader, features);
+        if (program == 0) {
+            continue;
+        }
+        if (program != last_program) {
+            last_program = program;
+            last_texture = NULL;
+            glUseProgram(program);
+        }
         mat4 model_matrix;
         glm_translate_make(model_matrix, render_queue[i].position);
         glm_quat_rotate(model_matrix, render_queue[i].rotation_quat, model_matrix);
-        glUniformMatrix4fv(basic_shader_u_model, 1, GL_FALSE, model_matrix[0]);
+        glUniformMatrix4fv(U_MODEL, 1, GL_FALSE, model_matrix[0]);
         mat4 mvp_matrix;
         glm_mat4_mul(vp_matrix, model_matrix, mvp_matrix);
-        glUniformMatrix4fv(basic_shader_u_mvp, 1, GL_FALSE, mvp_matrix[0]);
-        if (render_queue[i].model->vao != last_vao) {
-            last_vao = render_queue[i].model->vao;
+        glUniformMatrix4fv(U_MVP, 1, GL_FALSE, mvp_matrix[0]);
+        if (render_queue[i].vao != last_vao) {
+            last_vao = render_queue[i].vao;
             glBindVertexArray(last_vao);
         }
-        mat4 skeleton[MAX_BONES];
-        // TODO
-        int32_t bones_limit = MAX_BONES;
-        if (render_queue[i].model->bone_count < bones_limit) {
-            bones_limit = render_queue[i].model->bone_count;
+        if (features & NAXA_SHADER_SKINNED) {
+            glUniform1i(U_PALETTE_OFFSET, render_queue[i].palette_offset);
         }
-        for (int32_t j = 0; j < bones_limit; j++) {
-            memcpy(skeleton[j], render_queue[i].model->bones[j].matrix, sizeof(mat4));
-            glm_mat4_identity(render_queue[i].model->bones[j].matrix);
-            //glm_rotate_x(render_queue[i].model->bones[j].matrix, 0.1f, render_queue[i].model->bones[j].matrix);
+        if (features & NAXA_SHADER_MORPH) {
+            glUniform1i(U_MORPH_OFFSET, render_queue[i].morph_offset);
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, MORPH_START_BINDING, render_queue[i].model->morph_start_ssbo);
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, MORPH_DELTA_BINDING, render_queue[i].model->morph_delta_ssbo);
         }
-        glUniformMatrix4fv(basic_shader_u_skeleton, bones_limit, GL_FALSE, skeleton[0][0]);
         for (int32_t j = 0; j < render_queue[i].model->submodel_count; j++) {
             NaxaSubmodel_t* submodel = &render_queue[i].model->submodels[j];
-            if (submodel->diffuse->texture != last_texture) {
-                last_texture = submodel->diffuse->texture;
-                glBindTexture(GL_TEXTURE_2D, last_texture);
+            if (render_queue[i].model->submodel_count > 1) {
+                vec3 center;
+                glm_quat_rotatev(render_queue[i].rotation_quat, submodel->bounds.center, center);
+                glm_vec3_add(center, render_queue[i].position, center);
+                if (!cull_sphere_visible(frustum_planes, center, submodel->bounds.radius)) {
+                    continue;
+                }
+            }
+            stream_request(submodel->diffuse, render_queue[i].screen_size * naxa_globals.window_height);
+
+            // Every pool stays bound, switching textures is just two uniforms
+            if (submodel->diffuse != last_texture) {
+                last_texture = submodel->diffuse;
+                glUniform1i(U_TEXTURE_POOL, last_texture->pool);
+                glUniform1i(U_TEXTURE_LAYER, last_texture->layer);
             }
-            glDrawElements(GL_TRIANGLES, submodel->vertex_count, GL_UNSIGNED_INT, (void*)(int64_t)submodel->offset);
+            int32_t lod = render_queue[i].lod < submodel->lod_count ? render_queue[i].lod : submodel->lod_count - 1;
+            glDrawElements(GL_TRIANGLES, submodel->lods[lod].vertex_count, GL_UNSIGNED_INT, (void*)(int64_t)submodel->lods[lod].offset);
         }
     }
 
+    // Hand this frame's region over to the GPU
+    if (palette_region_ready) {
+        palette_fences[palette_region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        palette_region = (palette_region + 1) % PALETTE_REGIONS;
+        palette_region_ready = NAXA_FALSE;
+    }
+
     glfwSwapBuffers(naxa_globals.window);
 
     render_queue_len = 0;
+    crowd_queue_len = 0;
+    palette_len = 0;
+    occlusion_end_frame();
+
+    return NAXA_E_SUCCESS;
+}
+
+uint32_t render_skin_features() {
+    if (naxa_globals.flags1 & GLOBAL_FLAGS1_DUAL_QUAT_SKINNING) {
+        return NAXA_SHADER_SKINNED | NAXA_SHADER_DUAL_QUAT;
+    }
+    return NAXA_SHADER_SKINNED;
+}
+
+int32_t naxa_set_dual_quat_skinning(int32_t enabled) {
+    if (enabled) {
+        naxa_globals.flags1 |= GLOBAL_FLAGS1_DUAL_QUAT_SKINNING;
+    } else {
+        naxa_globals.flags1 &= ~GLOBAL_FLAGS1_DUAL_QUAT_SKINNING;
+    }
+
+    // Get the variant going before anything draws with it
+    shader_variant(&basic_shader, render_skin_features());
+    return NAXA_E_SUCCESS;
+}
+
+// Poses with every morph at 0 draw without the morph pass at all
+static int32_t morphs_active(NaxaPose_t* pose) {
+    for (int32_t i = 0; i < pose->morph_count; i++) {
+        if (pose->morph_weights[i] != 0.0f) {
+            return NAXA_TRUE;
+        }
+    }
+    return NAXA_FALSE;
+}
 
+int32_t render_enqueue_crowd(NaxaCrowd_t* crowd, float time) {
+    if (crowd == NULL || crowd->animation == NULL) {
+        report_error(NAXA_E_NULLPTR);
+        return NAXA_E_NULLPTR;
+    }
+    if (crowd_queue_len >= crowd_queue_size) {
+        crowd_queue_size *= 2;
+        crowd_queue = realloc(crowd_queue, crowd_queue_size * sizeof(CrowdRenderable_t));
+    }
+
+    // The LOD goes by the character nearest to the camera
+    vec3 nearest;
+    for (int32_t i = 0; i < 3; i++) {
+        nearest[i] = glm_clamp(0.0f, crowd->bounds.min[i], crowd->bounds.max[i]);
+    }
+    float screen_size = sphere_screen_size(nearest, crowd->animation->bounds.radius);
+    select_lod(&crowd->lod, screen_size);
+    crowd_queue[crowd_queue_len].crowd = crowd;
+    crowd_queue[crowd_queue_len].time = time;
+    crowd_queue[crowd_queue_len].screen_size = screen_size;
+    crowd_queue_len++;
     return NAXA_E_SUCCESS;
 }
 
@@ -113,13 +497,95 @@ int32_t render_enqueue(NaxaEntity_t* entity) {
         report_error(NAXA_E_NULLPTR);
         return NAXA_E_NULLPTR;
     }
+
+    // Hidden behind an occluder, never make it into the queue
+    if (naxa_globals.flags1 & GLOBAL_FLAGS1_OCCLUSION_CULLING) {
+        if (!occlusion_frame_ready()) {
+            mat4 vp_matrix;
+            view_projection(vp_matrix);
+            occlusion_begin_frame(vp_matrix);
+        }
+        mat4 model_matrix;
+        glm_translate_make(model_matrix, entity->position);
+        glm_quat_rotate(model_matrix, entity->rotation_quat, model_matrix);
+        if (!occlusion_test_box(entity->model->bounds.min, entity->model->bounds.max, model_matrix)) {
+            return NAXA_E_SUCCESS;
+        }
+    }
+
     if (render_queue_len >= render_queue_size) {
         render_queue_size *= 2;
         render_queue = realloc(render_queue, render_queue_size * sizeof(Renderable_t));
+        cull_x = realloc(cull_x, render_queue_size * sizeof(float));
+        cull_y = realloc(cull_y, render_queue_size * sizeof(float));
+        cull_z = realloc(cull_z, render_queue_size * sizeof(float));
+        cull_r = realloc(cull_r, render_queue_size * sizeof(float));
+        cull_visible = realloc(cull_visible, render_queue_size * sizeof(uint8_t));
     }
     render_queue[render_queue_len].model = entity->model;
+    render_queue[render_queue_len].screen_size = render_screen_size(entity);
+    render_queue[render_queue_len].lod = select_lod(&entity->lod, render_queue[render_queue_len].screen_size);
     glm_vec3_copy(entity->position, render_queue[render_queue_len].position);
     glm_vec4_copy(entity->rotation_quat, render_queue[render_queue_len].rotation_quat);
+    render_queue[render_queue_len].vao = entity->model->vao;
+    render_queue[render_queue_len].skin_slot = -1;
+    int32_t bone_count = entity->model->bone_count;
+    uint32_t features = bone_count > 0 ? render_skin_features() : 0;
+    int32_t morph_len = 0;
+    if (entity->pose != NULL && entity->pose->morph_count == entity->model->morph_count && morphs_active(entity->pose)) {
+        features |= NAXA_SHADER_MORPH;
+        morph_len = (entity->model->morph_count + 3) / 4;
+    }
+
+    // Pre-skinned poses only need a palette when they changed since they
+    // were last skinned, otherwise last frame's vertices are drawn again
+    int32_t needs_palette = features != 0;
+    if (bone_count > 0 && entity->pose != NULL && (naxa_globals.flags1 & GLOBAL_FLAGS1_PRESKINNING)) {
+        int32_t stale = NAXA_TRUE;
+        render_queue[render_queue_len].skin_slot = skin_acquire(entity->pose, entity->model, features, &stale);
+        needs_palette = stale;
+    }
+
+    // Reserve this entity's slice of the frame palette. Slices start on a
+    // whole mat4 so matrices stay aligned whatever came before them.
+    if (needs_palette) {
+        palette_begin_frame();
+        int32_t dual_quat = features & NAXA_SHADER_DUAL_QUAT;
+        int32_t offset = (palette_len + 3) & ~3;
+        int32_t len = bone_count * (dual_quat ? 2 : 4);
+        if (offset + len + morph_len > palette_size && grow_palette(offset + len + morph_len) != NAXA_E_SUCCESS) {
+            return NAXA_E_INTERNAL;
+        }
+
+        // Bind pose until something drives the skeleton
+        vec4* palette = &palette_region_base()[offset];
+        if (entity->pose != NULL && dual_quat) {
+            anim_skin_dual_quats(palette, entity->model, entity->pose);
+        } else if (entity->pose != NULL) {
+            anim_skin_palette((mat4*)palette, entity->model, entity->pose);
+        } else if (dual_quat) {
+            vec4 identity[2] = { { 0.0f, 0.0f, 0.0f, 1.0f }, { 0.0f, 0.0f, 0.0f, 0.0f } };
+            for (int32_t i = 0; i < bone_count; i++) {
+                memcpy(&palette[2 * i], identity, sizeof(identity));
+            }
+        } else {
+            for (int32_t i = 0; i < bone_count; i++) {
+                glm_mat4_identity(((mat4*)palette)[i]);
+            }
+        }
+        if (morph_len > 0) {
+            memset(&palette[len], 0, morph_len * sizeof(vec4));
+            memcpy(&palette[len], entity->pose->morph_weights, entity->pose->morph_count * sizeof(float));
+        }
+        render_queue[render_queue_len].palette_offset = offset;
+        render_queue[render_queue_len].morph_offset = offset + len;
+        render_queue[render_queue_len].features = features;
+        palette_len = offset + len + morph_len;
+    } else {
+        render_queue[render_queue_len].palette_offset = -1;
+        render_queue[render_queue_len].morph_offset = -1;
+        render_queue[render_queue_len].features = 0;
+    }
     render_queue_len++;
     
     return NAXA_E_SUCCESS;
@@ -0,0 +1,541 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <naxa/err.h>
+#include <naxa/log.h>
+#include <naxa/naxa_internal.h>
+
+// Linked programs are kept on disk as driver binaries. The key covers the
+// exact source every stage is compiled from and the driver that compiled
+// it, so an edit or a driver update just means compiling again.
+#define SHADER_CACHE_DIRECTORY "cache"
+#define SHADER_CACHE_MAGIC 0x4250584E
+#define SHADER_MAX_INCLUDE_DEPTH 16
+
+// KHR_parallel_shader_compile isn't in our glad, ARB has the same enums
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+typedef void (*MaxShaderCompilerThreads_t)(uint32_t count);
+
+// Indexed by feature bit, each one becomes a define in every stage
+static const char* SHADER_FEATURE_DEFINES[NAXA_SHADER_FEATURE_COUNT] = {
+    "NAXA_SKINNED",
+    "NAXA_DUAL_QUAT",
+    "NAXA_CROWD",
+    "NAXA_MORPH",
+};
+
+typedef struct {
+    char* data;
+    int32_t len;
+    int32_t size;
+} ShaderSource_t;
+
+// A program on its way through the driver, dest is written when it's done
+typedef struct ShaderBuild_t {
+    struct ShaderBuild_t* next;
+    uint32_t* dest;
+    uint64_t* key_dest;
+    int32_t* failed_dest;
+    uint32_t program;
+    int32_t stages_len;
+    NaxaShaderType_t stages[NAXA_SHADER_MAX_STAGES];
+    uint32_t shaders[NAXA_SHADER_MAX_STAGES];
+    uint32_t features;
+    uint64_t key;
+    int32_t cacheable;
+    int32_t cached;
+    double start;
+} ShaderBuild_t;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t binary_format;
+    uint64_t key;
+} ShaderCacheHeader_t;
+
+ShaderBuild_t* shader_builds;
+int32_t shader_parallel;
+NaxaShaderVariants_t* shader_variant_sets[NAXA_SHADER_MAX_VARIANT_SETS];
+int32_t shader_variant_sets_len;
+
+static void source_append(ShaderSource_t* source, const char* text, int32_t len) {
+    while (source->len + len + 1 > source->size) {
+        source->size = source->size ? source->size * 2 : 4096;
+        source->data = realloc(source->data, source->size);
+    }
+    memcpy(&source->data[source->len], text, len);
+    source->len += len;
+    source->data[source->len] = '\0';
+}
+
+static void source_appendf(ShaderSource_t* source, const char* format, int32_t value) {
+    char line[64];
+    int32_t len = snprintf(line, sizeof(line), format, value);
+    source_append(source, line, len);
+}
+
+// Pull in #include "file" lines relative to the including file. Every
+// #include is expanded in place and the GLSL compiler sorts out the #ifdefs
+// around them, so files pulled in from more than one place carry their own
+// #ifndef guard. Features are defined right after #version, which has to stay
+// the first line, and #line keeps compile errors pointing at the right
+// line of the file they are in.
+static int32_t preprocess(ShaderSource_t* dest, char* path, uint32_t features, int32_t depth) {
+    FILE* fp = fopen(path, "r");
+    if (fp == NULL) {
+        internal_logf(NAXA_SEVERITY_ERROR, "Could not open shader source %s", path);
+        report_error(NAXA_E_FILE);
+        return NAXA_E_FILE;
+    }
+    char* text = read_file_into_buffer(fp, NULL);
+    fclose(fp);
+    int32_t path_len = strlen(path);
+
+    int32_t rc = NAXA_E_SUCCESS;
+    int32_t line_number = 1;
+    char* line = text;
+    while (*line && rc == NAXA_E_SUCCESS) {
+        char* end = strchr(line, '\n');
+        int32_t len = end ? end - line + 1 : strlen(line);
+        char* directive = line;
+        while (*directive == ' ' || *directive == '\t') {
+            directive++;
+        }
+        if (strncmp(directive, "#include", 8) == 0) {
+            char* open = strchr(directive, '"');
+            char* close = open ? strchr(open + 1, '"') : NULL;
+            if (close == NULL || close > line + len) {
+                internal_logf(NAXA_SEVERITY_ERROR, "Malformed #include in %s line %d", path, line_number);
+                rc = NAXA_E_COMPILE;
+                report_error(rc);
+                break;
+            }
+
+            // Relative to the directory of the file doing the including
+            int32_t directory_len = path_len;
+            while (directory_len > 0 && path[directory_len - 1] != '/') {
+                directory_len--;
+            }
+            int32_t name_len = close - open - 1;
+            char* include_path = malloc(directory_len + name_len + 1);
+            memcpy(include_path, path, directory_len);
+            memcpy(&include_path[directory_len], open + 1, name_len);
+            include_path[directory_len + name_len] = '\0';
+            if (depth >= SHADER_MAX_INCLUDE_DEPTH) {
+                internal_logf(NAXA_SEVERITY_ERROR, "Includes nest too deep in %s line %d", path, line_number);
+                report_error(NAXA_E_EXHAUSTED);
+                rc = NAXA_E_EXHAUSTED;
+            } else {
+                source_appendf(dest, "#line %d\n", 1);
+                rc = preprocess(dest, include_path, features, depth + 1);
+                source_appendf(dest, "#line %d\n", line_number + 1);
+            }
+            free(include_path);
+        } else {
+            source_append(dest, line, len);
+            if (len > 0 && line[len - 1] != '\n') {
+                source_append(dest, "\n", 1);
+            }
+            if (depth == 0 && strncmp(directive, "#version", 8) == 0) {
+                for (int32_t i = 0; i < NAXA_SHADER_FEATURE_COUNT; i++) {
+                    if (features & (1 << i)) {
+                        source_append(dest, "#define ", 8);
+                        source_append(dest, SHADER_FEATURE_DEFINES[i], strlen(SHADER_FEATURE_DEFINES[i]));
+                        source_append(dest, " 1\n", 3);
+                    }
+                }
+                source_appendf(dest, "#line %d\n", line_number + 1);
+            }
+        }
+        line += len;
+        line_number++;
+    }
+    free(text);
+    return rc;
+}
+
+static char* load_shader_source(char* path, uint32_t features) {
+    ShaderSource_t source;
+    memset(&source, 0, sizeof(source));
+    int32_t rc = preprocess(&source, path, features, 0);
+    if (rc != NAXA_E_SUCCESS) {
+        free(source.data);
+        return NULL;
+    }
+    return source.data;
+}
+
+static uint64_t fnv1a(uint64_t hash, const void* data, size_t len) {
+    const uint8_t* bytes = data;
+    for (size_t i = 0; i < len; i++) {
+        hash ^= bytes[i];
+        hash *= 0x100000001B3ull;
+    }
+    return hash;
+}
+
+static uint64_t program_key(int32_t stages_len, NaxaShaderType_t* stages, char** sources) {
+    uint64_t hash = 0xCBF29CE484222325ull;
+    GLenum driver[3] = { GL_VENDOR, GL_RENDERER, GL_VERSION };
+    for (int32_t i = 0; i < 3; i++) {
+        const char* string = (const char*)glGetString(driver[i]);
+        if (string) {
+            hash = fnv1a(hash, string, strlen(string) + 1);
+        }
+    }
+    for (int32_t i = 0; i < stages_len; i++) {
+        hash = fnv1a(hash, &stages[i].type, sizeof(stages[i].type));
+        hash = fnv1a(hash, sources[i], strlen(sources[i]) + 1);
+    }
+    return hash;
+}
+
+static void cache_path(char* dest, size_t len, uint64_t key) {
+    snprintf(dest, len, "%s/%016llx.bin", SHADER_CACHE_DIRECTORY, (unsigned long long)key);
+}
+
+static int32_t load_cached_program(uint32_t program, uint64_t key) {
+    char path[64];
+    cache_path(path, sizeof(path), key);
+    FILE* fp = fopen(path, "rb");
+    if (fp == NULL) {
+        return NAXA_FALSE;
+    }
+    uint32_t file_len = 0;
+    uint8_t* data = (uint8_t*)read_file_into_buffer(fp, &file_len);
+    fclose(fp);
+    ShaderCacheHeader_t header;
+    if (data == NULL || file_len < sizeof(header)) {
+        free(data);
+        return NAXA_FALSE;
+    }
+    memcpy(&header, data, sizeof(header));
+    if (header.magic != SHADER_CACHE_MAGIC || header.key != key) {
+        free(data);
+        return NAXA_FALSE;
+    }
+
+    // The driver is free to reject a binary for any reason, that is fine
+    int32_t success = 0;
+    glProgramBinary(program, header.binary_format, &data[sizeof(header)], file_len - sizeof(header));
+    free(data);
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    return success != 0;
+}
+
+static void save_cached_program(uint32_t program, uint64_t key) {
+    int32_t binary_len = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &binary_len);
+    if (binary_len <= 0) {
+        return;
+    }
+    ShaderCacheHeader_t header = { .magic = SHADER_CACHE_MAGIC, .key = key };
+    uint8_t* binary = malloc(binary_len);
+    glGetProgramBinary(program, binary_len, &binary_len, &header.binary_format, binary);
+
+    char path[64];
+    cache_path(path, sizeof(path), key);
+    mkdir(SHADER_CACHE_DIRECTORY, 0755);
+    FILE* fp = fopen(path, "wb");
+    if (fp == NULL) {
+        internal_logf(NAXA_SEVERITY_WARN, "Could not write shader cache %s", path);
+        free(binary);
+        return;
+    }
+    fwrite(&header, 1, sizeof(header), fp);
+    fwrite(binary, 1, binary_len, fp);
+    fclose(fp);
+    free(binary);
+}
+
+int32_t init_shaders() {
+    shader_builds = NULL;
+    shader_parallel = NAXA_FALSE;
+
+    // Let the driver compile on as many threads as it likes, we only ask
+    // whether a program is done when we are about to use it
+    if (glfwExtensionSupported("GL_KHR_parallel_shader_compile")) {
+        MaxShaderCompilerThreads_t max_threads = (MaxShaderCompilerThreads_t)glfwGetProcAddress("glMaxShaderCompilerThreadsKHR");
+        if (max_threads) {
+            max_threads(0xFFFFFFFF);
+            shader_parallel = NAXA_TRUE;
+        }
+    } else if (glfwExtensionSupported("GL_ARB_parallel_shader_compile")) {
+        MaxShaderCompilerThreads_t max_threads = (MaxShaderCompilerThreads_t)glfwGetProcAddress("glMaxShaderCompilerThreadsARB");
+        if (max_threads) {
+            max_threads(0xFFFFFFFF);
+            shader_parallel = NAXA_TRUE;
+        }
+    }
+    internal_logf(NAXA_SEVERITY_INFO, "Parallel shader compilation %s", shader_parallel ? "enabled" : "unavailable");
+    return NAXA_E_SUCCESS;
+}
+
+// Read the sources and either load the cached binary or kick off the
+// compile and link without asking how it went
+static ShaderBuild_t* submit_build(uint32_t* dest, int32_t stages_len, NaxaShaderType_t* stages, uint32_t features) {
+    if (stages_len > NAXA_SHADER_MAX_STAGES) {
+        report_error(NAXA_E_BOUNDS);
+        return NULL;
+    }
+    double start = glfwGetTime();
+    char* sources[NAXA_SHADER_MAX_STAGES];
+    for (int32_t i = 0; i < stages_len; i++) {
+        sources[i] = load_shader_source(stages[i].path, features);
+        if (sources[i] == NULL) {
+            for (int32_t j = 0; j < i; j++) {
+                free(sources[j]);
+            }
+            return NULL;
+        }
+    }
+    ShaderBuild_t* build = calloc(1, sizeof(ShaderBuild_t));
+    build->dest = dest;
+    build->stages_len = stages_len;
+    memcpy(build->stages, stages, stages_len * sizeof(NaxaShaderType_t));
+    build->features = features;
+    build->start = start;
+
+    // Try the binary from a previous run before compiling anything
+    build->program = glCreateProgram();
+    build->key = program_key(stages_len, stages, sources);
+    int32_t binary_formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &binary_formats);
+    build->cacheable = binary_formats > 0;
+    build->cached = build->cacheable && load_cached_program(build->program, build->key);
+    if (!build->cached) {
+        // A rejected binary can leave the program in a state where it
+        // won't take shaders, start over with a fresh one
+        glDeleteProgram(build->program);
+        build->program = glCreateProgram();
+        for (int32_t i = 0; i < stages_len; i++) {
+            build->shaders[i] = glCreateShader(stages[i].type);
+            glShaderSource(build->shaders[i], 1, (const char**)&sources[i], NULL);
+            glCompileShader(build->shaders[i]);
+            glAttachShader(build->program, build->shaders[i]);
+        }
+        glProgramParameteri(build->program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        glLinkProgram(build->program);
+    }
+    for (int32_t i = 0; i < stages_len; i++) {
+        free(sources[i]);
+    }
+    return build;
+}
+
+static int32_t build_complete(ShaderBuild_t* build) {
+    if (build->cached || !shader_parallel) {
+        return NAXA_TRUE;
+    }
+    int32_t complete = 0;
+    glGetProgramiv(build->program, GL_COMPLETION_STATUS_KHR, &complete);
+    return complete != 0;
+}
+
+// Collect the results, this blocks if the driver isn't done yet. A program
+// that is being replaced only goes away once the new one linked, and one
+// that never linked is never handed out.
+static int32_t finish_build(ShaderBuild_t* build) {
+    int32_t linked = NAXA_TRUE;
+    if (!build->cached) {
+        int32_t success;
+        char info_log[512];
+        glGetProgramiv(build->program, GL_LINK_STATUS, &success);
+        linked = success != 0;
+        if (success == 0) {
+            for (int32_t i = 0; i < build->stages_len; i++) {
+                glGetShaderiv(build->shaders[i], GL_COMPILE_STATUS, &success);
+                if (success == 0) {
+                    glGetShaderInfoLog(build->shaders[i], sizeof(info_log), NULL, info_log);
+                    internal_logf(NAXA_SEVERITY_ERROR, "Failed to compile shader %s:\n%s", build->stages[i].path, info_log);
+                }
+            }
+            glGetProgramInfoLog(build->program, sizeof(info_log), NULL, info_log);
+            internal_logf(NAXA_SEVERITY_ERROR, "Failed to link shader:\n%s", info_log);
+        } else if (build->cacheable) {
+            save_cached_program(build->program, build->key);
+        }
+        for (int32_t i = 0; i < build->stages_len; i++) {
+            glDetachShader(build->program, build->shaders[i]);
+            glDeleteShader(build->shaders[i]);
+        }
+    }
+    internal_logf(NAXA_SEVERITY_INFO, "%s shader program %s (features 0x%x) in %.2f ms", build->cached ? "Loaded cached" : "Compiled",
+        build->stages[0].path, build->features, (glfwGetTime() - build->start) * 1000.0);
+    if (build->failed_dest) {
+        *build->failed_dest = !linked;
+    }
+    if (!linked) {
+        if (*build->dest != 0) {
+            internal_logf(NAXA_SEVERITY_WARN, "Keeping the previous build of %s", build->stages[0].path);
+        }
+        glDeleteProgram(build->program);
+        report_error(NAXA_E_COMPILE);
+        return NAXA_E_COMPILE;
+    }
+    if (*build->dest != 0) {
+        glDeleteProgram(*build->dest);
+    }
+    *build->dest = build->program;
+    if (build->key_dest) {
+        *build->key_dest = build->key;
+    }
+    return NAXA_E_SUCCESS;
+}
+
+int32_t load_shader_program(uint32_t* dest, int32_t stages_len, NaxaShaderType_t* stages, uint32_t features) {
+    if (dest == NULL || stages == NULL) {
+        report_error(NAXA_E_NULLPTR);
+        return NAXA_E_NULLPTR;
+    }
+    ShaderBuild_t* build = submit_build(dest, stages_len, stages, features);
+    if (build == NULL) {
+        return NAXA_E_FILE;
+    }
+    int32_t rc = finish_build(build);
+    free(build);
+    return rc;
+}
+
+static int32_t queue_build(uint32_t* dest, uint64_t* key_dest, int32_t* failed_dest, int32_t stages_len, NaxaShaderType_t* stages, uint32_t features) {
+    ShaderBuild_t* build = submit_build(dest, stages_len, stages, features);
+    if (build == NULL) {
+        if (failed_dest) {
+            *failed_dest = NAXA_TRUE;
+        }
+        return NAXA_E_FILE;
+    }
+    build->key_dest = key_dest;
+    build->failed_dest = failed_dest;
+    build->next = shader_builds;
+    shader_builds = build;
+    return NAXA_E_SUCCESS;
+}
+
+int32_t shader_queue_program(uint32_t* dest, int32_t stages_len, NaxaShaderType_t* stages, uint32_t features) {
+    if (dest == NULL || stages == NULL) {
+        report_error(NAXA_E_NULLPTR);
+        return NAXA_E_NULLPTR;
+    }
+    return queue_build(dest, NULL, NULL, stages_len, stages, features);
+}
+
+int32_t shader_pending(uint32_t* dest) {
+    for (ShaderBuild_t* build = shader_builds; build; build = build->next) {
+        if (build->dest == dest) {
+            return NAXA_TRUE;
+        }
+    }
+    return NAXA_FALSE;
+}
+
+int32_t shader_pump(int32_t wait) {
+    // Hand out whatever the driver has finished, or everything when waiting
+    ShaderBuild_t** link = &shader_builds;
+    int32_t pending = 0;
+    while (*link) {
+        ShaderBuild_t* build = *link;
+        if (!wait && !build_complete(build)) {
+            link = &build->next;
+            pending++;
+            continue;
+        }
+        finish_build(build);
+        *link = build->next;
+        free(build);
+    }
+    return pending;
+}
+
+int32_t shader_variants_init(NaxaShaderVariants_t* dest, int32_t stages_len, NaxaShaderType_t* stages) {
+    if (dest == NULL || stages == NULL) {
+        report_error(NAXA_E_NULLPTR);
+        return NAXA_E_NULLPTR;
+    }
+    if (stages_len > NAXA_SHADER_MAX_STAGES) {
+        report_error(NAXA_E_BOUNDS);
+        return NAXA_E_BOUNDS;
+    }
+    if (shader_variant_sets_len >= NAXA_SHADER_MAX_VARIANT_SETS) {
+        report_error(NAXA_E_EXHAUSTED);
+        return NAXA_E_EXHAUSTED;
+    }
+    memset(dest, 0, sizeof(NaxaShaderVariants_t));
+    dest->stages_len = stages_len;
+    memcpy(dest->stages, stages, stages_len * sizeof(NaxaShaderType_t));
+    shader_variant_sets[shader_variant_sets_len++] = dest;
+    return NAXA_E_SUCCESS;
+}
+
+uint32_t shader_variant(NaxaShaderVariants_t* variants, uint32_t features) {
+    // Queued the first time something draws with it, 0 until it is built
+    // and for good if it doesn't build
+    features &= (1 << NAXA_SHADER_FEATURE_COUNT) - 1;
+    uint32_t* program = &variants->programs[features];
+    if (*program == 0 && !variants->failed[features] && !shader_pending(program)) {
+        queue_build(program, &variants->keys[features], &variants->failed[features], variants->stages_len, variants->stages, features);
+    }
+    return *program;
+}
+
+int32_t shader_variants_free(NaxaShaderVariants_t* variants) {
+    if (variants == NULL) {
+        report_error(NAXA_E_NULLPTR);
+        return NAXA_E_NULLPTR;
+    }
+
+    // Nothing still in the compiler may write into these afterwards
+    shader_pump(NAXA_TRUE);
+    for (int32_t i = 0; i < (1 << NAXA_SHADER_FEATURE_COUNT); i++) {
+        if (variants->programs[i]) {
+            glDeleteProgram(variants->programs[i]);
+            variants->programs[i] = 0;
+        }
+    }
+    for (int32_t i = 0; i < shader_variant_sets_len; i++) {
+        if (shader_variant_sets[i] == variants) {
+            shader_variant_sets[i] = shader_variant_sets[--shader_variant_sets_len];
+            break;
+        }
+    }
+    return NAXA_E_SUCCESS;
+}
+
+int32_t shader_reload() {
+    // Whatever file changed, a variant only needs building again if the
+    // source it preprocesses to is different now. The old program keeps
+    // drawing until the new one is out of the compiler.
+    for (int32_t i = 0; i < shader_variant_sets_len; i++) {
+        NaxaShaderVariants_t* variants = shader_variant_sets[i];
+        for (uint32_t features = 0; features < (1 << NAXA_SHADER_FEATURE_COUNT); features++) {
+            // Anything that failed gets another go the next time it's drawn
+            uint32_t* program = &variants->programs[features];
+            variants->failed[features] = NAXA_FALSE;
+            if (*program == 0 || shader_pending(program)) {
+                continue;
+            }
+            char* sources[NAXA_SHADER_MAX_STAGES];
+            int32_t loaded = 0;
+            for (; loaded < variants->stages_len; loaded++) {
+                sources[loaded] = load_shader_source(variants->stages[loaded].path, features);
+                if (sources[loaded] == NULL) {
+                    break;
+                }
+            }
+            int32_t changed = loaded == variants->stages_len &&
+                program_key(variants->stages_len, variants->stages, sources) != variants->keys[features];
+            for (int32_t j = 0; j < loaded; j++) {
+                free(sources[j]);
+            }
+            if (changed) {
+                queue_build(program, &variants->keys[features], &variants->failed[features], variants->stages_len, variants->stages, features);
+            }
+        }
+    }
+    return NAXA_E_SUCCESS;
+}
@@ -0,0 +1,407 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include <naxa/err.h>
+#include <naxa/naxa_internal.h>
+
+// Mesh simplification by half edge collapse driven by quadric error
+// metrics. Vertices only ever collapse onto other existing vertices, so a
+// simplified mesh is just a new index list over the same vertex buffer.
+
+#define SIMPLIFY_MAX_PASSES 32
+#define SIMPLIFY_BONE_PENALTY 1.0
+#define SIMPLIFY_MIN_NORMAL_DOT 0.2f
+#define HASH_EMPTY 0xFFFFFFFFFFFFFFFFull
+
+typedef struct {
+    // Upper triangle of a symmetric 4x4 and the area it was built from
+    double a00, a01, a02, a03;
+    double a11, a12, a13;
+    double a22, a23;
+    double a33;
+    double weight;
+} Quadric_t;
+
+typedef struct {
+    uint32_t from;
+    uint32_t to;
+    double cost;
+} Collapse_t;
+
+typedef struct {
+    int32_t size;
+    uint64_t* keys;
+    uint32_t* values;
+} HashTable_t;
+
+static uint64_t hash_mix(uint64_t key) {
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdull;
+    key ^= key >> 33;
+    return key;
+}
+
+static void hash_init(HashTable_t* table, int32_t count) {
+    table->size = 16;
+    while (table->size < count * 2) {
+        table->size *= 2;
+    }
+    table->keys = malloc(table->size * sizeof(uint64_t));
+    table->values = malloc(table->size * sizeof(uint32_t));
+    memset(table->keys, 0xFF, table->size * sizeof(uint64_t));
+}
+
+static void hash_free(HashTable_t* table) {
+    free(table->keys);
+    free(table->values);
+}
+
+// Returns the existing value for key, or inserts value and returns it
+static uint32_t hash_insert(HashTable_t* table, uint64_t key, uint32_t value) {
+    uint32_t slot = hash_mix(key) & (table->size - 1);
+    while (table->keys[slot] != HASH_EMPTY) {
+        if (table->keys[slot] == key) {
+            return table->values[slot];
+        }
+        slot = (slot + 1) & (table->size - 1);
+    }
+    table->keys[slot] = key;
+    table->values[slot] = value;
+    return value;
+}
+
+static int32_t hash_contains(HashTable_t* table, uint64_t key) {
+    uint32_t slot = hash_mix(key) & (table->size - 1);
+    while (table->keys[slot] != HASH_EMPTY) {
+        if (table->keys[slot] == key) {
+            return NAXA_TRUE;
+        }
+        slot = (slot + 1) & (table->size - 1);
+    }
+    return NAXA_FALSE;
+}
+
+static uint64_t position_key(vec3 position) {
+    uint32_t bits[3];
+    memcpy(bits, position, sizeof(bits));
+    return hash_mix(((uint64_t)bits[0] << 32) | bits[1]) ^ bits[2];
+}
+
+static void quadric_add_plane(Quadric_t* q, double a, double b, double c, double d, double weight) {
+    q->a00 += weight * a * a;
+    q->a01 += weight * a * b;
+    q->a02 += weight * a * c;
+    q->a03 += weight * a * d;
+    q->a11 += weight * b * b;
+    q->a12 += weight * b * c;
+    q->a13 += weight * b * d;
+    q->a22 += weight * c * c;
+    q->a23 += weight * c * d;
+    q->a33 += weight * d * d;
+    q->weight += weight;
+}
+
+static void quadric_add(Quadric_t* dest, Quadric_t* q) {
+    double* d = (double*)dest;
+    double* s = (double*)q;
+    for (int32_t i = 0; i < sizeof(Quadric_t) / sizeof(double); i++) {
+        d[i] += s[i];
+    }
+}
+
+// Mean squared distance from the planes that make up the quadric
+static double quadric_error(Quadric_t* a, Quadric_t* b, vec3 v) {
+    double x = v[0];
+    double y = v[1];
+    double z = v[2];
+    double a00 = a->a00 + b->a00, a01 = a->a01 + b->a01, a02 = a->a02 + b->a02, a03 = a->a03 + b->a03;
+    double a11 = a->a11 + b->a11, a12 = a->a12 + b->a12, a13 = a->a13 + b->a13;
+    double a22 = a->a22 + b->a22, a23 = a->a23 + b->a23;
+    double a33 = a->a33 + b->a33;
+    double error = a00 * x * x + 2.0 * a01 * x * y + 2.0 * a02 * x * z + 2.0 * a03 * x
+        + a11 * y * y + 2.0 * a12 * y * z + 2.0 * a13 * y
+        + a22 * z * z + 2.0 * a23 * z
+        + a33;
+    double weight = a->weight + b->weight;
+    error = weight > 0.0 ? error / weight : error;
+    return error < 0.0 ? 0.0 : error;
+}
+
+// How different the skinning of two vertices is, from 0 to 2
+static double bone_weight_distance(VertexData_t* a, VertexData_t* b) {
+    double distance = 0.0;
+    for (int32_t i = 0; i < MAX_BONE_WEIGHTS; i++) {
+        if (a->bone_ids[i] < 0) {
+            continue;
+        }
+        float other = 0.0f;
+        for (int32_t j = 0; j < MAX_BONE_WEIGHTS; j++) {
+            if (b->bone_ids[j] == a->bone_ids[i]) {
+                other = b->bone_weights[j];
+            }
+        }
+        distance += fabs(a->bone_weights[i] - other);
+    }
+    for (int32_t j = 0; j < MAX_BONE_WEIGHTS; j++) {
+        if (b->bone_ids[j] < 0) {
+            continue;
+        }
+        int32_t shared = NAXA_FALSE;
+        for (int32_t i = 0; i < MAX_BONE_WEIGHTS; i++) {
+            if (a->bone_ids[i] == b->bone_ids[j]) {
+                shared = NAXA_TRUE;
+            }
+        }
+        if (!shared) {
+            distance += b->bone_weights[j];
+        }
+    }
+    return distance;
+}
+
+static double collapse_cost(VertexData_t* vertices, Quadric_t* quadrics, uint32_t from, uint32_t to) {
+    double cost = quadric_error(&quadrics[from], &quadrics[to], vertices[to].position);
+    double bones = bone_weight_distance(&vertices[from], &vertices[to]);
+    if (bones > 0.0) {
+        cost += SIMPLIFY_BONE_PENALTY * bones * glm_vec3_distance2(vertices[from].position, vertices[to].position);
+    }
+    return cost;
+}
+
+static int32_t compare_collapses(const void* a, const void* b) {
+    double left = ((Collapse_t*)a)->cost;
+    double right = ((Collapse_t*)b)->cost;
+    return (left > right) - (left < right);
+}
+
+// Would moving from onto to fold any of the triangles around from over?
+static int32_t collapse_flips(VertexData_t* vertices, uint32_t* indices, uint32_t* adjacency, int32_t* adjacency_offsets, uint32_t from, uint32_t to) {
+    for (int32_t i = adjacency_offsets[from]; i < adjacency_offsets[from + 1]; i++) {
+        uint32_t* triangle = &indices[adjacency[i] * 3];
+        if (triangle[0] == to || triangle[1] == to || triangle[2] == to) {
+            continue;
+        }
+        vec3 before[3];
+        vec3 after[3];
+        for (int32_t k = 0; k < 3; k++) {
+            glm_vec3_copy(vertices[triangle[k]].position, before[k]);
+            glm_vec3_copy(vertices[triangle[k] == from ? to : triangle[k]].position, after[k]);
+        }
+        vec3 e0;
+        vec3 e1;
+        vec3 normal_before;
+        vec3 normal_after;
+        glm_vec3_sub(before[1], before[0], e0);
+        glm_vec3_sub(before[2], before[0], e1);
+        glm_vec3_cross(e0, e1, normal_before);
+        glm_vec3_sub(after[1], after[0], e0);
+        glm_vec3_sub(after[2], after[0], e1);
+        glm_vec3_cross(e0, e1, normal_after);
+        float scale = glm_vec3_norm(normal_before) * glm_vec3_norm(normal_after);
+        if (glm_vec3_dot(normal_before, normal_after) < SIMPLIFY_MIN_NORMAL_DOT * scale) {
+            return NAXA_TRUE;
+        }
+    }
+    return NAXA_FALSE;
+}
+
+int32_t simplify_mesh(uint32_t* dest, int32_t* dest_len, float* dest_error, uint32_t* indices, int32_t index_count, VertexData_t* vertices, int32_t vertex_count, int32_t target_index_count) {
+    if (dest == NULL || dest_len == NULL || indices == NULL || vertices == NULL) {
+        report_error(NAXA_E_NULLPTR);
+        return NAXA_E_NULLPTR;
+    }
+    for (int32_t i = 0; i < index_count; i++) {
+        if (indices[i] >= vertex_count) {
+            report_error(NAXA_E_BOUNDS);
+            return NAXA_E_BOUNDS;
+        }
+    }
+    memcpy(dest, indices, index_count * sizeof(uint32_t));
+    *dest_len = index_count;
+    if (dest_error != NULL) {
+        *dest_error = 0.0f;
+    }
+    if (index_count <= target_index_count) {
+        return NAXA_E_SUCCESS;
+    }
+
+    // Vertices split along a UV or skinning seam share a position, find the
+    // first vertex at each position so seams can be recognized
+    uint32_t* position_remap = malloc(vertex_count * sizeof(uint32_t));
+    uint8_t* locked = calloc(vertex_count, sizeof(uint8_t));
+    HashTable_t positions;
+    hash_init(&positions, vertex_count);
+    for (uint32_t v = 0; v < vertex_count; v++) {
+        position_remap[v] = hash_insert(&positions, position_key(vertices[v].position), v);
+        if (position_remap[v] != v && memcmp(vertices[v].position, vertices[position_remap[v]].position, sizeof(vec3)) != 0) {
+            // Hash collision between different positions, don't trust it
+            position_remap[v] = v;
+        }
+    }
+    hash_free(&positions);
+    for (uint32_t v = 0; v < vertex_count; v++) {
+        if (position_remap[v] != v) {
+            locked[v] = NAXA_TRUE;
+            locked[position_remap[v]] = NAXA_TRUE;
+        }
+    }
+
+    // Open borders are locked too, otherwise holes would grow
+    HashTable_t edges;
+    hash_init(&edges, index_count);
+    for (int32_t i = 0; i < index_count; i += 3) {
+        for (int32_t k = 0; k < 3; k++) {
+            uint64_t a = position_remap[dest[i + k]];
+            uint64_t b = position_remap[dest[i + (k + 1) % 3]];
+            hash_insert(&edges, (a << 32) | b, 0);
+        }
+    }
+    for (int32_t i = 0; i < index_count; i += 3) {
+        for (int32_t k = 0; k < 3; k++) {
+            uint64_t a = position_remap[dest[i + k]];
+            uint64_t b = position_remap[dest[i + (k + 1) % 3]];
+            if (!hash_contains(&edges, (b << 32) | a)) {
+                locked[dest[i + k]] = NAXA_TRUE;
+                locked[dest[i + (k + 1) % 3]] = NAXA_TRUE;
+                locked[a] = NAXA_TRUE;
+                locked[b] = NAXA_TRUE;
+            }
+        }
+    }
+    hash_free(&edges);
+    for (uint32_t v = 0; v < vertex_count; v++) {
+        if (locked[position_remap[v]]) {
+            locked[v] = NAXA_TRUE;
+        }
+    }
+    free(position_remap);
+
+    // Area weighted plane quadrics
+    Quadric_t* quadrics = calloc(vertex_count, sizeof(Quadric_t));
+    for (int32_t i = 0; i < index_count; i += 3) {
+        vec3 e0;
+        vec3 e1;
+        vec3 normal;
+        glm_vec3_sub(vertices[dest[i + 1]].position, vertices[dest[i]].position, e0);
+        glm_vec3_sub(vertices[dest[i + 2]].position, vertices[dest[i]].position, e1);
+        glm_vec3_cross(e0, e1, normal);
+        float area = glm_vec3_norm(normal) * 0.5f;
+        if (area <= 0.0f) {
+            continue;
+        }
+        glm_vec3_normalize(normal);
+        double d = -glm_vec3_dot(normal, vertices[dest[i]].position);
+        for (int32_t k = 0; k < 3; k++) {
+            quadric_add_plane(&quadrics[dest[i + k]], normal[0], normal[1], normal[2], d, area);
+        }
+    }
+
+    int32_t* adjacency_offsets = malloc((vertex_count + 1) * sizeof(int32_t));
+    uint32_t* adjacency = malloc(index_count * sizeof(uint32_t));
+    Collapse_t* collapses = malloc(index_count * sizeof(Collapse_t));
+    uint32_t* remap = malloc(vertex_count * sizeof(uint32_t));
+    uint8_t* touched = malloc(vertex_count * sizeof(uint8_t));
+    double max_error = 0.0;
+    int32_t len = index_count;
+    for (int32_t pass = 0; pass < SIMPLIFY_MAX_PASSES && len > target_index_count; pass++) {
+        // Vertex to triangle adjacency for this pass
+        memset(adjacency_offsets, 0, (vertex_count + 1) * sizeof(int32_t));
+        for (int32_t i = 0; i < len; i++) {
+            adjacency_offsets[dest[i] + 1]++;
+        }
+        for (int32_t v = 0; v < vertex_count; v++) {
+            adjacency_offsets[v + 1] += adjacency_offsets[v];
+        }
+        int32_t* fill = malloc(vertex_count * sizeof(int32_t));
+        memcpy(fill, adjacency_offsets, vertex_count * sizeof(int32_t));
+        for (int32_t i = 0; i < len; i++) {
+            adjacency[fill[dest[i]]++] = i / 3;
+        }
+        free(fill);
+
+        // Every edge once, collapsing in whichever direction is cheaper
+        int32_t collapse_count = 0;
+        for (int32_t i = 0; i < len; i += 3) {
+            for (int32_t k = 0; k < 3; k++) {
+                uint32_t a = dest[i + k];
+                uint32_t b = dest[i + (k + 1) % 3];
+                if (a > b || (locked[a] && locked[b])) {
+                    continue;
+                }
+                double cost_ab = locked[a] ? INFINITY : collapse_cost(vertices, quadrics, a, b);
+                double cost_ba = locked[b] ? INFINITY : collapse_cost(vertices, quadrics, b, a);
+                Collapse_t* collapse = &collapses[collapse_count++];
+                collapse->from = cost_ab <= cost_ba ? a : b;
+                collapse->to = cost_ab <= cost_ba ? b : a;
+                collapse->cost = cost_ab <= cost_ba ? cost_ab : cost_ba;
+            }
+        }
+        if (collapse_count == 0) {
+            break;
+        }
+        qsort(collapses, collapse_count, sizeof(Collapse_t), compare_collapses);
+
+        // Take the cheapest collapses that don't touch each other, each one
+        // removes about two triangles
+        int32_t wanted = ((len - target_index_count) / 3 + 1) / 2;
+        int32_t performed = 0;
+        for (uint32_t v = 0; v < vertex_count; v++) {
+            remap[v] = v;
+        }
+        memset(touched, 0, vertex_count * sizeof(uint8_t));
+        for (int32_t c = 0; c < collapse_count && performed < wanted; c++) {
+            uint32_t from = collapses[c].from;
+            uint32_t to = collapses[c].to;
+            if (touched[from] || touched[to]) {
+                continue;
+            }
+            if (collapse_flips(vertices, dest, adjacency, adjacency_offsets, from, to)) {
+                continue;
+            }
+            remap[from] = to;
+            quadric_add(&quadrics[to], &quadrics[from]);
+            if (collapses[c].cost > max_error) {
+                max_error = collapses[c].cost;
+            }
+            for (int32_t i = adjacency_offsets[from]; i < adjacency_offsets[from + 1]; i++) {
+                uint32_t* triangle = &dest[adjacency[i] * 3];
+                touched[triangle[0]] = NAXA_TRUE;
+                touched[triangle[1]] = NAXA_TRUE;
+                touched[triangle[2]] = NAXA_TRUE;
+            }
+            touched[to] = NAXA_TRUE;
+            performed++;
+        }
+        if (performed == 0) {
+            break;
+        }
+
+        // Apply and drop the triangles that collapsed to nothing
+        int32_t new_len = 0;
+        for (int32_t i = 0; i < len; i += 3) {
+            uint32_t a = remap[dest[i]];
+            uint32_t b = remap[dest[i + 1]];
+            uint32_t c = remap[dest[i + 2]];
+            if (a == b || b == c || c == a) {
+                continue;
+            }
+            dest[new_len++] = a;
+            dest[new_len++] = b;
+            dest[new_len++] = c;
+        }
+        len = new_len;
+    }
+    free(adjacency_offsets);
+    free(adjacency);
+    free(collapses);
+    free(remap);
+    free(touched);
+    free(quadrics);
+    free(locked);
+
+    *dest_len = len;
+    if (dest_error != NULL) {
+        *dest_error = sqrtf((float)max_error);
+    }
+    return NAXA_E_SUCCESS;
+}
@@ -0,0 +1,183 @@
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <glad/glad.h>
+
+#include <naxa/err.h>
+#include <naxa/gfx.h>
+#include <naxa/log.h>
+#include <naxa/naxa_internal.h>
+
+// Bindings and uniform locations fixed in res/naxa.glsl
+#define PALETTE_BINDING 0
+#define SKIN_SOURCE_BINDING 1
+#define SKIN_DEST_BINDING 2
+#define U_PALETTE_OFFSET 2
+#define U_SKIN_VERTEX_COUNT 5
+#define U_MORPH_OFFSET 9
+#define MORPH_START_BINDING 4
+#define MORPH_DELTA_BINDING 5
+#define SKIN_GROUP_SIZE 64
+
+// Skinned vertices are just a position and a normal, the texture
+// coordinates are still read from the model's own VBO
+#define SKIN_VERTEX_BYTES (6 * sizeof(float))
+
+// Pre-skinned vertices of one pose. The VAO draws positions and normals
+// from the output buffer and everything else from the model it was made
+// for. model and revision say what the buffer currently holds.
+typedef struct {
+    NaxaPose_t* pose;
+    NaxaModel_t* model;
+    uint32_t revision;
+    uint32_t features;
+    NaxaModel_t* vao_model;
+    uint32_t vao;
+    uint32_t buffer;
+    int32_t vertex_size;
+    int32_t next_free;
+} SkinSlot_t;
+
+int32_t skin_slots_len;
+int32_t skin_slots_size;
+int32_t skin_free_list = -1;
+SkinSlot_t* skin_slots;
+int32_t skin_dispatched;
+int32_t skin_shader_ready;
+NaxaShaderVariants_t skin_shader;
+
+static void make_vao(SkinSlot_t* slot, NaxaModel_t* model) {
+    if (slot->vao == 0) {
+        glGenVertexArrays(1, &slot->vao);
+    }
+    glBindVertexArray(slot->vao);
+    glBindBuffer(GL_ARRAY_BUFFER, slot->buffer);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, SKIN_VERTEX_BYTES, (void*)0);
+    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, SKIN_VERTEX_BYTES, (void*)(3 * sizeof(float)));
+    glBindBuffer(GL_ARRAY_BUFFER, model->vbo);
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(VertexData_t), (void*)offsetof(VertexData_t, texture));
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, model->ebo);
+    glEnableVertexAttribArray(0);
+    glEnableVertexAttribArray(1);
+    glEnableVertexAttribArray(2);
+    glBindVertexArray(0);
+    slot->vao_model = model;
+}
+
+int32_t skin_acquire(NaxaPose_t* pose, NaxaModel_t* model, uint32_t features, int32_t* stale) {
+    if (pose->skin_slot < 0) {
+        if (skin_free_list >= 0) {
+            pose->skin_slot = skin_free_list;
+            skin_free_list = skin_slots[skin_free_list].next_free;
+        } else {
+            if (skin_slots_len >= skin_slots_size) {
+                skin_slots_size = skin_slots_size ? skin_slots_size * 2 : 16;
+                skin_slots = realloc(skin_slots, skin_slots_size * sizeof(SkinSlot_t));
+            }
+            pose->skin_slot = skin_slots_len++;
+        }
+        SkinSlot_t* slot = &skin_slots[pose->skin_slot];
+        memset(slot, 0, sizeof(SkinSlot_t));
+        slot->pose = pose;
+        slot->next_free = -1;
+    }
+    SkinSlot_t* slot = &skin_slots[pose->skin_slot];
+
+    // A different model might need a bigger buffer, and always a new VAO
+    if (slot->vertex_size < model->vertex_count) {
+        if (slot->buffer != 0) {
+            glDeleteBuffers(1, &slot->buffer);
+        }
+        glGenBuffers(1, &slot->buffer);
+        if (slot->buffer == 0) {
+            slot->vertex_size = 0;
+            report_error(NAXA_E_INTERNAL);
+            return -1;
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, slot->buffer);
+        glBufferData(GL_ARRAY_BUFFER, model->vertex_count * SKIN_VERTEX_BYTES, NULL, GL_DYNAMIC_COPY);
+        slot->vertex_size = model->vertex_count;
+        slot->model = NULL;
+        slot->vao_model = NULL;
+    }
+    if (slot->vao_model != model) {
+        make_vao(slot, model);
+    }
+    *stale = slot->model != model || slot->revision != pose->revision || slot->features != features;
+    return pose->skin_slot;
+}
+
+int32_t skin_dispatch(int32_t slot_index, NaxaModel_t* model, int32_t palette_offset, int32_t morph_offset, uint32_t features) {
+    // Not compiled yet, the caller skins in the vertex shader meanwhile
+    uint32_t program = shader_variant(&skin_shader, features);
+    if (program == 0) {
+        return NAXA_FALSE;
+    }
+    SkinSlot_t* slot = &skin_slots[slot_index];
+    glUseProgram(program);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SKIN_SOURCE_BINDING, model->vbo);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, SKIN_DEST_BINDING, slot->buffer);
+    glUniform1i(U_PALETTE_OFFSET, palette_offset);
+    glUniform1i(U_SKIN_VERTEX_COUNT, model->vertex_count);
+    if (features & NAXA_SHADER_MORPH) {
+        glUniform1i(U_MORPH_OFFSET, morph_offset);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, MORPH_START_BINDING, model->morph_start_ssbo);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, MORPH_DELTA_BINDING, model->morph_delta_ssbo);
+    }
+    glDispatchCompute((model->vertex_count + SKIN_GROUP_SIZE - 1) / SKIN_GROUP_SIZE, 1, 1);
+    slot->model = model;
+    slot->revision = slot->pose->revision;
+    slot->features = features;
+    skin_dispatched = NAXA_TRUE;
+    return NAXA_TRUE;
+}
+
+int32_t skin_finish_dispatches() {
+    // One barrier covers every dispatch before the draws read the results
+    if (skin_dispatched) {
+        glMemoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+        skin_dispatched = NAXA_FALSE;
+    }
+    return NAXA_E_SUCCESS;
+}
+
+uint32_t skin_vao(int32_t slot) {
+    return skin_slots[slot].vao;
+}
+
+int32_t skin_release(NaxaPose_t* pose) {
+    if (pose == NULL || pose->skin_slot < 0) {
+        return NAXA_E_SUCCESS;
+    }
+    SkinSlot_t* slot = &skin_slots[pose->skin_slot];
+    glDeleteVertexArrays(1, &slot->vao);
+    glDeleteBuffers(1, &slot->buffer);
+    slot->vao = 0;
+    slot->buffer = 0;
+    slot->pose = NULL;
+    slot->next_free = skin_free_list;
+    skin_free_list = pose->skin_slot;
+    pose->skin_slot = -1;
+    return NAXA_E_SUCCESS;
+}
+
+int32_t naxa_set_preskinning(int32_t enabled) {
+    if (enabled) {
+        if (!skin_shader_ready) {
+            NaxaShaderType_t skin_stages[] = {
+                { GL_COMPUTE_SHADER, "res/skin.comp" }
+            };
+            int32_t rc = shader_variants_init(&skin_shader, 1, skin_stages);
+            if (rc != NAXA_E_SUCCESS) {
+                return rc;
+            }
+            skin_shader_ready = NAXA_TRUE;
+        }
+        naxa_globals.flags1 |= GLOBAL_FLAGS1_PRESKINNING;
+        shader_variant(&skin_shader, render_skin_features());
+    } else {
+        naxa_globals.flags1 &= ~GLOBAL_FLAGS1_PRESKINNING;
+    }
+    return NAXA_E_SUCCESS;
+}
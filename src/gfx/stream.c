@@ -0,0 +1,268 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <naxa/err.h>
+#include <naxa/gfx.h>
+#include <naxa/log.h>
+#include <naxa/naxa_internal.h>
+
+// Textures come in with their mips up to this size resident and only get
+// the rest when the renderer actually draws them big enough to need it
+#define STREAM_INITIAL_SIZE 64
+#define STREAM_DEFAULT_BUDGET (256 * 1024 * 1024)
+#define STREAM_MAX_IN_FLIGHT 4
+
+NaxaTexture_t** streamed;
+int32_t streamed_len;
+int32_t streamed_size;
+int64_t stream_frame;
+int64_t stream_budget;
+int64_t stream_evictions;
+int64_t stream_promotions;
+
+int32_t stream_level_size(int32_t format, int32_t width, int32_t height) {
+    return texcomp_size(width, height, format);
+}
+
+int32_t stream_chain_size(NaxaTexture_t* texture, int32_t base_level) {
+    int32_t size = 0;
+    for (int32_t level = base_level; level < texture->level_count; level++) {
+        int32_t width = texture->width >> level > 0 ? texture->width >> level : 1;
+        int32_t height = texture->height >> level > 0 ? texture->height >> level : 1;
+        size += stream_level_size(texture->format, width, height);
+    }
+    return size;
+}
+
+int32_t stream_initial_level(int32_t width, int32_t height, int32_t level_count) {
+    int32_t level = 0;
+    while (level < level_count - 1 && (width >> level > STREAM_INITIAL_SIZE || height >> level > STREAM_INITIAL_SIZE)) {
+        level++;
+    }
+    return level;
+}
+
+static int64_t resident_bytes() {
+    int64_t bytes = 0;
+    for (int32_t i = 0; i < streamed_len; i++) {
+        bytes += stream_chain_size(streamed[i], streamed[i]->resident_level);
+    }
+    return bytes;
+}
+
+static int32_t allocate_level(NaxaTexture_t* dest, NaxaTexture_t* texture, int32_t level) {
+    int32_t width = texture->width >> level > 0 ? texture->width >> level : 1;
+    int32_t height = texture->height >> level > 0 ? texture->height >> level : 1;
+    return texpool_allocate(dest, texture->internal_format, width, height, texture->level_count - level);
+}
+
+// Drop the top mip of a texture. The smaller levels are already in VRAM so
+// this is a GPU side copy into a layer one size class down.
+static int32_t demote(NaxaTexture_t* texture) {
+    int32_t level = texture->resident_level + 1;
+    NaxaTexture_t allocation;
+    int32_t rc = allocate_level(&allocation, texture, level);
+    if (rc != NAXA_E_SUCCESS) {
+        return rc;
+    }
+    uint32_t source = texpool_texture(texture->pool);
+    uint32_t dest = texpool_texture(allocation.pool);
+    for (int32_t i = level; i < texture->level_count && !(naxa_globals.flags1 & GLOBAL_FLAGS1_HEADLESS); i++) {
+        int32_t width = texture->width >> i > 0 ? texture->width >> i : 1;
+        int32_t height = texture->height >> i > 0 ? texture->height >> i : 1;
+        glCopyImageSubData(source, GL_TEXTURE_2D_ARRAY, i - texture->resident_level, 0, 0, texture->layer,
+            dest, GL_TEXTURE_2D_ARRAY, i - level, 0, 0, allocation.layer, width, height, 1);
+    }
+    texpool_release(texture);
+    texture->pool = allocation.pool;
+    texture->layer = allocation.layer;
+    texture->resident_level = level;
+    stream_evictions++;
+    return NAXA_E_SUCCESS;
+}
+
+// How far evict could get us down without touching anything on screen
+static int64_t reclaimable_bytes(NaxaTexture_t* keep) {
+    int64_t bytes = 0;
+    for (int32_t i = 0; i < streamed_len; i++) {
+        NaxaTexture_t* texture = streamed[i];
+        if (texture == keep || texture->streaming || texture->resident_level >= texture->floor_level ||
+            texture->last_used >= stream_frame) {
+            continue;
+        }
+        bytes += stream_chain_size(texture, texture->resident_level) - stream_chain_size(texture, texture->floor_level);
+    }
+    return bytes;
+}
+
+// Make room for some bytes by demoting whatever was drawn longest ago
+static int32_t evict(int64_t needed, NaxaTexture_t* keep) {
+    int64_t bytes = resident_bytes();
+    while (bytes + needed > stream_budget) {
+        NaxaTexture_t* victim = NULL;
+        for (int32_t i = 0; i < streamed_len; i++) {
+            NaxaTexture_t* texture = streamed[i];
+            if (texture == keep || texture->streaming || texture->resident_level >= texture->floor_level) {
+                continue;
+            }
+            if (victim == NULL || texture->last_used < victim->last_used) {
+                victim = texture;
+            }
+        }
+        if (victim == NULL || victim->last_used >= stream_frame) {
+            // Everything left is on screen right now
+            return NAXA_FALSE;
+        }
+        int64_t before = stream_chain_size(victim, victim->resident_level);
+        if (demote(victim) != NAXA_E_SUCCESS) {
+            return NAXA_FALSE;
+        }
+        bytes -= before - stream_chain_size(victim, victim->resident_level);
+    }
+    return NAXA_TRUE;
+}
+
+int32_t init_streaming() {
+    streamed_len = 0;
+    streamed_size = 64;
+    streamed = malloc(streamed_size * sizeof(NaxaTexture_t*));
+    stream_frame = 0;
+    stream_budget = STREAM_DEFAULT_BUDGET;
+    stream_evictions = 0;
+    stream_promotions = 0;
+    return NAXA_E_SUCCESS;
+}
+
+int32_t stream_register(NaxaTexture_t* texture) {
+    if (streamed_len >= streamed_size) {
+        streamed_size *= 2;
+        streamed = realloc(streamed, streamed_size * sizeof(NaxaTexture_t*));
+    }
+    texture->stream_index = streamed_len;
+    texture->requested_level = texture->level_count;
+    texture->last_used = stream_frame;
+    streamed[streamed_len++] = texture;
+    return NAXA_E_SUCCESS;
+}
+
+int32_t stream_unregister(NaxaTexture_t* texture) {
+    if (texture->stream_index < 0 || texture->stream_index >= streamed_len || streamed[texture->stream_index] != texture) {
+        report_error(NAXA_E_INTERNAL);
+        return NAXA_E_INTERNAL;
+    }
+    streamed_len--;
+    streamed[texture->stream_index] = streamed[streamed_len];
+    streamed[texture->stream_index]->stream_index = texture->stream_index;
+    texture->stream_index = -1;
+    return NAXA_E_SUCCESS;
+}
+
+int32_t stream_request(NaxaTexture_t* texture, float screen_pixels) {
+    if (texture == NULL) {
+        report_error(NAXA_E_NULLPTR);
+        return NAXA_E_NULLPTR;
+    }
+
+    // Roughly one texel per pixel if the texture covers the model once
+    int32_t size = texture->width > texture->height ? texture->width : texture->height;
+    int32_t level = 0;
+    if (screen_pixels > 0.0f && size > screen_pixels) {
+        level = (int32_t)floorf(log2f(size / screen_pixels));
+    }
+    level = level < texture->level_count - 1 ? level : texture->level_count - 1;
+    if (level < texture->requested_level) {
+        texture->requested_level = level;
+    }
+    texture->last_used = stream_frame;
+    return NAXA_E_SUCCESS;
+}
+
+int32_t stream_upload_done(NaxaTexture_t* texture, int32_t pool, int32_t layer, int32_t base_level) {
+    if (pool != texture->pool || layer != texture->layer) {
+        texpool_release(texture);
+        texture->pool = pool;
+        texture->layer = layer;
+    }
+    texture->resident_level = base_level;
+    texture->streaming = NAXA_FALSE;
+    return NAXA_E_SUCCESS;
+}
+
+int32_t stream_update() {
+    // Start loading better mips for whatever was drawn too small last frame
+    int32_t in_flight = 0;
+    for (int32_t i = 0; i < streamed_len; i++) {
+        in_flight += streamed[i]->streaming;
+    }
+    for (int32_t i = 0; i < streamed_len && in_flight < STREAM_MAX_IN_FLIGHT; i++) {
+        NaxaTexture_t* texture = streamed[i];
+        int32_t level = texture->requested_level > texture->ceiling_level ? texture->requested_level : texture->ceiling_level;
+        if (texture->streaming || level >= texture->resident_level) {
+            continue;
+        }
+        int64_t needed = stream_chain_size(texture, level) - stream_chain_size(texture, texture->resident_level);
+        if (resident_bytes() + needed - reclaimable_bytes(texture) > stream_budget) {
+            continue;
+        }
+
+        // Only demote anything once the bigger layer is actually ours
+        NaxaTexture_t allocation;
+        int32_t rc = allocate_level(&allocation, texture, level);
+        if (rc == NAXA_E_EXHAUSTED) {
+            // No layers left at that size, settle for a level down from now on
+            internal_logf(NAXA_SEVERITY_WARN, "No room for level %d of %s, capping it at level %d", level, texture->path, level + 1);
+            texture->ceiling_level = level + 1;
+            continue;
+        }
+        if (rc != NAXA_E_SUCCESS) {
+            continue;
+        }
+        if (!evict(needed, texture) || upload_queue_texture(texture, allocation.pool, allocation.layer, level) != NAXA_E_SUCCESS) {
+            texpool_release(&allocation);
+            continue;
+        }
+        stream_promotions++;
+        in_flight++;
+    }
+
+    // Requests only count for the frame they were made in
+    for (int32_t i = 0; i < streamed_len; i++) {
+        streamed[i]->requested_level = streamed[i]->level_count;
+    }
+
+    // Loads and promotions that landed can push us over, settle back down
+    evict(0, NULL);
+    stream_frame++;
+    return NAXA_E_SUCCESS;
+}
+
+int32_t naxa_set_texture_budget(int64_t bytes) {
+    if (bytes <= 0) {
+        report_error(NAXA_E_BOUNDS);
+        return NAXA_E_BOUNDS;
+    }
+    stream_budget = bytes;
+    return NAXA_E_SUCCESS;
+}
+
+int32_t naxa_get_texture_stats(NaxaTextureStats_t* dest) {
+    if (dest == NULL) {
+        report_error(NAXA_E_NULLPTR);
+        return NAXA_E_NULLPTR;
+    }
+    memset(dest, 0, sizeof(NaxaTextureStats_t));
+    dest->budget_bytes = stream_budget;
+    dest->texture_count = streamed_len;
+    for (int32_t i = 0; i < streamed_len; i++) {
+        NaxaTexture_t* texture = streamed[i];
+        dest->resident_bytes += stream_chain_size(texture, texture->resident_level);
+        dest->full_bytes += stream_chain_size(texture, 0);
+        dest->full_resolution_count += texture->resident_level == 0;
+        dest->streaming_count += texture->streaming;
+    }
+    dest->pool_bytes = texpool_allocated_bytes();
+    dest->promotions = stream_promotions;
+    dest->evictions = stream_evictions;
+    return NAXA_E_SUCCESS;
+}
@@ -0,0 +1,514 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <naxa/err.h>
+#include <naxa/gfx.h>
+#include <naxa/naxa_internal.h>
+
+// CPU block compression for the texture cooker. Every encoder takes RGBA8
+// texels and has a matching decoder so the output can be checked without
+// a GPU.
+
+static const int32_t BC7_WEIGHTS4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+static int32_t clamp_byte(int32_t value) {
+    return value < 0 ? 0 : (value > 255 ? 255 : value);
+}
+
+// Gather a 4x4 block, repeating the last row and column past the edges
+static void fetch_block(uint8_t block[16][4], uint8_t* rgba, int32_t width, int32_t height, int32_t bx, int32_t by) {
+    for (int32_t y = 0; y < 4; y++) {
+        int32_t sy = by * 4 + y < height ? by * 4 + y : height - 1;
+        for (int32_t x = 0; x < 4; x++) {
+            int32_t sx = bx * 4 + x < width ? bx * 4 + x : width - 1;
+            memcpy(block[y * 4 + x], &rgba[(sy * width + sx) * 4], 4);
+        }
+    }
+}
+
+static void store_block(uint8_t block[16][4], uint8_t* rgba, int32_t width, int32_t height, int32_t bx, int32_t by) {
+    for (int32_t y = 0; y < 4 && by * 4 + y < height; y++) {
+        for (int32_t x = 0; x < 4 && bx * 4 + x < width; x++) {
+            memcpy(&rgba[((by * 4 + y) * width + bx * 4 + x) * 4], block[y * 4 + x], 4);
+        }
+    }
+}
+
+// Endpoints along the principal axis of the block in the first channels
+static void principal_endpoints(uint8_t block[16][4], int32_t channels, float low[4], float high[4]) {
+    float mean[4] = { 0.0f };
+    for (int32_t i = 0; i < 16; i++) {
+        for (int32_t c = 0; c < channels; c++) {
+            mean[c] += block[i][c] / 16.0f;
+        }
+    }
+    float covariance[4][4] = { { 0.0f } };
+    for (int32_t i = 0; i < 16; i++) {
+        for (int32_t a = 0; a < channels; a++) {
+            for (int32_t b = 0; b < channels; b++) {
+                covariance[a][b] += (block[i][a] - mean[a]) * (block[i][b] - mean[b]);
+            }
+        }
+    }
+
+    // Power iteration is plenty for the dominant eigenvector of a 4x4
+    float axis[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+    for (int32_t iteration = 0; iteration < 8; iteration++) {
+        float next[4] = { 0.0f };
+        float length = 0.0f;
+        for (int32_t a = 0; a < channels; a++) {
+            for (int32_t b = 0; b < channels; b++) {
+                next[a] += covariance[a][b] * axis[b];
+            }
+            length += next[a] * next[a];
+        }
+        if (length < 1e-8f) {
+            break;
+        }
+        length = sqrtf(length);
+        for (int32_t a = 0; a < channels; a++) {
+            axis[a] = next[a] / length;
+        }
+    }
+
+    float t_min = INFINITY;
+    float t_max = -INFINITY;
+    for (int32_t i = 0; i < 16; i++) {
+        float t = 0.0f;
+        for (int32_t c = 0; c < channels; c++) {
+            t += (block[i][c] - mean[c]) * axis[c];
+        }
+        t_min = fminf(t_min, t);
+        t_max = fmaxf(t_max, t);
+    }
+
+    // Pull the ends in a little, the extremes are rarely worth hitting
+    float inset = (t_max - t_min) / 32.0f;
+    t_min += inset;
+    t_max -= inset;
+    for (int32_t c = 0; c < channels; c++) {
+        low[c] = fminf(fmaxf(mean[c] + axis[c] * t_min, 0.0f), 255.0f);
+        high[c] = fminf(fmaxf(mean[c] + axis[c] * t_max, 0.0f), 255.0f);
+    }
+}
+
+static uint16_t pack_565(float color[3]) {
+    int32_t r = (int32_t)(color[0] * 31.0f / 255.0f + 0.5f);
+    int32_t g = (int32_t)(color[1] * 63.0f / 255.0f + 0.5f);
+    int32_t b = (int32_t)(color[2] * 31.0f / 255.0f + 0.5f);
+    return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+static void unpack_565(uint16_t packed, int32_t color[3]) {
+    int32_t r = (packed >> 11) & 31;
+    int32_t g = (packed >> 5) & 63;
+    int32_t b = packed & 31;
+    color[0] = (r << 3) | (r >> 2);
+    color[1] = (g << 2) | (g >> 4);
+    color[2] = (b << 3) | (b >> 2);
+}
+
+static void bc1_palette(uint16_t c0, uint16_t c1, int32_t four_color, int32_t palette[4][4]) {
+    unpack_565(c0, palette[0]);
+    unpack_565(c1, palette[1]);
+    palette[0][3] = 255;
+    palette[1][3] = 255;
+    for (int32_t c = 0; c < 3; c++) {
+        if (four_color) {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        } else {
+            palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+            palette[3][c] = 0;
+        }
+    }
+    palette[2][3] = 255;
+    palette[3][3] = four_color ? 255 : 0;
+}
+
+static void encode_bc1_block(uint8_t* dest, uint8_t block[16][4], int32_t allow_alpha) {
+    int32_t transparent = NAXA_FALSE;
+    for (int32_t i = 0; i < 16 && allow_alpha; i++) {
+        if (block[i][3] < 128) {
+            transparent = NAXA_TRUE;
+        }
+    }
+    float low[4];
+    float high[4];
+    principal_endpoints(block, 3, low, high);
+    uint16_t c0 = pack_565(high);
+    uint16_t c1 = pack_565(low);
+
+    // c0 > c1 selects four colors, c0 <= c1 three colors and transparent
+    if ((c0 < c1) != transparent) {
+        uint16_t swap = c0;
+        c0 = c1;
+        c1 = swap;
+    }
+    int32_t four_color = c0 > c1;
+    int32_t palette[4][4];
+    bc1_palette(c0, c1, four_color, palette);
+
+    uint32_t indices = 0;
+    for (int32_t i = 0; i < 16; i++) {
+        int32_t best = 0;
+        if (transparent && block[i][3] < 128) {
+            best = 3;
+        } else {
+            int32_t best_error = 0x7FFFFFFF;
+            for (int32_t p = 0; p < (four_color ? 4 : 3); p++) {
+                int32_t error = 0;
+                for (int32_t c = 0; c < 3; c++) {
+                    int32_t d = block[i][c] - palette[p][c];
+                    error += d * d;
+                }
+                if (error < best_error) {
+                    best_error = error;
+                    best = p;
+                }
+            }
+        }
+        indices |= (uint32_t)best << (i * 2);
+    }
+    dest[0] = c0 & 0xFF;
+    dest[1] = c0 >> 8;
+    dest[2] = c1 & 0xFF;
+    dest[3] = c1 >> 8;
+    memcpy(&dest[4], &indices, 4);
+}
+
+static void decode_bc1_block(uint8_t block[16][4], uint8_t* src, int32_t force_four_color) {
+    uint16_t c0 = src[0] | (src[1] << 8);
+    uint16_t c1 = src[2] | (src[3] << 8);
+    uint32_t indices;
+    memcpy(&indices, &src[4], 4);
+    int32_t palette[4][4];
+    bc1_palette(c0, c1, force_four_color || c0 > c1, palette);
+    for (int32_t i = 0; i < 16; i++) {
+        int32_t index = (indices >> (i * 2)) & 3;
+        for (int32_t c = 0; c < 4; c++) {
+            block[i][c] = palette[index][c];
+        }
+    }
+}
+
+static void bc4_palette(int32_t a0, int32_t a1, int32_t palette[8]) {
+    palette[0] = a0;
+    palette[1] = a1;
+    if (a0 > a1) {
+        for (int32_t i = 1; i < 7; i++) {
+            palette[i + 1] = ((7 - i) * a0 + i * a1 + 3) / 7;
+        }
+    } else {
+        for (int32_t i = 1; i < 5; i++) {
+            palette[i + 1] = ((5 - i) * a0 + i * a1 + 2) / 5;
+        }
+        palette[6] = 0;
+        palette[7] = 255;
+    }
+}
+
+static void encode_bc4_block(uint8_t* dest, uint8_t block[16][4], int32_t channel) {
+    int32_t a0 = 0;
+    int32_t a1 = 255;
+    for (int32_t i = 0; i < 16; i++) {
+        a0 = block[i][channel] > a0 ? block[i][channel] : a0;
+        a1 = block[i][channel] < a1 ? block[i][channel] : a1;
+    }
+    int32_t palette[8];
+    bc4_palette(a0, a1, palette);
+    uint64_t indices = 0;
+    for (int32_t i = 0; i < 16; i++) {
+        int32_t best = 0;
+        int32_t best_error = 0x7FFFFFFF;
+        for (int32_t p = 0; p < 8; p++) {
+            int32_t error = abs(block[i][channel] - palette[p]);
+            if (error < best_error) {
+                best_error = error;
+                best = p;
+            }
+        }
+        indices |= (uint64_t)best << (i * 3);
+    }
+    dest[0] = a0;
+    dest[1] = a1;
+    for (int32_t i = 0; i < 6; i++) {
+        dest[2 + i] = (indices >> (i * 8)) & 0xFF;
+    }
+}
+
+static void decode_bc4_block(uint8_t block[16][4], uint8_t* src, int32_t channel) {
+    int32_t palette[8];
+    bc4_palette(src[0], src[1], palette);
+    uint64_t indices = 0;
+    for (int32_t i = 0; i < 6; i++) {
+        indices |= (uint64_t)src[2 + i] << (i * 8);
+    }
+    for (int32_t i = 0; i < 16; i++) {
+        block[i][channel] = palette[(indices >> (i * 3)) & 7];
+    }
+}
+
+static void put_bits(uint8_t* dest, int32_t* position, uint32_t value, int32_t count) {
+    for (int32_t i = 0; i < count; i++) {
+        if ((value >> i) & 1) {
+            dest[*position >> 3] |= 1 << (*position & 7);
+        }
+        (*position)++;
+    }
+}
+
+static uint32_t get_bits(uint8_t* src, int32_t* position, int32_t count) {
+    uint32_t value = 0;
+    for (int32_t i = 0; i < count; i++) {
+        value |= (uint32_t)((src[*position >> 3] >> (*position & 7)) & 1) << i;
+        (*position)++;
+    }
+    return value;
+}
+
+// Quantize to 7 bits plus a shared p-bit, picking whichever p-bit lands closer
+static void quantize_bc7_endpoint(float endpoint[4], int32_t quantized[4], int32_t* p_bit) {
+    int32_t best_error = 0x7FFFFFFF;
+    for (int32_t p = 0; p < 2; p++) {
+        int32_t candidate[4];
+        int32_t error = 0;
+        for (int32_t c = 0; c < 4; c++) {
+            int32_t q = (int32_t)((endpoint[c] - p) / 2.0f + 0.5f);
+            q = q < 0 ? 0 : (q > 127 ? 127 : q);
+            candidate[c] = q;
+            int32_t d = ((q << 1) | p) - (int32_t)(endpoint[c] + 0.5f);
+            error += d * d;
+        }
+        if (error < best_error) {
+            best_error = error;
+            memcpy(quantized, candidate, sizeof(candidate));
+            *p_bit = p;
+        }
+    }
+}
+
+// Mode 6 only: one subset, RGBA endpoints and 4 bit indices
+static void encode_bc7_block(uint8_t* dest, uint8_t block[16][4]) {
+    float low[4];
+    float high[4];
+    principal_endpoints(block, 4, low, high);
+    int32_t endpoints[2][4];
+    int32_t p_bits[2];
+    quantize_bc7_endpoint(low, endpoints[0], &p_bits[0]);
+    quantize_bc7_endpoint(high, endpoints[1], &p_bits[1]);
+
+    int32_t palette[16][4];
+    for (int32_t c = 0; c < 4; c++) {
+        int32_t e0 = (endpoints[0][c] << 1) | p_bits[0];
+        int32_t e1 = (endpoints[1][c] << 1) | p_bits[1];
+        for (int32_t i = 0; i < 16; i++) {
+            palette[i][c] = ((64 - BC7_WEIGHTS4[i]) * e0 + BC7_WEIGHTS4[i] * e1 + 32) >> 6;
+        }
+    }
+    int32_t indices[16];
+    for (int32_t i = 0; i < 16; i++) {
+        int32_t best_error = 0x7FFFFFFF;
+        for (int32_t p = 0; p < 16; p++) {
+            int32_t error = 0;
+            for (int32_t c = 0; c < 4; c++) {
+                int32_t d = block[i][c] - palette[p][c];
+                error += d * d;
+            }
+            if (error < best_error) {
+                best_error = error;
+                indices[i] = p;
+            }
+        }
+    }
+
+    // The first index is stored with an implied zero top bit
+    if (indices[0] & 8) {
+        for (int32_t c = 0; c < 4; c++) {
+            int32_t swap = endpoints[0][c];
+            endpoints[0][c] = endpoints[1][c];
+            endpoints[1][c] = swap;
+        }
+        int32_t swap = p_bits[0];
+        p_bits[0] = p_bits[1];
+        p_bits[1] = swap;
+        for (int32_t i = 0; i < 16; i++) {
+            indices[i] = 15 - indices[i];
+        }
+    }
+
+    memset(dest, 0, 16);
+    int32_t position = 0;
+    put_bits(dest, &position, 1 << 6, 7);
+    for (int32_t c = 0; c < 4; c++) {
+        put_bits(dest, &position, endpoints[0][c], 7);
+        put_bits(dest, &position, endpoints[1][c], 7);
+    }
+    put_bits(dest, &position, p_bits[0], 1);
+    put_bits(dest, &position, p_bits[1], 1);
+    for (int32_t i = 0; i < 16; i++) {
+        put_bits(dest, &position, indices[i], i == 0 ? 3 : 4);
+    }
+}
+
+static int32_t decode_bc7_block(uint8_t block[16][4], uint8_t* src) {
+    int32_t position = 0;
+    if (get_bits(src, &position, 7) != 1 << 6) {
+        // Our encoder only writes mode 6
+        return NAXA_E_INTERNAL;
+    }
+    int32_t endpoints[2][4];
+    for (int32_t c = 0; c < 4; c++) {
+        endpoints[0][c] = get_bits(src, &position, 7);
+        endpoints[1][c] = get_bits(src, &position, 7);
+    }
+    int32_t p0 = get_bits(src, &position, 1);
+    int32_t p1 = get_bits(src, &position, 1);
+    for (int32_t i = 0; i < 16; i++) {
+        int32_t index = get_bits(src, &position, i == 0 ? 3 : 4);
+        for (int32_t c = 0; c < 4; c++) {
+            int32_t e0 = (endpoints[0][c] << 1) | p0;
+            int32_t e1 = (endpoints[1][c] << 1) | p1;
+            block[i][c] = clamp_byte(((64 - BC7_WEIGHTS4[index]) * e0 + BC7_WEIGHTS4[index] * e1 + 32) >> 6);
+        }
+    }
+    return NAXA_E_SUCCESS;
+}
+
+// RGBA8 rides along as a format of 1x1 blocks so cooked raw textures can
+// go through the same paths as compressed ones
+int32_t texcomp_block_size(int32_t format) {
+    switch (format) {
+        case NAXA_TEXTURE_RGBA8:
+            return 4;
+        case NAXA_TEXTURE_BC1:
+            return 8;
+        case NAXA_TEXTURE_BC3:
+        case NAXA_TEXTURE_BC5:
+        case NAXA_TEXTURE_BC7:
+            return 16;
+    }
+    return 0;
+}
+
+int32_t texcomp_size(int32_t width, int32_t height, int32_t format) {
+    if (format == NAXA_TEXTURE_RGBA8) {
+        return width * height * 4;
+    }
+    return ((width + 3) / 4) * ((height + 3) / 4) * texcomp_block_size(format);
+}
+
+int32_t texcomp_encode(uint8_t* dest, uint8_t* rgba, int32_t width, int32_t height, int32_t format) {
+    if (dest == NULL || rgba == NULL) {
+        report_error(NAXA_E_NULLPTR);
+        return NAXA_E_NULLPTR;
+    }
+    if (format == NAXA_TEXTURE_RGBA8) {
+        memcpy(dest, rgba, width * height * 4);
+        return NAXA_E_SUCCESS;
+    }
+    int32_t block_size = texcomp_block_size(format);
+    if (block_size == 0) {
+        report_error(NAXA_E_BOUNDS);
+        return NAXA_E_BOUNDS;
+    }
+    int32_t blocks_x = (width + 3) / 4;
+    int32_t blocks_y = (height + 3) / 4;
+    for (int32_t by = 0; by < blocks_y; by++) {
+        for (int32_t bx = 0; bx < blocks_x; bx++) {
+            uint8_t block[16][4];
+            uint8_t* out = &dest[(by * blocks_x + bx) * block_size];
+            fetch_block(block, rgba, width, height, bx, by);
+            switch (format) {
+                case NAXA_TEXTURE_BC1:
+                    encode_bc1_block(out, block, NAXA_TRUE);
+                    break;
+                case NAXA_TEXTURE_BC3:
+                    encode_bc4_block(out, block, 3);
+                    encode_bc1_block(out + 8, block, NAXA_FALSE);
+                    break;
+                case NAXA_TEXTURE_BC5:
+                    encode_bc4_block(out, block, 0);
+                    encode_bc4_block(out + 8, block, 1);
+                    break;
+                case NAXA_TEXTURE_BC7:
+                    encode_bc7_block(out, block);
+                    break;
+            }
+        }
+    }
+    return NAXA_E_SUCCESS;
+}
+
+int32_t texcomp_decode(uint8_t* dest, uint8_t* blocks, int32_t width, int32_t height, int32_t format) {
+    if (dest == NULL || blocks == NULL) {
+        report_error(NAXA_E_NULLPTR);
+        return NAXA_E_NULLPTR;
+    }
+    if (format == NAXA_TEXTURE_RGBA8) {
+        memcpy(dest, blocks, width * height * 4);
+        return NAXA_E_SUCCESS;
+    }
+    int32_t block_size = texcomp_block_size(format);
+    if (block_size == 0) {
+        report_error(NAXA_E_BOUNDS);
+        return NAXA_E_BOUNDS;
+    }
+    int32_t blocks_x = (width + 3) / 4;
+    int32_t blocks_y = (height + 3) / 4;
+    for (int32_t by = 0; by < blocks_y; by++) {
+        for (int32_t bx = 0; bx < blocks_x; bx++) {
+            uint8_t block[16][4];
+            uint8_t* in = &blocks[(by * blocks_x + bx) * block_size];
+            switch (format) {
+                case NAXA_TEXTURE_BC1:
+                    decode_bc1_block(block, in, NAXA_FALSE);
+                    break;
+                case NAXA_TEXTURE_BC3:
+                    decode_bc1_block(block, in + 8, NAXA_TRUE);
+                    decode_bc4_block(block, in, 3);
+                    break;
+                case NAXA_TEXTURE_BC5:
+                    memset(block, 0, sizeof(block));
+                    decode_bc4_block(block, in, 0);
+                    decode_bc4_block(block, in + 8, 1);
+                    for (int32_t i = 0; i < 16; i++) {
+                        block[i][3] = 255;
+                    }
+                    break;
+                case NAXA_TEXTURE_BC7:
+                    if (decode_bc7_block(block, in) != NAXA_E_SUCCESS) {
+                        report_error(NAXA_E_INTERNAL);
+                        return NAXA_E_INTERNAL;
+                    }
+                    break;
+            }
+            store_block(block, dest, width, height, bx, by);
+        }
+    }
+    return NAXA_E_SUCCESS;
+}
+
+// Peak signal to noise ratio over the channels the format actually keeps
+float texcomp_psnr(uint8_t* rgba, uint8_t* blocks, int32_t width, int32_t height, int32_t format) {
+    uint8_t* decoded = malloc(width * height * 4);
+    if (texcomp_decode(decoded, blocks, width, height, format) != NAXA_E_SUCCESS) {
+        free(decoded);
+        return 0.0f;
+    }
+    int32_t channels = format == NAXA_TEXTURE_BC5 ? 2 : 4;
+    double squared_error = 0.0;
+    for (int32_t i = 0; i < width * height; i++) {
+        for (int32_t c = 0; c < channels; c++) {
+            double d = (double)rgba[i * 4 + c] - decoded[i * 4 + c];
+            squared_error += d * d;
+        }
+    }
+    free(decoded);
+    double mse = squared_error / ((double)width * height * channels);
+    if (mse <= 0.0) {
+        return INFINITY;
+    }
+    return (float)(10.0 * log10(255.0 * 255.0 / mse));
+}
@@ -0,0 +1,222 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include <naxa/err.h>
+#include <naxa/log.h>
+#include <naxa/naxa_internal.h>
+
+// Every texture lives in a layer of a 2D array shared with the textures of
+// the same size and format. Pool N stays bound to texture unit N for its
+// whole life, so draws only ever pick a pool and a layer.
+#define TEXTURE_POOL_INITIAL_LAYERS 4
+#define TEXTURE_ANISOTROPY 8.0f
+#define TEXTURE_HEADLESS_MAX_LAYERS 2048
+
+typedef struct {
+    uint32_t texture;
+    uint32_t internal_format;
+    int32_t width;
+    int32_t height;
+    int32_t level_count;
+    int32_t layer_count;
+    int32_t layers_used;
+    uint8_t* layers;
+} TexturePool_t;
+
+TexturePool_t texture_pools[NAXA_TEXTURE_POOL_COUNT];
+int32_t texture_pool_max_layers;
+float texture_anisotropy;
+
+static uint32_t create_array(TexturePool_t* pool, int32_t layer_count) {
+    // Headless pools only keep their books, the slot stands in for a name
+    if (naxa_globals.flags1 & GLOBAL_FLAGS1_HEADLESS) {
+        return (uint32_t)(pool - texture_pools) + 1;
+    }
+    uint32_t texture = 0;
+    glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &texture);
+    if (texture == 0) {
+        return 0;
+    }
+    glTextureParameteri(texture, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTextureParameteri(texture, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTextureParameteri(texture, GL_TEXTURE_MIN_FILTER, pool->level_count > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+    glTextureParameteri(texture, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTextureParameterf(texture, GL_TEXTURE_MAX_ANISOTROPY, texture_anisotropy);
+    glTextureStorage3D(texture, pool->level_count, pool->internal_format, pool->width, pool->height, layer_count);
+    return texture;
+}
+
+// Double the layer count, the old layers come along on the GPU
+static int32_t grow_pool(int32_t index) {
+    TexturePool_t* pool = &texture_pools[index];
+    int32_t layer_count = pool->layer_count * 2;
+    layer_count = layer_count < texture_pool_max_layers ? layer_count : texture_pool_max_layers;
+    uint32_t texture = create_array(pool, layer_count);
+    if (texture == 0) {
+        report_error(NAXA_E_INTERNAL);
+        return NAXA_E_INTERNAL;
+    }
+    if (!(naxa_globals.flags1 & GLOBAL_FLAGS1_HEADLESS)) {
+        for (int32_t level = 0; level < pool->level_count; level++) {
+            int32_t width = pool->width >> level > 0 ? pool->width >> level : 1;
+            int32_t height = pool->height >> level > 0 ? pool->height >> level : 1;
+            glCopyImageSubData(pool->texture, GL_TEXTURE_2D_ARRAY, level, 0, 0, 0,
+                texture, GL_TEXTURE_2D_ARRAY, level, 0, 0, 0, width, height, pool->layer_count);
+        }
+        glDeleteTextures(1, &pool->texture);
+        glBindTextureUnit(index, texture);
+    }
+    pool->texture = texture;
+    pool->layers = realloc(pool->layers, layer_count);
+    memset(&pool->layers[pool->layer_count], 0, layer_count - pool->layer_count);
+    pool->layer_count = layer_count;
+    internal_logf(NAXA_SEVERITY_TRACE, "Grew texture pool %d to %d layers", index, layer_count);
+    return NAXA_E_SUCCESS;
+}
+
+static int32_t find_pool(uint32_t internal_format, int32_t width, int32_t height, int32_t level_count) {
+    int32_t empty = -1;
+    for (int32_t i = 0; i < NAXA_TEXTURE_POOL_COUNT; i++) {
+        TexturePool_t* pool = &texture_pools[i];
+        if (pool->texture == 0) {
+            empty = empty < 0 ? i : empty;
+            continue;
+        }
+        if (pool->internal_format == internal_format && pool->width == width && pool->height == height &&
+            pool->level_count == level_count &&
+            (pool->layers_used < pool->layer_count || pool->layer_count < texture_pool_max_layers)) {
+            return i;
+        }
+    }
+    if (empty < 0) {
+        return -1;
+    }
+
+    // Nothing compatible with room to spare, start a new pool
+    TexturePool_t* pool = &texture_pools[empty];
+    pool->internal_format = internal_format;
+    pool->width = width;
+    pool->height = height;
+    pool->level_count = level_count;
+    pool->texture = create_array(pool, TEXTURE_POOL_INITIAL_LAYERS);
+    if (pool->texture == 0) {
+        return -1;
+    }
+    pool->layer_count = TEXTURE_POOL_INITIAL_LAYERS;
+    pool->layers_used = 0;
+    pool->layers = calloc(TEXTURE_POOL_INITIAL_LAYERS, 1);
+    if (!(naxa_globals.flags1 & GLOBAL_FLAGS1_HEADLESS)) {
+        glBindTextureUnit(empty, pool->texture);
+    }
+    internal_logf(NAXA_SEVERITY_TRACE, "Created texture pool %d for %dx%d", empty, width, height);
+    return empty;
+}
+
+int32_t init_texture_pools() {
+    memset(texture_pools, 0, sizeof(texture_pools));
+    if (naxa_globals.flags1 & GLOBAL_FLAGS1_HEADLESS) {
+        texture_pool_max_layers = TEXTURE_HEADLESS_MAX_LAYERS;
+        texture_anisotropy = 1.0f;
+        return NAXA_E_SUCCESS;
+    }
+    glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &texture_pool_max_layers);
+
+    // Ask for as much anisotropy as we want, capped by the driver
+    float max_anisotropy = 1.0f;
+    glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY, &max_anisotropy);
+    texture_anisotropy = TEXTURE_ANISOTROPY < max_anisotropy ? TEXTURE_ANISOTROPY : max_anisotropy;
+    return NAXA_E_SUCCESS;
+}
+
+int32_t texpool_allocate(NaxaTexture_t* dest, uint32_t internal_format, int32_t width, int32_t height, int32_t level_count) {
+    if (dest == NULL) {
+        report_error(NAXA_E_NULLPTR);
+        return NAXA_E_NULLPTR;
+    }
+    int32_t index = find_pool(internal_format, width, height, level_count);
+    if (index < 0) {
+        report_error(NAXA_E_EXHAUSTED);
+        return NAXA_E_EXHAUSTED;
+    }
+    TexturePool_t* pool = &texture_pools[index];
+    if (pool->layers_used == pool->layer_count) {
+        int32_t rc = grow_pool(index);
+        if (rc != NAXA_E_SUCCESS) {
+            return rc;
+        }
+    }
+    int32_t layer = 0;
+    while (pool->layers[layer]) {
+        layer++;
+    }
+    pool->layers[layer] = NAXA_TRUE;
+    pool->layers_used++;
+    dest->pool = index;
+    dest->layer = layer;
+    return NAXA_E_SUCCESS;
+}
+
+int32_t texpool_release(NaxaTexture_t* texture) {
+    if (texture == NULL) {
+        report_error(NAXA_E_NULLPTR);
+        return NAXA_E_NULLPTR;
+    }
+    if (texture->pool < 0 || texture->pool >= NAXA_TEXTURE_POOL_COUNT) {
+        report_error(NAXA_E_BOUNDS);
+        return NAXA_E_BOUNDS;
+    }
+    TexturePool_t* pool = &texture_pools[texture->pool];
+    pool->layers[texture->layer] = NAXA_FALSE;
+    pool->layers_used--;
+    if (pool->layers_used == 0) {
+        // Give the VRAM and the texture unit back
+        if (!(naxa_globals.flags1 & GLOBAL_FLAGS1_HEADLESS)) {
+            glBindTextureUnit(texture->pool, 0);
+            glDeleteTextures(1, &pool->texture);
+        }
+        free(pool->layers);
+        memset(pool, 0, sizeof(TexturePool_t));
+    }
+    return NAXA_E_SUCCESS;
+}
+
+// Only the formats the loader hands out, uncompressed is always RGBA8
+static int64_t level_bytes(uint32_t internal_format, int32_t width, int32_t height) {
+    int64_t blocks = (int64_t)((width + 3) / 4) * ((height + 3) / 4);
+    switch (internal_format) {
+        case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:
+        case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT:
+            return blocks * 8;
+        case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+        case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT:
+        case GL_COMPRESSED_RG_RGTC2:
+        case GL_COMPRESSED_RGBA_BPTC_UNORM:
+        case GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM:
+            return blocks * 16;
+        default:
+            return (int64_t)width * height * 4;
+    }
+}
+
+int64_t texpool_allocated_bytes() {
+    int64_t bytes = 0;
+    for (int32_t i = 0; i < NAXA_TEXTURE_POOL_COUNT; i++) {
+        TexturePool_t* pool = &texture_pools[i];
+        if (pool->texture == 0) {
+            continue;
+        }
+        for (int32_t level = 0; level < pool->level_count; level++) {
+            int32_t width = pool->width >> level > 0 ? pool->width >> level : 1;
+            int32_t height = pool->height >> level > 0 ? pool->height >> level : 1;
+            bytes += level_bytes(pool->internal_format, width, height) * pool->layer_count;
+        }
+    }
+    return bytes;
+}
+
+uint32_t texpool_texture(int32_t pool) {
+    if (pool < 0 || pool >= NAXA_TEXTURE_POOL_COUNT) {
+        return 0;
+    }
+    return texture_pools[pool].texture;
+}
@@ -0,0 +1,488 @@
+#include <stdlib.h>
+#include <string.h>
+#include <threads.h>
+
+#include <stb/stb_image.h>
+
+#include <naxa/err.h>
+#include <naxa/log.h>
+#include <naxa/naxa_internal.h>
+
+// The ring is one persistently mapped pixel unpack buffer. The decoder
+// thread decodes and filters mip chains right into it and the main thread
+// only issues the copies out of it and fences them. Headless the ring is
+// plain memory and there is nothing to copy into.
+
+typedef struct UploadJob_t {
+    struct UploadJob_t* next;
+    NaxaTexture_t* texture;
+    char* path;
+    int32_t format;
+    int32_t cooked;
+    int32_t srgb;
+    uint32_t internal_format;
+    int32_t width;
+    int32_t height;
+    int32_t level_count;
+    int32_t base_level;
+    int32_t pool;
+    int32_t layer;
+    int32_t owns_layer;
+    int32_t size;
+    int32_t ring_offset;
+    int32_t ring_span;
+    uint8_t* fallback;
+    int32_t failed;
+    GLsync fence;
+    int64_t issued_frame;
+} UploadJob_t;
+
+typedef struct {
+    UploadJob_t* head;
+    UploadJob_t* tail;
+} UploadQueue_t;
+
+uint32_t upload_ring_buffer;
+uint8_t* upload_ring;
+int32_t upload_ring_head;
+int32_t upload_ring_used;
+int32_t upload_ring_waiting;
+int64_t upload_frame;
+int32_t upload_frame_bytes;
+
+// Pending and ready are shared with the decoder thread, in flight is only
+// touched by the main thread
+mtx_t upload_mutex;
+cnd_t upload_condition;
+int32_t upload_thread_stop;
+UploadQueue_t upload_pending;
+UploadJob_t* upload_decoding;
+UploadQueue_t upload_ready;
+UploadQueue_t upload_in_flight;
+
+static void queue_push(UploadQueue_t* queue, UploadJob_t* job) {
+    job->next = NULL;
+    if (queue->tail) {
+        queue->tail->next = job;
+    } else {
+        queue->head = job;
+    }
+    queue->tail = job;
+}
+
+static UploadJob_t* queue_pop(UploadQueue_t* queue) {
+    UploadJob_t* job = queue->head;
+    if (job) {
+        queue->head = job->next;
+        if (queue->head == NULL) {
+            queue->tail = NULL;
+        }
+    }
+    return job;
+}
+
+static void free_job(UploadJob_t* job) {
+    if (job->fence) {
+        glDeleteSync(job->fence);
+    }
+    free(job->fallback);
+    free(job->path);
+    free(job);
+}
+
+// Space is handed out and given back in FIFO order, so a byte count is
+// enough to know whether the next span would run into the oldest one
+static int32_t ring_reserve(UploadJob_t* job) {
+    int32_t offset = upload_ring_head;
+    int32_t padding = 0;
+    if (offset + job->size > UPLOAD_RING_SIZE) {
+        padding = UPLOAD_RING_SIZE - offset;
+        offset = 0;
+    }
+    if (upload_ring_used + padding + job->size > UPLOAD_RING_SIZE) {
+        return NAXA_FALSE;
+    }
+    job->ring_offset = offset;
+    job->ring_span = padding + job->size;
+    upload_ring_head = (offset + job->size) % UPLOAD_RING_SIZE;
+    upload_ring_used += job->ring_span;
+    return NAXA_TRUE;
+}
+
+// Cooked levels go up as they were read, only the ones from the base level
+// down and in the order the GPU wants them
+static void copy_levels(uint8_t* dest, UploadJob_t* job, NaxaKtx_t* ktx) {
+    for (int32_t level = job->base_level; level < job->level_count; level++) {
+        memcpy(dest, ktx->levels[level], ktx->level_sizes[level]);
+        dest += ktx->level_sizes[level];
+    }
+}
+
+int32_t upload_fill_levels(uint8_t* dest, uint8_t* pixels, int32_t channels, int32_t width, int32_t height,
+        int32_t level_count, int32_t base_level, int32_t srgb) {
+    if (dest == NULL || pixels == NULL) {
+        report_error(NAXA_E_NULLPTR);
+        return NAXA_E_NULLPTR;
+    }
+    if (base_level < 0 || base_level >= level_count) {
+        report_error(NAXA_E_BOUNDS);
+        return NAXA_E_BOUNDS;
+    }
+    if (base_level == 0) {
+        image_expand_rgba(dest, pixels, width * height, channels);
+        return mip_build_chain(dest, width, height, level_count, srgb);
+    }
+
+    // Levels above the base never go up, they are filtered down in place
+    // in the decoded image and only the base level lands in dest
+    uint8_t* expanded = NULL;
+    uint8_t* level = pixels;
+    if (channels != 4) {
+        expanded = malloc((size_t)width * height * 4);
+        image_expand_rgba(expanded, pixels, width * height, channels);
+        level = expanded;
+    }
+    for (int32_t i = 0; i < base_level; i++) {
+        mip_downsample(i == base_level - 1 ? dest : level, level, width, height, srgb);
+        width = width > 1 ? width / 2 : 1;
+        height = height > 1 ? height / 2 : 1;
+    }
+    free(expanded);
+    return mip_build_chain(dest, width, height, level_count - base_level, srgb);
+}
+
+// Headless nothing ever waits on the GPU, copies count as done a fixed
+// number of pumps after they were issued
+static int32_t fence_signalled(UploadJob_t* job) {
+    if (naxa_globals.flags1 & GLOBAL_FLAGS1_HEADLESS) {
+        return upload_frame - job->issued_frame >= UPLOAD_HEADLESS_LATENCY;
+    }
+    uint32_t status = glClientWaitSync(job->fence, 0, 0);
+    return status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED;
+}
+
+// Chains too big for the ring come from client memory instead
+static void copy_to_layer(UploadJob_t* job) {
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, job->fallback ? 0 : upload_ring_buffer);
+    uint32_t texture_id = texpool_texture(job->pool);
+    uint8_t* source = job->fallback ? job->fallback : (uint8_t*)(intptr_t)job->ring_offset;
+    for (int32_t level = job->base_level; level < job->level_count; level++) {
+        int32_t width = job->width >> level > 0 ? job->width >> level : 1;
+        int32_t height = job->height >> level > 0 ? job->height >> level : 1;
+        int32_t level_size = stream_level_size(job->format, width, height);
+        if (job->format == NAXA_TEXTURE_RGBA8) {
+            glTextureSubImage3D(texture_id, level - job->base_level, 0, 0, job->layer, width, height, 1,
+                GL_RGBA, GL_UNSIGNED_BYTE, source);
+        } else {
+            glCompressedTextureSubImage3D(texture_id, level - job->base_level, 0, 0, job->layer, width, height, 1,
+                job->internal_format, level_size, source);
+        }
+        source += level_size;
+    }
+}
+
+static int upload_thread_func(void* user) {
+    // Same orientation as every other image naxa loads
+    stbi_set_flip_vertically_on_load(1);
+    mtx_lock(&upload_mutex);
+    while (!upload_thread_stop) {
+        UploadJob_t* job = queue_pop(&upload_pending);
+        if (job == NULL) {
+            cnd_wait(&upload_condition, &upload_mutex);
+            continue;
+        }
+        int32_t cancelled = job->texture == NULL;
+        upload_decoding = job;
+        mtx_unlock(&upload_mutex);
+
+        // Decode first, the levels are filtered straight into the ring once
+        // there is room for them
+        uint8_t* pixels = NULL;
+        int32_t channels = 0;
+        NaxaKtx_t ktx;
+        memset(&ktx, 0, sizeof(ktx));
+        if (!cancelled && job->cooked) {
+            if (ktx_read(&ktx, job->path) != NAXA_E_SUCCESS || ktx.format != job->format ||
+                ktx.width != job->width || ktx.height != job->height || ktx.level_count != job->level_count) {
+                ktx_free(&ktx);
+                job->failed = NAXA_TRUE;
+            }
+        } else if (!cancelled) {
+            // Keep the channels the file has, widening to RGBA ourselves is
+            // much cheaper than letting stb_image do it per pixel
+            int32_t width;
+            int32_t height;
+            pixels = stbi_load(job->path, &width, &height, &channels, 0);
+            if (pixels == NULL || width != job->width || height != job->height) {
+                job->failed = NAXA_TRUE;
+            }
+        }
+        if (job->failed) {
+            internal_logf(NAXA_SEVERITY_ERROR, "Failed to decode texture %s", job->path);
+        }
+
+        // Fill the levels in once the GPU is done with enough of the ring
+        mtx_lock(&upload_mutex);
+        if (!cancelled && !job->failed) {
+            uint8_t* dest = NULL;
+            if (job->size > UPLOAD_RING_SIZE) {
+                job->fallback = malloc(job->size);
+                dest = job->fallback;
+            } else {
+                while (!upload_thread_stop && !ring_reserve(job)) {
+                    upload_ring_waiting = NAXA_TRUE;
+                    cnd_wait(&upload_condition, &upload_mutex);
+                }
+                upload_ring_waiting = NAXA_FALSE;
+                dest = job->ring_span > 0 ? &upload_ring[job->ring_offset] : NULL;
+            }
+            if (dest) {
+                mtx_unlock(&upload_mutex);
+                if (job->cooked) {
+                    copy_levels(dest, job, &ktx);
+                } else {
+                    upload_fill_levels(dest, pixels, channels, job->width, job->height, job->level_count,
+                        job->base_level, job->srgb);
+                }
+                mtx_lock(&upload_mutex);
+            }
+        }
+        stbi_image_free(pixels);
+        ktx_free(&ktx);
+        upload_decoding = NULL;
+        queue_push(&upload_ready, job);
+    }
+    mtx_unlock(&upload_mutex);
+    return 0;
+}
+
+int32_t init_uploader() {
+    if (naxa_globals.flags1 & GLOBAL_FLAGS1_HEADLESS) {
+        upload_ring = malloc(UPLOAD_RING_SIZE);
+    } else {
+        // Filtering reads back the level it just wrote, so the ring is
+        // mapped for reading too and asked to live in cached system memory
+        glCreateBuffers(1, &upload_ring_buffer);
+        uint32_t flags = GL_MAP_WRITE_BIT | GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glNamedBufferStorage(upload_ring_buffer, UPLOAD_RING_SIZE, NULL, flags | GL_CLIENT_STORAGE_BIT);
+        upload_ring = glMapNamedBufferRange(upload_ring_buffer, 0, UPLOAD_RING_SIZE, flags);
+        if (upload_ring == NULL) {
+            glDeleteBuffers(1, &upload_ring_buffer);
+        }
+    }
+    if (upload_ring == NULL) {
+        report_error(NAXA_E_INTERNAL);
+        return NAXA_E_INTERNAL;
+    }
+    upload_ring_head = 0;
+    upload_ring_used = 0;
+    upload_ring_waiting = NAXA_FALSE;
+    upload_frame = 0;
+    upload_frame_bytes = 0;
+    memset(&upload_pending, 0, sizeof(UploadQueue_t));
+    upload_decoding = NULL;
+    memset(&upload_ready, 0, sizeof(UploadQueue_t));
+    memset(&upload_in_flight, 0, sizeof(UploadQueue_t));
+
+    // Start the decoder thread
+    upload_thread_stop = 0;
+    mtx_init(&upload_mutex, mtx_plain);
+    cnd_init(&upload_condition);
+    if (thrd_create(&naxa_globals.thread_upload, upload_thread_func, NULL) != thrd_success) {
+        report_error(NAXA_E_INTERNAL);
+        return NAXA_E_INTERNAL;
+    }
+    naxa_globals.thread_flags |= GLOBAL_THREADFLAGS_UPLOAD;
+    return NAXA_E_SUCCESS;
+}
+
+int32_t upload_queue_texture(NaxaTexture_t* texture, int32_t pool, int32_t layer, int32_t base_level) {
+    if (texture == NULL) {
+        report_error(NAXA_E_NULLPTR);
+        return NAXA_E_NULLPTR;
+    }
+
+    if (!(naxa_globals.thread_flags & GLOBAL_THREADFLAGS_UPLOAD)) {
+        // Headless without the uploader there is nothing to decode into,
+        // the layer counts as filled
+        if (naxa_globals.flags1 & GLOBAL_FLAGS1_HEADLESS) {
+            return stream_upload_done(texture, pool, layer, base_level);
+        }
+        report_error(NAXA_E_INTERNAL);
+        return NAXA_E_INTERNAL;
+    }
+    UploadJob_t* job = calloc(1, sizeof(UploadJob_t));
+    int32_t path_len = strlen(texture->path);
+    job->path = malloc(path_len + 1);
+    memcpy(job->path, texture->path, path_len + 1);
+    job->texture = texture;
+    job->format = texture->format;
+    job->cooked = texture->cooked;
+    job->srgb = texture->srgb;
+    job->internal_format = texture->internal_format;
+    job->width = texture->width;
+    job->height = texture->height;
+    job->level_count = texture->level_count;
+    job->base_level = base_level;
+    job->pool = pool;
+    job->layer = layer;
+    job->owns_layer = pool != texture->pool || layer != texture->layer;
+    job->size = stream_chain_size(texture, base_level);
+    texture->streaming = NAXA_TRUE;
+
+    mtx_lock(&upload_mutex);
+    queue_push(&upload_pending, job);
+    mtx_unlock(&upload_mutex);
+    cnd_broadcast(&upload_condition);
+    return NAXA_E_SUCCESS;
+}
+
+int32_t upload_cancel_texture(NaxaTexture_t* texture) {
+    if (!(naxa_globals.thread_flags & GLOBAL_THREADFLAGS_UPLOAD)) {
+        return NAXA_E_SUCCESS;
+    }
+
+    // Anything already issued finished its copy before the texture goes away
+    mtx_lock(&upload_mutex);
+    if (upload_decoding && upload_decoding->texture == texture) {
+        upload_decoding->texture = NULL;
+    }
+    for (UploadJob_t* job = upload_pending.head; job; job = job->next) {
+        if (job->texture == texture) {
+            job->texture = NULL;
+        }
+    }
+    for (UploadJob_t* job = upload_ready.head; job; job = job->next) {
+        if (job->texture == texture) {
+            job->texture = NULL;
+        }
+    }
+    mtx_unlock(&upload_mutex);
+    return NAXA_E_SUCCESS;
+}
+
+int32_t upload_pump() {
+    if (!(naxa_globals.thread_flags & GLOBAL_THREADFLAGS_UPLOAD)) {
+        return NAXA_E_SUCCESS;
+    }
+
+    // Give back ring space the GPU has finished copying out of. The decoder
+    // has to look again before it counts as waiting on the ring.
+    int32_t headless = naxa_globals.flags1 & GLOBAL_FLAGS1_HEADLESS;
+    int32_t retired = 0;
+    upload_frame++;
+    while (upload_in_flight.head && fence_signalled(upload_in_flight.head)) {
+        UploadJob_t* job = queue_pop(&upload_in_flight);
+        mtx_lock(&upload_mutex);
+        upload_ring_used -= job->ring_span;
+        upload_ring_waiting = NAXA_FALSE;
+        mtx_unlock(&upload_mutex);
+        free_job(job);
+        retired++;
+    }
+    if (retired) {
+        cnd_broadcast(&upload_condition);
+    }
+
+    // Issue copies for finished decodes until the frame budget runs out
+    int32_t budget = UPLOAD_BYTES_PER_FRAME;
+    while (budget > 0) {
+        mtx_lock(&upload_mutex);
+        UploadJob_t* job = queue_pop(&upload_ready);
+        mtx_unlock(&upload_mutex);
+        if (job == NULL) {
+            break;
+        }
+        if (job->texture != NULL && !job->failed) {
+            if (!headless) {
+                copy_to_layer(job);
+            }
+            internal_logf(NAXA_SEVERITY_TRACE, "Uploaded texture %s from level %d", job->path, job->base_level);
+            stream_upload_done(job->texture, job->pool, job->layer, job->base_level);
+            budget -= job->size;
+        } else {
+            // Nobody is going to sample the layer this was headed for, and
+            // a file that failed once is not worth asking for again
+            if (job->texture != NULL) {
+                job->texture->streaming = NAXA_FALSE;
+                job->texture->ceiling_level = job->texture->resident_level;
+            }
+            if (job->owns_layer) {
+                NaxaTexture_t allocation = { .pool = job->pool, .layer = job->layer };
+                texpool_release(&allocation);
+            }
+        }
+        if (job->ring_span == 0) {
+            free_job(job);
+            continue;
+        }
+
+        // Cancelled jobs still hold ring space and have to retire in order
+        job->fence = headless ? NULL : glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        job->issued_frame = upload_frame;
+        queue_push(&upload_in_flight, job);
+    }
+    if (!headless) {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+    upload_frame_bytes = UPLOAD_BYTES_PER_FRAME - budget;
+    return NAXA_E_SUCCESS;
+}
+
+int32_t upload_get_stats(UploadStats_t* dest) {
+    if (dest == NULL) {
+        report_error(NAXA_E_NULLPTR);
+        return NAXA_E_NULLPTR;
+    }
+    memset(dest, 0, sizeof(UploadStats_t));
+    if (!(naxa_globals.thread_flags & GLOBAL_THREADFLAGS_UPLOAD)) {
+        return NAXA_E_SUCCESS;
+    }
+    mtx_lock(&upload_mutex);
+    dest->ring_head = upload_ring_head;
+    dest->ring_used = upload_ring_used;
+    dest->ring_waiting = upload_ring_waiting;
+    dest->pending = upload_decoding != NULL;
+    for (UploadJob_t* job = upload_pending.head; job; job = job->next) {
+        dest->pending++;
+    }
+    for (UploadJob_t* job = upload_ready.head; job; job = job->next) {
+        dest->ready++;
+    }
+    mtx_unlock(&upload_mutex);
+    for (UploadJob_t* job = upload_in_flight.head; job; job = job->next) {
+        dest->in_flight++;
+    }
+    dest->frame_bytes = upload_frame_bytes;
+    return NAXA_E_SUCCESS;
+}
+
+int32_t await_upload_thread() {
+    if (naxa_globals.thread_flags & GLOBAL_THREADFLAGS_UPLOAD) {
+        // Tell the thread to stop and wait for it
+        mtx_lock(&upload_mutex);
+        upload_thread_stop = 1;
+        mtx_unlock(&upload_mutex);
+        cnd_broadcast(&upload_condition);
+        thrd_join(naxa_globals.thread_upload, NULL);
+        memset(&naxa_globals.thread_upload, 0, sizeof(thrd_t));
+        naxa_globals.thread_flags &= ~GLOBAL_THREADFLAGS_UPLOAD;
+
+        // Drop whatever never made it to the GPU
+        UploadQueue_t* queues[3] = { &upload_pending, &upload_ready, &upload_in_flight };
+        for (int32_t i = 0; i < 3; i++) {
+            UploadJob_t* job;
+            while ((job = queue_pop(queues[i]))) {
+                free_job(job);
+            }
+        }
+        if (naxa_globals.flags1 & GLOBAL_FLAGS1_HEADLESS) {
+            free(upload_ring);
+        } else {
+            glUnmapNamedBuffer(upload_ring_buffer);
+            glDeleteBuffers(1, &upload_ring_buffer);
+        }
+        upload_ring = NULL;
+    }
+    return NAXA_E_SUCCESS;
+}
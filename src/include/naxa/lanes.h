@@ -0,0 +1,68 @@
+#ifndef __naxa_lanes_h__
+#define __naxa_lanes_h__
+
+// Float vectors as wide as the build allows, one AVX register, one SSE
+// register or a plain float. Code written against these runs the same
+// loop at any width, LANES floats per step.
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE__)
+#include <xmmintrin.h>
+#else
+#include <math.h>
+#endif
+
+#define LANE_ALIGNED __attribute__((aligned(32)))
+
+#if defined(__AVX__)
+#define LANES 8
+typedef __m256 Lane_t;
+#define lane_load(p) _mm256_load_ps(p)
+#define lane_store(p, v) _mm256_store_ps(p, v)
+#define lane_set1(x) _mm256_set1_ps(x)
+#define lane_add(a, b) _mm256_add_ps(a, b)
+#define lane_sub(a, b) _mm256_sub_ps(a, b)
+#define lane_mul(a, b) _mm256_mul_ps(a, b)
+#define lane_div(a, b) _mm256_div_ps(a, b)
+#define lane_min(a, b) _mm256_min_ps(a, b)
+#define lane_max(a, b) _mm256_max_ps(a, b)
+#define lane_rsqrt(a) _mm256_rsqrt_ps(a)
+#define lane_flip_sign(a, s) _mm256_xor_ps(a, _mm256_and_ps(s, _mm256_set1_ps(-0.0f)))
+#elif defined(__SSE__)
+#define LANES 4
+typedef __m128 Lane_t;
+#define lane_load(p) _mm_load_ps(p)
+#define lane_store(p, v) _mm_store_ps(p, v)
+#define lane_set1(x) _mm_set1_ps(x)
+#define lane_add(a, b) _mm_add_ps(a, b)
+#define lane_sub(a, b) _mm_sub_ps(a, b)
+#define lane_mul(a, b) _mm_mul_ps(a, b)
+#define lane_div(a, b) _mm_div_ps(a, b)
+#define lane_min(a, b) _mm_min_ps(a, b)
+#define lane_max(a, b) _mm_max_ps(a, b)
+#define lane_rsqrt(a) _mm_rsqrt_ps(a)
+#define lane_flip_sign(a, s) _mm_xor_ps(a, _mm_and_ps(s, _mm_set1_ps(-0.0f)))
+#else
+#define LANES 1
+typedef float Lane_t;
+#define lane_load(p) (*(p))
+#define lane_store(p, v) (*(p) = (v))
+#define lane_set1(x) (x)
+#define lane_add(a, b) ((a) + (b))
+#define lane_sub(a, b) ((a) - (b))
+#define lane_mul(a, b) ((a) * (b))
+#define lane_div(a, b) ((a) / (b))
+#define lane_min(a, b) fminf(a, b)
+#define lane_max(a, b) fmaxf(a, b)
+#define lane_rsqrt(a) (1.0f / sqrtf(a))
+#define lane_flip_sign(a, s) (signbit(s) ? -(a) : (a))
+#endif
+
+// 1 / |v| from the estimate and one Newton step, zero stays finite
+static inline Lane_t lane_inverse_length(Lane_t length2) {
+    length2 = lane_max(length2, lane_set1(1e-20f));
+    Lane_t inverse = lane_rsqrt(length2);
+    return lane_mul(inverse, lane_sub(lane_set1(1.5f), lane_mul(lane_mul(lane_set1(0.5f), length2), lane_mul(inverse, inverse))));
+}
+
+#endif
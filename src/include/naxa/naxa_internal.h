@@ -1,6 +1,7 @@
 #ifndef __naxa_internal_h__
 #define __naxa_internal_h__
 
+#include <stdatomic.h>
 #include <stdint.h>
 #include <threads.h>
 
@@ -9,16 +10,38 @@
 
 #include <naxa/naxa.h>
 
+// glad is generated without the S3TC extension, the enums are stable though
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT1_EXT 0x83F1
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+#ifndef GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT 0x8C4D
+#endif
+#ifndef GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT 0x8C4F
+#endif
+
 typedef struct {
     // Flags
     #define GLOBAL_FLAGS1_SEGFAULTED 0x1
     #define GLOBAL_FLAGS1_STDOUT_LOGGING 0x2
+    #define GLOBAL_FLAGS1_OCCLUSION_CULLING 0x4
+    #define GLOBAL_FLAGS1_PRESKINNING 0x8
+    #define GLOBAL_FLAGS1_DUAL_QUAT_SKINNING 0x10
+    #define GLOBAL_FLAGS1_JOB_FIBERS 0x20
+    #define GLOBAL_FLAGS1_HEADLESS 0x40
     int64_t flags1;
 
     // Threads
     #define GLOBAL_THREADFLAGS_LOG 0x1
+    #define GLOBAL_THREADFLAGS_UPLOAD 0x2
+    #define GLOBAL_THREADFLAGS_JOBS 0x4
     int64_t thread_flags;
     thrd_t thread_log;
+    thrd_t thread_upload;
 
     // GLFW context which is shared between graphics and input
     GLFWwindow* window;
@@ -26,24 +49,251 @@ typedef struct {
     int window_height;
 } NaxaGlobals_t;
 
+// Assimp types, only the loader and the animation importer include assimp
+struct aiMatrix4x4;
+struct aiScene;
+
 typedef struct {
     uint32_t type;
     char* path;
 } NaxaShaderType_t;
 
+// Optional shader features, each one turns on a NAXA_* define in the source
+#define NAXA_SHADER_SKINNED 0x1
+#define NAXA_SHADER_DUAL_QUAT 0x2
+#define NAXA_SHADER_CROWD 0x4
+#define NAXA_SHADER_MORPH 0x8
+#define NAXA_SHADER_FEATURE_COUNT 4
+#define NAXA_SHADER_MAX_STAGES 4
+#define NAXA_SHADER_MAX_VARIANT_SETS 32
+
+// Every feature combination of one set of stages, compiled when first used.
+// The key is what the program was built from, for hot reloading. A variant
+// that failed to build isn't tried again until the sources are reloaded.
+typedef struct {
+    int32_t stages_len;
+    NaxaShaderType_t stages[NAXA_SHADER_MAX_STAGES];
+    uint32_t programs[1 << NAXA_SHADER_FEATURE_COUNT];
+    uint64_t keys[1 << NAXA_SHADER_FEATURE_COUNT];
+    int32_t failed[1 << NAXA_SHADER_FEATURE_COUNT];
+} NaxaShaderVariants_t;
+
+// Texture arrays, each bound to the texture unit of the same index. Has to
+// match the sampler array in the fragment shader.
+#define NAXA_TEXTURE_POOL_COUNT 16
+
+// A cooked texture and its mip chain, level 0 is the largest. Colour is
+// sRGB encoded unless the file says it is linear.
+#define NAXA_MAX_MIP_LEVELS 16
+typedef struct {
+    int32_t format;
+    int32_t srgb;
+    int32_t width;
+    int32_t height;
+    int32_t level_count;
+    int32_t level_sizes[NAXA_MAX_MIP_LEVELS];
+    uint8_t* levels[NAXA_MAX_MIP_LEVELS];
+} NaxaKtx_t;
+
+// Poses are ten planes of floats, every plane padded to a whole number of
+// 8 wide vector blocks
+#define NAXA_POSE_ALIGNMENT 32
+#define NAXA_POSE_STRIDE_MULTIPLE 8
+#define NAXA_POSE_PLANES 10
+
+// Frustum culling kernels, cull_spheres takes the widest the CPU has
+#define CULL_KERNEL_SCALAR 0
+#define CULL_KERNEL_SSE 1
+#define CULL_KERNEL_AVX 2
+
+// Texture upload ring. Headless there is no GPU and copies count as done
+// UPLOAD_HEADLESS_LATENCY pumps after they were issued.
+#define UPLOAD_RING_SIZE (64 * 1024 * 1024)
+#define UPLOAD_BYTES_PER_FRAME (16 * 1024 * 1024)
+#define UPLOAD_HEADLESS_LATENCY 2
+typedef struct {
+    int32_t ring_head;
+    int32_t ring_used;
+    int32_t ring_waiting;
+    int32_t pending;
+    int32_t ready;
+    int32_t in_flight;
+    int32_t frame_bytes;
+} UploadStats_t;
+
+// Interleaved vertex layout of every model VBO
+#define MAX_BONE_WEIGHTS 4
+typedef struct {
+    vec3 position;
+    vec2 texture;
+    vec3 normal;
+    ivec4 bone_ids;
+    vec4 bone_weights;
+} VertexData_t;
+
+// Dynamic AABB tree. Leaves hold fattened boxes so small movements don't
+// touch the tree, and queries walk a depth first flattened copy of it.
+typedef struct {
+    vec3 min;
+    vec3 max;
+    int32_t parent;
+    int32_t left;
+    int32_t right;
+    int32_t height;
+    void* user;
+} NaxaBvhNode_t;
+
+typedef struct {
+    vec3 min;
+    vec3 max;
+    int32_t skip;
+    int32_t leaf;
+    void* user;
+} NaxaBvhFlatNode_t;
+
+typedef struct {
+    int32_t root;
+    int32_t free_list;
+    int32_t node_count;
+    int32_t node_size;
+    NaxaBvhNode_t* nodes;
+    int32_t flat_dirty;
+    int32_t flat_len;
+    int32_t flat_size;
+    NaxaBvhFlatNode_t* flat;
+    float margin;
+} NaxaBvh_t;
+
+// Return NAXA_FALSE to stop the query early
+typedef int32_t (*NaxaBvhCallback_t)(void* user, void* context);
+
 extern NaxaGlobals_t naxa_globals;
 
 // Generic functions
 uint32_t hash_code(char* string);
 char* read_file_into_buffer(FILE* fp, uint32_t* len);
+void* arena_alloc(NaxaArena_t* arena, int64_t bytes, int64_t alignment);
+
+// Spatial index
+int32_t bvh_init(NaxaBvh_t* bvh, float margin);
+int32_t bvh_free(NaxaBvh_t* bvh);
+int32_t bvh_insert(NaxaBvh_t* bvh, int32_t* dest, vec3 min, vec3 max, void* user);
+int32_t bvh_remove(NaxaBvh_t* bvh, int32_t proxy);
+int32_t bvh_update(NaxaBvh_t* bvh, int32_t proxy, vec3 min, vec3 max);
+int32_t bvh_rebuild(NaxaBvh_t* bvh);
+int32_t bvh_flatten(NaxaBvh_t* bvh);
+int32_t bvh_query_box(NaxaBvh_t* bvh, vec3 min, vec3 max, NaxaBvhCallback_t callback, void* context);
+int32_t bvh_query_sphere(NaxaBvh_t* bvh, vec3 center, float radius, NaxaBvhCallback_t callback, void* context);
+int32_t bvh_query_ray(NaxaBvh_t* bvh, vec3 origin, vec3 direction, float max_distance, NaxaBvhCallback_t callback, void* context);
+int32_t bvh_query_frustum(NaxaBvh_t* bvh, vec4 planes[6], NaxaBvhCallback_t callback, void* context);
 
 // Graphics functions
 int32_t init_gfx_context(int32_t window_width, int32_t window_height, char* window_name);
 int32_t init_renderer();
 int32_t init_loader_caches();
-int32_t load_shader_program(uint32_t* dest, int32_t stages_len, NaxaShaderType_t* stages);
+int32_t simplify_mesh(uint32_t* dest, int32_t* dest_len, float* dest_error, uint32_t* indices, int32_t index_count, VertexData_t* vertices, int32_t vertex_count, int32_t target_index_count);
+int32_t init_texture_pools();
+int32_t texpool_allocate(NaxaTexture_t* dest, uint32_t internal_format, int32_t width, int32_t height, int32_t level_count);
+int32_t texpool_release(NaxaTexture_t* texture);
+uint32_t texpool_texture(int32_t pool);
+int64_t texpool_allocated_bytes();
+int32_t init_streaming();
+int32_t stream_level_size(int32_t format, int32_t width, int32_t height);
+int32_t stream_chain_size(NaxaTexture_t* texture, int32_t base_level);
+int32_t stream_initial_level(int32_t width, int32_t height, int32_t level_count);
+int32_t stream_register(NaxaTexture_t* texture);
+int32_t stream_unregister(NaxaTexture_t* texture);
+int32_t stream_request(NaxaTexture_t* texture, float screen_pixels);
+int32_t stream_upload_done(NaxaTexture_t* texture, int32_t pool, int32_t layer, int32_t base_level);
+int32_t stream_update();
+int32_t init_uploader();
+int32_t upload_queue_texture(NaxaTexture_t* texture, int32_t pool, int32_t layer, int32_t base_level);
+int32_t upload_cancel_texture(NaxaTexture_t* texture);
+int32_t upload_pump();
+int32_t upload_fill_levels(uint8_t* dest, uint8_t* pixels, int32_t channels, int32_t width, int32_t height,
+    int32_t level_count, int32_t base_level, int32_t srgb);
+int32_t upload_get_stats(UploadStats_t* dest);
+int32_t await_upload_thread();
+int32_t init_mip_tables();
+int32_t mip_level_count(int32_t width, int32_t height);
+int32_t mip_chain_size(int32_t width, int32_t height, int32_t level_count);
+int32_t mip_downsample(uint8_t* dest, uint8_t* src, int32_t src_width, int32_t src_height, int32_t gamma_correct);
+int32_t mip_build_chain(uint8_t* dest, int32_t width, int32_t height, int32_t level_count, int32_t gamma_correct);
+int32_t image_expand_rgba(uint8_t* dest, uint8_t* src, int32_t pixel_count, int32_t channels);
+int32_t texcomp_block_size(int32_t format);
+int32_t texcomp_size(int32_t width, int32_t height, int32_t format);
+int32_t texcomp_encode(uint8_t* dest, uint8_t* rgba, int32_t width, int32_t height, int32_t format);
+int32_t texcomp_decode(uint8_t* dest, uint8_t* blocks, int32_t width, int32_t height, int32_t format);
+float texcomp_psnr(uint8_t* rgba, uint8_t* blocks, int32_t width, int32_t height, int32_t format);
+int32_t ktx_is_ktx(char* path);
+int32_t ktx_write(char* path, NaxaKtx_t* ktx);
+int32_t ktx_read_header(NaxaKtx_t* dest, char* path);
+int32_t ktx_read(NaxaKtx_t* dest, char* path);
+int32_t ktx_free(NaxaKtx_t* ktx);
+int32_t init_shaders();
+int32_t load_shader_program(uint32_t* dest, int32_t stages_len, NaxaShaderType_t* stages, uint32_t features);
+int32_t shader_queue_program(uint32_t* dest, int32_t stages_len, NaxaShaderType_t* stages, uint32_t features);
+int32_t shader_pending(uint32_t* dest);
+int32_t shader_pump(int32_t wait);
+int32_t shader_variants_init(NaxaShaderVariants_t* dest, int32_t stages_len, NaxaShaderType_t* stages);
+uint32_t shader_variant(NaxaShaderVariants_t* variants, uint32_t features);
+int32_t shader_variants_free(NaxaShaderVariants_t* variants);
+int32_t shader_reload();
+int32_t reload_texture(char* path);
+int32_t init_watcher(char* root);
+int32_t watch_poll(void (*changed)(char* path));
+int32_t teardown_watcher();
 int32_t render_all();
 int32_t render_enqueue(NaxaEntity_t* entity);
+int32_t render_enqueue_crowd(NaxaCrowd_t* crowd, float time);
+uint32_t render_skin_features();
+float render_screen_size(NaxaEntity_t* entity);
+int32_t cull_sphere_visible(vec4 planes[6], vec3 center, float radius);
+int32_t cull_spheres(vec4 planes[6], int32_t count, float* x, float* y, float* z, float* r, uint8_t* visible);
+int32_t cull_spheres_scalar(vec4 planes[6], int32_t count, float* x, float* y, float* z, float* r, uint8_t* visible);
+int32_t cull_kernel_supported(int32_t kernel);
+int32_t cull_spheres_kernel(int32_t kernel, vec4 planes[6], int32_t count, float* x, float* y, float* z, float* r, uint8_t* visible);
+int32_t init_occlusion();
+int32_t occlusion_add_occluder(vec3* positions, int32_t vertex_count, uint32_t* indices, int32_t index_count, mat4 transform);
+int32_t occlusion_clear_occluders();
+int32_t occlusion_begin_frame(mat4 view_projection);
+int32_t occlusion_end_frame();
+int32_t occlusion_frame_ready();
+int32_t occlusion_test_box(vec3 min, vec3 max, mat4 transform);
+int32_t occlusion_dump(char* path, int32_t level);
+int32_t skin_acquire(NaxaPose_t* pose, NaxaModel_t* model, uint32_t features, int32_t* stale);
+int32_t skin_dispatch(int32_t slot, NaxaModel_t* model, int32_t palette_offset, int32_t morph_offset, uint32_t features);
+int32_t skin_finish_dispatches();
+uint32_t skin_vao(int32_t slot);
+int32_t skin_release(NaxaPose_t* pose);
+int32_t morph_import(NaxaModel_t* model, const struct aiScene* scene);
+int32_t morph_free(NaxaModel_t* model);
+
+// Animation functions
+void anim_ai_matrix(mat4 dest, struct aiMatrix4x4* src);
+int32_t anim_import(NaxaModel_t* model, const struct aiScene* scene);
+int32_t anim_free(NaxaModel_t* model);
+int32_t anim_pose_bytes(int32_t joint_count);
+void anim_pose_bind(NaxaPose_t* dest, float* planes, int32_t joint_count);
+int32_t anim_skin_palette(mat4* dest, NaxaModel_t* model, NaxaPose_t* pose);
+int32_t anim_skin_dual_quats(vec4* dest, NaxaModel_t* model, NaxaPose_t* pose);
+void anim_blend_lerp(NaxaPose_t* dest, NaxaPose_t* other, float* mask, float weight);
+int32_t anim_lod_update(NaxaAnimLod_t* lod, int32_t level, float now, NaxaPoseSource_t source, void* user, NaxaPose_t* dest);
+
+// Job system, a job covers [first, last) of whatever data points to and
+// takes one off its counter when done. Waiting on a counter runs other jobs,
+// or with fibers parks the waiting job so its thread can run them.
+#define NAXA_MAX_JOB_THREADS 64
+typedef void (*NaxaJobFunction_t)(void* data, int32_t first, int32_t last);
+typedef atomic_int NaxaJobCounter_t;
+int32_t init_jobs(int32_t thread_count, int32_t fibers);
+int32_t teardown_jobs();
+int32_t job_thread_count();
+int32_t job_thread_current();
+int32_t job_park_count();
+int32_t job_submit(NaxaJobFunction_t function, void* data, int32_t first, int32_t last, NaxaJobCounter_t* counter);
+int32_t job_wait(NaxaJobCounter_t* counter);
+int32_t job_parallel_for(int32_t count, int32_t min_chunk, NaxaJobFunction_t function, void* data);
 
 // Internal logging utilities
 int32_t init_log_engine(char* log_file, int32_t stdout_logging);
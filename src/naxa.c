@@ -11,6 +11,9 @@
 #include <naxa/naxa.h>
 #include <naxa/naxa_internal.h>
 
+#define DEMO_CROWD_SIZE 32
+#define DEMO_CROWD_SPACING 4.0f
+
 NaxaGlobals_t naxa_globals;
 
 static void handle_segfault(int signum) {
@@ -30,7 +33,22 @@ static void handle_segfault(int signum) {
     exit(1);
 }
 
-extern int32_t naxa_init() {
+// Shader sources can be pulled in by any program so they all get checked,
+// anything else might be a texture somebody loaded
+static void hot_reload(char* path) {
+    static const char* shader_extensions[] = { ".vert", ".frag", ".geom", ".comp", ".glsl" };
+    char* extension = strrchr(path, '.');
+    for (int32_t i = 0; extension && i < sizeof(shader_extensions) / sizeof(char*); i++) {
+        if (strcmp(extension, shader_extensions[i]) == 0) {
+            shader_reload();
+            return;
+        }
+    }
+    reload_texture(path);
+}
+
+// Everything that comes up with or without a window
+static int32_t init_core() {
     int32_t rc;
 
     // Clear out the global area
@@ -47,19 +65,64 @@ extern int32_t naxa_init() {
     set_log_severity(NAXA_SEVERITY_INFO);
     internal_log("Started Naxa");
 
+    // Worker threads for everything that splits up, one per core. Nothing
+    // waits inside a job yet, so jobs run straight on the threads and the
+    // fiber backend stays off until something needs it.
+    if ((rc = init_jobs(0, NAXA_FALSE)) != NAXA_E_SUCCESS) {
+        return rc;
+    }
+    return NAXA_E_SUCCESS;
+}
+
+extern int32_t naxa_init() {
+    int32_t rc;
+    if ((rc = init_core()) != NAXA_E_SUCCESS) {
+        return rc;
+    }
+
     // Set up the graphics context
     // TODO let the application choose
     if ((rc = init_gfx_context(720, 480, NULL)) != NAXA_E_SUCCESS) {
         return rc;
     }
 
-    // Set up OpenGL stuff
+    // Set up OpenGL stuff, timed to see what the shader cache saves
+    double start = glfwGetTime();
+    init_shaders();
     init_renderer();
     init_loader_caches();
+    init_uploader();
+    init_occlusion();
+    internal_logf(NAXA_SEVERITY_INFO, "Graphics ready in %.2f ms", (glfwGetTime() - start) * 1000.0);
 
+    // Pick up edits to resources while running, fine to go without
+    if (init_watcher("res") != NAXA_E_SUCCESS) {
+        internal_logs(NAXA_SEVERITY_WARN, "Hot reloading is unavailable");
+    }
+
+    return NAXA_E_SUCCESS;
+}
+
+extern int32_t naxa_init_headless() {
+    int32_t rc;
+    if ((rc = init_core()) != NAXA_E_SUCCESS) {
+        return rc;
+    }
+
+    // Texture pools and streaming only do their bookkeeping without GL
+    naxa_globals.flags1 |= GLOBAL_FLAGS1_HEADLESS;
+    init_occlusion();
+    init_texture_pools();
+    init_streaming();
+    init_mip_tables();
+    internal_log("Running headless");
     return NAXA_E_SUCCESS;
 }
 
+static int32_t sample_source(void* user, float time, NaxaPose_t* dest) {
+    return naxa_sample_clip((NaxaAnimSampler_t*)user, time, dest);
+}
+
 extern int32_t naxa_run() {
     internal_log("Entered game loop");
 
@@ -68,13 +131,66 @@ extern int32_t naxa_run() {
     entity.position[0] = 0.0f;
     entity.position[1] = -10.0f;
     entity.position[2] = -20.0f;
+    glm_quat_identity(entity.rotation_quat);
+    entity.pose = NULL;
+    entity.lod = 0;
+
+    // Play the first clip if the model came with any
+    NaxaPose_t pose;
+    NaxaAnimSampler_t sampler;
+    NaxaAnimLod_t anim_lod;
+    memset(&sampler, 0, sizeof(sampler));
+    if (entity.model != NULL && entity.model->clip_count > 0) {
+        naxa_init_pose(&pose, entity.model);
+        naxa_init_sampler(&sampler, entity.model, &entity.model->clips[0]);
+        naxa_init_anim_lod(&anim_lod, entity.model);
+        entity.pose = &pose;
+    }
+
+    // A crowd in the background playing the same clips from baked textures
+    NaxaVertexAnimation_t crowd_animation;
+    NaxaCrowd_t crowd;
+    memset(&crowd_animation, 0, sizeof(crowd_animation));
+    memset(&crowd, 0, sizeof(crowd));
+    if (entity.pose != NULL && naxa_cook_vertex_animation(&crowd_animation, entity.model, 30.0f) == NAXA_E_SUCCESS &&
+        naxa_init_crowd(&crowd, &crowd_animation, DEMO_CROWD_SIZE * DEMO_CROWD_SIZE) == NAXA_E_SUCCESS) {
+        NaxaCrowdInstance_t* instances = malloc(crowd.instance_count * sizeof(NaxaCrowdInstance_t));
+        for (int32_t i = 0; i < crowd.instance_count; i++) {
+            instances[i].position[0] = (i % DEMO_CROWD_SIZE - DEMO_CROWD_SIZE / 2) * DEMO_CROWD_SPACING;
+            instances[i].position[1] = -10.0f;
+            instances[i].position[2] = -40.0f - (i / DEMO_CROWD_SIZE) * DEMO_CROWD_SPACING;
+            glm_quat_identity(instances[i].rotation_quat);
+            instances[i].clip = i % crowd_animation.clip_count;
+            instances[i].time_offset = i * 0.37f;
+            instances[i].speed = 1.0f;
+        }
+        naxa_set_crowd_instances(&crowd, 0, crowd.instance_count, instances);
+        free(instances);
+    }
 
     while (!glfwWindowShouldClose(naxa_globals.window)) {
+        watch_poll(hot_reload);
+        shader_pump(NAXA_FALSE);
+        upload_pump();
+        stream_update();
+        if (entity.pose != NULL) {
+            naxa_update_anim_lod(&anim_lod, &entity, glfwGetTime(), sample_source, &sampler);
+        }
         render_enqueue(&entity);
+        if (crowd.animation != NULL) {
+            render_enqueue_crowd(&crowd, glfwGetTime());
+        }
         render_all();
         glfwPollEvents();
     }
 
+    naxa_free_crowd(&crowd);
+    naxa_free_vertex_animation(&crowd_animation);
+    if (entity.pose != NULL) {
+        naxa_free_anim_lod(&anim_lod);
+        naxa_free_sampler(&sampler);
+        naxa_free_pose(entity.pose);
+    }
     naxa_free_model(entity.model);
 
     return NAXA_E_SUCCESS;
@@ -89,7 +205,11 @@ extern int32_t naxa_stop() {
 
 extern int32_t naxa_teardown() {
     internal_log("Tearing down Naxa");
-    
+
+    occlusion_clear_occluders();
+    teardown_watcher();
+    await_upload_thread();
+    teardown_jobs();
     glfwTerminate();
 
     // The log engine should be torn down last because it will close the file
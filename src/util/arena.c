@@ -0,0 +1,54 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include <naxa/anim.h>
+#include <naxa/err.h>
+#include <naxa/log.h>
+#include <naxa/naxa_internal.h>
+
+#define ARENA_ALIGNMENT 64
+
+int32_t naxa_init_arena(NaxaArena_t* dest, int64_t bytes) {
+    if (dest == NULL) {
+        report_error(NAXA_E_NULLPTR);
+        return NAXA_E_NULLPTR;
+    }
+    bytes = (bytes + ARENA_ALIGNMENT - 1) / ARENA_ALIGNMENT * ARENA_ALIGNMENT;
+    dest->memory = aligned_alloc(ARENA_ALIGNMENT, bytes > 0 ? bytes : ARENA_ALIGNMENT);
+    if (dest->memory == NULL) {
+        report_error(NAXA_E_EXHAUSTED);
+        return NAXA_E_EXHAUSTED;
+    }
+    dest->size = bytes;
+    dest->used = 0;
+    return NAXA_E_SUCCESS;
+}
+
+int32_t naxa_reset_arena(NaxaArena_t* arena) {
+    if (arena == NULL) {
+        report_error(NAXA_E_NULLPTR);
+        return NAXA_E_NULLPTR;
+    }
+    arena->used = 0;
+    return NAXA_E_SUCCESS;
+}
+
+int32_t naxa_free_arena(NaxaArena_t* arena) {
+    if (arena == NULL) {
+        return NAXA_E_SUCCESS;
+    }
+    free(arena->memory);
+    memset(arena, 0, sizeof(NaxaArena_t));
+    return NAXA_E_SUCCESS;
+}
+
+// NULL when it doesn't fit, callers decide whether that is an error.
+// Memory goes back by resetting used to what it was before.
+void* arena_alloc(NaxaArena_t* arena, int64_t bytes, int64_t alignment) {
+    int64_t offset = (arena->used + alignment - 1) / alignment * alignment;
+    if (offset + bytes > arena->size) {
+        return NULL;
+    }
+    arena->used = offset + bytes;
+    return arena->memory + offset;
+}
@@ -0,0 +1,664 @@
+#include <float.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <naxa/err.h>
+#include <naxa/naxa_internal.h>
+
+#define BVH_NULL -1
+#define BVH_FREE_HEIGHT -1
+#define BVH_SAH_BINS 12
+
+static int32_t is_leaf(NaxaBvhNode_t* node) {
+    return node->left == BVH_NULL;
+}
+
+static float surface_area(vec3 min, vec3 max) {
+    float dx = max[0] - min[0];
+    float dy = max[1] - min[1];
+    float dz = max[2] - min[2];
+    return 2.0f * (dx * dy + dy * dz + dz * dx);
+}
+
+static void box_union(vec3 a_min, vec3 a_max, vec3 b_min, vec3 b_max, vec3 dest_min, vec3 dest_max) {
+    glm_vec3_minv(a_min, b_min, dest_min);
+    glm_vec3_maxv(a_max, b_max, dest_max);
+}
+
+static int32_t box_contains(vec3 outer_min, vec3 outer_max, vec3 inner_min, vec3 inner_max) {
+    return outer_min[0] <= inner_min[0] && outer_min[1] <= inner_min[1] && outer_min[2] <= inner_min[2] &&
+        outer_max[0] >= inner_max[0] && outer_max[1] >= inner_max[1] && outer_max[2] >= inner_max[2];
+}
+
+static int32_t box_overlaps(vec3 a_min, vec3 a_max, vec3 b_min, vec3 b_max) {
+    return a_min[0] <= b_max[0] && a_max[0] >= b_min[0] &&
+        a_min[1] <= b_max[1] && a_max[1] >= b_min[1] &&
+        a_min[2] <= b_max[2] && a_max[2] >= b_min[2];
+}
+
+static int32_t alloc_node(NaxaBvh_t* bvh) {
+    if (bvh->free_list == BVH_NULL) {
+        // Grow the pool and thread the new nodes onto the free list
+        int32_t old_size = bvh->node_size;
+        bvh->node_size = old_size == 0 ? 64 : old_size * 2;
+        bvh->nodes = realloc(bvh->nodes, bvh->node_size * sizeof(NaxaBvhNode_t));
+        for (int32_t i = old_size; i < bvh->node_size; i++) {
+            bvh->nodes[i].parent = i + 1 < bvh->node_size ? i + 1 : BVH_NULL;
+            bvh->nodes[i].height = BVH_FREE_HEIGHT;
+        }
+        bvh->free_list = old_size;
+    }
+    int32_t index = bvh->free_list;
+    NaxaBvhNode_t* node = &bvh->nodes[index];
+    bvh->free_list = node->parent;
+    node->parent = BVH_NULL;
+    node->left = BVH_NULL;
+    node->right = BVH_NULL;
+    node->height = 0;
+    node->user = NULL;
+    bvh->node_count++;
+    return index;
+}
+
+static void free_node(NaxaBvh_t* bvh, int32_t index) {
+    bvh->nodes[index].parent = bvh->free_list;
+    bvh->nodes[index].height = BVH_FREE_HEIGHT;
+    bvh->free_list = index;
+    bvh->node_count--;
+}
+
+static void refit_node(NaxaBvh_t* bvh, int32_t index) {
+    NaxaBvhNode_t* node = &bvh->nodes[index];
+    NaxaBvhNode_t* left = &bvh->nodes[node->left];
+    NaxaBvhNode_t* right = &bvh->nodes[node->right];
+    box_union(left->min, left->max, right->min, right->max, node->min, node->max);
+    node->height = 1 + (left->height > right->height ? left->height : right->height);
+}
+
+// AVL style rotation that lifts the taller grandchild when a subtree leans
+// too far to one side. Returns the index of the new subtree root.
+static int32_t balance_node(NaxaBvh_t* bvh, int32_t index_a) {
+    NaxaBvhNode_t* a = &bvh->nodes[index_a];
+    if (is_leaf(a) || a->height < 2) {
+        return index_a;
+    }
+    int32_t index_b = a->left;
+    int32_t index_c = a->right;
+    NaxaBvhNode_t* b = &bvh->nodes[index_b];
+    NaxaBvhNode_t* c = &bvh->nodes[index_c];
+    int32_t balance = c->height - b->height;
+
+    if (balance > 1) {
+        // Rotate C up
+        int32_t index_f = c->left;
+        int32_t index_g = c->right;
+        NaxaBvhNode_t* f = &bvh->nodes[index_f];
+        NaxaBvhNode_t* g = &bvh->nodes[index_g];
+        c->left = index_a;
+        c->parent = a->parent;
+        a->parent = index_c;
+        if (c->parent != BVH_NULL) {
+            if (bvh->nodes[c->parent].left == index_a) {
+                bvh->nodes[c->parent].left = index_c;
+            } else {
+                bvh->nodes[c->parent].right = index_c;
+            }
+        } else {
+            bvh->root = index_c;
+        }
+        if (f->height > g->height) {
+            c->right = index_f;
+            a->right = index_g;
+            g->parent = index_a;
+        } else {
+            c->right = index_g;
+            a->right = index_f;
+            f->parent = index_a;
+        }
+        refit_node(bvh, index_a);
+        refit_node(bvh, index_c);
+        return index_c;
+    }
+    if (balance < -1) {
+        // Rotate B up
+        int32_t index_d = b->left;
+        int32_t index_e = b->right;
+        NaxaBvhNode_t* d = &bvh->nodes[index_d];
+        NaxaBvhNode_t* e = &bvh->nodes[index_e];
+        b->left = index_a;
+        b->parent = a->parent;
+        a->parent = index_b;
+        if (b->parent != BVH_NULL) {
+            if (bvh->nodes[b->parent].left == index_a) {
+                bvh->nodes[b->parent].left = index_b;
+            } else {
+                bvh->nodes[b->parent].right = index_b;
+            }
+        } else {
+            bvh->root = index_b;
+        }
+        if (d->height > e->height) {
+            b->right = index_d;
+            a->left = index_e;
+            e->parent = index_a;
+        } else {
+            b->right = index_e;
+            a->left = index_d;
+            d->parent = index_a;
+        }
+        refit_node(bvh, index_a);
+        refit_node(bvh, index_b);
+        return index_b;
+    }
+    return index_a;
+}
+
+static void refit_ancestors(NaxaBvh_t* bvh, int32_t index) {
+    while (index != BVH_NULL) {
+        index = balance_node(bvh, index);
+        refit_node(bvh, index);
+        index = bvh->nodes[index].parent;
+    }
+}
+
+static void insert_leaf(NaxaBvh_t* bvh, int32_t leaf) {
+    if (bvh->root == BVH_NULL) {
+        bvh->root = leaf;
+        bvh->nodes[leaf].parent = BVH_NULL;
+        return;
+    }
+
+    // Walk down picking whichever side grows the surface area the least,
+    // stopping once making a new parent here is cheaper than descending
+    NaxaBvhNode_t* leaf_node = &bvh->nodes[leaf];
+    int32_t index = bvh->root;
+    while (!is_leaf(&bvh->nodes[index])) {
+        NaxaBvhNode_t* node = &bvh->nodes[index];
+        vec3 combined_min;
+        vec3 combined_max;
+        box_union(node->min, node->max, leaf_node->min, leaf_node->max, combined_min, combined_max);
+        float area = surface_area(node->min, node->max);
+        float combined_area = surface_area(combined_min, combined_max);
+        float cost = 2.0f * combined_area;
+        float inheritance_cost = 2.0f * (combined_area - area);
+
+        float child_cost[2];
+        int32_t children[2] = { node->left, node->right };
+        for (int32_t i = 0; i < 2; i++) {
+            NaxaBvhNode_t* child = &bvh->nodes[children[i]];
+            box_union(child->min, child->max, leaf_node->min, leaf_node->max, combined_min, combined_max);
+            child_cost[i] = surface_area(combined_min, combined_max) + inheritance_cost;
+            if (!is_leaf(child)) {
+                child_cost[i] -= surface_area(child->min, child->max);
+            }
+        }
+        if (cost < child_cost[0] && cost < child_cost[1]) {
+            break;
+        }
+        index = child_cost[0] < child_cost[1] ? children[0] : children[1];
+    }
+
+    // Splice a new parent in above the chosen sibling
+    int32_t sibling = index;
+    int32_t old_parent = bvh->nodes[sibling].parent;
+    int32_t new_parent = alloc_node(bvh);
+    leaf_node = &bvh->nodes[leaf];
+    NaxaBvhNode_t* parent_node = &bvh->nodes[new_parent];
+    parent_node->parent = old_parent;
+    parent_node->left = sibling;
+    parent_node->right = leaf;
+    refit_node(bvh, new_parent);
+    if (old_parent != BVH_NULL) {
+        if (bvh->nodes[old_parent].left == sibling) {
+            bvh->nodes[old_parent].left = new_parent;
+        } else {
+            bvh->nodes[old_parent].right = new_parent;
+        }
+    } else {
+        bvh->root = new_parent;
+    }
+    bvh->nodes[sibling].parent = new_parent;
+    leaf_node->parent = new_parent;
+
+    refit_ancestors(bvh, new_parent);
+}
+
+static void remove_leaf(NaxaBvh_t* bvh, int32_t leaf) {
+    if (leaf == bvh->root) {
+        bvh->root = BVH_NULL;
+        return;
+    }
+    int32_t parent = bvh->nodes[leaf].parent;
+    int32_t grandparent = bvh->nodes[parent].parent;
+    int32_t sibling = bvh->nodes[parent].left == leaf ? bvh->nodes[parent].right : bvh->nodes[parent].left;
+    if (grandparent != BVH_NULL) {
+        if (bvh->nodes[grandparent].left == parent) {
+            bvh->nodes[grandparent].left = sibling;
+        } else {
+            bvh->nodes[grandparent].right = sibling;
+        }
+        bvh->nodes[sibling].parent = grandparent;
+        free_node(bvh, parent);
+        refit_ancestors(bvh, grandparent);
+    } else {
+        bvh->root = sibling;
+        bvh->nodes[sibling].parent = BVH_NULL;
+        free_node(bvh, parent);
+    }
+}
+
+int32_t bvh_init(NaxaBvh_t* bvh, float margin) {
+    if (bvh == NULL) {
+        report_error(NAXA_E_NULLPTR);
+        return NAXA_E_NULLPTR;
+    }
+    memset(bvh, 0, sizeof(NaxaBvh_t));
+    bvh->root = BVH_NULL;
+    bvh->free_list = BVH_NULL;
+    bvh->margin = margin;
+    bvh->flat_dirty = NAXA_TRUE;
+    return NAXA_E_SUCCESS;
+}
+
+int32_t bvh_free(NaxaBvh_t* bvh) {
+    if (bvh == NULL) {
+        return NAXA_E_SUCCESS;
+    }
+    free(bvh->nodes);
+    free(bvh->flat);
+    memset(bvh, 0, sizeof(NaxaBvh_t));
+    bvh->root = BVH_NULL;
+    bvh->free_list = BVH_NULL;
+    return NAXA_E_SUCCESS;
+}
+
+int32_t bvh_insert(NaxaBvh_t* bvh, int32_t* dest, vec3 min, vec3 max, void* user) {
+    if (bvh == NULL || dest == NULL) {
+        report_error(NAXA_E_NULLPTR);
+        return NAXA_E_NULLPTR;
+    }
+    int32_t leaf = alloc_node(bvh);
+    NaxaBvhNode_t* node = &bvh->nodes[leaf];
+    vec3 margin = { bvh->margin, bvh->margin, bvh->margin };
+    glm_vec3_sub(min, margin, node->min);
+    glm_vec3_add(max, margin, node->max);
+    node->user = user;
+    insert_leaf(bvh, leaf);
+    bvh->flat_dirty = NAXA_TRUE;
+    *dest = leaf;
+    return NAXA_E_SUCCESS;
+}
+
+int32_t bvh_remove(NaxaBvh_t* bvh, int32_t proxy) {
+    if (bvh == NULL) {
+        report_error(NAXA_E_NULLPTR);
+        return NAXA_E_NULLPTR;
+    }
+    if (proxy < 0 || proxy >= bvh->node_size || bvh->nodes[proxy].height != 0) {
+        report_error(NAXA_E_BOUNDS);
+        return NAXA_E_BOUNDS;
+    }
+    remove_leaf(bvh, proxy);
+    free_node(bvh, proxy);
+    bvh->flat_dirty = NAXA_TRUE;
+    return NAXA_E_SUCCESS;
+}
+
+int32_t bvh_update(NaxaBvh_t* bvh, int32_t proxy, vec3 min, vec3 max) {
+    if (bvh == NULL) {
+        report_error(NAXA_E_NULLPTR);
+        return NAXA_E_NULLPTR;
+    }
+    if (proxy < 0 || proxy >= bvh->node_size || bvh->nodes[proxy].height != 0) {
+        report_error(NAXA_E_BOUNDS);
+        return NAXA_E_BOUNDS;
+    }
+
+    // Small movements stay inside the fattened box and cost nothing
+    NaxaBvhNode_t* node = &bvh->nodes[proxy];
+    if (box_contains(node->min, node->max, min, max)) {
+        return NAXA_E_SUCCESS;
+    }
+    remove_leaf(bvh, proxy);
+    vec3 margin = { bvh->margin, bvh->margin, bvh->margin };
+    glm_vec3_sub(min, margin, node->min);
+    glm_vec3_add(max, margin, node->max);
+    insert_leaf(bvh, proxy);
+    bvh->flat_dirty = NAXA_TRUE;
+    return NAXA_E_SUCCESS;
+}
+
+// Top down binned SAH build over a list of existing leaves
+static int32_t build_sah(NaxaBvh_t* bvh, int32_t* leaves, int32_t count) {
+    if (count == 1) {
+        return leaves[0];
+    }
+
+    // Split along the longest axis of the centroid bounds
+    vec3 centroid_min = { INFINITY, INFINITY, INFINITY };
+    vec3 centroid_max = { -INFINITY, -INFINITY, -INFINITY };
+    for (int32_t i = 0; i < count; i++) {
+        vec3 centroid;
+        glm_vec3_center(bvh->nodes[leaves[i]].min, bvh->nodes[leaves[i]].max, centroid);
+        glm_vec3_minv(centroid_min, centroid, centroid_min);
+        glm_vec3_maxv(centroid_max, centroid, centroid_max);
+    }
+    int32_t axis = 0;
+    vec3 extent;
+    glm_vec3_sub(centroid_max, centroid_min, extent);
+    if (extent[1] > extent[axis]) {
+        axis = 1;
+    }
+    if (extent[2] > extent[axis]) {
+        axis = 2;
+    }
+
+    int32_t split = count / 2;
+    if (extent[axis] > 0.0f) {
+        // Bin the centroids and sweep for the cheapest split plane
+        int32_t bin_count[BVH_SAH_BINS] = { 0 };
+        vec3 bin_min[BVH_SAH_BINS];
+        vec3 bin_max[BVH_SAH_BINS];
+        for (int32_t b = 0; b < BVH_SAH_BINS; b++) {
+            glm_vec3_copy((vec3){ INFINITY, INFINITY, INFINITY }, bin_min[b]);
+            glm_vec3_copy((vec3){ -INFINITY, -INFINITY, -INFINITY }, bin_max[b]);
+        }
+        float scale = BVH_SAH_BINS / extent[axis];
+        for (int32_t i = 0; i < count; i++) {
+            NaxaBvhNode_t* leaf = &bvh->nodes[leaves[i]];
+            float centroid = (leaf->min[axis] + leaf->max[axis]) * 0.5f;
+            int32_t b = (int32_t)((centroid - centroid_min[axis]) * scale);
+            if (b >= BVH_SAH_BINS) {
+                b = BVH_SAH_BINS - 1;
+            }
+            bin_count[b]++;
+            box_union(bin_min[b], bin_max[b], leaf->min, leaf->max, bin_min[b], bin_max[b]);
+        }
+        float right_area[BVH_SAH_BINS];
+        int32_t right_count[BVH_SAH_BINS];
+        vec3 sweep_min = { INFINITY, INFINITY, INFINITY };
+        vec3 sweep_max = { -INFINITY, -INFINITY, -INFINITY };
+        int32_t sweep_count = 0;
+        for (int32_t b = BVH_SAH_BINS - 1; b > 0; b--) {
+            box_union(sweep_min, sweep_max, bin_min[b], bin_max[b], sweep_min, sweep_max);
+            sweep_count += bin_count[b];
+            right_area[b] = sweep_count > 0 ? surface_area(sweep_min, sweep_max) : 0.0f;
+            right_count[b] = sweep_count;
+        }
+        glm_vec3_copy((vec3){ INFINITY, INFINITY, INFINITY }, sweep_min);
+        glm_vec3_copy((vec3){ -INFINITY, -INFINITY, -INFINITY }, sweep_max);
+        sweep_count = 0;
+        float best_cost = INFINITY;
+        int32_t best_bin = -1;
+        for (int32_t b = 1; b < BVH_SAH_BINS; b++) {
+            box_union(sweep_min, sweep_max, bin_min[b - 1], bin_max[b - 1], sweep_min, sweep_max);
+            sweep_count += bin_count[b - 1];
+            if (sweep_count == 0 || right_count[b] == 0) {
+                continue;
+            }
+            float cost = surface_area(sweep_min, sweep_max) * sweep_count + right_area[b] * right_count[b];
+            if (cost < best_cost) {
+                best_cost = cost;
+                best_bin = b;
+            }
+        }
+
+        // Partition the leaves around the chosen plane
+        if (best_bin != -1) {
+            int32_t lo = 0;
+            int32_t hi = count - 1;
+            while (lo <= hi) {
+                NaxaBvhNode_t* leaf = &bvh->nodes[leaves[lo]];
+                float centroid = (leaf->min[axis] + leaf->max[axis]) * 0.5f;
+                int32_t b = (int32_t)((centroid - centroid_min[axis]) * scale);
+                if (b >= BVH_SAH_BINS) {
+                    b = BVH_SAH_BINS - 1;
+                }
+                if (b < best_bin) {
+                    lo++;
+                } else {
+                    int32_t swap = leaves[lo];
+                    leaves[lo] = leaves[hi];
+                    leaves[hi] = swap;
+                    hi--;
+                }
+            }
+            if (lo > 0 && lo < count) {
+                split = lo;
+            }
+        }
+    }
+
+    int32_t index = alloc_node(bvh);
+    int32_t left = build_sah(bvh, leaves, split);
+    int32_t right = build_sah(bvh, leaves + split, count - split);
+    bvh->nodes[index].left = left;
+    bvh->nodes[index].right = right;
+    bvh->nodes[left].parent = index;
+    bvh->nodes[right].parent = index;
+    refit_node(bvh, index);
+    return index;
+}
+
+int32_t bvh_rebuild(NaxaBvh_t* bvh) {
+    if (bvh == NULL) {
+        report_error(NAXA_E_NULLPTR);
+        return NAXA_E_NULLPTR;
+    }
+    if (bvh->root == BVH_NULL) {
+        return NAXA_E_SUCCESS;
+    }
+
+    // Keep the leaves where they are so proxies stay valid, drop the rest
+    int32_t leaf_count = 0;
+    int32_t* leaves = malloc(bvh->node_count * sizeof(int32_t));
+    for (int32_t i = 0; i < bvh->node_size; i++) {
+        if (bvh->nodes[i].height == BVH_FREE_HEIGHT) {
+            continue;
+        }
+        if (is_leaf(&bvh->nodes[i])) {
+            leaves[leaf_count++] = i;
+        } else {
+            free_node(bvh, i);
+        }
+    }
+    bvh->root = build_sah(bvh, leaves, leaf_count);
+    bvh->nodes[bvh->root].parent = BVH_NULL;
+    free(leaves);
+    bvh->flat_dirty = NAXA_TRUE;
+    return NAXA_E_SUCCESS;
+}
+
+static void flatten_node(NaxaBvh_t* bvh, int32_t index) {
+    NaxaBvhNode_t* node = &bvh->nodes[index];
+    int32_t flat_index = bvh->flat_len++;
+    NaxaBvhFlatNode_t* flat = &bvh->flat[flat_index];
+    glm_vec3_copy(node->min, flat->min);
+    glm_vec3_copy(node->max, flat->max);
+    flat->user = node->user;
+    flat->leaf = is_leaf(node);
+    if (!flat->leaf) {
+        flatten_node(bvh, node->left);
+        flatten_node(bvh, node->right);
+    }
+    bvh->flat[flat_index].skip = bvh->flat_len;
+}
+
+int32_t bvh_flatten(NaxaBvh_t* bvh) {
+    if (bvh == NULL) {
+        report_error(NAXA_E_NULLPTR);
+        return NAXA_E_NULLPTR;
+    }
+    if (!bvh->flat_dirty) {
+        return NAXA_E_SUCCESS;
+    }
+    if (bvh->flat_size < bvh->node_count) {
+        bvh->flat_size = bvh->node_size;
+        bvh->flat = realloc(bvh->flat, bvh->flat_size * sizeof(NaxaBvhFlatNode_t));
+    }
+    bvh->flat_len = 0;
+    if (bvh->root != BVH_NULL) {
+        flatten_node(bvh, bvh->root);
+    }
+    bvh->flat_dirty = NAXA_FALSE;
+    return NAXA_E_SUCCESS;
+}
+
+// Report every leaf under an accepted subtree without testing it again
+static int32_t report_subtree(NaxaBvh_t* bvh, int32_t index, NaxaBvhCallback_t callback, void* context) {
+    int32_t end = bvh->flat[index].skip;
+    for (int32_t i = index; i < end; i++) {
+        if (bvh->flat[i].leaf && !callback(bvh->flat[i].user, context)) {
+            return NAXA_FALSE;
+        }
+    }
+    return NAXA_TRUE;
+}
+
+int32_t bvh_query_box(NaxaBvh_t* bvh, vec3 min, vec3 max, NaxaBvhCallback_t callback, void* context) {
+    if (bvh == NULL || callback == NULL) {
+        report_error(NAXA_E_NULLPTR);
+        return NAXA_E_NULLPTR;
+    }
+    bvh_flatten(bvh);
+    int32_t i = 0;
+    while (i < bvh->flat_len) {
+        NaxaBvhFlatNode_t* node = &bvh->flat[i];
+        if (!box_overlaps(node->min, node->max, min, max)) {
+            i = node->skip;
+            continue;
+        }
+        if (node->leaf && !callback(node->user, context)) {
+            break;
+        }
+        i++;
+    }
+    return NAXA_E_SUCCESS;
+}
+
+int32_t bvh_query_sphere(NaxaBvh_t* bvh, vec3 center, float radius, NaxaBvhCallback_t callback, void* context) {
+    if (bvh == NULL || callback == NULL) {
+        report_error(NAXA_E_NULLPTR);
+        return NAXA_E_NULLPTR;
+    }
+    bvh_flatten(bvh);
+    float radius2 = radius * radius;
+    int32_t i = 0;
+    while (i < bvh->flat_len) {
+        NaxaBvhFlatNode_t* node = &bvh->flat[i];
+
+        // Distance from the center to the closest point of the box
+        float distance2 = 0.0f;
+        for (int32_t axis = 0; axis < 3; axis++) {
+            float d = 0.0f;
+            if (center[axis] < node->min[axis]) {
+                d = node->min[axis] - center[axis];
+            } else if (center[axis] > node->max[axis]) {
+                d = center[axis] - node->max[axis];
+            }
+            distance2 += d * d;
+        }
+        if (distance2 > radius2) {
+            i = node->skip;
+            continue;
+        }
+        if (node->leaf && !callback(node->user, context)) {
+            break;
+        }
+        i++;
+    }
+    return NAXA_E_SUCCESS;
+}
+
+int32_t bvh_query_ray(NaxaBvh_t* bvh, vec3 origin, vec3 direction, float max_distance, NaxaBvhCallback_t callback, void* context) {
+    if (bvh == NULL || callback == NULL) {
+        report_error(NAXA_E_NULLPTR);
+        return NAXA_E_NULLPTR;
+    }
+    bvh_flatten(bvh);
+    // An axis the ray doesn't move along gets no inverse, 0 * inf on a slab
+    // plane would be NaN and lose the hit. Tiny components are clamped short
+    // of inf for the same reason.
+    vec3 inverse;
+    for (int32_t axis = 0; axis < 3; axis++) {
+        inverse[axis] = direction[axis] != 0.0f ? glm_clamp(1.0f / direction[axis], -FLT_MAX, FLT_MAX) : 0.0f;
+    }
+    int32_t i = 0;
+    while (i < bvh->flat_len) {
+        NaxaBvhFlatNode_t* node = &bvh->flat[i];
+
+        // Slab test, a ray parallel to a slab is either always in it or never
+        float t_near = 0.0f;
+        float t_far = max_distance;
+        for (int32_t axis = 0; axis < 3; axis++) {
+            if (direction[axis] == 0.0f) {
+                if (origin[axis] < node->min[axis] || origin[axis] > node->max[axis]) {
+                    t_far = -1.0f;
+                }
+                continue;
+            }
+            float t0 = (node->min[axis] - origin[axis]) * inverse[axis];
+            float t1 = (node->max[axis] - origin[axis]) * inverse[axis];
+            if (t0 > t1) {
+                float swap = t0;
+                t0 = t1;
+                t1 = swap;
+            }
+            t_near = t0 > t_near ? t0 : t_near;
+            t_far = t1 < t_far ? t1 : t_far;
+        }
+        if (t_near > t_far) {
+            i = node->skip;
+            continue;
+        }
+        if (node->leaf && !callback(node->user, context)) {
+            break;
+        }
+        i++;
+    }
+    return NAXA_E_SUCCESS;
+}
+
+int32_t bvh_query_frustum(NaxaBvh_t* bvh, vec4 planes[6], NaxaBvhCallback_t callback, void* context) {
+    if (bvh == NULL || planes == NULL || callback == NULL) {
+        report_error(NAXA_E_NULLPTR);
+        return NAXA_E_NULLPTR;
+    }
+    bvh_flatten(bvh);
+    int32_t i = 0;
+    while (i < bvh->flat_len) {
+        NaxaBvhFlatNode_t* node = &bvh->flat[i];
+        int32_t outside = NAXA_FALSE;
+        int32_t inside = NAXA_TRUE;
+        for (int32_t p = 0; p < 6 && !outside; p++) {
+            // Corners furthest along and against the plane normal
+            vec3 positive;
+            vec3 negative;
+            for (int32_t axis = 0; axis < 3; axis++) {
+                positive[axis] = planes[p][axis] >= 0.0f ? node->max[axis] : node->min[axis];
+                negative[axis] = planes[p][axis] >= 0.0f ? node->min[axis] : node->max[axis];
+            }
+            if (glm_vec3_dot(planes[p], positive) + planes[p][3] < 0.0f) {
+                outside = NAXA_TRUE;
+            } else if (glm_vec3_dot(planes[p], negative) + planes[p][3] < 0.0f) {
+                inside = NAXA_FALSE;
+            }
+        }
+        if (outside) {
+            i = node->skip;
+            continue;
+        }
+        if (inside) {
+            if (!report_subtree(bvh, i, callback, context)) {
+                break;
+            }
+            i = node->skip;
+            continue;
+        }
+        if (node->leaf && !callback(node->user, context)) {
+            break;
+        }
+        i++;
+    }
+    return NAXA_E_SUCCESS;
+}
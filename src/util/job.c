@@ -0,0 +1,498 @@
+#include <stdalign.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <threads.h>
+#include <time.h>
+#include <ucontext.h>
+#include <unistd.h>
+
+#include <naxa/err.h>
+#include <naxa/log.h>
+#include <naxa/naxa_internal.h>
+
+// Deques are fixed size, a thread with more jobs than this queued runs the
+// extra ones itself as they are submitted
+#define JOB_DEQUE_SIZE 4096
+#define JOB_SPINS 64
+#define JOB_SLEEP_NANOSECONDS 1000000
+#define JOB_CHUNKS_PER_THREAD 4
+#define JOB_MAX_FIBERS 256
+#define JOB_FIBER_STACK_SIZE (256 * 1024)
+#define FIBER_DONE 0
+#define FIBER_WAITING 1
+
+typedef struct {
+    NaxaJobFunction_t function;
+    void* data;
+    int32_t first;
+    int32_t last;
+    NaxaJobCounter_t* counter;
+} Job_t;
+
+// A job with its own stack so it can be parked halfway through. Fibers are
+// not tied to a thread, a waiting fiber carries on on whichever thread sees
+// its counter reach 0 first and goes back to that thread's scheduler.
+typedef struct JobFiber {
+    ucontext_t context;
+    ucontext_t* scheduler;
+    Job_t job;
+    int32_t state;
+    NaxaJobCounter_t* waiting_on;
+    void* stack;
+    struct JobFiber* next;
+} JobFiber_t;
+
+// Chase-Lev deque, the owner pushes and pops at the bottom and everyone
+// else steals from the top. C11 orderings follow Le et al., "Correct and
+// Efficient Work-Stealing for Weak Memory Models". Jobs are copied in and
+// out by value, a thief copies before it claims the slot and throws the copy
+// away if someone else got there first.
+typedef struct {
+    alignas(64) atomic_int_fast64_t top;
+    alignas(64) atomic_int_fast64_t bottom;
+    uint32_t random;
+    ucontext_t scheduler;
+    JobFiber_t* free_fibers;
+    Job_t buffer[JOB_DEQUE_SIZE];
+} JobThread_t;
+
+// Thread 0 is whoever called init_jobs, the rest are workers. Threads that
+// failed to start keep an empty deque so the count never changes under the
+// workers.
+int32_t job_thread_len;
+int32_t job_workers_started;
+JobThread_t* job_threads;
+thrd_t job_workers[NAXA_MAX_JOB_THREADS];
+atomic_int job_stop;
+atomic_uint job_epoch;
+atomic_int job_sleepers;
+mtx_t job_mutex;
+cnd_t job_condition;
+_Thread_local int32_t job_thread_index = -1;
+
+// Every fiber ever made, the free ones sit on the list of the thread that
+// last finished a job on them and the parked ones on the waiting list
+JobFiber_t* job_fibers[JOB_MAX_FIBERS];
+atomic_int job_fibers_len;
+JobFiber_t* job_waiting;
+atomic_int job_waiting_len;
+mtx_t job_waiting_mutex;
+atomic_int job_parks;
+_Thread_local JobFiber_t* job_fiber;
+
+static int32_t deque_push(JobThread_t* thread, Job_t* job) {
+    int64_t bottom = atomic_load_explicit(&thread->bottom, memory_order_relaxed);
+    int64_t top = atomic_load_explicit(&thread->top, memory_order_acquire);
+    if (bottom - top >= JOB_DEQUE_SIZE) {
+        return NAXA_FALSE;
+    }
+    thread->buffer[bottom & (JOB_DEQUE_SIZE - 1)] = *job;
+    atomic_store_explicit(&thread->bottom, bottom + 1, memory_order_release);
+    return NAXA_TRUE;
+}
+
+static int32_t deque_pop(JobThread_t* thread, Job_t* dest) {
+    int64_t bottom = atomic_load_explicit(&thread->bottom, memory_order_relaxed) - 1;
+    atomic_store_explicit(&thread->bottom, bottom, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    int64_t top = atomic_load_explicit(&thread->top, memory_order_relaxed);
+    if (top > bottom) {
+        atomic_store_explicit(&thread->bottom, bottom + 1, memory_order_relaxed);
+        return NAXA_FALSE;
+    }
+    *dest = thread->buffer[bottom & (JOB_DEQUE_SIZE - 1)];
+    if (top == bottom) {
+        // Last one left, race the thieves for it
+        int32_t won = atomic_compare_exchange_strong_explicit(&thread->top, &top, top + 1, memory_order_seq_cst, memory_order_relaxed);
+        atomic_store_explicit(&thread->bottom, bottom + 1, memory_order_relaxed);
+        return won;
+    }
+    return NAXA_TRUE;
+}
+
+static int32_t deque_steal(JobThread_t* thread, Job_t* dest) {
+    int64_t top = atomic_load_explicit(&thread->top, memory_order_acquire);
+    atomic_thread_fence(memory_order_seq_cst);
+    int64_t bottom = atomic_load_explicit(&thread->bottom, memory_order_acquire);
+    if (top >= bottom) {
+        return NAXA_FALSE;
+    }
+    *dest = thread->buffer[top & (JOB_DEQUE_SIZE - 1)];
+    return atomic_compare_exchange_strong_explicit(&thread->top, &top, top + 1, memory_order_seq_cst, memory_order_relaxed);
+}
+
+static void wake_workers() {
+    atomic_fetch_add(&job_epoch, 1);
+    if (atomic_load(&job_sleepers) > 0) {
+        mtx_lock(&job_mutex);
+        cnd_signal(&job_condition);
+        mtx_unlock(&job_mutex);
+    }
+}
+
+// Finishing the last job of a counter is as good as a submit when a fiber
+// is parked on it
+static void run_job(Job_t* job) {
+    job->function(job->data, job->first, job->last);
+    if (job->counter != NULL) {
+        if (atomic_fetch_sub_explicit(job->counter, 1, memory_order_release) == 1 && atomic_load(&job_waiting_len) > 0) {
+            wake_workers();
+        }
+    }
+}
+
+// Own work first, newest first for the cache, then someone else's oldest
+static int32_t find_job(Job_t* dest) {
+    int32_t found = NAXA_FALSE;
+    uint32_t random = 1;
+    if (job_thread_index >= 0) {
+        JobThread_t* self = &job_threads[job_thread_index];
+        found = deque_pop(self, dest);
+        self->random ^= self->random << 13;
+        self->random ^= self->random >> 17;
+        self->random ^= self->random << 5;
+        random = self->random;
+    }
+    for (int32_t i = 0; !found && i < job_thread_len; i++) {
+        int32_t victim = (random + i) % job_thread_len;
+        if (victim != job_thread_index) {
+            found = deque_steal(&job_threads[victim], dest);
+        }
+    }
+    return found;
+}
+
+// Runs jobs until the end of time, the scheduler hands it a new one every
+// time it switches back in after a job finished
+static void fiber_main() {
+    JobFiber_t* fiber = job_fiber;
+    while (NAXA_TRUE) {
+        run_job(&fiber->job);
+        fiber->state = FIBER_DONE;
+        swapcontext(&fiber->context, fiber->scheduler);
+    }
+}
+
+static JobFiber_t* take_free_fiber(JobThread_t* self) {
+    JobFiber_t* fiber = self->free_fibers;
+    if (fiber != NULL) {
+        self->free_fibers = fiber->next;
+        return fiber;
+    }
+
+    // Out of fibers means the caller runs the job without one
+    int32_t index = atomic_fetch_add(&job_fibers_len, 1);
+    if (index >= JOB_MAX_FIBERS) {
+        atomic_store(&job_fibers_len, JOB_MAX_FIBERS);
+        return NULL;
+    }
+    fiber = malloc(sizeof(JobFiber_t));
+    if (fiber == NULL || (fiber->stack = malloc(JOB_FIBER_STACK_SIZE)) == NULL) {
+        free(fiber);
+        job_fibers[index] = NULL;
+        return NULL;
+    }
+    getcontext(&fiber->context);
+    fiber->context.uc_stack.ss_sp = fiber->stack;
+    fiber->context.uc_stack.ss_size = JOB_FIBER_STACK_SIZE;
+    fiber->context.uc_link = NULL;
+    makecontext(&fiber->context, fiber_main, 0);
+    fiber->next = NULL;
+    job_fibers[index] = fiber;
+    return fiber;
+}
+
+// First parked fiber whose counter ran out, if any
+static JobFiber_t* take_ready_fiber() {
+    if (atomic_load(&job_waiting_len) == 0) {
+        return NULL;
+    }
+    mtx_lock(&job_waiting_mutex);
+    JobFiber_t** link = &job_waiting;
+    JobFiber_t* fiber = NULL;
+    while (*link != NULL) {
+        if (atomic_load_explicit((*link)->waiting_on, memory_order_acquire) <= 0) {
+            fiber = *link;
+            *link = fiber->next;
+            atomic_fetch_sub(&job_waiting_len, 1);
+            break;
+        }
+        link = &(*link)->next;
+    }
+    mtx_unlock(&job_waiting_mutex);
+    return fiber;
+}
+
+// One step of a job thread's scheduler, always on the thread's own stack.
+// A fiber is only put back on a list once it has switched out completely,
+// otherwise another thread could switch into a half saved context.
+static int32_t schedule_one(JobThread_t* self) {
+    JobFiber_t* fiber = take_ready_fiber();
+    if (fiber == NULL) {
+        Job_t job;
+        if (!find_job(&job)) {
+            return NAXA_FALSE;
+        }
+        fiber = take_free_fiber(self);
+        if (fiber == NULL) {
+            run_job(&job);
+            return NAXA_TRUE;
+        }
+        fiber->job = job;
+    }
+    fiber->scheduler = &self->scheduler;
+    job_fiber = fiber;
+    swapcontext(&self->scheduler, &fiber->context);
+    job_fiber = NULL;
+    if (fiber->state == FIBER_DONE) {
+        fiber->next = self->free_fibers;
+        self->free_fibers = fiber;
+    } else {
+        mtx_lock(&job_waiting_mutex);
+        fiber->next = job_waiting;
+        job_waiting = fiber;
+        atomic_fetch_add(&job_waiting_len, 1);
+        mtx_unlock(&job_waiting_mutex);
+    }
+    return NAXA_TRUE;
+}
+
+static int32_t run_one() {
+    if ((naxa_globals.flags1 & GLOBAL_FLAGS1_JOB_FIBERS) && job_thread_index >= 0) {
+        return schedule_one(&job_threads[job_thread_index]);
+    }
+    Job_t job;
+    if (!find_job(&job)) {
+        return NAXA_FALSE;
+    }
+    run_job(&job);
+    return NAXA_TRUE;
+}
+
+static int worker_func(void* arg) {
+    job_thread_index = (int32_t)(intptr_t)arg;
+    int32_t idle = 0;
+    while (!atomic_load(&job_stop)) {
+        uint32_t epoch = atomic_load(&job_epoch);
+        if (run_one()) {
+            idle = 0;
+            continue;
+        }
+        if (++idle < JOB_SPINS) {
+            thrd_yield();
+            continue;
+        }
+
+        // Nothing came up for a while, sleep until something is submitted.
+        // The epoch catches a submit between the last look and the wait, the
+        // timeout is only a backstop.
+        mtx_lock(&job_mutex);
+        atomic_fetch_add(&job_sleepers, 1);
+        if (atomic_load(&job_epoch) == epoch && !atomic_load(&job_stop)) {
+            struct timespec until;
+            timespec_get(&until, TIME_UTC);
+            until.tv_nsec += JOB_SLEEP_NANOSECONDS;
+            if (until.tv_nsec >= 1000000000) {
+                until.tv_sec++;
+                until.tv_nsec -= 1000000000;
+            }
+            cnd_timedwait(&job_condition, &job_mutex, &until);
+        }
+        atomic_fetch_sub(&job_sleepers, 1);
+        mtx_unlock(&job_mutex);
+    }
+    return 0;
+}
+
+int32_t init_jobs(int32_t thread_count, int32_t fibers) {
+    // One thread per core by default, counting the one we are on
+    if (thread_count <= 0) {
+        thread_count = (int32_t)sysconf(_SC_NPROCESSORS_ONLN);
+    }
+    thread_count = thread_count < 1 ? 1 : thread_count;
+    thread_count = thread_count > NAXA_MAX_JOB_THREADS ? NAXA_MAX_JOB_THREADS : thread_count;
+    job_threads = aligned_alloc(64, thread_count * sizeof(JobThread_t));
+    if (job_threads == NULL) {
+        report_error(NAXA_E_EXHAUSTED);
+        return NAXA_E_EXHAUSTED;
+    }
+    for (int32_t i = 0; i < thread_count; i++) {
+        atomic_init(&job_threads[i].top, 0);
+        atomic_init(&job_threads[i].bottom, 0);
+        job_threads[i].random = 0x9E3779B9u * (i + 1);
+        job_threads[i].free_fibers = NULL;
+    }
+    atomic_store(&job_fibers_len, 0);
+    atomic_store(&job_waiting_len, 0);
+    atomic_store(&job_parks, 0);
+    job_waiting = NULL;
+    mtx_init(&job_waiting_mutex, mtx_plain);
+    if (fibers) {
+        naxa_globals.flags1 |= GLOBAL_FLAGS1_JOB_FIBERS;
+    } else {
+        naxa_globals.flags1 &= ~GLOBAL_FLAGS1_JOB_FIBERS;
+    }
+    atomic_store(&job_stop, NAXA_FALSE);
+    atomic_store(&job_epoch, 0);
+    atomic_store(&job_sleepers, 0);
+    mtx_init(&job_mutex, mtx_plain);
+    cnd_init(&job_condition);
+    job_thread_index = 0;
+    job_thread_len = thread_count;
+    job_workers_started = 1;
+    for (int32_t i = 1; i < thread_count; i++) {
+        if (thrd_create(&job_workers[i], worker_func, (void*)(intptr_t)i) != thrd_success) {
+            internal_logf(NAXA_SEVERITY_WARN, "Only started %d of %d job threads", i, thread_count);
+            break;
+        }
+        job_workers_started++;
+    }
+    naxa_globals.thread_flags |= GLOBAL_THREADFLAGS_JOBS;
+    internal_logf(NAXA_SEVERITY_INFO, "Job system running on %d threads%s", job_workers_started, fibers ? " with fibers" : "");
+    return NAXA_E_SUCCESS;
+}
+
+int32_t teardown_jobs() {
+    if (!(naxa_globals.thread_flags & GLOBAL_THREADFLAGS_JOBS)) {
+        return NAXA_E_SUCCESS;
+    }
+
+    // Whatever is still queued runs here before the workers go
+    while (run_one());
+    atomic_store(&job_stop, NAXA_TRUE);
+    mtx_lock(&job_mutex);
+    cnd_broadcast(&job_condition);
+    mtx_unlock(&job_mutex);
+    for (int32_t i = 1; i < job_workers_started; i++) {
+        thrd_join(job_workers[i], NULL);
+    }
+    mtx_destroy(&job_mutex);
+    cnd_destroy(&job_condition);
+
+    // Anything still parked waits on a counter that will never run out
+    if (atomic_load(&job_waiting_len) > 0) {
+        internal_logf(NAXA_SEVERITY_WARN, "%d jobs were still waiting at teardown", atomic_load(&job_waiting_len));
+    }
+    int32_t fibers_len = atomic_load(&job_fibers_len);
+    fibers_len = fibers_len < JOB_MAX_FIBERS ? fibers_len : JOB_MAX_FIBERS;
+    for (int32_t i = 0; i < fibers_len; i++) {
+        if (job_fibers[i] != NULL) {
+            free(job_fibers[i]->stack);
+            free(job_fibers[i]);
+            job_fibers[i] = NULL;
+        }
+    }
+    atomic_store(&job_fibers_len, 0);
+    job_waiting = NULL;
+    atomic_store(&job_waiting_len, 0);
+    mtx_destroy(&job_waiting_mutex);
+    naxa_globals.flags1 &= ~GLOBAL_FLAGS1_JOB_FIBERS;
+    free(job_threads);
+    job_threads = NULL;
+    job_thread_len = 0;
+    job_workers_started = 0;
+    job_thread_index = -1;
+    naxa_globals.thread_flags &= ~GLOBAL_THREADFLAGS_JOBS;
+    return NAXA_E_SUCCESS;
+}
+
+int32_t job_thread_count() {
+    return job_workers_started > 0 ? job_workers_started : 1;
+}
+
+int32_t job_thread_current() {
+    return job_thread_index;
+}
+
+int32_t job_park_count() {
+    return atomic_load(&job_parks);
+}
+
+int32_t job_submit(NaxaJobFunction_t function, void* data, int32_t first, int32_t last, NaxaJobCounter_t* counter) {
+    if (function == NULL) {
+        report_error(NAXA_E_NULLPTR);
+        return NAXA_E_NULLPTR;
+    }
+
+    // Only job threads own a deque, anyone else just does the work now.
+    // The same goes for a thread that has run out of deque.
+    Job_t job = { function, data, first, last, counter };
+    if (job_thread_index < 0) {
+        job.counter = NULL;
+        run_job(&job);
+        return NAXA_E_SUCCESS;
+    }
+    if (counter != NULL) {
+        atomic_fetch_add_explicit(counter, 1, memory_order_relaxed);
+    }
+    if (!deque_push(&job_threads[job_thread_index], &job)) {
+        run_job(&job);
+        return NAXA_E_SUCCESS;
+    }
+
+    // Wake a worker if any went to sleep
+    wake_workers();
+    return NAXA_E_SUCCESS;
+}
+
+int32_t job_wait(NaxaJobCounter_t* counter) {
+    if (counter == NULL) {
+        report_error(NAXA_E_NULLPTR);
+        return NAXA_E_NULLPTR;
+    }
+
+    // A fiber parks until the counter runs out and its thread moves on to
+    // other work. The scheduler to go back to is read fresh on every switch
+    // since the fiber may come back on another thread.
+    JobFiber_t* fiber = job_fiber;
+    if (fiber != NULL) {
+        while (atomic_load_explicit(counter, memory_order_acquire) > 0) {
+            fiber->state = FIBER_WAITING;
+            fiber->waiting_on = counter;
+            atomic_fetch_add_explicit(&job_parks, 1, memory_order_relaxed);
+            swapcontext(&fiber->context, fiber->scheduler);
+        }
+        return NAXA_E_SUCCESS;
+    }
+
+    // Anywhere else, help out instead of blocking, whatever runs here may
+    // well be one of the jobs being waited on
+    while (atomic_load_explicit(counter, memory_order_acquire) > 0) {
+        if (!run_one()) {
+            thrd_yield();
+        }
+    }
+    return NAXA_E_SUCCESS;
+}
+
+int32_t job_parallel_for(int32_t count, int32_t min_chunk, NaxaJobFunction_t function, void* data) {
+    if (function == NULL) {
+        report_error(NAXA_E_NULLPTR);
+        return NAXA_E_NULLPTR;
+    }
+    if (count <= 0) {
+        return NAXA_E_SUCCESS;
+    }
+
+    // A few chunks per thread so stealing evens out uneven chunks, but
+    // never so small that queueing costs more than the work
+    int32_t chunk = (count + job_thread_count() * JOB_CHUNKS_PER_THREAD - 1) / (job_thread_count() * JOB_CHUNKS_PER_THREAD);
+    chunk = chunk > min_chunk ? chunk : min_chunk;
+    chunk = chunk > 0 ? chunk : 1;
+    if (chunk >= count) {
+        function(data, 0, count);
+        return NAXA_E_SUCCESS;
+    }
+    NaxaJobCounter_t counter;
+    atomic_init(&counter, 0);
+    for (int32_t first = chunk; first < count; first += chunk) {
+        int32_t last = first + chunk < count ? first + chunk : count;
+        job_submit(function, data, first, last, &counter);
+    }
+
+    // The first chunk is ours
+    function(data, 0, chunk);
+    return job_wait(&counter);
+}
@@ -0,0 +1,195 @@
+#include <dirent.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/inotify.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <naxa/err.h>
+#include <naxa/log.h>
+#include <naxa/naxa_internal.h>
+
+// Editors tend to touch a file several times per save, so a path only
+// counts as changed once it has been quiet for a little while
+#define WATCH_DEBOUNCE 0.1
+#define WATCH_MAX_DIRECTORIES 256
+#define WATCH_MAX_PENDING 64
+#define WATCH_EVENTS (IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE)
+
+typedef struct {
+    int32_t wd;
+    char* path;
+} WatchDirectory_t;
+
+typedef struct {
+    char* path;
+    double time;
+} WatchPending_t;
+
+int32_t watch_fd = -1;
+WatchDirectory_t watch_directories[WATCH_MAX_DIRECTORIES];
+int32_t watch_directories_len;
+WatchPending_t watch_pending[WATCH_MAX_PENDING];
+int32_t watch_pending_len;
+
+static double now_seconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static char* join_path(char* directory, char* name) {
+    int32_t len = strlen(directory) + 1 + strlen(name);
+    char* path = malloc(len + 1);
+    snprintf(path, len + 1, "%s/%s", directory, name);
+    return path;
+}
+
+static void mark_pending(char* path, double time) {
+    for (int32_t i = 0; i < watch_pending_len; i++) {
+        if (strcmp(watch_pending[i].path, path) == 0) {
+            watch_pending[i].time = time;
+            free(path);
+            return;
+        }
+    }
+    if (watch_pending_len >= WATCH_MAX_PENDING) {
+        free(path);
+        return;
+    }
+    watch_pending[watch_pending_len].path = path;
+    watch_pending[watch_pending_len].time = time;
+    watch_pending_len++;
+}
+
+// Watch a directory and everything below it, inotify isn't recursive.
+// Files can land in a new directory before its watch exists, those count
+// as changed straight away.
+static void watch_directory(char* path, int32_t created, double time) {
+    if (watch_directories_len >= WATCH_MAX_DIRECTORIES) {
+        internal_logf(NAXA_SEVERITY_WARN, "Too many directories to watch, skipping %s", path);
+        return;
+    }
+    int32_t wd = inotify_add_watch(watch_fd, path, WATCH_EVENTS);
+    if (wd < 0) {
+        return;
+    }
+    int32_t path_len = strlen(path);
+    watch_directories[watch_directories_len].wd = wd;
+    watch_directories[watch_directories_len].path = malloc(path_len + 1);
+    memcpy(watch_directories[watch_directories_len].path, path, path_len + 1);
+    watch_directories_len++;
+
+    DIR* dir = opendir(path);
+    if (dir == NULL) {
+        return;
+    }
+    struct dirent* entry;
+    while ((entry = readdir(dir))) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+            continue;
+        }
+        char* child = join_path(path, entry->d_name);
+        if (entry->d_type == DT_DIR) {
+            watch_directory(child, created, time);
+            free(child);
+        } else if (created) {
+            mark_pending(child, time);
+        } else {
+            free(child);
+        }
+    }
+    closedir(dir);
+}
+
+int32_t init_watcher(char* root) {
+    watch_directories_len = 0;
+    watch_pending_len = 0;
+    watch_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (watch_fd < 0) {
+        report_error(NAXA_E_INTERNAL);
+        return NAXA_E_INTERNAL;
+    }
+    watch_directory(root, NAXA_FALSE, 0.0);
+    internal_logf(NAXA_SEVERITY_INFO, "Watching %d directories under %s for changes", watch_directories_len, root);
+    return NAXA_E_SUCCESS;
+}
+
+int32_t watch_poll(void (*changed)(char* path)) {
+    if (watch_fd < 0) {
+        return NAXA_E_SUCCESS;
+    }
+
+    // Drain everything the kernel has for us without ever blocking
+    char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    double now = now_seconds();
+    for (;;) {
+        ssize_t len = read(watch_fd, buffer, sizeof(buffer));
+        if (len <= 0) {
+            if (len < 0 && errno != EAGAIN) {
+                report_error(NAXA_E_INTERNAL);
+            }
+            break;
+        }
+        for (char* cursor = buffer; cursor < buffer + len;) {
+            struct inotify_event* event = (struct inotify_event*)cursor;
+            cursor += sizeof(struct inotify_event) + event->len;
+            if (event->len == 0) {
+                continue;
+            }
+            char* directory = NULL;
+            for (int32_t i = 0; i < watch_directories_len; i++) {
+                if (watch_directories[i].wd == event->wd) {
+                    directory = watch_directories[i].path;
+                    break;
+                }
+            }
+            if (directory == NULL) {
+                continue;
+            }
+            char* path = join_path(directory, event->name);
+            if (event->mask & IN_ISDIR) {
+                if (event->mask & IN_CREATE) {
+                    watch_directory(path, NAXA_TRUE, now);
+                }
+                free(path);
+            } else if (event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO)) {
+                mark_pending(path, now);
+            } else {
+                free(path);
+            }
+        }
+    }
+
+    // Hand out whatever has settled
+    for (int32_t i = 0; i < watch_pending_len;) {
+        if (now - watch_pending[i].time < WATCH_DEBOUNCE) {
+            i++;
+            continue;
+        }
+        internal_logf(NAXA_SEVERITY_INFO, "Reloading %s", watch_pending[i].path);
+        changed(watch_pending[i].path);
+        free(watch_pending[i].path);
+        watch_pending[i] = watch_pending[--watch_pending_len];
+    }
+    return NAXA_E_SUCCESS;
+}
+
+int32_t teardown_watcher() {
+    if (watch_fd < 0) {
+        return NAXA_E_SUCCESS;
+    }
+    close(watch_fd);
+    watch_fd = -1;
+    for (int32_t i = 0; i < watch_directories_len; i++) {
+        free(watch_directories[i].path);
+    }
+    for (int32_t i = 0; i < watch_pending_len; i++) {
+        free(watch_pending[i].path);
+    }
+    watch_directories_len = 0;
+    watch_pending_len = 0;
+    return NAXA_E_SUCCESS;
+}
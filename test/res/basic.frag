@@ -1,15 +1,16 @@
 #version 460 core
 
+#include "naxa.glsl"
+
 in vec2 v_tex;
 in vec3 v_norm;
 
-in float v_debug;
-
 out vec4 o_frag_color;
 
-uniform sampler2D u_texture;
+layout(binding = 0) uniform sampler2DArray u_textures[TEXTURE_POOL_COUNT];
+layout(location = U_TEXTURE_POOL) uniform int u_texture_pool;
+layout(location = U_TEXTURE_LAYER) uniform int u_texture_layer;
 
 void main() {
-    o_frag_color = texture(u_texture, v_tex);
-    o_frag_color = vec4(v_debug, v_debug, v_debug, 1);
+    o_frag_color = texture(u_textures[u_texture_pool], vec3(v_tex, u_texture_layer));
 }
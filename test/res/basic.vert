@@ -1,46 +1,82 @@
 #version 460 core
 
+#include "naxa.glsl"
+
 layout (location = 0) in vec3 a_pos;
 layout (location = 1) in vec2 a_tex;
 layout (location = 2) in vec3 a_norm;
-layout (location = 3) in ivec4 a_bone_ids;
-layout (location = 4) in vec4 a_bone_weights;
 
 out vec2 v_tex;
 out vec3 v_norm;
 
-out float v_debug;
+layout (location = U_MODEL) uniform mat4 u_model;
+layout (location = U_MVP) uniform mat4 u_mvp;
+
+#ifdef NAXA_SKINNED
+layout (location = 3) in ivec4 a_bone_ids;
+layout (location = 4) in vec4 a_bone_weights;
+
+#include "skinning.glsl"
+#endif
 
-const int MAX_BONES = 200;
-const int MAX_BONE_WEIGHTS = 4;
+#ifdef NAXA_MORPH
+#include "morph.glsl"
+#endif
 
-uniform mat4 u_model;
-uniform mat4 u_mvp;
-uniform mat4 u_skeleton[MAX_BONES];
+#ifdef NAXA_CROWD
+// Laid out like CrowdInstanceData_t in crowd.c
+struct CrowdInstance {
+    vec4 position_first_frame;
+    vec4 rotation;
+    vec4 frames;
+};
+
+layout (std430, binding = CROWD_BINDING) readonly buffer Crowd {
+    CrowdInstance b_instances[];
+};
+
+layout (binding = VAT_POSITION_UNIT) uniform sampler2D u_vat_positions;
+layout (binding = VAT_NORMAL_UNIT) uniform sampler2D u_vat_normals;
+layout (location = U_CROWD_TIME) uniform float u_crowd_time;
+layout (location = U_VAT_WIDTH) uniform int u_vat_width;
+layout (location = U_VAT_ROWS_PER_FRAME) uniform int u_vat_rows_per_frame;
+
+ivec2 vat_texel(float frame) {
+    return ivec2(gl_VertexID % u_vat_width, int(frame) * u_vat_rows_per_frame + gl_VertexID / u_vat_width);
+}
+
+vec3 rotate(vec4 q, vec3 v) {
+    return v + 2.0 * cross(q.xyz, cross(q.xyz, v) + q.w * v);
+}
+#endif
 
 void main() {
-    vec4 total_position = vec4(0.0);
-    vec3 total_normal = vec3(0.0);
-    v_debug = 0;
-    for (int i = 0; i < MAX_BONE_WEIGHTS; i++) {
-        if (a_bone_ids[i] < 0) {
-            break;
-        }
-        if (a_bone_ids[i] >= MAX_BONES) {
-            v_debug = a_bone_ids[i] / (2147483647.0);
-            total_position = vec4(a_pos, 1.0);
-            break;
-            
-        }
-        vec4 local_position = u_skeleton[a_bone_ids[i]] * vec4(a_pos, 1.0);
-        total_position += local_position * a_bone_weights[i];
-        vec3 local_normal = mat3(u_skeleton[a_bone_ids[i]]) * a_norm;
-        total_normal += local_normal;
-
-        
-    }
-    total_position.w = 1.0;
-    gl_Position = u_mvp * total_position;
+#if defined(NAXA_CROWD)
+    // Every character plays its own clip, blend between the two frames
+    // either side of its time, the last one loops back to the first
+    CrowdInstance instance = b_instances[gl_InstanceID];
+    float frame = mod(u_crowd_time * instance.frames.y + instance.frames.z, instance.frames.x);
+    float frame_before = floor(frame);
+    float frame_after = mod(frame_before + 1.0, instance.frames.x);
+    ivec2 before = vat_texel(instance.position_first_frame.w + frame_before);
+    ivec2 after = vat_texel(instance.position_first_frame.w + frame_after);
+    float t = frame - frame_before;
+    vec3 position = mix(texelFetch(u_vat_positions, before, 0).xyz, texelFetch(u_vat_positions, after, 0).xyz, t);
+    vec3 normal = mix(texelFetch(u_vat_normals, before, 0).xyz, texelFetch(u_vat_normals, after, 0).xyz, t);
+    gl_Position = u_mvp * vec4(instance.position_first_frame.xyz + rotate(instance.rotation, position), 1.0);
+    v_tex = a_tex;
+    v_norm = rotate(instance.rotation, normal);
+#else
+    vec3 position = a_pos;
+    vec3 normal = a_norm;
+#ifdef NAXA_MORPH
+    morph(gl_VertexID, position, normal);
+#endif
+#ifdef NAXA_SKINNED
+    skin(position, normal, a_bone_ids, a_bone_weights, position, normal);
+#endif
+    gl_Position = u_mvp * vec4(position, 1.0);
     v_tex = a_tex;
-    v_norm = mat3(u_model) * total_normal;
+    v_norm = mat3(u_model) * normal;
+#endif
 }
@@ -0,0 +1,36 @@
+#ifndef MORPH_GLSL
+#define MORPH_GLSL
+
+// Morph targets shared by basic.vert and skin.comp, see morph.c
+
+#include "palette.glsl"
+
+// Deltas of vertex v are b_morph_deltas[b_morph_starts[v]] up to the
+// start of the next vertex. Each is a position delta with the index of
+// its morph target in w, then a normal delta.
+struct MorphDelta {
+    vec4 position_morph;
+    vec4 normal;
+};
+
+layout (std430, binding = MORPH_START_BINDING) readonly buffer MorphStarts {
+    uint b_morph_starts[];
+};
+
+layout (std430, binding = MORPH_DELTA_BINDING) readonly buffer MorphDeltas {
+    MorphDelta b_morph_deltas[];
+};
+
+layout (location = U_MORPH_OFFSET) uniform int u_morph_offset;
+
+void morph(int vertex, inout vec3 position, inout vec3 normal) {
+    uint end = b_morph_starts[vertex + 1];
+    for (uint i = b_morph_starts[vertex]; i < end; i++) {
+        int target = floatBitsToInt(b_morph_deltas[i].position_morph.w);
+        float weight = b_palette[u_morph_offset + target / 4][target % 4];
+        position += b_morph_deltas[i].position_morph.xyz * weight;
+        normal += b_morph_deltas[i].normal.xyz * weight;
+    }
+}
+
+#endif
@@ -0,0 +1,34 @@
+#ifndef NAXA_GLSL
+#define NAXA_GLSL
+
+// Locations and bindings render.c sets, shared by every variant so they
+// stay put whichever program is bound
+#define TEXTURE_POOL_COUNT 16
+#define PALETTE_BINDING 0
+
+#define U_MODEL 0
+#define U_MVP 1
+#define U_PALETTE_OFFSET 2
+#define U_TEXTURE_POOL 3
+#define U_TEXTURE_LAYER 4
+
+// Compute pre-skinning, see skin.comp
+#define SKIN_SOURCE_BINDING 1
+#define SKIN_DEST_BINDING 2
+#define SKIN_GROUP_SIZE 64
+#define U_SKIN_VERTEX_COUNT 5
+
+// Vertex animation crowds, see crowd.c
+#define CROWD_BINDING 3
+#define VAT_POSITION_UNIT 16
+#define VAT_NORMAL_UNIT 17
+#define U_CROWD_TIME 6
+#define U_VAT_WIDTH 7
+#define U_VAT_ROWS_PER_FRAME 8
+
+// Morph targets, see morph.c
+#define MORPH_START_BINDING 4
+#define MORPH_DELTA_BINDING 5
+#define U_MORPH_OFFSET 9
+
+#endif
@@ -0,0 +1,12 @@
+#ifndef PALETTE_GLSL
+#define PALETTE_GLSL
+
+// Bone palettes and morph weights of every draw this frame, packed end to
+// end. A bone is a mat4 as four columns, or with NAXA_DUAL_QUAT a dual
+// quaternion as its real part then its dual part. Morph weights are four
+// to a vec4.
+layout (std430, binding = PALETTE_BINDING) readonly buffer Palette {
+    vec4 b_palette[];
+};
+
+#endif
@@ -0,0 +1,65 @@
+#ifndef SKINNING_GLSL
+#define SKINNING_GLSL
+
+// Skinning shared by basic.vert and skin.comp
+
+#include "palette.glsl"
+
+const int MAX_BONE_WEIGHTS = 4;
+
+layout (location = U_PALETTE_OFFSET) uniform int u_palette_offset;
+
+#ifdef NAXA_DUAL_QUAT
+void skin(vec3 position, vec3 normal, ivec4 bone_ids, vec4 bone_weights, out vec3 skinned_position, out vec3 skinned_normal) {
+    // Blend on the same side as the first bone, q and -q are the same
+    // rotation but would cancel out
+    vec4 real = vec4(0.0, 0.0, 0.0, 1.0);
+    vec4 dual = vec4(0.0);
+    if (bone_ids[0] >= 0) {
+        real = vec4(0.0);
+        vec4 first = b_palette[u_palette_offset + 2 * bone_ids[0]];
+        for (int i = 0; i < MAX_BONE_WEIGHTS; i++) {
+            if (bone_ids[i] < 0) {
+                break;
+            }
+            int bone = u_palette_offset + 2 * bone_ids[i];
+            vec4 bone_real = b_palette[bone];
+            float weight = dot(bone_real, first) < 0.0 ? -bone_weights[i] : bone_weights[i];
+            real += bone_real * weight;
+            dual += b_palette[bone + 1] * weight;
+        }
+        float inverse_length = 1.0 / length(real);
+        real *= inverse_length;
+        dual *= inverse_length;
+    }
+
+    // Rotate, then translate by 2 * dual * conjugate(real)
+    vec3 r = real.xyz;
+    skinned_position = position + 2.0 * cross(r, cross(r, position) + real.w * position)
+        + 2.0 * (real.w * dual.xyz - dual.w * r + cross(r, dual.xyz));
+    skinned_normal = normal + 2.0 * cross(r, cross(r, normal) + real.w * normal);
+}
+#else
+void skin(vec3 position, vec3 normal, ivec4 bone_ids, vec4 bone_weights, out vec3 skinned_position, out vec3 skinned_normal) {
+    if (bone_ids[0] < 0) {
+        skinned_position = position;
+        skinned_normal = normal;
+        return;
+    }
+    vec4 total_position = vec4(0.0);
+    vec3 total_normal = vec3(0.0);
+    for (int i = 0; i < MAX_BONE_WEIGHTS; i++) {
+        if (bone_ids[i] < 0) {
+            break;
+        }
+        int bone = u_palette_offset + 4 * bone_ids[i];
+        mat4 matrix = mat4(b_palette[bone], b_palette[bone + 1], b_palette[bone + 2], b_palette[bone + 3]);
+        total_position += matrix * vec4(position, 1.0) * bone_weights[i];
+        total_normal += mat3(matrix) * normal * bone_weights[i];
+    }
+    skinned_position = total_position.xyz;
+    skinned_normal = total_normal;
+}
+#endif
+
+#endif
@@ -0,0 +1,241 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <assimp/scene.h>
+#include <assimp/types.h>
+
+#include <naxa/anim.h>
+#include <naxa/err.h>
+#include <naxa/log.h>
+#include <naxa/naxa_internal.h>
+
+#include "checks.h"
+
+#define BENCH_FRAMES 120
+#define BENCH_FRAME_TIME (1.0f / 60.0f)
+#define BENCH_CLIP_TICKS 60
+#define BENCH_TICKS_PER_SECOND 30.0
+#define BENCH_CHILDREN 3
+#define BENCH_MIN_CHUNK 8
+
+// One frame of the crowd for the job system to split up
+typedef struct {
+    NaxaModel_t* model;
+    NaxaAnimSampler_t* samplers;
+    NaxaPose_t* poses;
+    mat4* palette;
+    int32_t joint_count;
+    int32_t frame;
+} BenchFrame_t;
+
+static double now_seconds() {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int32_t sample_source(void* user, float time, NaxaPose_t* dest) {
+    return naxa_sample_clip((NaxaAnimSampler_t*)user, time, dest);
+}
+
+static void animate_range(void* data, int32_t first, int32_t last) {
+    BenchFrame_t* bench = data;
+    for (int32_t i = first; i < last; i++) {
+        naxa_sample_clip(&bench->samplers[i], bench->frame * BENCH_FRAME_TIME + i * 0.037f, &bench->poses[i]);
+        anim_skin_palette(&bench->palette[i * bench->joint_count], bench->model, &bench->poses[i]);
+    }
+}
+
+// A crowd seen from inside it, a few characters close and most far away
+static int32_t crowd_level(int32_t character, int32_t character_count) {
+    static const int32_t LEVELS[10] = { 0, 1, 1, 2, 2, 2, 3, 3, 3, 3 };
+    return LEVELS[(int64_t)character * 10 / character_count];
+}
+
+static void set_ai_string(struct aiString* dest, char* format, int32_t index) {
+    dest->length = snprintf(dest->data, sizeof(dest->data), format, index);
+}
+
+static struct aiMatrix4x4 ai_translation(float x, float y, float z) {
+    struct aiMatrix4x4 matrix = {
+        1.0f, 0.0f, 0.0f, x,
+        0.0f, 1.0f, 0.0f, y,
+        0.0f, 0.0f, 1.0f, z,
+        0.0f, 0.0f, 0.0f, 1.0f
+    };
+    return matrix;
+}
+
+// A bushy made up skeleton with every joint animated, roughly what a
+// humanoid with fingers and face bones looks like to the evaluator
+static void build_scene(struct aiScene* scene, struct aiNode* nodes, struct aiNode** children, struct aiAnimation* animation,
+        struct aiNodeAnim* channels, struct aiNodeAnim** channel_list, int32_t joint_count) {
+    memset(scene, 0, sizeof(struct aiScene));
+    memset(animation, 0, sizeof(struct aiAnimation));
+    for (int32_t i = 0; i < joint_count; i++) {
+        memset(&nodes[i], 0, sizeof(struct aiNode));
+        set_ai_string(&nodes[i].mName, "joint%d", i);
+        nodes[i].mTransformation = ai_translation(0.0f, i == 0 ? 0.0f : 0.1f, 0.0f);
+        children[i] = &nodes[i];
+    }
+    for (int32_t i = 0; i < joint_count; i++) {
+        int32_t first = i * BENCH_CHILDREN + 1;
+        if (first < joint_count) {
+            nodes[i].mChildren = &children[first];
+            nodes[i].mNumChildren = joint_count - first < BENCH_CHILDREN ? joint_count - first : BENCH_CHILDREN;
+        }
+    }
+
+    for (int32_t i = 0; i < joint_count; i++) {
+        struct aiNodeAnim* channel = &channels[i];
+        memset(channel, 0, sizeof(struct aiNodeAnim));
+        channel->mNodeName = nodes[i].mName;
+        channel->mNumPositionKeys = BENCH_CLIP_TICKS + 1;
+        channel->mNumRotationKeys = BENCH_CLIP_TICKS + 1;
+        channel->mNumScalingKeys = 1;
+        channel->mPositionKeys = malloc(channel->mNumPositionKeys * sizeof(struct aiVectorKey));
+        channel->mRotationKeys = malloc(channel->mNumRotationKeys * sizeof(struct aiQuatKey));
+        channel->mScalingKeys = malloc(sizeof(struct aiVectorKey));
+        for (int32_t key = 0; key <= BENCH_CLIP_TICKS; key++) {
+            float angle = sinf(key * 0.1f + i) * 0.5f;
+            channel->mPositionKeys[key].mTime = key;
+            channel->mPositionKeys[key].mValue = (struct aiVector3D){ 0.0f, 0.1f + angle * 0.01f, 0.0f };
+            channel->mRotationKeys[key].mTime = key;
+            channel->mRotationKeys[key].mValue = (struct aiQuaternion){ cosf(angle), sinf(angle), 0.0f, 0.0f };
+        }
+        channel->mScalingKeys[0].mTime = 0.0;
+        channel->mScalingKeys[0].mValue = (struct aiVector3D){ 1.0f, 1.0f, 1.0f };
+        channel_list[i] = channel;
+    }
+    set_ai_string(&animation->mName, "bench%d", 0);
+    animation->mDuration = BENCH_CLIP_TICKS;
+    animation->mTicksPerSecond = BENCH_TICKS_PER_SECOND;
+    animation->mNumChannels = joint_count;
+    animation->mChannels = channel_list;
+    scene->mRootNode = &nodes[0];
+}
+
+int32_t benchmark_animation(int32_t character_count, int32_t joint_count) {
+    if (character_count <= 0 || joint_count <= 0) {
+        report_error(NAXA_E_BOUNDS);
+        return NAXA_E_BOUNDS;
+    }
+
+    // Stand up a model the way the loader would, every joint a bone
+    struct aiScene scene;
+    struct aiAnimation animation;
+    struct aiAnimation* animations[] = { &animation };
+    struct aiNode* nodes = malloc(joint_count * sizeof(struct aiNode));
+    struct aiNode** children = malloc(joint_count * sizeof(struct aiNode*));
+    struct aiNodeAnim* channels = malloc(joint_count * sizeof(struct aiNodeAnim));
+    struct aiNodeAnim** channel_list = malloc(joint_count * sizeof(struct aiNodeAnim*));
+    build_scene(&scene, nodes, children, &animation, channels, channel_list, joint_count);
+    scene.mNumAnimations = 1;
+    scene.mAnimations = animations;
+
+    NaxaModel_t model;
+    memset(&model, 0, sizeof(NaxaModel_t));
+    model.bone_count = joint_count;
+    model.bones = malloc(joint_count * sizeof(NaxaBone_t));
+    for (int32_t i = 0; i < joint_count; i++) {
+        model.bones[i].name = malloc(nodes[i].mName.length + 1);
+        memcpy(model.bones[i].name, nodes[i].mName.data, nodes[i].mName.length + 1);
+        model.bones[i].index = i;
+        glm_mat4_identity(model.bones[i].matrix);
+    }
+    anim_import(&model, &scene);
+    for (int32_t i = 0; i < joint_count; i++) {
+        free(channels[i].mPositionKeys);
+        free(channels[i].mRotationKeys);
+        free(channels[i].mScalingKeys);
+    }
+    free(nodes);
+    free(children);
+    free(channels);
+    free(channel_list);
+
+    // Everyone plays the same clip at a different point in it
+    NaxaAnimSampler_t* samplers = malloc(character_count * sizeof(NaxaAnimSampler_t));
+    NaxaPose_t* poses = malloc(character_count * sizeof(NaxaPose_t));
+    for (int32_t i = 0; i < character_count; i++) {
+        naxa_init_sampler(&samplers[i], &model, &model.clips[0]);
+        naxa_init_pose(&poses[i], &model);
+    }
+    mat4* palette = aligned_alloc(sizeof(mat4), (size_t)character_count * joint_count * sizeof(mat4));
+
+    double sample_seconds = 0.0;
+    double palette_seconds = 0.0;
+    for (int32_t frame = 0; frame < BENCH_FRAMES; frame++) {
+        double start = now_seconds();
+        for (int32_t i = 0; i < character_count; i++) {
+            naxa_sample_clip(&samplers[i], frame * BENCH_FRAME_TIME + i * 0.037f, &poses[i]);
+        }
+        double sampled = now_seconds();
+        for (int32_t i = 0; i < character_count; i++) {
+            anim_skin_palette(&palette[i * joint_count], &model, &poses[i]);
+        }
+        double end = now_seconds();
+        sample_seconds += sampled - start;
+        palette_seconds += end - sampled;
+    }
+
+    double joints = (double)character_count * joint_count * BENCH_FRAMES;
+    internal_logf(NAXA_SEVERITY_INFO, "%d characters x %d joints: sample %.3f ms, palette %.3f ms per frame",
+        character_count, joint_count, sample_seconds * 1000.0 / BENCH_FRAMES, palette_seconds * 1000.0 / BENCH_FRAMES);
+    internal_logf(NAXA_SEVERITY_INFO, "%.1f ns per joint sampled, %.1f ns per joint to palette",
+        sample_seconds * 1e9 / joints, palette_seconds * 1e9 / joints);
+
+    // Same crowd again spread over the job threads, sampling and palette
+    // together since every character is independent
+    BenchFrame_t bench = { &model, samplers, poses, palette, joint_count, 0 };
+    double parallel_seconds = 0.0;
+    for (int32_t frame = 0; frame < BENCH_FRAMES; frame++) {
+        double start = now_seconds();
+        bench.frame = frame;
+        job_parallel_for(character_count, BENCH_MIN_CHUNK, animate_range, &bench);
+        parallel_seconds += now_seconds() - start;
+    }
+    internal_logf(NAXA_SEVERITY_INFO, "On %d threads: sample and palette %.3f ms per frame (%.1fx faster)",
+        job_thread_count(), parallel_seconds * 1000.0 / BENCH_FRAMES, (sample_seconds + palette_seconds) / parallel_seconds);
+
+    // Same crowd again with animation LOD spread like a real scene
+    NaxaAnimLod_t* lods = malloc(character_count * sizeof(NaxaAnimLod_t));
+    for (int32_t i = 0; i < character_count; i++) {
+        naxa_init_anim_lod(&lods[i], &model);
+    }
+    // Sampling, resolving and the palette timed as one, LOD cuts all three
+    double lod_seconds = 0.0;
+    for (int32_t frame = 0; frame < BENCH_FRAMES; frame++) {
+        double start = now_seconds();
+        for (int32_t i = 0; i < character_count; i++) {
+            anim_lod_update(&lods[i], crowd_level(i, character_count), frame * BENCH_FRAME_TIME + i * 0.037f,
+                sample_source, &samplers[i], &poses[i]);
+            anim_skin_palette(&palette[i * joint_count], &model, &poses[i]);
+        }
+        lod_seconds += now_seconds() - start;
+    }
+    internal_logf(NAXA_SEVERITY_INFO, "With animation LOD (%d/%d/%d/%d joints): sample and palette %.3f ms per frame (%.1fx less)",
+        model.skeleton.lod_joint_counts[0], model.skeleton.lod_joint_counts[1], model.skeleton.lod_joint_counts[2],
+        model.skeleton.lod_joint_counts[3], lod_seconds * 1000.0 / BENCH_FRAMES, (sample_seconds + palette_seconds) / lod_seconds);
+    for (int32_t i = 0; i < character_count; i++) {
+        naxa_free_anim_lod(&lods[i]);
+    }
+    free(lods);
+
+    free(palette);
+    for (int32_t i = 0; i < character_count; i++) {
+        naxa_free_sampler(&samplers[i]);
+        naxa_free_pose(&poses[i]);
+    }
+    free(samplers);
+    free(poses);
+    for (int32_t i = 0; i < joint_count; i++) {
+        free(model.bones[i].name);
+    }
+    free(model.bones);
+    anim_free(&model);
+    return NAXA_E_SUCCESS;
+}
@@ -0,0 +1,289 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <assimp/scene.h>
+#include <assimp/types.h>
+
+#include <naxa/anim.h>
+#include <naxa/err.h>
+#include <naxa/log.h>
+#include <naxa/naxa_internal.h>
+
+#include "checks.h"
+
+// A three joint arm root -> spine -> arm, every joint 1 up from its parent
+// at rest. Clips hold one key so every pose below is worked out by hand.
+#define CHECK_JOINTS 3
+#define CHECK_CLIPS 3
+#define CHECK_TOLERANCE 1e-4f
+#define CHECK_SQRT_HALF 0.70710678f
+
+// Clips in the order build_model imports them
+enum { CLIP_WALK, CLIP_RUN, CLIP_WAVE };
+
+typedef struct {
+    char* name;
+    float translation[3];
+    float rotation[4];
+    float scale;
+} CheckKey_t;
+
+// What a joint should come out as, rotations are x, y, z, w
+typedef struct {
+    char* what;
+    float translations[CHECK_JOINTS][3];
+    float rotations[CHECK_JOINTS][4];
+    float scales[CHECK_JOINTS];
+} CheckPose_t;
+
+static void set_ai_string(struct aiString* dest, char* string) {
+    dest->length = strlen(string);
+    memcpy(dest->data, string, dest->length + 1);
+}
+
+static struct aiMatrix4x4 ai_translation(float x, float y, float z) {
+    struct aiMatrix4x4 matrix = {
+        1.0f, 0.0f, 0.0f, x,
+        0.0f, 1.0f, 0.0f, y,
+        0.0f, 0.0f, 1.0f, z,
+        0.0f, 0.0f, 0.0f, 1.0f
+    };
+    return matrix;
+}
+
+// Every joint of a clip holds the same key for the whole clip
+static void build_clip(struct aiAnimation* animation, struct aiNodeAnim* channels, struct aiNodeAnim** channel_list,
+        struct aiVectorKey* vectors, struct aiQuatKey* quats, struct aiNode* nodes, CheckKey_t* key) {
+    memset(animation, 0, sizeof(struct aiAnimation));
+    set_ai_string(&animation->mName, key->name);
+    animation->mDuration = 1.0;
+    animation->mTicksPerSecond = 30.0;
+    animation->mNumChannels = CHECK_JOINTS;
+    animation->mChannels = channel_list;
+    for (int32_t joint = 0; joint < CHECK_JOINTS; joint++) {
+        struct aiNodeAnim* channel = &channels[joint];
+        memset(channel, 0, sizeof(struct aiNodeAnim));
+        channel->mNodeName = nodes[joint].mName;
+        vectors[2 * joint].mValue = (struct aiVector3D){ key->translation[0], key->translation[1], key->translation[2] };
+        vectors[2 * joint + 1].mValue = (struct aiVector3D){ key->scale, key->scale, key->scale };
+        quats[joint].mValue = (struct aiQuaternion){ key->rotation[3], key->rotation[0], key->rotation[1], key->rotation[2] };
+        channel->mNumPositionKeys = 1;
+        channel->mPositionKeys = &vectors[2 * joint];
+        channel->mNumScalingKeys = 1;
+        channel->mScalingKeys = &vectors[2 * joint + 1];
+        channel->mNumRotationKeys = 1;
+        channel->mRotationKeys = &quats[joint];
+        channel_list[joint] = channel;
+    }
+}
+
+static int32_t build_model(NaxaModel_t* model) {
+    static char* NAMES[CHECK_JOINTS] = { "root", "spine", "arm" };
+    static CheckKey_t KEYS[CHECK_CLIPS] = {
+        { "walk", { 0.0f, 2.0f, 0.0f }, { 0.0f, 0.0f, 0.0f, 1.0f }, 1.0f },
+        // A quarter turn about z
+        { "run", { 0.0f, 4.0f, 0.0f }, { 0.0f, 0.0f, CHECK_SQRT_HALF, CHECK_SQRT_HALF }, 2.0f },
+        // Rest plus 1 along x and a quarter turn about x
+        { "wave", { 1.0f, 1.0f, 0.0f }, { CHECK_SQRT_HALF, 0.0f, 0.0f, CHECK_SQRT_HALF }, 1.5f }
+    };
+    struct aiNode nodes[CHECK_JOINTS];
+    struct aiNode* children[CHECK_JOINTS];
+    struct aiAnimation animations[CHECK_CLIPS];
+    struct aiAnimation* animation_list[CHECK_CLIPS];
+    struct aiNodeAnim channels[CHECK_CLIPS][CHECK_JOINTS];
+    struct aiNodeAnim* channel_lists[CHECK_CLIPS][CHECK_JOINTS];
+    struct aiVectorKey vectors[CHECK_CLIPS][2 * CHECK_JOINTS];
+    struct aiQuatKey quats[CHECK_CLIPS][CHECK_JOINTS];
+    for (int32_t joint = 0; joint < CHECK_JOINTS; joint++) {
+        memset(&nodes[joint], 0, sizeof(struct aiNode));
+        set_ai_string(&nodes[joint].mName, NAMES[joint]);
+        nodes[joint].mTransformation = ai_translation(0.0f, 1.0f, 0.0f);
+        children[joint] = &nodes[joint];
+        if (joint + 1 < CHECK_JOINTS) {
+            nodes[joint].mChildren = &children[joint + 1];
+            nodes[joint].mNumChildren = 1;
+        }
+    }
+    for (int32_t clip = 0; clip < CHECK_CLIPS; clip++) {
+        build_clip(&animations[clip], channels[clip], channel_lists[clip], vectors[clip], quats[clip], nodes, &KEYS[clip]);
+        animation_list[clip] = &animations[clip];
+    }
+    struct aiScene scene;
+    memset(&scene, 0, sizeof(struct aiScene));
+    scene.mRootNode = &nodes[0];
+    scene.mNumAnimations = CHECK_CLIPS;
+    scene.mAnimations = animation_list;
+
+    memset(model, 0, sizeof(NaxaModel_t));
+    model->bone_count = CHECK_JOINTS;
+    model->bones = malloc(CHECK_JOINTS * sizeof(NaxaBone_t));
+    for (int32_t i = 0; i < CHECK_JOINTS; i++) {
+        model->bones[i].name = NAMES[i];
+        model->bones[i].index = i;
+        glm_mat4_identity(model->bones[i].matrix);
+    }
+    return anim_import(model, &scene);
+}
+
+static int32_t find_joint(NaxaModel_t* model, char* name) {
+    for (int32_t joint = 0; joint < model->skeleton.joint_count; joint++) {
+        if (strcmp(model->skeleton.names[joint], name) == 0) {
+            return joint;
+        }
+    }
+    return -1;
+}
+
+// Joints of the expected pose are in the order root, spine, arm whatever
+// order the importer put them in. q and -q are the same rotation.
+static int32_t compare_pose(NaxaModel_t* model, NaxaPose_t* pose, CheckPose_t* expected) {
+    static char* NAMES[CHECK_JOINTS] = { "root", "spine", "arm" };
+    int32_t stride = pose->stride;
+    int32_t mismatches = 0;
+    for (int32_t i = 0; i < CHECK_JOINTS; i++) {
+        int32_t joint = find_joint(model, NAMES[i]);
+        float error = 0.0f;
+        float dot = 0.0f;
+        for (int32_t c = 0; c < 4; c++) {
+            dot += pose->rotations[c * stride + joint] * expected->rotations[i][c];
+        }
+        for (int32_t c = 0; c < 3; c++) {
+            error = fmaxf(error, fabsf(pose->translations[c * stride + joint] - expected->translations[i][c]));
+            error = fmaxf(error, fabsf(pose->scales[c * stride + joint] - expected->scales[i]));
+        }
+        error = fmaxf(error, 1.0f - fabsf(dot));
+        if (error > CHECK_TOLERANCE) {
+            internal_logf(NAXA_SEVERITY_ERROR, "%s: %s is off by %f, got t (%f, %f, %f) r (%f, %f, %f, %f) s %f",
+                expected->what, NAMES[i], error,
+                pose->translations[joint], pose->translations[stride + joint], pose->translations[2 * stride + joint],
+                pose->rotations[joint], pose->rotations[stride + joint], pose->rotations[2 * stride + joint],
+                pose->rotations[3 * stride + joint], pose->scales[joint]);
+            mismatches++;
+        }
+    }
+    return mismatches;
+}
+
+// Evaluate root into pose and make sure every temporary pose went back
+static int32_t evaluate(NaxaBlendTree_t* tree, int32_t root, float now, NaxaArena_t* arena, NaxaPose_t* pose, char* what) {
+    int32_t rc = naxa_evaluate_blend_tree(tree, root, now, arena, pose);
+    if (rc != NAXA_E_SUCCESS) {
+        internal_logf(NAXA_SEVERITY_ERROR, "%s: evaluating failed with %s, arena of %lld bytes", what, naxa_strerror(rc), (long long)arena->size);
+        return rc;
+    }
+    if (arena->used != 0) {
+        internal_logf(NAXA_SEVERITY_ERROR, "%s: %lld arena bytes still in use after evaluating", what, (long long)arena->used);
+        return NAXA_E_INTERNAL;
+    }
+    return NAXA_E_SUCCESS;
+}
+
+int32_t check_blend_tree() {
+    NaxaModel_t model;
+    int32_t rc = build_model(&model);
+    if (rc != NAXA_E_SUCCESS) {
+        internal_logf(NAXA_SEVERITY_ERROR, "Couldn't import the blend check skeleton");
+        free(model.bones);
+        return rc;
+    }
+
+    // crossfade fades walk into run over a second from 0, additive puts
+    // half of wave over it, masked shows the additive result on the spine
+    // and arm and walk on the root. masked nests additive as its second
+    // child, so it needs two temporary poses at once.
+    NaxaBlendTree_t tree;
+    int32_t walk;
+    int32_t run;
+    int32_t wave;
+    int32_t masked_walk;
+    int32_t crossfade;
+    int32_t additive;
+    int32_t masked;
+    naxa_init_blend_tree(&tree, &model, 8);
+    naxa_blend_clip(&tree, &walk, &model.clips[CLIP_WALK]);
+    naxa_blend_clip(&tree, &run, &model.clips[CLIP_RUN]);
+    naxa_blend_clip(&tree, &wave, &model.clips[CLIP_WAVE]);
+    naxa_blend_clip(&tree, &masked_walk, &model.clips[CLIP_WALK]);
+    naxa_blend_lerp(&tree, &crossfade, walk, run);
+    naxa_blend_additive(&tree, &additive, crossfade, wave);
+    naxa_blend_lerp(&tree, &masked, masked_walk, additive);
+    naxa_blend_fade(&tree, crossfade, 1.0f, 1.0f, 0.0f);
+    naxa_blend_fade(&tree, additive, 0.5f, 0.0f, 0.0f);
+    naxa_blend_fade(&tree, masked, 1.0f, 0.0f, 0.0f);
+    naxa_blend_mask_branch(&tree, masked, "spine");
+
+    // A quarter of the way through the crossfade:
+    //   translation 2 + (4 - 2) / 4 = 2.5, scale 1 + (2 - 1) / 4 = 1.25,
+    //   rotation nlerp(identity, (0, 0, 0.7071, 0.7071), 0.25)
+    //     = (0, 0, 0.1768, 0.9268) / 0.9435 = (0, 0, 0.1873655, 0.9822903)
+    // Half of wave on top:
+    //   translation + (1, 0, 0) / 2, scale 1.25 * (1 + 0.5 / 2) = 1.5625,
+    //   rotation crossfade * nlerp(identity, (0.7071, 0, 0, 0.7071), 0.5)
+    //     = (0, 0, 0.1873655, 0.9822903) * (0.3826834, 0, 0, 0.9238795)
+    //     = (0.3759062, 0.0717017, 0.1731032, 0.9075179)
+    static CheckPose_t EXPECTED[] = {
+        { "crossfade",
+            { { 0.0f, 2.5f, 0.0f }, { 0.0f, 2.5f, 0.0f }, { 0.0f, 2.5f, 0.0f } },
+            { { 0.0f, 0.0f, 0.1873655f, 0.9822903f }, { 0.0f, 0.0f, 0.1873655f, 0.9822903f }, { 0.0f, 0.0f, 0.1873655f, 0.9822903f } },
+            { 1.25f, 1.25f, 1.25f } },
+        { "additive layer",
+            { { 0.5f, 2.5f, 0.0f }, { 0.5f, 2.5f, 0.0f }, { 0.5f, 2.5f, 0.0f } },
+            { { 0.3759062f, 0.0717017f, 0.1731032f, 0.9075179f }, { 0.3759062f, 0.0717017f, 0.1731032f, 0.9075179f },
+                { 0.3759062f, 0.0717017f, 0.1731032f, 0.9075179f } },
+            { 1.5625f, 1.5625f, 1.5625f } },
+        { "masked layer",
+            { { 0.0f, 2.0f, 0.0f }, { 0.5f, 2.5f, 0.0f }, { 0.5f, 2.5f, 0.0f } },
+            { { 0.0f, 0.0f, 0.0f, 1.0f }, { 0.3759062f, 0.0717017f, 0.1731032f, 0.9075179f },
+                { 0.3759062f, 0.0717017f, 0.1731032f, 0.9075179f } },
+            { 1.0f, 1.5625f, 1.5625f } },
+        // Past the end of the fade the crossfade is just run
+        { "finished crossfade",
+            { { 0.0f, 4.0f, 0.0f }, { 0.0f, 4.0f, 0.0f }, { 0.0f, 4.0f, 0.0f } },
+            { { 0.0f, 0.0f, CHECK_SQRT_HALF, CHECK_SQRT_HALF }, { 0.0f, 0.0f, CHECK_SQRT_HALF, CHECK_SQRT_HALF },
+                { 0.0f, 0.0f, CHECK_SQRT_HALF, CHECK_SQRT_HALF } },
+            { 2.0f, 2.0f, 2.0f } }
+    };
+    int32_t roots[] = { crossfade, additive, masked, crossfade };
+    float times[] = { 0.25f, 0.25f, 0.25f, 2.0f };
+
+    // Exactly the two poses the deepest path needs. Anything taking more,
+    // or going around the arena, shows up as a failure or in arena->used.
+    int32_t arena_bytes = 2 * naxa_pose_bytes(&model);
+    NaxaArena_t arena;
+    naxa_init_arena(&arena, arena_bytes);
+    NaxaPose_t pose;
+    naxa_init_pose(&pose, &model);
+    int32_t failures = 0;
+    for (int32_t i = 0; i < sizeof(roots) / sizeof(int32_t); i++) {
+        if (evaluate(&tree, roots[i], times[i], &arena, &pose, EXPECTED[i].what) != NAXA_E_SUCCESS) {
+            failures++;
+            continue;
+        }
+        failures += compare_pose(&model, &pose, &EXPECTED[i]);
+    }
+    naxa_free_arena(&arena);
+
+    // One pose short has to fail cleanly rather than find memory elsewhere
+    internal_logs(NAXA_SEVERITY_INFO, "Evaluating in an arena one pose short, it should report running out");
+    naxa_init_arena(&arena, naxa_pose_bytes(&model));
+    rc = naxa_evaluate_blend_tree(&tree, masked, 0.25f, &arena, &pose);
+    if (rc != NAXA_E_EXHAUSTED) {
+        internal_logf(NAXA_SEVERITY_ERROR, "Masked layer in an arena one pose short returned %s instead of running out",
+            naxa_strerror(rc));
+        failures++;
+    }
+    naxa_free_arena(&arena);
+
+    naxa_free_pose(&pose);
+    naxa_free_blend_tree(&tree);
+    anim_free(&model);
+    free(model.bones);
+    if (failures > 0) {
+        internal_logf(NAXA_SEVERITY_ERROR, "Blend tree check failed, %d problems", failures);
+        return NAXA_E_INTERNAL;
+    }
+    internal_logf(NAXA_SEVERITY_INFO, "Blend tree check passed, %d poses match in a %d byte arena",
+        (int32_t)(sizeof(roots) / sizeof(int32_t)), arena_bytes);
+    return NAXA_E_SUCCESS;
+}
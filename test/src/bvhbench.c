@@ -0,0 +1,289 @@
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <naxa/err.h>
+#include <naxa/log.h>
+#include <naxa/naxa_internal.h>
+
+#include "checks.h"
+
+#define BENCH_SEED 4321
+#define BENCH_FRAMES 60
+#define BENCH_FRAME_TIME (1.0f / 60.0f)
+#define BENCH_WORLD_SIZE 1000.0f
+#define BENCH_MAX_SPEED 10.0f
+#define BENCH_MARGIN 0.5f
+#define BENCH_QUERIES 1000
+#define BENCH_QUERY_SIZE 20.0f
+#define BENCH_RAY_LENGTH 200.0f
+#define BENCH_CHECKED_RAYS 16
+#define BENCH_CHECKED_QUERIES 64
+#define BENCH_SPHERE_RADIUS 15.0f
+#define BENCH_FRUSTUM_FAR 250.0f
+
+typedef struct {
+    vec3 position;
+    vec3 velocity;
+    float half_size;
+    int32_t proxy;
+} BenchObject_t;
+
+typedef struct {
+    int64_t hits;
+    void* wanted;
+    int32_t found;
+} BenchHits_t;
+
+// Which objects a query reported, and how many times
+typedef struct {
+    BenchObject_t* objects;
+    uint8_t* reported;
+} BenchMarks_t;
+
+static double now_seconds() {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static float random_range(float low, float high) {
+    return low + (high - low) * ((float)rand() / (float)RAND_MAX);
+}
+
+static int32_t count_hit(void* user, void* context) {
+    BenchHits_t* hits = context;
+    hits->hits++;
+    hits->found |= user == hits->wanted;
+    return NAXA_TRUE;
+}
+
+static int32_t mark_hit(void* user, void* context) {
+    BenchMarks_t* marks = context;
+    marks->reported[(BenchObject_t*)user - marks->objects]++;
+    return NAXA_TRUE;
+}
+
+// The tree keeps fattened leaf boxes, the brute force scan tests the same
+// boxes so both sides have to agree exactly
+static int32_t brute_box(vec3 box_min, vec3 box_max, vec3 min, vec3 max) {
+    for (int32_t axis = 0; axis < 3; axis++) {
+        if (box_min[axis] > max[axis] || box_max[axis] < min[axis]) {
+            return NAXA_FALSE;
+        }
+    }
+    return NAXA_TRUE;
+}
+
+static int32_t brute_sphere(vec3 box_min, vec3 box_max, vec3 center, float radius) {
+    float distance2 = 0.0f;
+    for (int32_t axis = 0; axis < 3; axis++) {
+        float d = 0.0f;
+        if (center[axis] < box_min[axis]) {
+            d = box_min[axis] - center[axis];
+        } else if (center[axis] > box_max[axis]) {
+            d = center[axis] - box_max[axis];
+        }
+        distance2 += d * d;
+    }
+    return distance2 <= radius * radius;
+}
+
+static int32_t brute_frustum(vec3 box_min, vec3 box_max, vec4 planes[6]) {
+    for (int32_t p = 0; p < 6; p++) {
+        vec3 positive;
+        for (int32_t axis = 0; axis < 3; axis++) {
+            positive[axis] = planes[p][axis] >= 0.0f ? box_max[axis] : box_min[axis];
+        }
+        if (glm_vec3_dot(planes[p], positive) + planes[p][3] < 0.0f) {
+            return NAXA_FALSE;
+        }
+    }
+    return NAXA_TRUE;
+}
+
+// Run one query of each kind at random and compare what it reported against
+// every leaf box, returns how many objects disagree and adds up the results
+static int32_t check_queries(NaxaBvh_t* bvh, BenchObject_t* objects, int32_t object_count, uint8_t* reported, int64_t* results) {
+    BenchMarks_t marks = { objects, reported };
+    int32_t mismatches = 0;
+    for (int32_t kind = 0; kind < 3; kind++) {
+        vec3 min;
+        vec3 max;
+        vec3 center;
+        vec4 planes[6];
+        memset(reported, 0, object_count);
+        if (kind == 0) {
+            for (int32_t axis = 0; axis < 3; axis++) {
+                min[axis] = random_range(0.0f, BENCH_WORLD_SIZE - BENCH_QUERY_SIZE);
+                max[axis] = min[axis] + BENCH_QUERY_SIZE;
+            }
+            bvh_query_box(bvh, min, max, mark_hit, &marks);
+        } else if (kind == 1) {
+            for (int32_t axis = 0; axis < 3; axis++) {
+                center[axis] = random_range(0.0f, BENCH_WORLD_SIZE);
+            }
+            bvh_query_sphere(bvh, center, BENCH_SPHERE_RADIUS, mark_hit, &marks);
+        } else {
+            // A camera somewhere in the world looking somewhere else
+            vec3 eye;
+            vec3 target;
+            mat4 projection;
+            mat4 view;
+            mat4 view_projection;
+            for (int32_t axis = 0; axis < 3; axis++) {
+                eye[axis] = random_range(0.0f, BENCH_WORLD_SIZE);
+                target[axis] = random_range(0.0f, BENCH_WORLD_SIZE);
+            }
+            glm_perspective(glm_rad(60.0f), 1.5f, 1.0f, BENCH_FRUSTUM_FAR, projection);
+            glm_lookat(eye, target, (vec3){ 0.0f, 1.0f, 0.0f }, view);
+            glm_mat4_mul(projection, view, view_projection);
+            glm_frustum_planes(view_projection, planes);
+            bvh_query_frustum(bvh, planes, mark_hit, &marks);
+        }
+        for (int32_t i = 0; i < object_count; i++) {
+            NaxaBvhNode_t* leaf = &bvh->nodes[objects[i].proxy];
+            int32_t expected;
+            if (kind == 0) {
+                expected = brute_box(leaf->min, leaf->max, min, max);
+            } else if (kind == 1) {
+                expected = brute_sphere(leaf->min, leaf->max, center, BENCH_SPHERE_RADIUS);
+            } else {
+                expected = brute_frustum(leaf->min, leaf->max, planes);
+            }
+            if (reported[i] != expected) {
+                mismatches++;
+            }
+            *results += expected;
+        }
+    }
+    return mismatches;
+}
+
+static void object_box(BenchObject_t* object, vec3 min, vec3 max) {
+    vec3 half = { object->half_size, object->half_size, object->half_size };
+    glm_vec3_sub(object->position, half, min);
+    glm_vec3_add(object->position, half, max);
+}
+
+int32_t benchmark_bvh(int32_t object_count) {
+    if (object_count <= 0) {
+        report_error(NAXA_E_BOUNDS);
+        return NAXA_E_BOUNDS;
+    }
+
+    // Boxes of a few sizes drifting around a cube of a world
+    srand(BENCH_SEED);
+    BenchObject_t* objects = malloc(object_count * sizeof(BenchObject_t));
+    NaxaBvh_t bvh;
+    bvh_init(&bvh, BENCH_MARGIN);
+    double start = now_seconds();
+    for (int32_t i = 0; i < object_count; i++) {
+        BenchObject_t* object = &objects[i];
+        for (int32_t axis = 0; axis < 3; axis++) {
+            object->position[axis] = random_range(0.0f, BENCH_WORLD_SIZE);
+            object->velocity[axis] = random_range(-BENCH_MAX_SPEED, BENCH_MAX_SPEED);
+        }
+        object->half_size = random_range(0.25f, 2.0f);
+        vec3 min;
+        vec3 max;
+        object_box(object, min, max);
+        bvh_insert(&bvh, &object->proxy, min, max, object);
+    }
+    double inserted = now_seconds();
+    bvh_rebuild(&bvh);
+    double rebuilt = now_seconds();
+    internal_logf(NAXA_SEVERITY_INFO, "%d objects: insert %.2f ms, SAH rebuild %.2f ms", object_count,
+        (inserted - start) * 1000.0, (rebuilt - inserted) * 1000.0);
+
+    // Everyone moves every frame, bouncing off the walls of the world
+    double update_seconds = 0.0;
+    for (int32_t frame = 0; frame < BENCH_FRAMES; frame++) {
+        double frame_start = now_seconds();
+        for (int32_t i = 0; i < object_count; i++) {
+            BenchObject_t* object = &objects[i];
+            glm_vec3_muladds(object->velocity, BENCH_FRAME_TIME, object->position);
+            for (int32_t axis = 0; axis < 3; axis++) {
+                if (object->position[axis] < 0.0f || object->position[axis] > BENCH_WORLD_SIZE) {
+                    object->velocity[axis] = -object->velocity[axis];
+                }
+            }
+            vec3 min;
+            vec3 max;
+            object_box(object, min, max);
+            bvh_update(&bvh, object->proxy, min, max);
+        }
+        bvh_flatten(&bvh);
+        update_seconds += now_seconds() - frame_start;
+    }
+    internal_logf(NAXA_SEVERITY_INFO, "Update and flatten %.3f ms per frame (%.1f ns per object)",
+        update_seconds * 1000.0 / BENCH_FRAMES, update_seconds * 1e9 / BENCH_FRAMES / object_count);
+
+    // Box, sphere and frustum queries after all that churn against a scan
+    // of every leaf, a leaf reported twice counts as a mismatch too
+    uint8_t* reported = malloc(object_count);
+    int32_t query_mismatches = 0;
+    int64_t query_results = 0;
+    for (int32_t q = 0; q < BENCH_CHECKED_QUERIES; q++) {
+        query_mismatches += check_queries(&bvh, objects, object_count, reported, &query_results);
+    }
+    free(reported);
+    internal_logf(NAXA_SEVERITY_INFO, "%d box, sphere and frustum queries against a brute force scan, %lld results, %d differ",
+        BENCH_CHECKED_QUERIES, (long long)query_results, query_mismatches);
+
+    // Box queries the size of a small room
+    BenchHits_t hits = { 0, NULL, NAXA_FALSE };
+    start = now_seconds();
+    for (int32_t q = 0; q < BENCH_QUERIES; q++) {
+        vec3 min;
+        vec3 max;
+        for (int32_t axis = 0; axis < 3; axis++) {
+            min[axis] = random_range(0.0f, BENCH_WORLD_SIZE - BENCH_QUERY_SIZE);
+            max[axis] = min[axis] + BENCH_QUERY_SIZE;
+        }
+        bvh_query_box(&bvh, min, max, count_hit, &hits);
+    }
+    double box_seconds = now_seconds() - start;
+    int64_t box_hits = hits.hits;
+
+    // Rays along an axis, the first few start exactly on a face of some
+    // object's box and have to find it. The other components are -0 like a
+    // negated direction has, which divides out to -inf.
+    hits.hits = 0;
+    int32_t missed = 0;
+    start = now_seconds();
+    for (int32_t q = 0; q < BENCH_QUERIES; q++) {
+        BenchObject_t* target = &objects[rand() % object_count];
+        NaxaBvhNode_t* leaf = &bvh.nodes[target->proxy];
+        int32_t axis = q % 3;
+        vec3 origin;
+        vec3 direction = { -0.0f, -0.0f, -0.0f };
+        glm_vec3_copy(target->position, origin);
+        origin[axis] -= BENCH_RAY_LENGTH * 0.5f;
+        origin[(axis + 1) % 3] = leaf->min[(axis + 1) % 3];
+        direction[axis] = 1.0f;
+        hits.wanted = target;
+        hits.found = NAXA_FALSE;
+        bvh_query_ray(&bvh, origin, direction, BENCH_RAY_LENGTH, count_hit, &hits);
+        if (q < BENCH_CHECKED_RAYS && !hits.found) {
+            missed++;
+        }
+    }
+    double ray_seconds = now_seconds() - start;
+    internal_logf(NAXA_SEVERITY_INFO, "%d box queries %.2f us each (%.1f hits), %d rays %.2f us each (%.1f hits)",
+        BENCH_QUERIES, box_seconds * 1e6 / BENCH_QUERIES, (double)box_hits / BENCH_QUERIES,
+        BENCH_QUERIES, ray_seconds * 1e6 / BENCH_QUERIES, (double)hits.hits / BENCH_QUERIES);
+
+    free(objects);
+    bvh_free(&bvh);
+    if (query_mismatches > 0) {
+        internal_logf(NAXA_SEVERITY_ERROR, "%d query results differ from a brute force scan over %d queries of each kind",
+            query_mismatches, BENCH_CHECKED_QUERIES);
+        return NAXA_E_INTERNAL;
+    }
+    if (missed > 0) {
+        internal_logf(NAXA_SEVERITY_ERROR, "%d of %d rays grazing a box missed it", missed, BENCH_CHECKED_RAYS);
+        return NAXA_E_INTERNAL;
+    }
+    return NAXA_E_SUCCESS;
+}
@@ -0,0 +1,59 @@
+#ifndef __checks_h__
+#define __checks_h__
+
+#include <stdint.h>
+
+// Checks and benchmarks the test program runs, they reach into the library
+// through naxa_internal.h and aren't part of libnaxa. All of them return
+// NAXA_E_SUCCESS or an error code, a check that finds a mismatch returns
+// NAXA_E_INTERNAL.
+
+// The SSE and AVX frustum culling kernels against the scalar path, batch
+// sizes that don't fill a vector cover the tails. Needs no window.
+int32_t check_culling();
+
+// Depth pyramid dumps of a fixed occluder scene against the reference PGMs
+// in reference_directory, or overwrite them with write_references. Boxes
+// known to be hidden or in view are tested too. Needs no window.
+int32_t check_occlusion(char* reference_directory, int32_t write_references);
+
+// BC1/BC3/BC5/BC7 encode and decode round trips against a PSNR floor per
+// format. Needs no window.
+int32_t check_texture_codecs();
+
+// Restarts the job system on fibers with thread_count threads and runs a
+// tree of jobs that wait on their children, which have to park and pick
+// back up, then puts the job system back. Needs no window.
+int32_t check_jobs(int32_t thread_count);
+
+// A crossfade, an additive layer and a masked layer of a three joint
+// skeleton evaluated in an arena just big enough, against poses worked out
+// by hand. An arena one pose short has to run out. Needs no window.
+int32_t check_blend_tree();
+
+// Drives texture streaming over a made up request trace with the texture
+// pools kept headless. Promotion, demotion, LRU eviction under the budget
+// and a failed allocation that must not evict anything are checked against
+// residency and the stats. Needs no window.
+int32_t check_streaming();
+
+// Filling the upload ring in place against mip chains built whole, then
+// the decoder thread and the pump over more textures than the ring holds.
+// The ring has to wrap, space may only come back once its fence signals
+// and every frame stops at its byte budget. Writes a scratch image to the
+// working directory. Needs no window.
+int32_t check_uploads();
+
+// Decode throughput of every image and KTX2 file in a directory
+int32_t benchmark_textures(char* directory);
+
+// Sampling and palette times for a crowd on a made up skeleton, alone and
+// on the job threads. Needs no window.
+int32_t benchmark_animation(int32_t character_count, int32_t joint_count);
+
+// Updates and queries on a spatial index of moving boxes. Box, sphere and
+// frustum queries have to match a brute force scan and rays that start on
+// the face of a box have to find it. Needs no window.
+int32_t benchmark_bvh(int32_t object_count);
+
+#endif
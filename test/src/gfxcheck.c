@@ -0,0 +1,354 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <naxa/err.h>
+#include <naxa/gfx.h>
+#include <naxa/log.h>
+#include <naxa/naxa_internal.h>
+
+#include "checks.h"
+
+#define CHECK_SEED 1234
+#define CHECK_CULL_MAX 4099
+#define CHECK_CULL_TIE 1e-3f
+#define CHECK_OCCLUSION_ASPECT 2.0f
+#define CHECK_OCCLUSION_NEAR 5.0f
+#define CHECK_OCCLUSION_FAR 100.0f
+#define CHECK_OCCLUSION_PIXEL_SLACK 2
+#define CHECK_OCCLUSION_EDGE_FRACTION 0.01
+#define CHECK_PATH_LENGTH 256
+#define CHECK_CODEC_WIDTH 70
+#define CHECK_CODEC_HEIGHT 38
+
+static float random_range(float low, float high) {
+    return low + (high - low) * ((float)rand() / (float)RAND_MAX);
+}
+
+// How far the sphere is inside its worst plane, 0 is touching it
+static float cull_margin(vec4 planes[6], float x, float y, float z, float r) {
+    float margin = INFINITY;
+    for (int32_t p = 0; p < 6; p++) {
+        margin = fminf(margin, planes[p][0] * x + planes[p][1] * y + planes[p][2] * z + planes[p][3] + r);
+    }
+    return margin;
+}
+
+int32_t check_culling() {
+    // Counts around the batch size to hit the tail, and a big one
+    static const int32_t COUNTS[] = { 0, 1, 7, 8, 9, 15, 16, 17, 31, 63, 100, 1000, CHECK_CULL_MAX - 3 };
+    float* x = malloc(CHECK_CULL_MAX * sizeof(float));
+    float* y = malloc(CHECK_CULL_MAX * sizeof(float));
+    float* z = malloc(CHECK_CULL_MAX * sizeof(float));
+    float* r = malloc(CHECK_CULL_MAX * sizeof(float));
+    uint8_t* simd_visible = malloc(CHECK_CULL_MAX);
+    uint8_t* scalar_visible = malloc(CHECK_CULL_MAX);
+
+    // A camera a little off the origin, spheres scattered well past every
+    // side of its frustum
+    mat4 projection;
+    mat4 view;
+    mat4 view_projection;
+    vec4 planes[6];
+    glm_perspective(glm_rad(90.0f), 1.5f, 0.1f, 100.0f, projection);
+    glm_translate_make(view, (vec3){ -3.0f, -2.0f, 5.0f });
+    glm_mat4_mul(projection, view, view_projection);
+    glm_frustum_planes(view_projection, planes);
+
+    // Every SIMD kernel this CPU runs, each against the scalar reference
+    static const int32_t KERNELS[] = { CULL_KERNEL_SSE, CULL_KERNEL_AVX };
+    static const char* KERNEL_NAMES[] = { "SSE", "AVX" };
+    int32_t checked = 0;
+    int32_t ties = 0;
+    int32_t mismatches = 0;
+    for (int32_t k = 0; k < sizeof(KERNELS) / sizeof(int32_t); k++) {
+        if (!cull_kernel_supported(KERNELS[k])) {
+            internal_logf(NAXA_SEVERITY_INFO, "Skipping the %s culling kernel, this CPU or build doesn't have it", KERNEL_NAMES[k]);
+            continue;
+        }
+        srand(CHECK_SEED);
+        for (int32_t c = 0; c < sizeof(COUNTS) / sizeof(int32_t); c++) {
+            // Start off the alignment of the arrays too
+            int32_t count = COUNTS[c];
+            int32_t first = c % 3;
+            for (int32_t i = first; i < first + count; i++) {
+                x[i] = random_range(-120.0f, 120.0f);
+                y[i] = random_range(-120.0f, 120.0f);
+                z[i] = random_range(-120.0f, 20.0f);
+                r[i] = random_range(0.01f, 8.0f);
+            }
+            cull_spheres_kernel(KERNELS[k], planes, count, &x[first], &y[first], &z[first], &r[first], &simd_visible[first]);
+            cull_spheres_scalar(planes, count, &x[first], &y[first], &z[first], &r[first], &scalar_visible[first]);
+            for (int32_t i = first; i < first + count; i++) {
+                if (simd_visible[i] == scalar_visible[i]) {
+                    continue;
+                }
+
+                // The two sum the plane distance in a different order, a
+                // sphere touching a plane may round either way
+                if (fabsf(cull_margin(planes, x[i], y[i], z[i], r[i])) < CHECK_CULL_TIE) {
+                    ties++;
+                    continue;
+                }
+                internal_logf(NAXA_SEVERITY_ERROR, "%s culling mismatch at %d of %d: (%f, %f, %f) r %f is %d, scalar says %d",
+                    KERNEL_NAMES[k], i - first, count, x[i], y[i], z[i], r[i], simd_visible[i], scalar_visible[i]);
+                mismatches++;
+            }
+            checked += count;
+        }
+    }
+
+    free(x);
+    free(y);
+    free(z);
+    free(r);
+    free(simd_visible);
+    free(scalar_visible);
+    if (mismatches > 0) {
+        internal_logf(NAXA_SEVERITY_ERROR, "Culling check failed, %d of %d spheres differ", mismatches, checked);
+        return NAXA_E_INTERNAL;
+    }
+    internal_logf(NAXA_SEVERITY_INFO, "Culling check passed, %d spheres agree (%d ties on a plane)", checked, ties);
+    return NAXA_E_SUCCESS;
+}
+
+typedef struct {
+    char* name;
+    vec3 center;
+    float half_size;
+    int32_t visible;
+} OcclusionProbe_t;
+
+static int32_t add_quad(vec3 a, vec3 b, vec3 c, vec3 d, mat4 transform) {
+    vec3 positions[4];
+    uint32_t indices[6] = { 0, 1, 2, 0, 2, 3 };
+    glm_vec3_copy(a, positions[0]);
+    glm_vec3_copy(b, positions[1]);
+    glm_vec3_copy(c, positions[2]);
+    glm_vec3_copy(d, positions[3]);
+    return occlusion_add_occluder(positions, 4, indices, 6, transform);
+}
+
+static int32_t add_cube(mat4 transform) {
+    vec3 positions[8];
+    uint32_t indices[36] = {
+        0, 1, 3, 0, 3, 2, 4, 6, 7, 4, 7, 5,
+        0, 4, 5, 0, 5, 1, 2, 3, 7, 2, 7, 6,
+        0, 2, 6, 0, 6, 4, 1, 5, 7, 1, 7, 3
+    };
+    for (int32_t i = 0; i < 8; i++) {
+        positions[i][0] = (i & 4) ? 1.0f : -1.0f;
+        positions[i][1] = (i & 2) ? 1.0f : -1.0f;
+        positions[i][2] = (i & 1) ? 1.0f : -1.0f;
+    }
+    return occlusion_add_occluder(positions, 8, indices, 36, transform);
+}
+
+static uint8_t* read_pgm(char* path, int32_t* width, int32_t* height) {
+    FILE* fp = fopen(path, "rb");
+    if (fp == NULL) {
+        return NULL;
+    }
+    uint8_t* pixels = NULL;
+    int32_t max_value;
+    if (fscanf(fp, "P5 %d %d %d", width, height, &max_value) == 3 && fgetc(fp) != EOF &&
+        *width > 0 && *height > 0 && max_value == 255) {
+        pixels = malloc((size_t)*width * *height);
+        if (fread(pixels, 1, (size_t)*width * *height, fp) != (size_t)*width * *height) {
+            free(pixels);
+            pixels = NULL;
+        }
+    }
+    fclose(fp);
+    return pixels;
+}
+
+// Pixels off by more than a rounding step, a few along the edges of the
+// occluders can land either side of a pixel center
+static int32_t compare_pgm(char* actual_path, char* reference_path) {
+    int32_t actual_width;
+    int32_t actual_height;
+    int32_t reference_width;
+    int32_t reference_height;
+    uint8_t* actual = read_pgm(actual_path, &actual_width, &actual_height);
+    uint8_t* reference = read_pgm(reference_path, &reference_width, &reference_height);
+    int32_t rc = NAXA_E_SUCCESS;
+    if (actual == NULL || reference == NULL) {
+        internal_logf(NAXA_SEVERITY_ERROR, "Couldn't read %s or %s", actual_path, reference_path);
+        rc = NAXA_E_FILE;
+    } else if (actual_width != reference_width || actual_height != reference_height) {
+        internal_logf(NAXA_SEVERITY_ERROR, "%s is %dx%d, the reference is %dx%d", actual_path,
+            actual_width, actual_height, reference_width, reference_height);
+        rc = NAXA_E_INTERNAL;
+    } else {
+        int32_t pixel_count = actual_width * actual_height;
+        int32_t differing = 0;
+        for (int32_t i = 0; i < pixel_count; i++) {
+            if (abs(actual[i] - reference[i]) > CHECK_OCCLUSION_PIXEL_SLACK) {
+                differing++;
+            }
+        }
+        if (differing > pixel_count * CHECK_OCCLUSION_EDGE_FRACTION) {
+            internal_logf(NAXA_SEVERITY_ERROR, "%s differs from %s in %d of %d pixels", actual_path, reference_path,
+                differing, pixel_count);
+            rc = NAXA_E_INTERNAL;
+        } else {
+            internal_logf(NAXA_SEVERITY_INFO, "%s matches its reference (%d edge pixels differ)", actual_path, differing);
+        }
+    }
+    free(actual);
+    free(reference);
+    return rc;
+}
+
+int32_t check_occlusion(char* reference_directory, int32_t write_references) {
+    static const int32_t LEVELS[] = { 0, 2, 4 };
+    static const OcclusionProbe_t PROBES[] = {
+        { "behind the wall", { -4.0f, 1.0f, -40.0f }, 1.0f, NAXA_FALSE },
+        { "in front of the wall", { -4.0f, 1.0f, -10.0f }, 1.0f, NAXA_TRUE },
+        { "under the floor", { 0.0f, -10.0f, -30.0f }, 1.0f, NAXA_FALSE },
+        { "above the box", { 30.0f, 25.0f, -40.0f }, 1.0f, NAXA_TRUE },
+        { "behind the box", { 26.0f, 2.0f, -40.0f }, 0.5f, NAXA_FALSE },
+        { "around the camera", { 0.0f, 0.0f, 0.0f }, 1.0f, NAXA_TRUE }
+    };
+    if (reference_directory == NULL) {
+        report_error(NAXA_E_NULLPTR);
+        return NAXA_E_NULLPTR;
+    }
+
+    // The camera sits at the origin looking down -z with the buffer's
+    // aspect. The near plane is far out so the 8 bit dumps keep some depth
+    // contrast. A wall left of center, a floor under everything, a box to
+    // the right and a triangle behind the camera that has to be dropped.
+    mat4 identity;
+    mat4 box_transform;
+    mat4 view_projection;
+    glm_mat4_identity(identity);
+    occlusion_clear_occluders();
+    add_quad((vec3){ -10.0f, -4.0f, -20.0f }, (vec3){ 2.0f, -4.0f, -20.0f },
+        (vec3){ 2.0f, 6.0f, -20.0f }, (vec3){ -10.0f, 6.0f, -20.0f }, identity);
+    add_quad((vec3){ -50.0f, -3.0f, -6.0f }, (vec3){ 50.0f, -3.0f, -6.0f },
+        (vec3){ 50.0f, -3.0f, -80.0f }, (vec3){ -50.0f, -3.0f, -80.0f }, identity);
+    glm_translate_make(box_transform, (vec3){ 10.0f, 1.0f, -15.0f });
+    glm_quat_rotate(box_transform, (versor){ 0.0f, 0.258819f, 0.0f, 0.965926f }, box_transform);
+    glm_scale(box_transform, (vec3){ 3.0f, 3.0f, 3.0f });
+    add_cube(box_transform);
+    vec3 near_triangle[3] = { { -1.0f, 0.0f, 1.0f }, { 1.0f, 0.0f, 1.0f }, { 0.0f, 1.0f, -5.0f } };
+    uint32_t near_indices[3] = { 0, 1, 2 };
+    occlusion_add_occluder(near_triangle, 3, near_indices, 3, identity);
+    glm_perspective(glm_rad(90.0f), CHECK_OCCLUSION_ASPECT, CHECK_OCCLUSION_NEAR, CHECK_OCCLUSION_FAR, view_projection);
+    occlusion_begin_frame(view_projection);
+
+    int32_t rc = NAXA_E_SUCCESS;
+    for (int32_t i = 0; i < sizeof(LEVELS) / sizeof(int32_t); i++) {
+        char actual_path[CHECK_PATH_LENGTH];
+        char reference_path[CHECK_PATH_LENGTH];
+        snprintf(actual_path, sizeof(actual_path), "occlusion_level%d.pgm", LEVELS[i]);
+        snprintf(reference_path, sizeof(reference_path), "%s/occlusion_level%d.pgm", reference_directory, LEVELS[i]);
+        if (write_references) {
+            int32_t dump_rc = occlusion_dump(reference_path, LEVELS[i]);
+            rc = dump_rc != NAXA_E_SUCCESS ? dump_rc : rc;
+            internal_logf(NAXA_SEVERITY_INFO, "Wrote %s", reference_path);
+            continue;
+        }
+        int32_t level_rc = occlusion_dump(actual_path, LEVELS[i]);
+        if (level_rc == NAXA_E_SUCCESS) {
+            level_rc = compare_pgm(actual_path, reference_path);
+        }
+        rc = level_rc != NAXA_E_SUCCESS ? level_rc : rc;
+    }
+
+    for (int32_t i = 0; i < sizeof(PROBES) / sizeof(OcclusionProbe_t); i++) {
+        const OcclusionProbe_t* probe = &PROBES[i];
+        vec3 min = { -probe->half_size, -probe->half_size, -probe->half_size };
+        vec3 max = { probe->half_size, probe->half_size, probe->half_size };
+        mat4 transform;
+        glm_translate_make(transform, (vec3){ probe->center[0], probe->center[1], probe->center[2] });
+        if (occlusion_test_box(min, max, transform) != probe->visible) {
+            internal_logf(NAXA_SEVERITY_ERROR, "The box %s should be %s", probe->name, probe->visible ? "visible" : "hidden");
+            rc = NAXA_E_INTERNAL;
+        }
+    }
+    occlusion_end_frame();
+    occlusion_clear_occluders();
+    if (rc == NAXA_E_SUCCESS) {
+        internal_logs(NAXA_SEVERITY_INFO, "Occlusion check passed");
+    }
+    return rc;
+}
+
+typedef struct {
+    char* name;
+    int32_t format;
+    float min_psnr[2];
+} CodecCase_t;
+
+// A smooth image with a little noise and one with hard edged tiles. Sizes
+// are not multiples of 4 so the partial blocks on the edges are covered.
+// BC1 only keeps 1 bit alpha so it gets an opaque copy.
+static void fill_codec_image(uint8_t* rgba, int32_t width, int32_t height, int32_t image, int32_t opaque) {
+    for (int32_t y = 0; y < height; y++) {
+        for (int32_t x = 0; x < width; x++) {
+            uint8_t* texel = &rgba[(y * width + x) * 4];
+            if (image == 0) {
+                int32_t noise = rand() % 9 - 4;
+                texel[0] = (uint8_t)glm_clamp(x * 255 / width + noise, 0, 255);
+                texel[1] = (uint8_t)glm_clamp(y * 255 / height + noise, 0, 255);
+                texel[2] = (uint8_t)glm_clamp(128 + 100 * sinf(x * 0.2f + y * 0.1f) + noise, 0, 255);
+                texel[3] = opaque ? 255 : (uint8_t)((x + y) * 255 / (width + height));
+            } else {
+                int32_t tile = (x / 6 + y / 5) % 3;
+                texel[0] = tile == 0 ? 230 : 20;
+                texel[1] = tile == 1 ? 200 : 40;
+                texel[2] = tile == 2 ? 250 : 60;
+                texel[3] = opaque ? 255 : (tile == 1 ? 64 : 255);
+            }
+        }
+    }
+}
+
+int32_t check_texture_codecs() {
+    // Floors sit a few dB under what the encoders reach today. Tiles score
+    // low because blocks where three tiles meet can't be fit by two endpoints.
+    static const CodecCase_t CASES[] = {
+        { "BC1", NAXA_TEXTURE_BC1, { 32.0f, 20.0f } },
+        { "BC3", NAXA_TEXTURE_BC3, { 32.0f, 20.0f } },
+        { "BC5", NAXA_TEXTURE_BC5, { 45.0f, 45.0f } },
+        { "BC7", NAXA_TEXTURE_BC7, { 33.0f, 19.0f } },
+    };
+    static const char* IMAGES[] = { "smooth", "tiles" };
+    const int32_t width = CHECK_CODEC_WIDTH;
+    const int32_t height = CHECK_CODEC_HEIGHT;
+    uint8_t* rgba = malloc(width * height * 4);
+    uint8_t* blocks = malloc(texcomp_size(width, height, NAXA_TEXTURE_BC7));
+    int32_t rc = NAXA_E_SUCCESS;
+
+    for (int32_t i = 0; i < sizeof(CASES) / sizeof(CodecCase_t); i++) {
+        const CodecCase_t* codec = &CASES[i];
+        for (int32_t image = 0; image < 2; image++) {
+            srand(CHECK_SEED);
+            fill_codec_image(rgba, width, height, image, codec->format == NAXA_TEXTURE_BC1);
+            int32_t encode_rc = texcomp_encode(blocks, rgba, width, height, codec->format);
+            if (encode_rc != NAXA_E_SUCCESS) {
+                rc = encode_rc;
+                continue;
+            }
+            float psnr = texcomp_psnr(rgba, blocks, width, height, codec->format);
+            if (psnr < codec->min_psnr[image]) {
+                internal_logf(NAXA_SEVERITY_ERROR, "%s round trip of the %s image is %.2f dB, needs %.2f dB",
+                    codec->name, IMAGES[image], psnr, codec->min_psnr[image]);
+                rc = NAXA_E_INTERNAL;
+            } else {
+                internal_logf(NAXA_SEVERITY_INFO, "%s round trip of the %s image is %.2f dB", codec->name, IMAGES[image], psnr);
+            }
+        }
+    }
+
+    free(rgba);
+    free(blocks);
+    if (rc == NAXA_E_SUCCESS) {
+        internal_logs(NAXA_SEVERITY_INFO, "Texture codec check passed");
+    }
+    return rc;
+}
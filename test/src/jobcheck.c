@@ -0,0 +1,145 @@
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <naxa/err.h>
+#include <naxa/log.h>
+#include <naxa/naxa_internal.h>
+
+#include "checks.h"
+
+// A tree of jobs where every inner node submits its children and waits on
+// them, so with fibers the inner nodes park and whoever finishes their last
+// child picks them back up. Nodes are laid out like a heap.
+#define CHECK_FANOUT 6
+#define CHECK_DEPTH 4
+#define CHECK_ROUNDS 8
+#define CHECK_LEAF_WORK 20000
+
+typedef struct {
+    int32_t first_leaf;
+    int64_t* sums;
+    atomic_int migrations;
+    atomic_int clobbered;
+} JobCheck_t;
+
+static double now_seconds() {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Something that takes a while and can't be skipped
+static int64_t leaf_value(int32_t node) {
+    uint32_t random = 0x9E3779B9u * (node + 1);
+    int64_t sum = 0;
+    for (int32_t i = 0; i < CHECK_LEAF_WORK; i++) {
+        random ^= random << 13;
+        random ^= random >> 17;
+        random ^= random << 5;
+        sum += random & 0xFF;
+    }
+    return sum;
+}
+
+static void check_node(void* data, int32_t first, int32_t last) {
+    JobCheck_t* check = data;
+    for (int32_t node = first; node < last; node++) {
+        if (node >= check->first_leaf) {
+            check->sums[node] = leaf_value(node);
+            continue;
+        }
+
+        // The counter and everything else on this stack has to come back
+        // intact, whichever thread resumes us
+        NaxaJobCounter_t counter;
+        atomic_init(&counter, 0);
+        int32_t child = node * CHECK_FANOUT + 1;
+        volatile int32_t marker = node ^ 0x5A5A5A5A;
+        for (int32_t i = 0; i < CHECK_FANOUT; i++) {
+            job_submit(check_node, data, child + i, child + i + 1, &counter);
+        }
+        int32_t before = job_thread_current();
+        job_wait(&counter);
+        if (job_thread_current() != before) {
+            atomic_fetch_add(&check->migrations, 1);
+        }
+        if (marker != (node ^ 0x5A5A5A5A)) {
+            atomic_fetch_add(&check->clobbered, 1);
+        }
+        int64_t sum = 0;
+        for (int32_t i = 0; i < CHECK_FANOUT; i++) {
+            sum += check->sums[child + i];
+        }
+        check->sums[node] = sum;
+    }
+}
+
+int32_t check_jobs(int32_t thread_count) {
+    if (thread_count <= 0) {
+        report_error(NAXA_E_BOUNDS);
+        return NAXA_E_BOUNDS;
+    }
+
+    // Nodes above the leaves, then the leaves
+    int32_t node_count = 1;
+    int32_t level_count = 1;
+    for (int32_t depth = 0; depth < CHECK_DEPTH; depth++) {
+        level_count *= CHECK_FANOUT;
+        node_count += level_count;
+    }
+    JobCheck_t check;
+    check.first_leaf = node_count - level_count;
+    check.sums = malloc(node_count * sizeof(int64_t));
+    int64_t expected = 0;
+    for (int32_t node = check.first_leaf; node < node_count; node++) {
+        expected += leaf_value(node);
+    }
+
+    // Swap in a job system with fibers for the check and put back whatever
+    // was running before
+    int32_t fibers_before = (naxa_globals.flags1 & GLOBAL_FLAGS1_JOB_FIBERS) != 0;
+    int32_t threads_before = job_thread_count();
+    teardown_jobs();
+    int32_t rc = init_jobs(thread_count, NAXA_TRUE);
+    if (rc != NAXA_E_SUCCESS) {
+        free(check.sums);
+        init_jobs(threads_before, fibers_before);
+        return rc;
+    }
+
+    int32_t wrong = 0;
+    atomic_init(&check.migrations, 0);
+    atomic_init(&check.clobbered, 0);
+    double start = now_seconds();
+    for (int32_t round = 0; round < CHECK_ROUNDS; round++) {
+        memset(check.sums, 0, node_count * sizeof(int64_t));
+        NaxaJobCounter_t counter;
+        atomic_init(&counter, 0);
+        job_submit(check_node, &check, 0, 1, &counter);
+        job_wait(&counter);
+        wrong += check.sums[0] != expected;
+    }
+    double elapsed = now_seconds() - start;
+    int32_t parks = job_park_count();
+    int32_t migrations = atomic_load(&check.migrations);
+    int32_t clobbered = atomic_load(&check.clobbered);
+    int32_t threads = job_thread_count();
+    internal_logf(NAXA_SEVERITY_INFO, "Jobs: %d rounds of %d nodes on %d threads in %.2f ms, %d parks, %d resumed on another thread",
+        CHECK_ROUNDS, node_count, threads, elapsed * 1000.0, parks, migrations);
+
+    teardown_jobs();
+    free(check.sums);
+    init_jobs(threads_before, fibers_before);
+
+    if (wrong > 0 || clobbered > 0) {
+        internal_logf(NAXA_SEVERITY_ERROR, "Job check failed, %d rounds summed wrong and %d stacks came back changed", wrong, clobbered);
+        return NAXA_E_INTERNAL;
+    }
+    if (parks == 0 || (threads > 1 && migrations == 0)) {
+        internal_logs(NAXA_SEVERITY_ERROR, "Job check failed, waiting jobs never parked and moved threads");
+        return NAXA_E_INTERNAL;
+    }
+    internal_logs(NAXA_SEVERITY_INFO, "Job check passed");
+    return NAXA_E_SUCCESS;
+}
@@ -1,7 +1,55 @@
+#include <string.h>
+
+#include <naxa/gfx.h>
 #include <naxa/naxa.h>
 
+#include "checks.h"
+
+// Modes that only check or time CPU code and never open a window
+static int32_t headless_mode(int argc, char** argv) {
+    static const char* MODES[] = { "animbench", "cullcheck", "bvhbench", "occlusioncheck", "codeccheck", "jobcheck", "blendcheck", "streamcheck", "uploadcheck" };
+    for (int32_t i = 0; argc >= 2 && i < sizeof(MODES) / sizeof(char*); i++) {
+        if (strcmp(argv[1], MODES[i]) == 0) {
+            return NAXA_TRUE;
+        }
+    }
+    return NAXA_FALSE;
+}
+
 int main(int argc, char** argv) {
-    naxa_init();
-    naxa_run();
+    int32_t rc = NAXA_E_SUCCESS;
+    if (headless_mode(argc, argv)) {
+        rc = naxa_init_headless();
+    } else {
+        rc = naxa_init();
+    }
+    if (rc != NAXA_E_SUCCESS) {
+        return 1;
+    }
+    if (argc == 3 && strcmp(argv[1], "bench") == 0) {
+        rc = benchmark_textures(argv[2]);
+    } else if (argc == 2 && strcmp(argv[1], "animbench") == 0) {
+        rc = benchmark_animation(1000, 150);
+    } else if (argc == 2 && strcmp(argv[1], "cullcheck") == 0) {
+        rc = check_culling();
+    } else if (argc == 2 && strcmp(argv[1], "bvhbench") == 0) {
+        rc = benchmark_bvh(100000);
+    } else if (argc >= 2 && strcmp(argv[1], "occlusioncheck") == 0) {
+        // "occlusioncheck write" refreshes the references after a deliberate change
+        rc = check_occlusion("res/occlusion", argc == 3 && strcmp(argv[2], "write") == 0);
+    } else if (argc == 2 && strcmp(argv[1], "codeccheck") == 0) {
+        rc = check_texture_codecs();
+    } else if (argc == 2 && strcmp(argv[1], "jobcheck") == 0) {
+        rc = check_jobs(4);
+    } else if (argc == 2 && strcmp(argv[1], "blendcheck") == 0) {
+        rc = check_blend_tree();
+    } else if (argc == 2 && strcmp(argv[1], "streamcheck") == 0) {
+        rc = check_streaming();
+    } else if (argc == 2 && strcmp(argv[1], "uploadcheck") == 0) {
+        rc = check_uploads();
+    } else {
+        rc = naxa_run();
+    }
     naxa_teardown();
-}
\ No newline at end of file
+    return rc == NAXA_E_SUCCESS ? 0 : 1;
+}
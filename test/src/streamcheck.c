@@ -0,0 +1,196 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <naxa/err.h>
+#include <naxa/gfx.h>
+#include <naxa/log.h>
+#include <naxa/naxa_internal.h>
+
+#include "checks.h"
+
+// Four 256x256 RGBA8 textures that start out at their 64x64 level, plus
+// small fillers to use up every pool left for the allocation failure case
+#define CHECK_TEXTURES 4
+#define CHECK_TEXTURE_SIZE 256
+#define CHECK_FILLERS (NAXA_TEXTURE_POOL_COUNT - 2)
+#define CHECK_FILLER_WIDTH 64
+#define CHECK_LARGE_BUDGET (1024 * 1024 * 1024)
+
+enum { TEXTURE_A, TEXTURE_B, TEXTURE_C, TEXTURE_D };
+
+// Set up and register a texture the way the loader does, at its initial
+// level and with the upload already landed
+static int32_t add_texture(NaxaTexture_t* texture, char* path, int32_t width, int32_t height) {
+    memset(texture, 0, sizeof(NaxaTexture_t));
+    int32_t size = width > height ? width : height;
+    texture->path = path;
+    texture->width = width;
+    texture->height = height;
+    texture->level_count = (int32_t)log2f(size) + 1;
+    texture->format = NAXA_TEXTURE_RGBA8;
+    texture->internal_format = GL_RGBA8;
+    texture->stream_index = -1;
+    texture->refs = 1;
+    int32_t level = stream_initial_level(width, height, texture->level_count);
+    texture->resident_level = level;
+    texture->floor_level = level;
+    int32_t rc = texpool_allocate(texture, texture->internal_format, width >> level > 0 ? width >> level : 1,
+        height >> level > 0 ? height >> level : 1, texture->level_count - level);
+    if (rc != NAXA_E_SUCCESS) {
+        return rc;
+    }
+    return stream_register(texture);
+}
+
+static int32_t expect_levels(char* step, NaxaTexture_t* textures, int32_t a, int32_t b, int32_t c, int32_t d) {
+    int32_t expected[CHECK_TEXTURES] = { a, b, c, d };
+    int32_t failures = 0;
+    for (int32_t i = 0; i < CHECK_TEXTURES; i++) {
+        if (textures[i].resident_level != expected[i]) {
+            internal_logf(NAXA_SEVERITY_ERROR, "%s: %s is at level %d, expected %d", step, textures[i].path,
+                textures[i].resident_level, expected[i]);
+            failures++;
+        }
+    }
+    return failures;
+}
+
+// Promotions and evictions since the check started, and the budget holds
+static int32_t expect_counts(char* step, NaxaTextureStats_t* start, int64_t promotions, int64_t evictions) {
+    NaxaTextureStats_t stats;
+    naxa_get_texture_stats(&stats);
+    int32_t failures = 0;
+    if (stats.promotions - start->promotions != promotions || stats.evictions - start->evictions != evictions) {
+        internal_logf(NAXA_SEVERITY_ERROR, "%s: %lld promotions and %lld evictions, expected %lld and %lld", step,
+            (long long)(stats.promotions - start->promotions), (long long)(stats.evictions - start->evictions),
+            (long long)promotions, (long long)evictions);
+        failures++;
+    }
+    if (stats.resident_bytes > stats.budget_bytes) {
+        internal_logf(NAXA_SEVERITY_ERROR, "%s: %lld bytes resident over a budget of %lld", step,
+            (long long)stats.resident_bytes, (long long)stats.budget_bytes);
+        failures++;
+    }
+    return failures;
+}
+
+static int64_t resident_now() {
+    NaxaTextureStats_t stats;
+    naxa_get_texture_stats(&stats);
+    return stats.resident_bytes;
+}
+
+// The request trace, returns how many expectations it missed. Fillers set
+// up so far are counted in filler_count either way.
+static int32_t run_trace(NaxaTexture_t* textures, NaxaTexture_t* fillers, int32_t* filler_count, NaxaTextureStats_t* start) {
+    int32_t failures = 0;
+    int64_t floors = resident_now();
+    int32_t floor = textures[TEXTURE_A].floor_level;
+
+    // Plenty of room, a is drawn at full size and c a frame later at half
+    naxa_set_texture_budget(CHECK_LARGE_BUDGET);
+    stream_request(&textures[TEXTURE_A], CHECK_TEXTURE_SIZE);
+    stream_update();
+    stream_request(&textures[TEXTURE_C], CHECK_TEXTURE_SIZE / 2);
+    stream_update();
+    failures += expect_levels("Promotion", textures, 0, floor, 1, floor);
+    failures += expect_counts("Promotion", start, 2, 0);
+
+    // No room to spare and b wants half size. a was drawn longest ago so
+    // it goes down a level, c stays.
+    naxa_set_texture_budget(resident_now());
+    stream_request(&textures[TEXTURE_B], CHECK_TEXTURE_SIZE / 2);
+    stream_update();
+    failures += expect_levels("LRU eviction", textures, 1, 1, 1, floor);
+    failures += expect_counts("LRU eviction", start, 3, 1);
+
+    // Budget down to the floors with nothing drawn, everyone settles back
+    naxa_set_texture_budget(floors);
+    stream_update();
+    failures += expect_levels("Demotion", textures, floor, floor, floor, floor);
+    failures += expect_counts("Demotion", start, 3, 4);
+    if (resident_now() != floors) {
+        internal_logf(NAXA_SEVERITY_ERROR, "Demotion: %lld bytes resident, expected the floors' %lld", (long long)resident_now(), (long long)floors);
+        failures++;
+    }
+
+    // d is on screen but there is nothing to take the room from
+    stream_request(&textures[TEXTURE_D], CHECK_TEXTURE_SIZE);
+    stream_update();
+    failures += expect_levels("Full budget", textures, floor, floor, floor, floor);
+    failures += expect_counts("Full budget", start, 3, 4);
+
+    // c goes back up, then fillers take every pool left so a's full size
+    // has nowhere to go. Making room first would have demoted c for
+    // nothing, instead a is capped a level down and nothing moves.
+    naxa_set_texture_budget(CHECK_LARGE_BUDGET);
+    stream_request(&textures[TEXTURE_C], CHECK_TEXTURE_SIZE / 2);
+    stream_update();
+    for (; *filler_count < CHECK_FILLERS; (*filler_count)++) {
+        if (add_texture(&fillers[*filler_count], "filler", CHECK_FILLER_WIDTH, *filler_count + 1) != NAXA_E_SUCCESS) {
+            internal_logf(NAXA_SEVERITY_ERROR, "Couldn't set up filler %d", *filler_count);
+            return failures + 1;
+        }
+    }
+    // Just enough budget for a at full size once c is back at its floor
+    NaxaTexture_t* a = &textures[TEXTURE_A];
+    NaxaTexture_t* c = &textures[TEXTURE_C];
+    naxa_set_texture_budget(resident_now() + stream_chain_size(a, 0) - stream_chain_size(a, a->floor_level) -
+        (stream_chain_size(c, c->resident_level) - stream_chain_size(c, c->floor_level)));
+    internal_logs(NAXA_SEVERITY_INFO, "Every texture pool is taken, the next allocation should fail");
+    stream_request(&textures[TEXTURE_A], CHECK_TEXTURE_SIZE);
+    stream_update();
+    failures += expect_levels("Allocation failure", textures, floor, floor, 1, floor);
+    failures += expect_counts("Allocation failure", start, 4, 4);
+    if (a->ceiling_level != 1) {
+        internal_logf(NAXA_SEVERITY_ERROR, "Allocation failure: a is capped at level %d, expected 1", a->ceiling_level);
+        failures++;
+    }
+
+    // Asked again with no room to spare, a gets the level it is capped at
+    // and c makes room for it
+    naxa_set_texture_budget(resident_now());
+    stream_request(&textures[TEXTURE_A], CHECK_TEXTURE_SIZE);
+    stream_update();
+    failures += expect_levels("Capped promotion", textures, 1, floor, floor, floor);
+    failures += expect_counts("Capped promotion", start, 5, 5);
+    return failures;
+}
+
+int32_t check_streaming() {
+    static char* NAMES[CHECK_TEXTURES] = { "a", "b", "c", "d" };
+    NaxaTexture_t textures[CHECK_TEXTURES];
+    NaxaTexture_t fillers[CHECK_FILLERS];
+    NaxaTextureStats_t start;
+    naxa_get_texture_stats(&start);
+    int32_t failures = 0;
+    int32_t texture_count = 0;
+    int32_t filler_count = 0;
+    while (texture_count < CHECK_TEXTURES &&
+        add_texture(&textures[texture_count], NAMES[texture_count], CHECK_TEXTURE_SIZE, CHECK_TEXTURE_SIZE) == NAXA_E_SUCCESS) {
+        texture_count++;
+    }
+    if (texture_count < CHECK_TEXTURES) {
+        internal_logf(NAXA_SEVERITY_ERROR, "Couldn't set up texture %s", NAMES[texture_count]);
+        failures++;
+    } else {
+        failures += run_trace(textures, fillers, &filler_count, &start);
+    }
+
+    for (int32_t i = 0; i < texture_count; i++) {
+        stream_unregister(&textures[i]);
+        texpool_release(&textures[i]);
+    }
+    for (int32_t i = 0; i < filler_count; i++) {
+        stream_unregister(&fillers[i]);
+        texpool_release(&fillers[i]);
+    }
+    naxa_set_texture_budget(start.budget_bytes);
+    if (failures > 0) {
+        internal_logf(NAXA_SEVERITY_ERROR, "Streaming check failed, %d problems", failures);
+        return NAXA_E_INTERNAL;
+    }
+    internal_logs(NAXA_SEVERITY_INFO, "Streaming check passed");
+    return NAXA_E_SUCCESS;
+}
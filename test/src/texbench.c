@@ -0,0 +1,127 @@
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#include <stb/stb_image.h>
+
+#include <naxa/err.h>
+#include <naxa/gfx.h>
+#include <naxa/log.h>
+#include <naxa/naxa_internal.h>
+
+#include "checks.h"
+
+#define MEGABYTE (1024.0 * 1024.0)
+
+typedef struct {
+    int32_t files;
+    double file_bytes;
+    double out_bytes;
+    double seconds;
+} BenchTotal_t;
+
+static double now_seconds() {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void add_total(BenchTotal_t* total, double file_bytes, double out_bytes, double seconds) {
+    total->files++;
+    total->file_bytes += file_bytes;
+    total->out_bytes += out_bytes;
+    total->seconds += seconds;
+}
+
+static void log_total(char* name, BenchTotal_t* total) {
+    if (total->files == 0 || total->seconds <= 0.0) {
+        return;
+    }
+    internal_logf(NAXA_SEVERITY_INFO, "%s: %d files, %.1f MB/s read, %.1f MB/s texture data", name, total->files,
+        total->file_bytes / MEGABYTE / total->seconds, total->out_bytes / MEGABYTE / total->seconds);
+}
+
+// Same work the decoder thread does before mip filtering
+static int32_t bench_image(BenchTotal_t* total, char* path, double file_bytes) {
+    int32_t width;
+    int32_t height;
+    int32_t channels;
+    double start = now_seconds();
+    uint8_t* pixels = stbi_load(path, &width, &height, &channels, 0);
+    if (pixels == NULL) {
+        return NAXA_FALSE;
+    }
+    double decoded = now_seconds();
+    uint8_t* rgba = malloc((size_t)width * height * 4);
+    image_expand_rgba(rgba, pixels, width * height, channels);
+    double end = now_seconds();
+    free(rgba);
+    stbi_image_free(pixels);
+
+    double out_bytes = (double)width * height * 4;
+    internal_logf(NAXA_SEVERITY_INFO, "%s: %dx%d %d channels, decode %.1f MB/s, expand %.1f MB/s", path, width, height,
+        channels, out_bytes / MEGABYTE / (decoded - start), out_bytes / MEGABYTE / (end - decoded));
+    add_total(total, file_bytes, out_bytes, end - start);
+    return NAXA_TRUE;
+}
+
+static int32_t bench_cooked(BenchTotal_t* total, char* path, double file_bytes) {
+    NaxaKtx_t ktx;
+    double start = now_seconds();
+    if (ktx_read(&ktx, path) != NAXA_E_SUCCESS) {
+        return NAXA_FALSE;
+    }
+    double end = now_seconds();
+    double out_bytes = 0.0;
+    for (int32_t level = 0; level < ktx.level_count; level++) {
+        out_bytes += ktx.level_sizes[level];
+    }
+    internal_logf(NAXA_SEVERITY_INFO, "%s: %dx%d cooked format %d, %.1f MB/s", path, ktx.width, ktx.height,
+        ktx.format, out_bytes / MEGABYTE / (end - start));
+    ktx_free(&ktx);
+    add_total(total, file_bytes, out_bytes, end - start);
+    return NAXA_TRUE;
+}
+
+int32_t benchmark_textures(char* directory) {
+    if (directory == NULL) {
+        report_error(NAXA_E_NULLPTR);
+        return NAXA_E_NULLPTR;
+    }
+    DIR* dir = opendir(directory);
+    if (dir == NULL) {
+        report_error(NAXA_E_FILE);
+        return NAXA_E_FILE;
+    }
+    stbi_set_flip_vertically_on_load(1);
+
+    // Images and cooked textures are totalled apart to compare the paths
+    BenchTotal_t images;
+    BenchTotal_t cooked;
+    memset(&images, 0, sizeof(images));
+    memset(&cooked, 0, sizeof(cooked));
+    int32_t directory_len = strlen(directory);
+    struct dirent* entry;
+    while ((entry = readdir(dir))) {
+        int32_t path_len = directory_len + 1 + strlen(entry->d_name);
+        char* path = malloc(path_len + 1);
+        snprintf(path, path_len + 1, "%s/%s", directory, entry->d_name);
+        struct stat info;
+        if (stat(path, &info) != 0 || !S_ISREG(info.st_mode)) {
+            free(path);
+            continue;
+        }
+        int32_t read = ktx_is_ktx(path) ? bench_cooked(&cooked, path, info.st_size) : bench_image(&images, path, info.st_size);
+        if (!read) {
+            internal_logf(NAXA_SEVERITY_WARN, "Skipped %s, not a texture", path);
+        }
+        free(path);
+    }
+    closedir(dir);
+    log_total("Images", &images);
+    log_total("Cooked", &cooked);
+    return NAXA_E_SUCCESS;
+}
@@ -0,0 +1,233 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <threads.h>
+#include <time.h>
+
+#include <naxa/err.h>
+#include <naxa/gfx.h>
+#include <naxa/log.h>
+#include <naxa/naxa_internal.h>
+
+#include "checks.h"
+
+// An odd sized image for the filter so the edges get clamped
+#define CHECK_FILL_WIDTH 45
+#define CHECK_FILL_HEIGHT 30
+
+// One grey image queued over and over, about a dozen of its mip chains
+// fill the ring and three or four of them use up a frame's budget
+#define CHECK_IMAGE_PATH "uploadcheck.pgm"
+#define CHECK_IMAGE_SIZE 1024
+#define CHECK_UPLOADS 16
+#define CHECK_MAX_PUMPS 32
+#define CHECK_SETTLE_SECONDS 10.0
+
+static double now_seconds() {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Filling from every level and channel count against the whole chain
+// built in one piece, in both colour spaces
+static int32_t check_fill() {
+    static const int32_t CHANNELS[] = { 1, 3, 4 };
+    static const int32_t BASE_LEVELS[] = { 0, 1, 3 };
+    int32_t width = CHECK_FILL_WIDTH;
+    int32_t height = CHECK_FILL_HEIGHT;
+    int32_t level_count = mip_level_count(width, height);
+    int32_t chain_size = mip_chain_size(width, height, level_count);
+    uint8_t* source = malloc(width * height * 4);
+    uint8_t* pixels = malloc(width * height * 4);
+    uint8_t* expected = malloc(chain_size);
+    uint8_t* filled = malloc(chain_size);
+    srand(33);
+    for (int32_t i = 0; i < width * height * 4; i++) {
+        source[i] = rand() & 0xFF;
+    }
+
+    int32_t failures = 0;
+    for (int32_t c = 0; c < sizeof(CHANNELS) / sizeof(int32_t); c++) {
+        for (int32_t srgb = 0; srgb <= 1; srgb++) {
+            image_expand_rgba(expected, source, width * height, CHANNELS[c]);
+            mip_build_chain(expected, width, height, level_count, srgb);
+            for (int32_t b = 0; b < sizeof(BASE_LEVELS) / sizeof(int32_t); b++) {
+                int32_t offset = mip_chain_size(width, height, BASE_LEVELS[b]);
+                memcpy(pixels, source, width * height * CHANNELS[c]);
+                memset(filled, 0, chain_size);
+                upload_fill_levels(filled, pixels, CHANNELS[c], width, height, level_count, BASE_LEVELS[b], srgb);
+                if (memcmp(filled, &expected[offset], chain_size - offset) != 0) {
+                    internal_logf(NAXA_SEVERITY_ERROR, "Filling %d channels %s from level %d doesn't match the whole chain",
+                        CHANNELS[c], srgb ? "as sRGB" : "as linear", BASE_LEVELS[b]);
+                    failures++;
+                }
+            }
+        }
+    }
+    free(source);
+    free(pixels);
+    free(expected);
+    free(filled);
+    return failures;
+}
+
+static int32_t write_image(char* path, int32_t size) {
+    FILE* fp = fopen(path, "wb");
+    if (fp == NULL) {
+        report_error(NAXA_E_FILE);
+        return NAXA_E_FILE;
+    }
+    fprintf(fp, "P5\n%d %d\n255\n", size, size);
+    uint8_t* row = malloc(size);
+    for (int32_t y = 0; y < size; y++) {
+        for (int32_t x = 0; x < size; x++) {
+            row[x] = (x ^ y) & 0xFF;
+        }
+        fwrite(row, 1, size, fp);
+    }
+    free(row);
+    fclose(fp);
+    return NAXA_E_SUCCESS;
+}
+
+// Wait for the decoder to run out of work or block on the ring
+static int32_t settle(UploadStats_t* stats) {
+    double start = now_seconds();
+    struct timespec nap = { 0, 1000000 };
+    upload_get_stats(stats);
+    while (stats->pending > 0 && !stats->ring_waiting) {
+        if (now_seconds() - start > CHECK_SETTLE_SECONDS) {
+            internal_logs(NAXA_SEVERITY_ERROR, "The decoder never settled");
+            return NAXA_FALSE;
+        }
+        thrd_sleep(&nap, NULL);
+        upload_get_stats(stats);
+    }
+    return NAXA_TRUE;
+}
+
+// Queue every texture and pump frames until they are all up and the ring
+// is empty again, returns how many expectations it missed
+static int32_t run_uploads(NaxaTexture_t* textures) {
+    int32_t level_count = mip_level_count(CHECK_IMAGE_SIZE, CHECK_IMAGE_SIZE);
+    int32_t chain = mip_chain_size(CHECK_IMAGE_SIZE, CHECK_IMAGE_SIZE, level_count);
+    int32_t capacity = UPLOAD_RING_SIZE / chain;
+    for (int32_t i = 0; i < CHECK_UPLOADS; i++) {
+        memset(&textures[i], 0, sizeof(NaxaTexture_t));
+        textures[i].path = CHECK_IMAGE_PATH;
+        textures[i].width = CHECK_IMAGE_SIZE;
+        textures[i].height = CHECK_IMAGE_SIZE;
+        textures[i].level_count = level_count;
+        textures[i].format = NAXA_TEXTURE_RGBA8;
+        textures[i].internal_format = GL_RGBA8;
+        textures[i].resident_level = level_count - 1;
+        textures[i].stream_index = -1;
+        textures[i].refs = 1;
+        if (upload_queue_texture(&textures[i], textures[i].pool, textures[i].layer, 0) != NAXA_E_SUCCESS) {
+            internal_logf(NAXA_SEVERITY_ERROR, "Couldn't queue upload %d", i);
+            return 1;
+        }
+    }
+
+    // Nothing is pumped yet, so the ring fills up and the decoder waits
+    int32_t failures = 0;
+    UploadStats_t stats;
+    if (!settle(&stats)) {
+        return failures + 1;
+    }
+    if (!stats.ring_waiting || stats.ready != capacity || stats.ring_used != capacity * chain) {
+        internal_logf(NAXA_SEVERITY_ERROR, "Before the first pump %d chains are ready in %d bytes, expected %d in %d and the decoder waiting",
+            stats.ready, stats.ring_used, capacity, capacity * chain);
+        failures++;
+    }
+
+    int32_t issued[CHECK_MAX_PUMPS];
+    int32_t head = stats.ring_head;
+    int32_t wrapped = NAXA_FALSE;
+    int32_t pump = 0;
+    for (; pump < CHECK_MAX_PUMPS && stats.pending + stats.ready + stats.in_flight > 0; pump++) {
+        int32_t ready = stats.ready;
+        int32_t used = stats.ring_used;
+        upload_pump();
+        upload_get_stats(&stats);
+
+        // The last copy has to start inside the budget, and the budget runs
+        // out unless there was too little ready
+        issued[pump] = stats.frame_bytes / chain;
+        if (stats.frame_bytes - chain >= UPLOAD_BYTES_PER_FRAME ||
+            (stats.frame_bytes < UPLOAD_BYTES_PER_FRAME && issued[pump] < ready)) {
+            internal_logf(NAXA_SEVERITY_ERROR, "Pump %d issued %d bytes with %d chains ready and a budget of %d",
+                pump, stats.frame_bytes, ready, UPLOAD_BYTES_PER_FRAME);
+            failures++;
+        }
+
+        // Copies hold on to their ring space until their fence signals
+        int32_t in_flight = 0;
+        for (int32_t i = pump; i >= 0 && i > pump - UPLOAD_HEADLESS_LATENCY; i--) {
+            in_flight += issued[i];
+        }
+        if (stats.in_flight != in_flight) {
+            internal_logf(NAXA_SEVERITY_ERROR, "Pump %d left %d copies in flight, expected %d", pump, stats.in_flight, in_flight);
+            failures++;
+        }
+        if (pump < UPLOAD_HEADLESS_LATENCY && (!stats.ring_waiting || stats.ring_used != used)) {
+            internal_logf(NAXA_SEVERITY_ERROR, "Pump %d gave ring space back before any fence signalled", pump);
+            failures++;
+        }
+        if (!settle(&stats)) {
+            return failures + 1;
+        }
+
+        // Every chain holds its own bytes, plus whatever was skipped at
+        // the end of the ring to wrap around
+        int32_t padding = stats.ring_used - (stats.ready + stats.in_flight) * chain;
+        if (padding < 0 || padding >= chain) {
+            internal_logf(NAXA_SEVERITY_ERROR, "After pump %d the ring holds %d bytes for %d chains", pump, stats.ring_used,
+                stats.ready + stats.in_flight);
+            failures++;
+        }
+        wrapped |= stats.ring_head < head;
+        head = stats.ring_head;
+    }
+
+    if (stats.pending + stats.ready + stats.in_flight > 0 || stats.ring_used != 0) {
+        internal_logf(NAXA_SEVERITY_ERROR, "After %d pumps %d chains still hold %d bytes of the ring", pump,
+            stats.pending + stats.ready + stats.in_flight, stats.ring_used);
+        failures++;
+    }
+    if (!wrapped) {
+        internal_logs(NAXA_SEVERITY_ERROR, "The ring never wrapped around");
+        failures++;
+    }
+    for (int32_t i = 0; i < CHECK_UPLOADS; i++) {
+        if (textures[i].streaming || textures[i].resident_level != 0) {
+            internal_logf(NAXA_SEVERITY_ERROR, "Upload %d never landed", i);
+            failures++;
+        }
+    }
+    return failures;
+}
+
+int32_t check_uploads() {
+    int32_t failures = check_fill();
+    NaxaTexture_t textures[CHECK_UPLOADS];
+    if (write_image(CHECK_IMAGE_PATH, CHECK_IMAGE_SIZE) != NAXA_E_SUCCESS) {
+        internal_logs(NAXA_SEVERITY_ERROR, "Couldn't write " CHECK_IMAGE_PATH);
+        failures++;
+    } else if (init_uploader() != NAXA_E_SUCCESS) {
+        internal_logs(NAXA_SEVERITY_ERROR, "Couldn't start the uploader");
+        failures++;
+    } else {
+        failures += run_uploads(textures);
+        await_upload_thread();
+    }
+    remove(CHECK_IMAGE_PATH);
+
+    if (failures > 0) {
+        internal_logf(NAXA_SEVERITY_ERROR, "Upload check failed, %d problems", failures);
+        return NAXA_E_INTERNAL;
+    }
+    internal_logs(NAXA_SEVERITY_INFO, "Upload check passed");
+    return NAXA_E_SUCCESS;
+}